@@ -49,22 +49,37 @@ bool AbstractAligner::test(bool gaps) const {
 }
 
 void AbstractAligner::align_block(Block* block) const {
+    align_blocks(Blocks(1, block));
+}
+
+void AbstractAligner::align_blocks(const Blocks& blocks) const {
     TimeIncrementer ti(this);
-    if (!alignment_needed(block)) {
-        return;
+    std::vector<Fragments> fragments;
+    std::vector<Strings> batch;
+    BOOST_FOREACH (Block* block, blocks) {
+        if (!alignment_needed(block)) {
+            continue;
+        }
+        fragments.push_back(Fragments(block->begin(), block->end()));
+        batch.push_back(Strings());
+        BOOST_FOREACH (Fragment* f, fragments.back()) {
+            batch.back().push_back(f->str(/* gap */ 0));
+        }
     }
-    Fragments fragments((block->begin()), block->end());
-    Strings rows;
-    BOOST_FOREACH (Fragment* f, fragments) {
-        rows.push_back(f->str(/* gap */ 0));
+    if (batch.empty()) {
+        return;
     }
-    align_seqs(rows);
-    refine_alignment(rows);
-    ASSERT_EQ(rows.size(), fragments.size());
-    for (int i = 0; i < fragments.size(); i++) {
-        AlignmentRow* row = create_row(this);
-        fragments[i]->set_row(row);
-        row->grow(rows[i]);
+    align_seqs_batch(batch);
+    for (int b = 0; b < batch.size(); b++) {
+        Strings& rows = batch[b];
+        const Fragments& ff = fragments[b];
+        refine_alignment(rows);
+        ASSERT_EQ(rows.size(), ff.size());
+        for (int i = 0; i < ff.size(); i++) {
+            AlignmentRow* row = create_row(this);
+            ff[i]->set_row(row);
+            row->grow(rows[i]);
+        }
     }
 }
 
@@ -101,45 +116,86 @@ static void remove_gaps(Strings& seqs) {
     }
 }
 
+typedef std::vector<int> Ints;
+
+// Moves non-empty sequences to non_empty_seqs
+struct SeqsPacking {
+    Ints index_in_seqs_;
+    Ints empty_seqs_;
+
+    void pack(Strings& seqs, Strings& non_empty_seqs) {
+        for (int i = 0; i < seqs.size(); i++) {
+            std::string& seq = seqs[i];
+            if (seq.empty()) {
+                empty_seqs_.push_back(i);
+            } else {
+                index_in_seqs_.push_back(i);
+                non_empty_seqs.push_back(std::string());
+                non_empty_seqs.back().swap(seq);
+            }
+        }
+    }
+
+    void unpack(Strings& seqs, Strings& non_empty_seqs) const {
+        int size_after = non_empty_seqs.size();
+        ASSERT_EQ(size_after, index_in_seqs_.size());
+        int length = non_empty_seqs.front().length();
+        for (int i = 0; i < index_in_seqs_.size(); i++) {
+            int si = index_in_seqs_[i];
+            seqs[si].swap(non_empty_seqs[i]);
+        }
+        BOOST_FOREACH (int i, empty_seqs_) {
+            seqs[i].resize(length, '-');
+        }
+        BOOST_FOREACH (std::string& seq, seqs) {
+            using namespace boost::algorithm;
+            to_upper(seq);
+            ASSERT_EQ(seq.length(), length);
+        }
+        remove_gaps(seqs);
+    }
+};
+
 void AbstractAligner::align_seqs(Strings& seqs) const {
+    std::vector<Strings> batch(1);
+    batch[0].swap(seqs);
+    align_seqs_batch(batch);
+    seqs.swap(batch[0]);
+}
+
+void AbstractAligner::align_seqs_batch(
+    std::vector<Strings>& batch) const {
     TimeIncrementer ti(this);
-    if (seqs.empty()) {
-        return;
+    std::vector<SeqsPacking> packings;
+    std::vector<Strings> non_empty_batch;
+    Ints index_in_batch;
+    for (int b = 0; b < batch.size(); b++) {
+        SeqsPacking packing;
+        Strings non_empty_seqs;
+        packing.pack(batch[b], non_empty_seqs);
+        if (!non_empty_seqs.empty()) {
+            packings.push_back(packing);
+            non_empty_batch.push_back(Strings());
+            non_empty_batch.back().swap(non_empty_seqs);
+            index_in_batch.push_back(b);
+        }
     }
-    typedef std::vector<int> Ints;
-    Ints index_in_seqs, empty_seqs;
-    Strings non_empty_seqs;
-    for (int i = 0; i < seqs.size(); i++) {
-        std::string& seq = seqs[i];
-        if (seq.empty()) {
-            empty_seqs.push_back(i);
-        } else {
-            index_in_seqs.push_back(i);
-            non_empty_seqs.push_back(std::string());
-            non_empty_seqs.back().swap(seq);
-        }
-    }
-    int size_before = non_empty_seqs.size();
-    if (size_before == 0) {
+    if (non_empty_batch.empty()) {
         return;
     }
-    align_seqs_impl(non_empty_seqs);
-    int size_after = non_empty_seqs.size();
-    ASSERT_EQ(size_after, size_before);
-    int length = non_empty_seqs.front().length();
-    for (int i = 0; i < index_in_seqs.size(); i++) {
-        int si = index_in_seqs[i];
-        seqs[si].swap(non_empty_seqs[i]);
-    }
-    BOOST_FOREACH (int i, empty_seqs) {
-        seqs[i].resize(length, '-');
+    align_seqs_batch_impl(non_empty_batch);
+    ASSERT_EQ(non_empty_batch.size(), packings.size());
+    for (int i = 0; i < packings.size(); i++) {
+        Strings& seqs = batch[index_in_batch[i]];
+        packings[i].unpack(seqs, non_empty_batch[i]);
     }
-    BOOST_FOREACH (std::string& seq, seqs) {
-        using namespace boost::algorithm;
-        to_upper(seq);
-        ASSERT_EQ(seq.length(), length);
+}
+
+void AbstractAligner::align_seqs_batch_impl(
+    std::vector<Strings>& batch) const {
+    BOOST_FOREACH (Strings& seqs, batch) {
+        align_seqs_impl(seqs);
     }
-    remove_gaps(seqs);
 }
 
 bool AbstractAligner::alignment_needed(Block* block) const {
@@ -195,9 +251,50 @@ void AbstractAligner::remove_pure_gap_columns(
     }
 }
 
+int AbstractAligner::batch_size() const {
+    return batch_size_impl();
+}
+
+int AbstractAligner::batch_size_impl() const {
+    return 1;
+}
+
+class BatchData : public ThreadData {
+public:
+    Blocks blocks_;
+    int batch_size_;
+};
+
+ThreadData* AbstractAligner::before_thread_impl() const {
+    int size = batch_size();
+    if (size <= 1) {
+        return 0;
+    }
+    BatchData* data = new BatchData;
+    data->batch_size_ = size;
+    return data;
+}
+
 void AbstractAligner::process_block_impl(Block* block,
-        ThreadData*) const {
-    align_block(block);
+        ThreadData* data) const {
+    if (!data) {
+        align_block(block);
+        return;
+    }
+    BatchData* bd = D_CAST<BatchData*>(data);
+    bd->blocks_.push_back(block);
+    if (bd->blocks_.size() >= bd->batch_size_) {
+        align_blocks(bd->blocks_);
+        bd->blocks_.clear();
+    }
+}
+
+void AbstractAligner::finish_thread_impl(ThreadData* data) const {
+    if (data) {
+        BatchData* bd = D_CAST<BatchData*>(data);
+        align_blocks(bd->blocks_);
+        bd->blocks_.clear();
+    }
 }
 
 const char* AbstractAligner::name_impl() const {
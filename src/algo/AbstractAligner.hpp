@@ -17,6 +17,9 @@ namespace npge {
 
 /** Align blocks.
 Skips block, if block's fragment has row.
+
+Each working thread collects up to batch_size() blocks and
+passes them to align_blocks() at once.
 */
 class AbstractAligner : public BlocksJobs {
 public:
@@ -26,9 +29,17 @@ public:
     /** Align a block */
     void align_block(Block* block) const;
 
+    /** Align several blocks at once.
+    Blocks are passed to align_seqs_batch().
+    */
+    void align_blocks(const Blocks& blocks) const;
+
     /** Apply sequences */
     void align_seqs(Strings& seqs) const;
 
+    /** Align several independent sets of sequences */
+    void align_seqs_batch(std::vector<Strings>& batch) const;
+
     /** Return if alignment is needed and build it in obvious cases */
     bool alignment_needed(Block* block) const;
 
@@ -41,10 +52,17 @@ public:
     /** Return aligner type */
     virtual std::string aligner_type() const = 0;
 
+    /** Return max number of blocks aligned at once while running */
+    int batch_size() const;
+
 protected:
     void change_blocks_impl(Blocks& blocks) const;
 
-    void process_block_impl(Block* block, ThreadData*) const;
+    ThreadData* before_thread_impl() const;
+
+    void process_block_impl(Block* block, ThreadData* data) const;
+
+    void finish_thread_impl(ThreadData* data) const;
 
     const char* name_impl() const;
 
@@ -53,6 +71,17 @@ protected:
     Each sequence is guaranteed not to be empty.
     */
     virtual void align_seqs_impl(Strings& seqs) const = 0;
+
+    /** Align several independent sets of sequences.
+    Each set satisfies requirements of align_seqs_impl().
+    Default implementation calls align_seqs_impl() for each set.
+    */
+    virtual void align_seqs_batch_impl(std::vector<Strings>& batch) const;
+
+    /** Return max number of blocks aligned at once.
+    Default implementation returns 1.
+    */
+    virtual int batch_size_impl() const;
 };
 
 }
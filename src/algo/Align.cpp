@@ -14,12 +14,15 @@
 
 namespace npge {
 
+// next iterations process only blocks changed by previous one
+static const char* CHANGED_ONLY = "--changed-only:=1";
+
 class LiteAlignLoop : public Pipe {
 public:
     LiteAlignLoop() {
         set_max_iterations(-1);
-        add(new MoveGaps);
-        add(new CutGaps);
+        add(new MoveGaps, CHANGED_ONLY);
+        add(new CutGaps, CHANGED_ONLY);
     }
 };
 
@@ -37,9 +40,9 @@ class AlignLoop : public Pipe {
 public:
     AlignLoop() {
         set_max_iterations(-1);
-        add(new MoveGaps);
-        add(new CutGaps);
-        add(new Filter);
+        add(new MoveGaps, CHANGED_ONLY);
+        add(new CutGaps, CHANGED_ONLY);
+        add(new Filter, CHANGED_ONLY);
     }
 };
 
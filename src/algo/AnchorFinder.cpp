@@ -7,19 +7,26 @@
 
 #include <map>
 #include "boost-xtime.hpp"
+#include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <boost/tuple/tuple_comparison.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/bind.hpp>
 
 #include "AnchorFinder.hpp"
 #include "SeqI.hpp"
+#include "KmerScanner.hpp"
 #include "Block.hpp"
 #include "BlockSet.hpp"
-#include "BloomFilter.hpp"
+#include "BlockedBloomFilter.hpp"
+#include "KmerIndex.hpp"
 #include "Exception.hpp"
 #include "thread_pool.hpp"
 #include "throw_assert.hpp"
 #include "SortedVector.hpp"
+#include "make_hash.hpp"
+#include "atomic.hpp"
 #include "boundaries.hpp"
 #include "cast.hpp"
 
@@ -34,6 +41,21 @@ struct AnchorFinderImpl {
 struct AnchorFinder::Impl : public AnchorFinderImpl {
 };
 
+static bool check_anchor_engine(const AnchorFinder* p,
+                                std::string& message) {
+    std::string engine = p->opt_value("anchor-engine").as<std::string>();
+    if (engine != "bloom" && engine != "hash" && engine != "index") {
+        message = "anchor-engine must be 'bloom', 'hash' or 'index'";
+        return false;
+    }
+    if (engine == "index" &&
+            p->opt_value("anchor-index").as<std::string>().empty()) {
+        message = "anchor-engine=index requires anchor-index";
+        return false;
+    }
+    return true;
+}
+
 AnchorFinder::AnchorFinder():
     impl_(new Impl) {
     add_gopt("anchor-size", "anchor size", "ANCHOR_SIZE");
@@ -46,6 +68,17 @@ AnchorFinder::AnchorFinder():
     add_gopt("max-anchor-fragments",
              "Maximum number of anchors fragments to return",
              "MAX_ANCHOR_FRAGMENTS");
+    add_gopt("anchor-engine",
+             "Way of finding anchors: 'bloom' (two passes "
+             "with Bloom filter, low memory), 'hash' "
+             "(one pass with hash table of all k-mers, faster) "
+             "or 'index' (sorted k-mers of sequences are stored "
+             "in anchor-index and reused by next runs)",
+             "ANCHOR_ENGINE");
+    add_gopt("anchor-index",
+             "File of persistent k-mer index (anchor-engine=index)",
+             "ANCHOR_INDEX");
+    add_opt_check(boost::bind(check_anchor_engine, this, _1));
     add_opt_rule("anchor-size > 0");
     int max_anchor_size = sizeof(hash_t) * 8 / 2;
     add_opt_rule("anchor-size <= " + TO_S(MAX_ANCHOR_SIZE));
@@ -100,7 +133,7 @@ class BloomTG : public ReusingThreadGroup,
     public AnchorFinderOptions {
 public:
     const Hashes& used_;
-    BloomFilter bloom_;
+    BlockedBloomFilter bloom_;
     Hashes hashes_; // output
     size_t length_sum_;
 
@@ -109,6 +142,7 @@ public:
         AnchorFinderOptions(finder),
         used_(used_hashes) {
         set_workers(finder->workers());
+        make_parts(workers());
         initialize_bloom();
     }
 
@@ -127,7 +161,6 @@ public:
             }
         }
         bloom_.set_members(length_sum_, error_prob_);
-        bloom_.set_optimal_hashes(length_sum_);
     }
 
     ThreadTask* create_task_impl(ThreadWorker* worker);
@@ -149,17 +182,22 @@ public:
     }
 };
 
-class BloomTask : public ThreadTask, public SeqI {
+class BloomTask : public ThreadTask {
 public:
+    SeqPart part_;
+    Sequence* seq_;
+    int anchor_;
     const Hashes& used_;
-    BloomFilter& bloom_;
+    BlockedBloomFilter& bloom_;
     Hashes& hashes_;
     bool prev_;
     bool similar_;
 
-    BloomTask(Sequence* seq, ThreadWorker* w):
+    BloomTask(const SeqPart& part, ThreadWorker* w):
         ThreadTask(w),
-        SeqI(seq, D_CAST<BloomTG*>(thread_group())),
+        part_(part),
+        seq_(part.seq_),
+        anchor_(D_CAST<BloomTG*>(thread_group())->anchor_),
         used_(D_CAST<BloomTG*>(thread_group())->used_),
         bloom_(D_CAST<BloomTG*>(thread_group())->bloom_),
         hashes_(D_CAST<BloomWorker*>(worker())->hashes_),
@@ -167,10 +205,10 @@ public:
         similar_(D_CAST<BloomTG*>(thread_group())->similar_) {
     }
 
-    void test_and_add() {
+    void test_and_add(const KmerScanner& scanner, int i) {
         bool hash_found = false;
-        if (ns_ == 0) {
-            hash_t hash = std::min(dir_, rev_);
+        if (!scanner.has_n(i)) {
+            hash_t hash = scanner.hash(i);
             if (!used_.has_elem(hash)) {
                 hash_found = bloom_.test_and_add(hash);
                 if (hash_found && (!prev_ || !similar_)) {
@@ -182,25 +220,22 @@ public:
     }
 
     void run_impl() {
-        if (seq_->size() < anchor_) {
-            return;
-        }
-        init_state();
         prev_ = false;
-        test_and_add();
-        size_t n = seq_->size() - anchor_;
-        for (size_t i = 0; i < n; i++) {
-            next_hash();
-            test_and_add();
+        KmerScanner scanner(seq_, anchor_, part_.begin_, part_.end_);
+        while (scanner.next_chunk()) {
+            int size = scanner.size();
+            for (int i = 0; i < size; i++) {
+                test_and_add(scanner, i);
+            }
         }
     }
 };
 
 ThreadTask* BloomTG::create_task_impl(ThreadWorker* worker) {
-    if (it_ != end_) {
-        Sequence* seq = *it_;
-        it_++;
-        return new BloomTask(seq, worker);
+    if (part_it_ != parts_end_) {
+        const SeqPart& part = *part_it_;
+        part_it_++;
+        return new BloomTask(part, worker);
     } else {
         return 0;
     }
@@ -259,6 +294,7 @@ public:
         AnchorFinderOptions(finder),
         hashes_(hashes) {
         set_workers(finder->workers());
+        make_parts(workers());
     }
 
     ThreadTask* create_task_impl(ThreadWorker* worker);
@@ -280,56 +316,56 @@ public:
     }
 };
 
-class FragmentTask : public ThreadTask, public SeqI {
+class FragmentTask : public ThreadTask {
 public:
+    SeqPart part_;
+    Sequence* seq_;
+    int anchor_;
     const Hashes& hashes_; // input
     FFs& ffs_; // output
 
-    FragmentTask(Sequence* seq, ThreadWorker* w):
+    FragmentTask(const SeqPart& part, ThreadWorker* w):
         ThreadTask(w),
-        SeqI(seq, D_CAST<FragmentTG*>(thread_group())),
+        part_(part),
+        seq_(part.seq_),
+        anchor_(D_CAST<FragmentTG*>(thread_group())->anchor_),
         hashes_(D_CAST<FragmentTG*>(thread_group())->hashes_),
         ffs_(D_CAST<FragmentWorker*>(worker())->ffs_) {
     }
 
-    void push(hash_t hash, bool direct) {
-        size_t pos = pos_;
+    void push(hash_t hash, size_t pos, bool direct) {
         if (direct == false) {
             pos += seq_->size();
         }
         ffs_.push_back(FoundFragment(hash, seq_, pos));
     }
 
-    void test_and_push() {
-        if (ns_ == 0) {
-            hash_t hash = std::min(dir_, rev_);
+    void test_and_push(const KmerScanner& scanner, int i) {
+        if (!scanner.has_n(i)) {
+            hash_t hash = scanner.hash(i);
             bool hash_found = hashes_.has_elem(hash);
             if (hash_found) {
-                bool direct = (hash == dir_);
-                push(hash, direct);
+                push(hash, scanner.pos(i), scanner.direct(i));
             }
         }
     }
 
     void run_impl() {
-        if (seq_->size() < anchor_) {
-            return;
-        }
-        init_state();
-        test_and_push();
-        size_t n = seq_->size() - anchor_;
-        for (size_t i = 0; i < n; i++) {
-            next_hash();
-            test_and_push();
+        KmerScanner scanner(seq_, anchor_, part_.begin_, part_.end_);
+        while (scanner.next_chunk()) {
+            int size = scanner.size();
+            for (int i = 0; i < size; i++) {
+                test_and_push(scanner, i);
+            }
         }
     }
 };
 
 ThreadTask* FragmentTG::create_task_impl(ThreadWorker* worker) {
-    if (it_ != end_) {
-        Sequence* seq = *it_;
-        it_++;
-        return new FragmentTask(seq, worker);
+    if (part_it_ != parts_end_) {
+        const SeqPart& part = *part_it_;
+        part_it_++;
+        return new FragmentTask(part, worker);
     } else {
         return 0;
     }
@@ -390,7 +426,619 @@ static void fragmenttg_postprocess(FragmentTG& tg,
     }
 }
 
+// single pass: sharded hash table of all k-mers
+
+const int SHARDS_BITS = 8;
+const int SHARDS = 1 << SHARDS_BITS;
+const int OUTBOX_SIZE = 1024;
+
+static int shard_of(hash_t hash) {
+    return mix_hash(hash) >> (sizeof(hash_t) * 8 - SHARDS_BITS);
+}
+
+struct Occurrence {
+    hash_t hash_;
+    pos_t pos_; // min_pos
+    int seq_ : 30; // index in SeqBase::seqs_
+    unsigned direct_ : 1;
+    unsigned repeated_ : 1; // used in KmerShard
+
+    Occurrence() {
+    }
+
+    Occurrence(hash_t hash, int seq, pos_t pos, bool direct):
+        hash_(hash), pos_(pos), seq_(seq),
+        direct_(direct), repeated_(false) {
+    }
+
+    bool operator<(const Occurrence& o) const {
+        typedef boost::tuple<hash_t, int, pos_t, bool> Tie;
+        return Tie(hash_, seq_, pos_, direct_) <
+               Tie(o.hash_, o.seq_, o.pos_, o.direct_);
+    }
+};
+
+typedef std::vector<Occurrence> Occurrences;
+
+/** Part of counting hash table with open addressing.
+First occurrence of k-mer is stored in the table.
+All occurrences of repeated k-mers are stored in repeats_.
+*/
+class KmerShard {
+public:
+    boost::mutex mutex_;
+    Occurrences table_; // pos_ = -1 means empty cell
+    size_t occupied_;
+    Occurrences repeats_;
+
+    KmerShard():
+        occupied_(0) {
+    }
+
+    // under mutex_
+    void add(const Occurrence& o) {
+        if ((occupied_ + 1) * 2 > table_.size()) {
+            rehash();
+        }
+        Occurrence& cell = find_cell(table_, o.hash_);
+        if (cell.pos_ == -1) {
+            cell = o;
+            occupied_ += 1;
+        } else {
+            if (!cell.repeated_) {
+                cell.repeated_ = true;
+                repeats_.push_back(cell);
+            }
+            repeats_.push_back(o);
+        }
+    }
+
+    void clear_table() {
+        Occurrences().swap(table_);
+        occupied_ = 0;
+    }
+
+private:
+    static Occurrence& find_cell(Occurrences& table, hash_t hash) {
+        size_t mask = table.size() - 1;
+        size_t index = mix_hash(hash) & mask;
+        while (table[index].pos_ != -1 &&
+                table[index].hash_ != hash) {
+            index = (index + 1) & mask;
+        }
+        return table[index];
+    }
+
+    void rehash() {
+        size_t new_size = std::max(table_.size() * 2, size_t(1024));
+        Occurrence empty;
+        empty.pos_ = -1;
+        Occurrences new_table(new_size, empty);
+        BOOST_FOREACH (const Occurrence& o, table_) {
+            if (o.pos_ != -1) {
+                find_cell(new_table, o.hash_) = o;
+            }
+        }
+        table_.swap(new_table);
+    }
+};
+
+class KmerTableTG : public ReusingThreadGroup,
+    public AnchorFinderOptions {
+public:
+    const Hashes& used_;
+    KmerShard shards_[SHARDS];
+
+    KmerTableTG(const AnchorFinder* finder,
+                const Hashes& used_hashes):
+        AnchorFinderOptions(finder),
+        used_(used_hashes) {
+        set_workers(finder->workers());
+        make_parts(workers());
+    }
+
+    void flush(Occurrences& outbox, int shard_index) {
+        KmerShard& shard = shards_[shard_index];
+        boost::mutex::scoped_lock lock(shard.mutex_);
+        BOOST_FOREACH (const Occurrence& o, outbox) {
+            shard.add(o);
+        }
+        outbox.clear();
+    }
+
+    ThreadTask* create_task_impl(ThreadWorker* worker);
+
+    ThreadWorker* create_worker_impl();
+};
+
+class KmerTableWorker : public ThreadWorker {
+public:
+    std::vector<Occurrences> outboxes_;
+
+    KmerTableWorker(ThreadGroup* group):
+        ThreadWorker(group), outboxes_(SHARDS) {
+    }
+
+    ~KmerTableWorker() {
+        KmerTableTG* g = D_CAST<KmerTableTG*>(thread_group());
+        for (int i = 0; i < SHARDS; i++) {
+            g->flush(outboxes_[i], i);
+        }
+    }
+};
+
+class KmerTableTask : public ThreadTask {
+public:
+    SeqPart part_;
+    int seq_index_;
+    Sequence* seq_;
+    int anchor_;
+    const Hashes& used_;
+
+    KmerTableTask(const SeqPart& part, ThreadWorker* w):
+        ThreadTask(w),
+        part_(part),
+        seq_index_(part.seq_index_),
+        seq_(part.seq_),
+        anchor_(D_CAST<KmerTableTG*>(thread_group())->anchor_),
+        used_(D_CAST<KmerTableTG*>(thread_group())->used_) {
+    }
+
+    void run_impl() {
+        KmerTableTG* g = D_CAST<KmerTableTG*>(thread_group());
+        KmerTableWorker* w = D_CAST<KmerTableWorker*>(worker());
+        KmerScanner scanner(seq_, anchor_, part_.begin_, part_.end_);
+        while (scanner.next_chunk()) {
+            int size = scanner.size();
+            for (int i = 0; i < size; i++) {
+                if (scanner.has_n(i)) {
+                    continue;
+                }
+                hash_t hash = scanner.hash(i);
+                if (used_.has_elem(hash)) {
+                    continue;
+                }
+                int shard = shard_of(hash);
+                Occurrences& outbox = w->outboxes_[shard];
+                outbox.push_back(Occurrence(hash, seq_index_,
+                                            scanner.pos(i),
+                                            scanner.direct(i)));
+                if (outbox.size() >= OUTBOX_SIZE) {
+                    g->flush(outbox, shard);
+                }
+            }
+        }
+    }
+};
+
+ThreadTask* KmerTableTG::create_task_impl(ThreadWorker* worker) {
+    if (part_it_ != parts_end_) {
+        const SeqPart& part = *part_it_;
+        part_it_++;
+        return new KmerTableTask(part, worker);
+    } else {
+        return 0;
+    }
+}
+
+ThreadWorker* KmerTableTG::create_worker_impl() {
+    return new KmerTableWorker(this);
+}
+
+/** Bits of positions of repeated k-mers, for each sequence */
+typedef std::vector<std::vector<uint64_t> > RepeatedBits;
+
+static bool repeated_at(const RepeatedBits& bits,
+                        int seq, pos_t pos) {
+    return (bits[seq][pos / 64] >> (pos % 64)) & 1;
+}
+
+/** Process shards in parallel.
+Stage 1: free hash tables, sort repeats, mark repeated positions.
+Stage 2: select anchors and make blocks.
+*/
+class ShardsTG : public ReusingThreadGroup {
+public:
+    KmerTableTG& table_;
+    RepeatedBits& bits_;
+    int stage_;
+    std::vector<Blocks> blocks_; // output of stage 2
+    int shard_;
+
+    ShardsTG(KmerTableTG& table, RepeatedBits& bits,
+             const AnchorFinder* finder):
+        table_(table), bits_(bits), stage_(1),
+        blocks_(SHARDS), shard_(0) {
+        set_workers(finder->workers());
+    }
+
+    void run_stage(int stage) {
+        stage_ = stage;
+        shard_ = 0;
+        perform();
+    }
+
+    ThreadTask* create_task_impl(ThreadWorker* worker);
+};
+
+class ShardTask : public ThreadTask {
+public:
+    int shard_index_;
+
+    ShardTask(int shard_index, ThreadWorker* w):
+        ThreadTask(w), shard_index_(shard_index) {
+    }
+
+    void mark() {
+        ShardsTG* g = D_CAST<ShardsTG*>(thread_group());
+        KmerShard& shard = g->table_.shards_[shard_index_];
+        shard.clear_table();
+        std::sort(shard.repeats_.begin(), shard.repeats_.end());
+        if (g->table_.similar_) {
+            BOOST_FOREACH (const Occurrence& o, shard.repeats_) {
+                std::vector<uint64_t>& b = g->bits_[o.seq_];
+                atomic_fetch_or(&b[o.pos_ / 64],
+                                uint64_t(1) << (o.pos_ % 64));
+            }
+        }
+    }
+
+    bool selected(const Occurrences& repeats,
+                  size_t begin, size_t end) const {
+        ShardsTG* g = D_CAST<ShardsTG*>(thread_group());
+        if (!g->table_.similar_) {
+            return true;
+        }
+        // like BloomTask: skip anchor if each of its occurrences
+        // follows an occurrence of other repeated anchor
+        for (size_t i = begin; i < end; i++) {
+            const Occurrence& o = repeats[i];
+            if (o.pos_ == 0 ||
+                    !repeated_at(g->bits_, o.seq_, o.pos_ - 1)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Block* make_block(const Occurrences& repeats,
+                      size_t begin, size_t end) const {
+        ShardsTG* g = D_CAST<ShardsTG*>(thread_group());
+        const Sequences& seqs = g->table_.seqs_;
+        int anchor = g->table_.anchor_;
+        Block* block = new Block;
+        for (size_t i = begin; i < end; i++) {
+            const Occurrence& o = repeats[i];
+            int ori = o.direct_ ? 1 : -1;
+            block->insert(new Fragment(seqs[o.seq_], o.pos_,
+                                       o.pos_ + anchor - 1, ori));
+        }
+        return block;
+    }
+
+    void make_blocks() {
+        ShardsTG* g = D_CAST<ShardsTG*>(thread_group());
+        KmerShard& shard = g->table_.shards_[shard_index_];
+        const Occurrences& repeats = shard.repeats_;
+        Blocks& blocks = g->blocks_[shard_index_];
+        size_t begin = 0;
+        while (begin < repeats.size()) {
+            size_t end = begin + 1;
+            while (end < repeats.size() &&
+                    repeats[end].hash_ == repeats[begin].hash_) {
+                end += 1;
+            }
+            ASSERT_GTE(end - begin, 2);
+            if (selected(repeats, begin, end)) {
+                blocks.push_back(make_block(repeats, begin, end));
+            }
+            begin = end;
+        }
+        Occurrences().swap(shard.repeats_);
+    }
+
+    void run_impl() {
+        ShardsTG* g = D_CAST<ShardsTG*>(thread_group());
+        if (g->stage_ == 1) {
+            mark();
+        } else {
+            make_blocks();
+        }
+    }
+};
+
+ThreadTask* ShardsTG::create_task_impl(ThreadWorker* worker) {
+    if (shard_ < SHARDS) {
+        int shard_index = shard_;
+        shard_++;
+        return new ShardTask(shard_index, worker);
+    } else {
+        return 0;
+    }
+}
+
+static void find_anchors_hash(const AnchorFinder* finder,
+                              Hashes& used_hashes) {
+    KmerTableTG table(finder, used_hashes);
+    table.perform();
+    RepeatedBits bits;
+    if (table.similar_) {
+        bits.resize(table.seqs_.size());
+        for (int i = 0; i < table.seqs_.size(); i++) {
+            bits[i].resize(table.seqs_[i]->size() / 64 + 1);
+        }
+    }
+    ShardsTG shards(table, bits, finder);
+    shards.run_stage(1);
+    shards.run_stage(2);
+    // blocks of shard are sorted by hash, shards are sorted by
+    // mixed hash, so the order does not depend on workers
+    BlockSet& bs = *finder->block_set();
+    int max_fragments = table.max_anchor_fragments_;
+    int fragments = 0;
+    BOOST_FOREACH (const Blocks& blocks, shards.blocks_) {
+        BOOST_FOREACH (Block* block, blocks) {
+            if (fragments + block->size() <= max_fragments) {
+                fragments += block->size();
+                check_block(block, table.anchor_);
+                used_hashes.push_back(block->front()->hash());
+                bs.insert(block);
+            } else {
+                delete block;
+            }
+        }
+    }
+    used_hashes.sort();
+    used_hashes.unique();
+}
+
+// persistent index of k-mers
+
+class IndexScanTG : public ReusingThreadGroup,
+    public AnchorFinderOptions {
+public:
+    std::vector<bool> scan_; // sequences missing in old index
+    KmerRecords records_;
+
+    IndexScanTG(const AnchorFinder* finder):
+        AnchorFinderOptions(finder),
+        scan_(seqs_.size(), false) {
+        set_workers(finder->workers());
+        make_parts(workers());
+    }
+
+    ThreadTask* create_task_impl(ThreadWorker* worker);
+
+    ThreadWorker* create_worker_impl();
+};
+
+class IndexScanWorker : public ThreadWorker {
+public:
+    KmerRecords records_;
+
+    IndexScanWorker(ThreadGroup* group):
+        ThreadWorker(group) {
+    }
+
+    ~IndexScanWorker() {
+        IndexScanTG* g = D_CAST<IndexScanTG*>(thread_group());
+        g->records_.insert(g->records_.end(),
+                           records_.begin(), records_.end());
+    }
+};
+
+class IndexScanTask : public ThreadTask {
+public:
+    SeqPart part_;
+
+    IndexScanTask(const SeqPart& part, ThreadWorker* w):
+        ThreadTask(w), part_(part) {
+    }
+
+    void run_impl() {
+        IndexScanTG* g = D_CAST<IndexScanTG*>(thread_group());
+        IndexScanWorker* w = D_CAST<IndexScanWorker*>(worker());
+        KmerIndex::scan(w->records_, *part_.seq_, part_.seq_index_,
+                        g->anchor_, part_.begin_, part_.end_);
+    }
+};
+
+ThreadTask* IndexScanTG::create_task_impl(ThreadWorker* worker) {
+    while (part_it_ != parts_end_ &&
+            !scan_[part_it_->seq_index_]) {
+        part_it_++;
+    }
+    if (part_it_ != parts_end_) {
+        const SeqPart& part = *part_it_;
+        part_it_++;
+        return new IndexScanTask(part, worker);
+    } else {
+        return 0;
+    }
+}
+
+ThreadWorker* IndexScanTG::create_worker_impl() {
+    return new IndexScanWorker(this);
+}
+
+/** Map sequences of old index to sequences of blockset.
+Sequences are compared by size and fingerprint, not by name,
+since names of consensuses change between iterations.
+*/
+static void match_index_seqs(const KmerIndex& old_index,
+                             KmerIndexSeqs& index_seqs,
+                             std::vector<int>& old_to_new,
+                             IndexScanTG& scan) {
+    typedef std::pair<pos_t, hash_t> SeqKey;
+    typedef std::multimap<SeqKey, int> KeyToOld;
+    KeyToOld key_to_old;
+    const KmerIndexSeqs& old_seqs = old_index.seqs();
+    old_to_new.resize(old_seqs.size(), -1);
+    for (int i = 0; i < old_seqs.size(); i++) {
+        const KmerIndexSeq& s = old_seqs[i];
+        key_to_old.insert(std::make_pair(SeqKey(s.size_,
+                                         s.fingerprint_), i));
+    }
+    const Sequences& seqs = scan.seqs_;
+    index_seqs.resize(seqs.size());
+    for (int i = 0; i < seqs.size(); i++) {
+        KmerIndexSeq& s = index_seqs[i];
+        s.name_ = seqs[i]->name();
+        s.size_ = seqs[i]->size();
+        s.fingerprint_ = KmerIndex::fingerprint(*seqs[i]);
+        KeyToOld::iterator it = key_to_old.find(SeqKey(s.size_,
+                                                s.fingerprint_));
+        if (it != key_to_old.end()) {
+            old_to_new[it->second] = i;
+            key_to_old.erase(it);
+        } else {
+            scan.scan_[i] = true;
+        }
+    }
+}
+
+static bool index_selected(const KmerRecords& repeats,
+                           size_t begin, size_t end,
+                           const RepeatedBits& bits, bool similar) {
+    if (!similar) {
+        return true;
+    }
+    for (size_t i = begin; i < end; i++) {
+        const KmerRecord& r = repeats[i];
+        if (r.pos_ == 0 || !repeated_at(bits, r.seq(), r.pos_ - 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Merge reused records of old index with new records.
+Merged records are written to writer. Occurrences of repeated
+k-mers, which are not in used_hashes, are appended to repeats.
+*/
+static void merge_index(const KmerIndex& old_index,
+                        const std::vector<int>& old_to_new,
+                        const KmerRecords& fresh,
+                        const Hashes& used_hashes,
+                        KmerIndexWriter& writer,
+                        KmerRecords& repeats,
+                        RepeatedBits& bits) {
+    const KmerRecord* old_it = old_index.begin();
+    const KmerRecord* old_end = old_index.end();
+    KmerRecords::const_iterator new_it = fresh.begin();
+    KmerRecords group;
+    while (old_it != old_end || new_it != fresh.end()) {
+        hash_t hash;
+        if (new_it == fresh.end() ||
+                (old_it != old_end && old_it->hash_ < new_it->hash_)) {
+            hash = old_it->hash_;
+        } else {
+            hash = new_it->hash_;
+        }
+        group.clear();
+        for (; old_it != old_end && old_it->hash_ == hash; ++old_it) {
+            ASSERT_LT(old_it->seq(), old_to_new.size());
+            int seq = old_to_new[old_it->seq()];
+            if (seq != -1) {
+                group.push_back(KmerRecord(hash, seq, old_it->pos_,
+                                           old_it->direct()));
+            }
+        }
+        for (; new_it != fresh.end() && new_it->hash_ == hash;
+                ++new_it) {
+            group.push_back(*new_it);
+        }
+        std::sort(group.begin(), group.end());
+        BOOST_FOREACH (const KmerRecord& r, group) {
+            writer.add(r);
+        }
+        if (group.size() >= 2 && !used_hashes.has_elem(hash)) {
+            BOOST_FOREACH (const KmerRecord& r, group) {
+                repeats.push_back(r);
+                if (!bits.empty()) {
+                    bits[r.seq()][r.pos_ / 64] |=
+                        uint64_t(1) << (r.pos_ % 64);
+                }
+            }
+        }
+    }
+}
+
+static void find_anchors_index(const AnchorFinder* finder,
+                               Hashes& used_hashes) {
+    namespace fs = boost::filesystem;
+    std::string filename =
+        finder->opt_value("anchor-index").as<std::string>();
+    IndexScanTG scan(finder);
+    int anchor = scan.anchor_;
+    KmerIndex old_index;
+    if (old_index.open(filename) && old_index.anchor() != anchor) {
+        old_index.close();
+    }
+    KmerIndexSeqs index_seqs;
+    std::vector<int> old_to_new;
+    match_index_seqs(old_index, index_seqs, old_to_new, scan);
+    scan.perform();
+    std::sort(scan.records_.begin(), scan.records_.end());
+    RepeatedBits bits;
+    if (scan.similar_) {
+        bits.resize(scan.seqs_.size());
+        for (int i = 0; i < scan.seqs_.size(); i++) {
+            bits[i].resize(scan.seqs_[i]->size() / 64 + 1);
+        }
+    }
+    KmerRecords repeats;
+    std::string tmp_filename = filename + ".tmp";
+    KmerIndexWriter writer(tmp_filename, anchor, index_seqs);
+    merge_index(old_index, old_to_new, scan.records_, used_hashes,
+                writer, repeats, bits);
+    writer.close();
+    KmerRecords().swap(scan.records_);
+    old_index.close();
+    fs::rename(tmp_filename, filename);
+    // make blocks
+    BlockSet& bs = *finder->block_set();
+    int max_fragments = scan.max_anchor_fragments_;
+    int fragments = 0;
+    size_t begin = 0;
+    while (begin < repeats.size()) {
+        size_t end = begin + 1;
+        while (end < repeats.size() &&
+                repeats[end].hash_ == repeats[begin].hash_) {
+            end += 1;
+        }
+        int size = end - begin;
+        if (index_selected(repeats, begin, end, bits, scan.similar_)
+                && fragments + size <= max_fragments) {
+            fragments += size;
+            Block* block = new Block;
+            for (size_t i = begin; i < end; i++) {
+                const KmerRecord& r = repeats[i];
+                int ori = r.direct() ? 1 : -1;
+                block->insert(new Fragment(scan.seqs_[r.seq()], r.pos_,
+                                           r.pos_ + anchor - 1, ori));
+            }
+            check_block(block, anchor);
+            used_hashes.push_back(repeats[begin].hash_);
+            bs.insert(block);
+        }
+        begin = end;
+    }
+    used_hashes.sort();
+    used_hashes.unique();
+}
+
 void AnchorFinder::run_impl() const {
+    std::string engine = opt_value("anchor-engine").as<std::string>();
+    if (engine == "hash" || engine == "index") {
+        if (engine == "hash") {
+            find_anchors_hash(this, impl_->used_hashes_);
+        } else {
+            find_anchors_index(this, impl_->used_hashes_);
+        }
+        ASSERT_TRUE(impl_->used_hashes_.is_sorted_unique());
+        return;
+    }
     BloomTG bloomtg(this, impl_->used_hashes_);
     bloomtg.perform();
     bloomtg_postprocess(bloomtg);
@@ -21,12 +21,29 @@ returned as a anchor (unless --anchor-similar=false).
 AnchorFinder memorizes hashes of previous run()'s
 and skips them from output.
 
-\note Using >= 2 workers may (very unlikely) cause races,
-    since bloom filter is not protected by a mutex.
-    Such a races may cause some anchors not to be found.
-\note The smallest piece of work, passed to a worker,
-    is one sequence.
-    So it is useless to set workers > sequences.
+Engines (option anchor-engine):
+ - bloom (default): the first pass finds candidate hashes
+   using Bloom filter, the second pass finds positions of
+   candidates. Memory usage is low.
+ - hash: one pass; all k-mers are added to sharded
+   hash table, each shard produces blocks independently.
+   Faster, but memory usage is proportional to
+   total length of sequences.
+ - index: sorted k-mers of all sequences are stored in
+   file anchor-index (see KmerIndex). Next run reads
+   k-mers of unchanged sequences (found by contents,
+   not by name) from the file and scans only new sequences.
+   The file is rewritten to describe the current sequences.
+
+\note Bloom filter (BlockedBloomFilter) is shared by workers.
+    It is updated atomically, so using >= 2 workers
+    does not cause anchors to be lost. If anchor-similar,
+    the choice of a representative anchor of a long repeat
+    may depend on the order in which workers process sequences.
+\note If workers >= 2, long sequences are split into
+    overlapping parts (see SeqBase::make_parts),
+    so all workers are loaded even if there are
+    few sequences.
 
 */
 class AnchorFinder : public Processor {
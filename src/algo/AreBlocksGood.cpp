@@ -17,6 +17,7 @@
 #include "BlockSet.hpp"
 #include "Fragment.hpp"
 #include "Block.hpp"
+#include "AlignmentMatrix.hpp"
 #include "FragmentCollection.hpp"
 #include "Union.hpp"
 #include "UniqueNames.hpp"
@@ -77,8 +78,10 @@ bool AreBlocksGood::are_blocks_good() const {
     BOOST_FOREACH (Block* b, *block_set()) {
         bool minor = !b->name().empty() && b->name()[0] == 'm';
         bool m = respect_minor && minor;
+        // shared by make_stat and Filter
+        AlignmentMatrix matrix(b);
         AlignmentStat al_stat;
-        make_stat(al_stat, b);
+        make_stat(al_stat, b, matrix);
         if (fc.block_has_overlap(b)) {
             overlaps_blocks.push_back(b->name());
             if (has_self_overlaps(b)) {
@@ -92,7 +95,7 @@ bool AreBlocksGood::are_blocks_good() const {
             if (al_stat.alignment_rows() != b->size()) {
                 alignmentless_blocks.push_back(b->name());
             } else {
-                if (!filter_->is_good_block(b)) {
+                if (!filter_->is_good_block(b, &matrix)) {
                     bad_blocks.push_back(b->name());
                 }
                 boost::shared_ptr<Block> copy(b->clone());
@@ -0,0 +1,158 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <cstdlib>
+#include <algorithm>
+#include <boost/foreach.hpp>
+
+#include "BandedAligner.hpp"
+#include "GeneralAligner.hpp"
+#include "throw_assert.hpp"
+
+namespace npge {
+
+BandedAligner::BandedAligner() {
+    add_gopt("gap-range", "Max distance from main diagonal "
+             "of considered states of pair alignment",
+             "ALIGNER_GAP_RANGE");
+    add_gopt("gap-penalty", "Gap penalty", "ALIGNER_GAP_PENALTY");
+    add_gopt("mismatch-penalty", "Mismatch penalty",
+             "ALIGNER_MISMATCH_PENALTY");
+    add_opt_rule("gap-range >= 0");
+    add_opt_rule("gap-penalty > 0");
+    add_opt_rule("mismatch-penalty >= 0");
+}
+
+struct StringPairContents {
+    const std::string* first_;
+    const std::string* second_;
+    int mismatch_penalty_;
+
+    int first_size() const {
+        return first_->size();
+    }
+
+    int second_size() const {
+        return second_->size();
+    }
+
+    int substitution(int row, int col) const {
+        return ((*first_)[row] == (*second_)[col]) ?
+               0 : mismatch_penalty_;
+    }
+};
+
+typedef GeneralAligner<StringPairContents> StringsAligner;
+typedef std::vector<int> Ints;
+
+/** Add number of letters inserted before each center letter */
+static void count_insertions(const PairAlignment& aln,
+                             Ints& max_insertions) {
+    int insertions = 0;
+    BOOST_FOREACH (const AlignmentPair& pair, aln) {
+        if (pair.first == -1) {
+            insertions += 1;
+        } else {
+            int& m = max_insertions[pair.first];
+            m = std::max(m, insertions);
+            insertions = 0;
+        }
+    }
+    int& m = max_insertions.back();
+    m = std::max(m, insertions);
+}
+
+static void append_insertion(std::string& row,
+                             const std::string& insertion,
+                             int max_insertion) {
+    row += insertion;
+    row.resize(row.size() + max_insertion - insertion.size(), '-');
+}
+
+static void make_row(std::string& row, const std::string& seq,
+                     const PairAlignment& aln,
+                     const Ints& max_insertions) {
+    std::string insertion;
+    BOOST_FOREACH (const AlignmentPair& pair, aln) {
+        if (pair.first == -1) {
+            insertion += seq[pair.second];
+        } else {
+            append_insertion(row, insertion,
+                             max_insertions[pair.first]);
+            insertion.clear();
+            row += (pair.second == -1) ? '-' : seq[pair.second];
+        }
+    }
+    append_insertion(row, insertion, max_insertions.back());
+}
+
+void BandedAligner::align_seqs_impl(Strings& seqs) const {
+    int size = seqs.size();
+    if (size < 2) {
+        return;
+    }
+    int center = 0;
+    for (int i = 1; i < size; i++) {
+        if (seqs[i].size() > seqs[center].size()) {
+            center = i;
+        }
+    }
+    const std::string& center_seq = seqs[center];
+    int gap_range = opt_value("gap-range").as<int>();
+    StringsAligner aligner;
+    aligner.set_gap_penalty(opt_value("gap-penalty").as<int>());
+    aligner.set_max_errors(-1);
+    aligner.set_vectorized(true);
+    StringPairContents contents;
+    contents.first_ = &center_seq;
+    contents.mismatch_penalty_ =
+        opt_value("mismatch-penalty").as<int>();
+    std::vector<PairAlignment> alignments(size);
+    Ints max_insertions(center_seq.size() + 1, 0);
+    for (int i = 0; i < size; i++) {
+        if (i == center) {
+            continue;
+        }
+        contents.second_ = &seqs[i];
+        aligner.set_contents(contents);
+        aligner.set_gap_range(global_gap_range(gap_range,
+                              center_seq.size(), seqs[i].size()));
+        int first_last, second_last;
+        aligner.align(first_last, second_last);
+        ASSERT_EQ(first_last, int(center_seq.size()) - 1);
+        ASSERT_EQ(second_last, int(seqs[i].size()) - 1);
+        aligner.export_alignment(first_last, second_last,
+                                 alignments[i]);
+        count_insertions(alignments[i], max_insertions);
+    }
+    Strings result(size);
+    for (int p = 0; p <= center_seq.size(); p++) {
+        std::string& row = result[center];
+        row.resize(row.size() + max_insertions[p], '-');
+        if (p < center_seq.size()) {
+            row += center_seq[p];
+        }
+    }
+    for (int i = 0; i < size; i++) {
+        if (i != center) {
+            make_row(result[i], seqs[i], alignments[i],
+                     max_insertions);
+        }
+    }
+    seqs.swap(result);
+}
+
+std::string BandedAligner::aligner_type() const {
+    return "banded";
+}
+
+const char* BandedAligner::name_impl() const {
+    return "Align blocks with internal banded aligner";
+}
+
+}
+
@@ -0,0 +1,41 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef NPGE_BANDED_ALIGNER_HPP_
+#define NPGE_BANDED_ALIGNER_HPP_
+
+#include "AbstractAligner.hpp"
+
+namespace npge {
+
+/** Align blocks with internal banded aligner.
+
+Each sequence is aligned to the longest one (center)
+by global Needleman-Wunsch with gap range (GeneralAligner).
+The band is widened to the difference of lengths
+up to a limit (see global_gap_range).
+Rows of the matrix are filled by vectorized kernel
+(aligner_fill_row), if supported by processor.
+Pair alignments are merged through the center sequence.
+*/
+class BandedAligner : public AbstractAligner {
+public:
+    /** Constructor */
+    BandedAligner();
+
+protected:
+    std::string aligner_type() const;
+
+    const char* name_impl() const;
+
+    void align_seqs_impl(Strings& seqs) const;
+};
+
+}
+
+#endif
+
@@ -0,0 +1,33 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <ostream>
+
+#include "BinaryWrite.hpp"
+#include "FileWriter.hpp"
+#include "binary_block_set.hpp"
+
+namespace npge {
+
+BinaryWrite::BinaryWrite():
+    file_writer_(this, "out-binary",
+                 "Output file with blockset in binary format", true) {
+    declare_bs("target", "Target blockset");
+}
+
+void BinaryWrite::run_impl() const {
+    std::ostream& out = file_writer_.output();
+    write_binary_block_set(*block_set(), out);
+    out.flush();
+}
+
+const char* BinaryWrite::name_impl() const {
+    return "Write blockset to file in binary format";
+}
+
+}
+
@@ -0,0 +1,37 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef NPGE_BINARY_WRITE_HPP_
+#define NPGE_BINARY_WRITE_HPP_
+
+#include "Processor.hpp"
+#include "FileWriter.hpp"
+
+namespace npge {
+
+/** Write blockset to file in binary format.
+Sequences are written too, so the file is self-contained.
+Read accepts such files as well as text blockset files.
+See write_binary_block_set().
+*/
+class BinaryWrite : public Processor {
+public:
+    /** Constructor */
+    BinaryWrite();
+
+protected:
+    void run_impl() const;
+    const char* name_impl() const;
+
+private:
+    FileWriter file_writer_;
+};
+
+}
+
+#endif
+
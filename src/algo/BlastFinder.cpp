@@ -10,6 +10,7 @@
 #include "BlastFinder.hpp"
 #include "RawWrite.hpp"
 #include "BlastRunner.hpp"
+#include "SeedExtendFinder.hpp"
 #include "ImportBlastHits.hpp"
 #include "FileCopy.hpp"
 #include "FileRemover.hpp"
@@ -18,7 +19,26 @@
 
 namespace npge {
 
+static bool check_blast_engine(const BlastFinder* p,
+                               std::string& message) {
+    std::string engine = p->opt_value("blast-engine").as<std::string>();
+    if (engine != "native" && engine != "blast") {
+        message = "blast-engine must be 'native' or 'blast'";
+        return false;
+    }
+    return true;
+}
+
 BlastFinder::BlastFinder() {
+    add_gopt("blast-engine",
+             "Way of finding hits: 'blast' (external blast) or "
+             "'native' (seeds and X-drop extension in process, "
+             "evalue and dust are not applied)",
+             "BLAST_ENGINE");
+    add_opt_check(boost::bind(check_blast_engine, this, _1));
+    native_ = new SeedExtendFinder;
+    native_->set_parent(this);
+    native_->point_bs("target=target", this);
     OptionGetter c = boost::bind(&BlastFinder::consensus, this);
     OptionGetter h = boost::bind(&BlastFinder::hits, this);
     RawWrite* cons = new RawWrite;
@@ -52,7 +72,14 @@ BlastFinder::BlastFinder() {
 }
 
 void BlastFinder::run_impl() const {
-    if (!block_set()->seqs().empty()) {
+    if (block_set()->seqs().empty()) {
+        return;
+    }
+    std::string engine = opt_value("blast-engine").as<std::string>();
+    if (engine == "native") {
+        native_->set_workers(workers());
+        native_->run();
+    } else {
         Pipe::run_impl();
     }
 }
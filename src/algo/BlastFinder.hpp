@@ -12,9 +12,15 @@
 
 namespace npge {
 
+class SeedExtendFinder;
+
 /** Takes sequences, add blast hits as blocks of these sequences.
 Run BlastFinder on sequence-only blockset (without blocks).
 It adds blast hits as blocks to this blockset.
+
+If blast-engine is 'native', hits are found in-process
+by SeedExtendFinder, without temporary files and external
+blast. If blast-engine is 'blast', blast is run.
 */
 class BlastFinder : public Pipe {
 public:
@@ -25,6 +31,7 @@ protected:
     void run_impl() const;
 
 private:
+    SeedExtendFinder* native_;
     mutable std::string consensus_;
     mutable std::string hits_;
 
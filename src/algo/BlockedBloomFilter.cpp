@@ -0,0 +1,186 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <cmath>
+#include <algorithm>
+
+#include "BlockedBloomFilter.hpp"
+#include "BloomFilter.hpp"
+#include "make_hash.hpp"
+#include "rank_select.hpp"
+#include "atomic.hpp"
+
+namespace npge {
+
+const size_t WORD_BITS = 64;
+const size_t CACHE_LINE_WORDS = 8;
+const size_t MAX_HASHES = 16;
+
+// 6 bits select a bit in 64-bit word
+const int BIT_INDEX_BITS = 6;
+const hash_t BIT_INDEX_MASK = WORD_BITS - 1;
+
+const hash_t SECOND_SEED = hash_t(0x9e3779b97f4a7c15ULL);
+
+BlockedBloomFilter::BlockedBloomFilter():
+    words_(0), words_number_(0), hashes_(0) {
+}
+
+BlockedBloomFilter::BlockedBloomFilter(size_t members,
+                                       double error_prob):
+    words_(0), words_number_(0), hashes_(0) {
+    set_members(members, error_prob);
+}
+
+void BlockedBloomFilter::clear() {
+    std::vector<uint64_t>().swap(storage_);
+    words_ = 0;
+    words_number_ = 0;
+    hashes_ = 0;
+}
+
+void BlockedBloomFilter::set_members(size_t members,
+                                     double error_prob) {
+    set_bits(optimal_bits(members, error_prob));
+    set_hashes(optimal_hashes(members, bits()));
+}
+
+size_t BlockedBloomFilter::bits() const {
+    return words_number_ * WORD_BITS;
+}
+
+void BlockedBloomFilter::set_bits(size_t bits) {
+    words_number_ = (bits + WORD_BITS - 1) / WORD_BITS;
+    std::vector<uint64_t>().swap(storage_);
+    if (words_number_ == 0) {
+        words_ = 0;
+        return;
+    }
+    // extra words to align words_ to cache line
+    storage_.resize(words_number_ + CACHE_LINE_WORDS - 1);
+    size_t line = CACHE_LINE_WORDS * sizeof(uint64_t);
+    size_t address = reinterpret_cast<size_t>(&storage_[0]);
+    size_t shift = (line - address % line) % line;
+    words_ = &storage_[0] + shift / sizeof(uint64_t);
+}
+
+size_t BlockedBloomFilter::hashes() const {
+    return hashes_;
+}
+
+void BlockedBloomFilter::set_hashes(size_t hashes) {
+    hashes_ = std::min(hashes, MAX_HASHES);
+}
+
+bool BlockedBloomFilter::test_and_add(hash_t hash) {
+    uint64_t mask = make_mask(hash);
+    uint64_t* word = words_ + word_index(hash);
+    uint64_t old = atomic_fetch_or(word, mask);
+    return (old & mask) == mask;
+}
+
+void BlockedBloomFilter::add(hash_t hash) {
+    uint64_t mask = make_mask(hash);
+    uint64_t* word = words_ + word_index(hash);
+    if ((*word & mask) != mask) {
+        atomic_fetch_or(word, mask);
+    }
+}
+
+bool BlockedBloomFilter::test(hash_t hash) const {
+    uint64_t mask = make_mask(hash);
+    uint64_t word = words_[word_index(hash)];
+    return (word & mask) == mask;
+}
+
+size_t BlockedBloomFilter::true_bits() const {
+    size_t result = 0;
+    for (size_t i = 0; i < words_number_; i++) {
+        result += popcount64(words_[i]);
+    }
+    return result;
+}
+
+double BlockedBloomFilter::false_positive(size_t members,
+        size_t bits, size_t hashes) {
+    size_t words = (bits + WORD_BITS - 1) / WORD_BITS;
+    if (words == 0 || hashes == 0) {
+        return 1.0;
+    }
+    double lambda = double(members) / words;
+    // probability that one bit is not set by one hash function
+    double q = 1.0 - 1.0 / WORD_BITS;
+    int max_i = int(lambda + 10 * std::sqrt(lambda) + 20);
+    double p_i = std::exp(-lambda); // Poisson(i), i = 0
+    double result = 0;
+    for (int i = 0; i <= max_i; i++) {
+        if (i > 0) {
+            p_i *= lambda / i;
+        }
+        double bit_set = 1.0 - std::pow(q, double(hashes * i));
+        result += p_i * std::pow(bit_set, double(hashes));
+    }
+    return result;
+}
+
+size_t BlockedBloomFilter::optimal_bits(size_t members,
+                                        double error_prob) {
+    size_t result = BloomFilter::optimal_bits(members, error_prob);
+    result = std::max(result, WORD_BITS);
+    // blocked filter needs more bits than classical one
+    for (int step = 0; step < 100; step++) {
+        size_t hashes = optimal_hashes(members, result);
+        if (false_positive(members, result, hashes) <= error_prob) {
+            break;
+        }
+        result += result / 10 + 1;
+    }
+    return result;
+}
+
+size_t BlockedBloomFilter::optimal_hashes(size_t members,
+        size_t bits) {
+    size_t result = 1;
+    double best = false_positive(members, bits, 1);
+    for (size_t hashes = 2; hashes <= MAX_HASHES; hashes++) {
+        double fp = false_positive(members, bits, hashes);
+        if (fp < best) {
+            best = fp;
+            result = hashes;
+        }
+    }
+    return result;
+}
+
+size_t BlockedBloomFilter::max_hashes() {
+    return MAX_HASHES;
+}
+
+size_t BlockedBloomFilter::word_index(hash_t hash) const {
+    return mix_hash(hash) % hash_t(words_number_);
+}
+
+uint64_t BlockedBloomFilter::make_mask(hash_t hash) const {
+    uint64_t mask = 0;
+    hash_t seed = SECOND_SEED;
+    hash_t bit_source = mix_hash(hash ^ seed);
+    int bits_left = sizeof(hash_t) * 8;
+    for (size_t i = 0; i < hashes_; i++) {
+        if (bits_left < BIT_INDEX_BITS) {
+            seed += SECOND_SEED;
+            bit_source = mix_hash(hash ^ seed);
+            bits_left = sizeof(hash_t) * 8;
+        }
+        mask |= uint64_t(1) << (bit_source & BIT_INDEX_MASK);
+        bit_source >>= BIT_INDEX_BITS;
+        bits_left -= BIT_INDEX_BITS;
+    }
+    return mask;
+}
+
+}
+
@@ -0,0 +1,128 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef NPGE_BLOCKED_BLOOM_FILTER_HPP_
+#define NPGE_BLOCKED_BLOOM_FILTER_HPP_
+
+#include <vector>
+#include <boost/utility.hpp>
+
+#include "global.hpp"
+
+namespace npge {
+
+/** Cache-blocked Bloom filter, safe for concurrent use.
+
+All probes of a member fall into one 64-bit word.
+Words are aligned to cache lines, so testing or adding a member
+touches one cache line instead of hashes() random ones.
+
+add() and test_and_add() update the word with one atomic fetch-or.
+That is why test_and_add() is linearizable: if a member is added
+twice from different threads, at least one of the calls
+returns true.
+
+False positive rate of blocked filter is higher than of
+classical one with same bits number. optimal_bits()
+and optimal_hashes() take it into account.
+
+Hash functions are fixed (do not depend on random seed),
+so results are reproducible.
+
+\see BloomFilter
+*/
+class BlockedBloomFilter : boost::noncopyable {
+public:
+    /** Default constructor.
+    Postconditions: bits() = 0, hashes() = 0.
+    */
+    BlockedBloomFilter();
+
+    /** Constructor.
+    \see set_members
+    */
+    BlockedBloomFilter(size_t members, double error_prob);
+
+    /** Clear internal state */
+    void clear();
+
+    /** Set optimal bits number and hash functions number.
+    \see optimal_bits(), optimal_hashes()
+    */
+    void set_members(size_t members, double error_prob);
+
+    /** Get bits number (multiple of 64) */
+    size_t bits() const;
+
+    /** Set bits number.
+    Number is rounded up to multiple of 64.
+    \warning This method clears all added members.
+    */
+    void set_bits(size_t bits);
+
+    /** Get hash functions number */
+    size_t hashes() const;
+
+    /** Set hash functions number.
+    \warning This method invalidates all added members.
+    */
+    void set_hashes(size_t hashes);
+
+    /** Return if the member is likely to be added and add it.
+    This method can be called from multiple threads.
+    */
+    bool test_and_add(hash_t hash);
+
+    /** Add member.
+    This method can be called from multiple threads.
+    */
+    void add(hash_t hash);
+
+    /** Return if the member is likely to be added */
+    bool test(hash_t hash) const;
+
+    /** Return the number of "true" (used) bits */
+    size_t true_bits() const;
+
+    /** Return expected false positive probability.
+    Members are distributed between words according to
+    Poisson distribution.
+    */
+    static double false_positive(size_t members, size_t bits,
+                                 size_t hashes);
+
+    /** Return optimal bits number.
+    Starts from classical optimal bits number
+    (BloomFilter::optimal_bits()) and increases it
+    until false_positive() <= error_prob.
+    */
+    static size_t optimal_bits(size_t members, double error_prob);
+
+    /** Return optimal hash functions number.
+    Returns number of hash functions from [1, max_hashes()],
+    minimizing false_positive().
+    */
+    static size_t optimal_hashes(size_t members, size_t bits);
+
+    /** Max number of hash functions */
+    static size_t max_hashes();
+
+private:
+    std::vector<uint64_t> storage_;
+    uint64_t* words_;
+    size_t words_number_;
+    size_t hashes_;
+
+    size_t word_index(hash_t hash) const;
+
+    uint64_t make_mask(hash_t hash) const;
+};
+
+}
+
+#endif
+
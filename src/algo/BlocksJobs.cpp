@@ -6,6 +6,8 @@
  */
 
 #include <vector>
+#include <map>
+#include <algorithm>
 #include <boost/cast.hpp>
 #include <boost/foreach.hpp>
 #include <boost/tuple/tuple.hpp>
@@ -14,6 +16,7 @@
 #include "BlocksJobs.hpp"
 #include "BlockSet.hpp"
 #include "Block.hpp"
+#include "Fragment.hpp"
 #include "Meta.hpp"
 #include "thread_pool.hpp"
 #include "cast.hpp"
@@ -39,10 +42,7 @@ class BlockGroup : public ReusingThreadGroup {
 public:
     BlockGroup(const BlocksJobs* jobs):
         jobs_(jobs), bs_i_(0), work_data_(0) {
-        std::string block_set_name = jobs->block_set_name();
-        BlockSetPtr target = jobs->get_bs(block_set_name);
-        BlocksVector _(target->begin(), target->end());
-        bs_.swap(_);
+        jobs->blocks_to_process(bs_);
         set_workers(jobs->workers());
         const Meta* meta = jobs->meta();
         AnyAs big = meta->get_opt("BLOCKS_IN_GROUP", 1);
@@ -55,6 +55,7 @@ public:
 
     void perform_impl() {
         jobs_->change_blocks(bs_);
+        count_costs();
         jobs_->initialize_work();
         work_data_ = jobs_->before_work();
         ReusingThreadGroup::perform_impl();
@@ -69,6 +70,45 @@ private:
     BlocksVector bs_;
     int bs_i_;
     int blocks_in_group_;
+    std::vector<double> costs_;
+    double remaining_cost_;
+
+    void count_costs() {
+        costs_.clear();
+        costs_.reserve(bs_.size());
+        remaining_cost_ = 0;
+        BOOST_FOREACH (Block* block, bs_) {
+            double cost = double(block->size()) *
+                          std::max(block->alignment_length(), pos_t(1));
+            costs_.push_back(cost);
+            remaining_cost_ += cost;
+        }
+        if (workers() > 1) {
+            move_dominant();
+        }
+    }
+
+    /* Dominant block costs more than a share of one worker.
+    Such blocks are started first, so that subtasks spawned
+    by them (see spawn_ranges) are shared by other workers
+    instead of finishing the pass on one core.
+    */
+    void move_dominant() {
+        double share = remaining_cost_ / workers();
+        BlocksVector bs;
+        std::vector<double> costs;
+        for (int pass = 0; pass < 2; pass++) {
+            bool dominant = (pass == 0);
+            for (int i = 0; i < bs_.size(); i++) {
+                if ((costs_[i] > share) == dominant) {
+                    bs.push_back(bs_[i]);
+                    costs.push_back(costs_[i]);
+                }
+            }
+        }
+        bs_.swap(bs);
+        costs_.swap(costs);
+    }
 };
 
 class BlockWorker : public ThreadWorker {
@@ -149,22 +189,29 @@ ThreadTask* BlockGroup::create_task_impl(ThreadWorker* worker) {
             task->blocks_.swap(bs_);
             return task;
         }
-        int tasks = bs_.size() - bs_i_;
-        int taks_per_worker = tasks / workers();
-        taks_per_worker = std::max(taks_per_worker, 1);
-        int n = std::min(taks_per_worker, blocks_in_group_);
+        // cost of block = size * length.
+        // Chunk gets 1/(4 * workers) of remaining cost,
+        // so chunks become smaller to the end of work and
+        // threads finish at the same time.
+        // Large blocks are given one by one.
+        double max_cost = remaining_cost_ / (4 * workers());
+        double cost = costs_[bs_i_];
+        int n = 1;
+        while (n < blocks_in_group_ && bs_i_ + n < bs_.size() &&
+                cost + costs_[bs_i_ + n] <= max_cost) {
+            cost += costs_[bs_i_ + n];
+            n += 1;
+        }
+        remaining_cost_ -= cost;
         if (n == 1) {
             Block* block = bs_[bs_i_];
             bs_i_ += 1;
             return new OneBlockTask(block, jobs_, w);
         } else {
             BlockTask* task = new BlockTask(jobs_, w);
-            task->blocks_.reserve(n);
-            for (int i = 0; i < n; i++) {
-                Block* block = bs_[bs_i_];
-                task->blocks_.push_back(block);
-                bs_i_ += 1;
-            }
+            task->blocks_.assign(bs_.begin() + bs_i_,
+                                 bs_.begin() + bs_i_ + n);
+            bs_i_ += n;
             return task;
         }
     } else {
@@ -177,7 +224,113 @@ ThreadWorker* BlockGroup::create_worker_impl() {
 }
 
 BlocksJobs::BlocksJobs(const std::string& block_set_name):
-    block_set_name_(block_set_name) {
+    block_set_name_(block_set_name), tracked_generation_(0) {
+}
+
+typedef std::pair<pos_t, pos_t> Interval;
+typedef std::vector<Interval> Intervals;
+typedef std::map<const Sequence*, Intervals> Seq2Intervals;
+
+static void add_interval(Seq2Intervals& s2i, const Fragment& f,
+                         int distance) {
+    s2i[f.seq()].push_back(Interval(f.min_pos() - distance,
+                                    f.max_pos() + distance));
+}
+
+static void merge_intervals(Intervals& intervals) {
+    std::sort(intervals.begin(), intervals.end());
+    Intervals merged;
+    BOOST_FOREACH (const Interval& interval, intervals) {
+        if (!merged.empty() &&
+                interval.first <= merged.back().second + 1) {
+            merged.back().second = std::max(merged.back().second,
+                                            interval.second);
+        } else {
+            merged.push_back(interval);
+        }
+    }
+    intervals.swap(merged);
+}
+
+static bool touches(const Seq2Intervals& s2i, const Fragment* f) {
+    Seq2Intervals::const_iterator it = s2i.find(f->seq());
+    if (it == s2i.end()) {
+        return false;
+    }
+    const Intervals& intervals = it->second;
+    // ends of merged intervals are sorted too
+    Intervals::const_iterator i = std::lower_bound(intervals.begin(),
+                                  intervals.end(),
+                                  Interval(f->min_pos(), f->min_pos()));
+    if (i != intervals.end() && i->first <= f->max_pos()) {
+        return true;
+    }
+    return i != intervals.begin() && (i - 1)->second >= f->min_pos();
+}
+
+void BlocksJobs::blocks_to_process(BlocksVector& blocks) const {
+    BlockSetPtr bs = get_bs(block_set_name());
+    if (!changed_only() || tracked_bs_.lock() != bs ||
+            tracked_options_ != options_fingerprint()) {
+        blocks.assign(bs->begin(), bs->end());
+        return;
+    }
+    BlocksVector changed;
+    bs->changed_since(tracked_generation_, changed);
+    std::vector<Fragment> removed;
+    bs->removed_since(tracked_generation_, removed);
+    int distance = opt_value("changed-distance").as<int>();
+    Seq2Intervals s2i;
+    BOOST_FOREACH (Block* block, changed) {
+        BOOST_FOREACH (Fragment* f, *block) {
+            add_interval(s2i, *f, distance);
+        }
+    }
+    BOOST_FOREACH (const Fragment& f, removed) {
+        add_interval(s2i, f, distance);
+    }
+    for (Seq2Intervals::iterator it = s2i.begin();
+            it != s2i.end(); ++it) {
+        merge_intervals(it->second);
+    }
+    std::sort(changed.begin(), changed.end());
+    blocks.clear();
+    BOOST_FOREACH (Block* block, *bs) {
+        bool selected = std::binary_search(changed.begin(),
+                                           changed.end(), block);
+        if (!selected) {
+            BOOST_FOREACH (Fragment* f, *block) {
+                if (touches(s2i, f)) {
+                    selected = true;
+                    break;
+                }
+            }
+        }
+        if (selected) {
+            blocks.push_back(block);
+        }
+    }
+}
+
+void BlocksJobs::add_changed_only_options(bool changed_only) {
+    add_opt("changed-only", "Process only blocks changed since "
+            "previous run and their neighbours", changed_only);
+    add_opt("changed-distance", "Max distance from changed blocks "
+            "to neighbours processed in changed-only mode", 0);
+    add_opt_rule("changed-distance >= 0");
+}
+
+bool BlocksJobs::changed_only() const {
+    return has_opt("changed-only") &&
+           opt_value("changed-only").as<bool>();
+}
+
+std::string BlocksJobs::options_fingerprint() const {
+    std::string result;
+    BOOST_FOREACH (const std::string& opt, opts()) {
+        result += opt + "=" + opt_value(opt).to_s() + "\n";
+    }
+    return result;
 }
 
 struct BlockCompareName2 {
@@ -237,6 +390,14 @@ void BlocksJobs::after_work(WorkData* work_data) const {
 void BlocksJobs::run_impl() const {
     BlockGroup block_group(this);
     block_group.perform();
+    if (changed_only()) {
+        // changes made by this run are not tracked
+        BlockSetPtr bs = get_bs(block_set_name());
+        bs->track_changes();
+        tracked_bs_ = bs;
+        tracked_generation_ = BlockSet::new_generation();
+        tracked_options_ = options_fingerprint();
+    }
 }
 
 void BlocksJobs::change_blocks_impl(BlocksVector& blocks) const {
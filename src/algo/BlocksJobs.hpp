@@ -9,6 +9,7 @@
 #define NPGE_BLOCKS_JOBS_HPP_
 
 #include <vector>
+#include <boost/weak_ptr.hpp>
 
 #include "Processor.hpp"
 
@@ -66,6 +67,19 @@ public:
         block_set_name_ = block_set_name;
     }
 
+    /** Get blocks to be processed.
+    All blocks of blockset for iteration are returned,
+    unless changed-only mode is on.
+    In changed-only mode, blocks inserted or changed since
+    previous run of this processor on the same blockset
+    with the same options are returned, as well as blocks
+    having fragments, located not farther than --changed-distance
+    from fragments of changed or removed blocks.
+
+    \see add_changed_only_options
+    */
+    void blocks_to_process(std::vector<Block*>& blocks) const;
+
     /** Change list of blocks.
     This action is applied to vist of blocks
     before running process_block() on them.
@@ -131,6 +145,13 @@ public:
 protected:
     void run_impl() const;
 
+    /** Add options of changed-only mode (see blocks_to_process).
+    This mode is suitable for processors, result of which
+    for a block depends only on the block and its neighbours,
+    and does not change if the processor is applied again.
+    */
+    void add_changed_only_options(bool changed_only = false);
+
     /** Change list of blocks.
     Does nothing by default.
     */
@@ -187,6 +208,15 @@ protected:
 
 private:
     std::string block_set_name_;
+    // blockset, generation and options of previous run
+    // in changed-only mode
+    mutable boost::weak_ptr<BlockSet> tracked_bs_;
+    mutable unsigned int tracked_generation_;
+    mutable std::string tracked_options_;
+
+    bool changed_only() const;
+
+    std::string options_fingerprint() const;
 };
 
 }
@@ -18,7 +18,8 @@
 
 namespace npge {
 
-ConSeq::ConSeq(const BlockSetPtr& source) {
+ConSeq::ConSeq(const BlockSetPtr& source):
+    cache_type_(-1), generation_(0) {
     set_other(source);
     add_seq_storage_options(this);
     declare_bs("other",
@@ -30,8 +31,20 @@ ConSeq::ConSeq(const BlockSetPtr& source) {
 
 struct CSData : public ThreadData {
     std::vector<SequencePtr> seqs_;
+    std::vector<std::pair<const Block*, SequencePtr> > computed_;
 };
 
+void ConSeq::initialize_work_impl() const {
+    int type = seq_type(this);
+    if (type != cache_type_) {
+        cache_.clear();
+        cache_type_ = type;
+    }
+    // blocks changed after this point have generation >= generation_
+    generation_ = BlockSet::new_generation();
+    new_cache_.clear();
+}
+
 ThreadData* ConSeq::before_thread_impl() const {
     return new CSData;
 }
@@ -42,11 +55,22 @@ void ConSeq::process_block_impl(Block* b, ThreadData* d) const {
         seq = boost::make_shared<FragmentSequence>(b->front());
         seq->set_block(b, /* set consensus */ false);
     } else if (b->size() >= 2) {
-        seq = create_sequence(this);
-        seq->set_block(b);
+        // fragments of weak block do not report changes to it
+        Cache::const_iterator it = cache_.find(b);
+        if (!b->weak() && it != cache_.end() &&
+                b->generation() < it->second.generation_ &&
+                b->name() == it->second.name_) {
+            seq = it->second.seq_;
+        } else {
+            seq = create_sequence(this);
+            seq->set_block(b);
+        }
     }
     CSData* data = boost::polymorphic_cast<CSData*>(d);
     data->seqs_.push_back(seq);
+    if (b->size() >= 2 && !b->weak()) {
+        data->computed_.push_back(std::make_pair(b, seq));
+    }
 }
 
 void ConSeq::after_thread_impl(ThreadData* d) const {
@@ -55,6 +79,19 @@ void ConSeq::after_thread_impl(ThreadData* d) const {
     BOOST_FOREACH (const SequencePtr& seq, data->seqs_) {
         t.add_sequence(seq);
     }
+    typedef std::pair<const Block*, SequencePtr> BlockSeq;
+    BOOST_FOREACH (const BlockSeq& bs, data->computed_) {
+        CachedSeq& cached = new_cache_[bs.first];
+        cached.generation_ = generation_;
+        cached.name_ = bs.first->name();
+        cached.seq_ = bs.second;
+    }
+}
+
+void ConSeq::finish_work_impl() const {
+    // blocks not processed by this run are forgotten
+    cache_.swap(new_cache_);
+    new_cache_.clear();
 }
 
 const char* ConSeq::name_impl() const {
@@ -8,12 +8,20 @@
 #ifndef NPGE_CONSEQ_HPP_
 #define NPGE_CONSEQ_HPP_
 
+#include <map>
+#include <string>
+
 #include "BlocksJobs.hpp"
 
 namespace npge {
 
 /** Add consensus sequences, produced from blocks of source blockset.
 Depends on UniqueNames. Blocks must be aligned.
+
+Consensus sequences are cached until the next run.
+Blocks not changed since previous run (see Block::generation())
+are not recomputed: the same sequence is added to the target.
+Renaming of sequences is not tracked.
 */
 class ConSeq : public BlocksJobs {
 public:
@@ -27,7 +35,25 @@ protected:
 
     void after_thread_impl(ThreadData* d) const;
 
+    void initialize_work_impl() const;
+
+    void finish_work_impl() const;
+
     const char* name_impl() const;
+
+private:
+    struct CachedSeq {
+        unsigned int generation_; // valid if block is older
+        std::string name_;
+        SequencePtr seq_;
+    };
+
+    typedef std::map<const Block*, CachedSeq> Cache;
+
+    mutable Cache cache_; // from previous run
+    mutable Cache new_cache_; // filled by this run
+    mutable int cache_type_; // SequenceType of cached sequences
+    mutable unsigned int generation_; // generation of this run
 };
 
 }
@@ -33,11 +33,14 @@ namespace npge {
 
 typedef std::map<std::string, double> LeafLength;
 typedef std::map<std::string, Blocks> BranchBlocks;
+typedef boost::unordered_map<BranchBits, Blocks> BranchBitsBlocks;
 
+/* Branches are accumulated as bits in hash tables of threads,
+merged in after_thread and converted to strings at the end. */
 class BranchData : public ThreadData {
 public:
-    BranchTable table;
-    BranchBlocks branch_blocks;
+    BranchBitsTable table;
+    BranchBitsBlocks branch_blocks;
     LeafLength leaf_length;
 };
 
@@ -46,6 +49,8 @@ public:
     mutable BranchTable table;
     mutable BranchBlocks branch_blocks;
     mutable LeafLength leaf_length;
+    mutable BranchBitsTable bits_table;
+    mutable BranchBitsBlocks bits_blocks;
 
     BranchGenerator() {
         print_tree_  = new PrintTree;
@@ -61,6 +66,8 @@ public:
         table.clear();
         branch_blocks.clear();
         leaf_length.clear();
+        bits_table.clear();
+        bits_blocks.clear();
     }
 
     ThreadData* before_thread_impl() const {
@@ -78,8 +85,9 @@ public:
         }
     };
 
-    static void add_table(BranchTable& dst, const BranchTable& src) {
-        BOOST_FOREACH (const BranchTable::value_type& branch_length,
+    static void add_table(BranchBitsTable& dst,
+                          const BranchBitsTable& src) {
+        BOOST_FOREACH (const BranchBitsTable::value_type& branch_length,
                       src) {
             dst[branch_length.first] += branch_length.second;
         }
@@ -100,10 +108,10 @@ public:
         Leafs leafs;
         tree->all_leafs(leafs);
         std::sort(leafs.begin(), leafs.end(), GenomeNameCompare());
-        BranchTable t;
-        tree->branch_table(t, leafs, block_weight);
+        BranchBitsTable t;
+        tree->branch_bits_table(t, leafs, block_weight);
         add_table(d->table, t);
-        BOOST_FOREACH (const BranchTable::value_type& branch_length,
+        BOOST_FOREACH (const BranchBitsTable::value_type& branch_length,
                       t) {
             d->branch_blocks[branch_length.first].push_back(block);
         }
@@ -117,20 +125,30 @@ public:
 
     void after_thread_impl(ThreadData* data) const {
         BranchData* d = boost::polymorphic_downcast<BranchData*>(data);
-        add_table(table, d->table);
+        add_table(bits_table, d->table);
         BOOST_FOREACH (const LeafLength::value_type& ll,
                       d->leaf_length) {
             leaf_length[ll.first] += ll.second;
         }
-        BOOST_FOREACH (const BranchBlocks::value_type& bb,
+        BOOST_FOREACH (const BranchBitsBlocks::value_type& bb,
                       d->branch_blocks) {
-            const std::string& branch_str = bb.first;
             const Blocks& blocks = bb.second;
-            Blocks& dst_blocks = branch_blocks[branch_str];
-            BOOST_FOREACH (Block* block, blocks) {
-                dst_blocks.push_back(block);
-            }
+            Blocks& dst_blocks = bits_blocks[bb.first];
+            dst_blocks.insert(dst_blocks.end(),
+                              blocks.begin(), blocks.end());
+        }
+    }
+
+    void finish_work_impl() const {
+        BOOST_FOREACH (const BranchBitsTable::value_type& branch_length,
+                      bits_table) {
+            std::string branch_str;
+            branch_str = TreeNode::branch_bits_to_str(branch_length.first);
+            table[branch_str] = branch_length.second;
+            branch_blocks[branch_str].swap(bits_blocks[branch_length.first]);
         }
+        bits_table.clear();
+        bits_blocks.clear();
     }
 
 private:
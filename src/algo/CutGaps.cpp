@@ -17,10 +17,21 @@
 
 namespace npge {
 
+CutGapsOptions::CutGapsOptions():
+    strict(false), row_type(COMPACT_ROW) {
+}
+
+CutGapsOptions::CutGapsOptions(const Processor* p) {
+    strict = p->opt_value("cut-strict").as<bool>();
+    row_type = npge::row_type(p);
+}
+
 CutGaps::CutGaps(bool strict) {
     add_row_storage_options(this);
     add_opt("cut-strict", "cut more gaps", strict);
     declare_bs("target", "Target blockset");
+    add_changed_only_options();
+    add_options_snapshot(&options_);
 }
 
 static void slice_fragment(Fragment* f, int al_from, int al_to, RowType type,
@@ -138,8 +149,8 @@ bool CutGaps::cut_gaps(Block* block) const {
     bool result = false;
     int length = block->alignment_length();
     int from, to;
-    bool strict = opt_value("cut-strict").as<bool>();
-    if (strict) {
+    CutGapsOptions o = options_.get(this);
+    if (o.strict) {
         find_boundaries_strict(block, from, to);
     } else {
         find_boundaries_permissive(block, from, to);
@@ -151,7 +162,7 @@ bool CutGaps::cut_gaps(Block* block) const {
         } else {
             std::vector<Fragment*> fragments(block->begin(), block->end());
             BOOST_FOREACH (Fragment* f, fragments) {
-                slice_fragment(f, from, to, row_type(this), block);
+                slice_fragment(f, from, to, o.row_type, block);
             }
         }
     }
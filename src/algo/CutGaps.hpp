@@ -9,9 +9,22 @@
 #define NPGE_CUT_GAPS_HPP_
 
 #include "BlocksJobs.hpp"
+#include "OptionsSnapshot.hpp"
 
 namespace npge {
 
+/** Values of options of CutGaps */
+struct CutGapsOptions {
+    bool strict;
+    RowType row_type;
+
+    /** Constructor */
+    CutGapsOptions();
+
+    /** Read values of options of the processor */
+    CutGapsOptions(const Processor* p);
+};
+
 /** Cut longest terminal gap.
 
 Alignment is preserved.
@@ -69,6 +82,9 @@ protected:
     void process_block_impl(Block* block, ThreadData*) const;
 
     const char* name_impl() const;
+
+private:
+    OptionsSnapshot<CutGapsOptions> options_;
 };
 
 }
@@ -6,12 +6,15 @@
  */
 
 #include <cstdlib>
+#include <sstream>
 #include <boost/format.hpp>
 #include <boost/foreach.hpp>
 #include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "ExternalAligner.hpp"
 #include "FastaReader.hpp"
+#include "PipeProcess.hpp"
 #include "write_fasta.hpp"
 #include "name_to_stream.hpp"
 #include "throw_assert.hpp"
@@ -21,13 +24,139 @@
 
 namespace npge {
 
-ExternalAligner::ExternalAligner() {
+// terminates requests to and answers of aligner server
+const char* SERVER_END = "//\n";
+
+class ExternalAligner::Impl {
+public:
+    boost::mutex mutex_;
+    std::vector<PipeProcess*> idle_servers_;
+
+    ~Impl() {
+        stop();
+    }
+
+    PipeProcess* acquire(const std::string& cmd) {
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            while (!idle_servers_.empty()) {
+                PipeProcess* server = idle_servers_.back();
+                idle_servers_.pop_back();
+                if (server->cmd() == cmd) {
+                    return server;
+                }
+                delete server;
+            }
+        }
+        return new PipeProcess(cmd);
+    }
+
+    void release(PipeProcess* server) {
+        if (server->good()) {
+            boost::mutex::scoped_lock lock(mutex_);
+            idle_servers_.push_back(server);
+        } else {
+            delete server;
+        }
+    }
+
+    void stop() {
+        boost::mutex::scoped_lock lock(mutex_);
+        BOOST_FOREACH (PipeProcess* server, idle_servers_) {
+            delete server;
+        }
+        idle_servers_.clear();
+    }
+};
+
+ExternalAligner::ExternalAligner():
+    impl_(new Impl) {
     add_opt("aligner-cmd",
             "Template of command for external aligner",
             std::string(), true);
+    add_opt("aligner-pipes",
+            "Pass sequences to external aligner through pipes "
+            "instead of temp files",
+            false);
+    add_opt("aligner-server",
+            "Command of long-lived aligner, "
+            "reading batches of blocks from stdin "
+            "(empty means running aligner-cmd for each block)",
+            std::string());
+    add_opt("aligner-batch",
+            "Max number of blocks sent to aligner-server at once",
+            16);
+    add_opt_rule("aligner-batch >= 1");
+}
+
+ExternalAligner::~ExternalAligner() {
+    delete impl_;
 }
 
+void ExternalAligner::stop_servers() const {
+    impl_->stop();
+}
+
+static void write_seqs(std::ostream& out,
+                       const std::vector<Strings>& batch) {
+    int index = 0;
+    BOOST_FOREACH (const Strings& seqs, batch) {
+        BOOST_FOREACH (const std::string& seq, seqs) {
+            write_fasta(out, TO_S(index), "", seq, 60);
+            index += 1;
+        }
+    }
+}
+
+static void read_rows(Strings& rows, std::istream& input);
+
 void ExternalAligner::align_seqs_impl(Strings& seqs) const {
+    if (!opt_value("aligner-server").as<std::string>().empty()) {
+        std::vector<Strings> batch(1);
+        batch[0].swap(seqs);
+        align_seqs_batch_impl(batch);
+        seqs.swap(batch[0]);
+    } else if (opt_value("aligner-pipes").as<bool>()) {
+        align_with_pipes(seqs);
+    } else {
+        align_with_files(seqs);
+    }
+}
+
+void ExternalAligner::align_seqs_batch_impl(
+    std::vector<Strings>& batch) const {
+    std::string cmd = opt_value("aligner-server").as<std::string>();
+    if (cmd.empty()) {
+        AbstractAligner::align_seqs_batch_impl(batch);
+        return;
+    }
+    TimeIncrementer ti(this);
+    std::stringstream input;
+    write_seqs(input, batch);
+    input << SERVER_END;
+    std::string output;
+    PipeProcess* server = impl_->acquire(cmd);
+    bool ok = server->communicate(input.str(), output, SERVER_END);
+    impl_->release(server);
+    if (!ok) {
+        throw Exception("aligner server failed. Command: " + cmd);
+    }
+    output.resize(output.size() - std::string(SERVER_END).size());
+    std::istringstream aligned(output);
+    Strings rows;
+    read_rows(rows, aligned);
+    int index = 0;
+    BOOST_FOREACH (Strings& seqs, batch) {
+        BOOST_FOREACH (std::string& seq, seqs) {
+            ASSERT_LT(index, rows.size());
+            seq.swap(rows[index]);
+            index += 1;
+        }
+    }
+    ASSERT_EQ(index, rows.size());
+}
+
+void ExternalAligner::align_with_files(Strings& seqs) const {
     std::string input = tmp_file();
     ASSERT_FALSE(input.empty());
     std::string output = tmp_file();
@@ -50,6 +179,35 @@ void ExternalAligner::align_seqs_impl(Strings& seqs) const {
     }
 }
 
+void ExternalAligner::align_with_pipes(Strings& seqs) const {
+    TimeIncrementer ti(this);
+    std::stringstream input;
+    write_seqs(input, std::vector<Strings>(1, seqs));
+    std::string cmd = opt_value("aligner-cmd").as<std::string>();
+    std::string cmd_string = str(boost::format(cmd) %
+                                 "/dev/stdin" % "/dev/stdout");
+    PipeProcess process(cmd_string);
+    std::string output;
+    bool ok = process.communicate(input.str(), output);
+    int r = process.wait();
+    if (!ok || r) {
+        throw Exception("external aligner failed with code " +
+                        TO_S(r) + ". Command: " + cmd_string);
+    }
+    std::istringstream aligned(output);
+    Strings rows;
+    read_rows(rows, aligned);
+    ASSERT_EQ(rows.size(), seqs.size());
+    seqs.swap(rows);
+}
+
+int ExternalAligner::batch_size_impl() const {
+    if (opt_value("aligner-server").as<std::string>().empty()) {
+        return 1;
+    }
+    return opt_value("aligner-batch").as<int>();
+}
+
 void ExternalAligner::align_file(const std::string& input,
                                  const std::string& output) const {
     TimeIncrementer ti(this);
@@ -92,12 +250,16 @@ public:
     int i_;
 };
 
+static void read_rows(Strings& rows, std::istream& input) {
+    AlignmentReader reader(rows, input);
+    reader.read_all_sequences();
+}
+
 void ExternalAligner::read_alignment(Strings& rows,
                                      const std::string& file) const {
     TimeIncrementer ti(this);
     boost::shared_ptr<std::istream> aligned = name_to_istream(file);
-    AlignmentReader reader(rows, *aligned);
-    reader.read_all_sequences();
+    read_rows(rows, *aligned);
 }
 
 std::string ExternalAligner::aligner_type() const {
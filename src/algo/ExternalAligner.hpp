@@ -12,12 +12,54 @@
 
 namespace npge {
 
-/** Align blocks with external alignment tool */
+/** Align blocks with external alignment tool.
+
+By default the tool is started for each block.
+If option "aligner-pipes" is true, FASTA is passed to the tool
+through pipes (/dev/stdin and /dev/stdout are substituted into
+command template), otherwise temp files are used.
+
+If option "aligner-server" is not empty, it is a command of
+long-lived aligner. Pool of such processes (one process per
+working thread) is kept until the aligner is destroyed.
+Each request to the server is a batch of several blocks:
+FASTA records of all blocks followed by line "//".
+Records are renamed to consecutive numbers 0..N-1 through all
+blocks of the batch. The server must answer with aligned
+records (with same names, any order) followed by line "//"
+and wait for the next request.
+Up to "aligner-batch" blocks are sent to the server at once
+(blocks are collected by each working thread, see AbstractAligner).
+
+Example: request with two blocks (2 and 1 fragments)
+\code
+>0
+ATGC
+>1
+AGC
+>2
+TT
+//
+\endcode
+Answer of the server:
+\code
+>0
+ATGC
+>1
+A-GC
+>2
+TT
+//
+\endcode
+*/
 class ExternalAligner : public AbstractAligner {
 public:
     /** Constructor */
     ExternalAligner();
 
+    /** Destructor */
+    ~ExternalAligner();
+
     /** Apply external aligner to file */
     void align_file(const std::string& input,
                     const std::string& output) const;
@@ -26,12 +68,28 @@ public:
     void read_alignment(Strings& rows,
                         const std::string& file) const;
 
+    /** Stop all server processes */
+    void stop_servers() const;
+
 protected:
     std::string aligner_type() const;
 
     const char* name_impl() const;
 
     void align_seqs_impl(Strings& seqs) const;
+
+    void align_seqs_batch_impl(std::vector<Strings>& batch) const;
+
+    /** Return "aligner-batch" if "aligner-server" is set, else 1 */
+    int batch_size_impl() const;
+
+private:
+    class Impl;
+    Impl* impl_;
+
+    void align_with_files(Strings& seqs) const;
+
+    void align_with_pipes(Strings& seqs) const;
 };
 
 /** Mafft aligner */
@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <boost/foreach.hpp>
 #include <boost/cast.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include "Filter.hpp"
 #include "SizeLimits.hpp"
@@ -17,6 +18,7 @@
 #include "Fragment.hpp"
 #include "Block.hpp"
 #include "BlockSet.hpp"
+#include "AlignmentMatrix.hpp"
 #include "goodSlices.hpp"
 #include "block_stat.hpp"
 #include "boundaries.hpp"
@@ -83,19 +85,22 @@ const char* LiteFilter::name_impl() const {
            "frangment length and block size)";
 }
 
-struct LengthRequirements {
-    int min_fragment_length;
-    Decimal min_identity;
-    int min_end;
-    int frame_length;
+FilterOptions::FilterOptions():
+    min_fragment(0), min_block(0), max_block(-1),
+    frame_length(0), min_end(0),
+    find_subblocks(false), good_to_other(false) {
+}
 
-    LengthRequirements(const Processor* p) {
-        min_fragment_length = p->opt_value("min-fragment").as<int>();
-        frame_length = p->opt_value("frame-length").as<int>();
-        min_identity = p->opt_value("min-identity").as<Decimal>();
-        min_end = p->opt_value("min-end").as<int>();
-    }
-};
+FilterOptions::FilterOptions(const Processor* p) {
+    min_fragment = p->opt_value("min-fragment").as<int>();
+    min_block = p->opt_value("min-block").as<int>();
+    max_block = p->opt_value("max-block").as<int>();
+    min_identity = p->opt_value("min-identity").as<Decimal>();
+    frame_length = p->opt_value("frame-length").as<int>();
+    min_end = p->opt_value("min-end").as<int>();
+    find_subblocks = p->opt_value("find-subblocks").as<bool>();
+    good_to_other = p->opt_value("good-to-other").as<bool>();
+}
 
 Filter::Filter() {
     add_size_limits_options(this);
@@ -107,6 +112,8 @@ Filter::Filter() {
     declare_bs("target", "Filtered blockset");
     declare_bs("other", "Target blockset for good blocks "
                "(if --good-to-other)");
+    add_changed_only_options();
+    add_options_snapshot(&options_);
 }
 
 bool Filter::is_good_fragment(const Fragment* fragment) const {
@@ -135,39 +142,31 @@ static int minIdentCount(Decimal min_identity) {
     return min_good_count;
 }
 
-static Coordinates goodSubblocks(const Block* block,
-        const LengthRequirements& lr) {
-    int nrows = block->size();
-    Fragments ff(block->begin(), block->end());
-    std::vector<std::string> rows(nrows);
-    std::vector<const char*> crows(nrows);
-    for (int i = 0; i < nrows; i++) {
-        Fragment* f = ff[i];
-        rows[i] = f->str();
-        crows[i] = rows[i].c_str();
-    }
-    int length = block->alignment_length();
-    int min_length = lr.min_fragment_length;
+static Coordinates goodSubblocks(const AlignmentMatrix& matrix,
+        const FilterOptions& lr) {
+    int min_length = lr.min_fragment;
     int frame_length = lr.frame_length;
     int min_identity = minIdentCount(lr.min_identity);
-    Scores scores = goodColumns(&crows[0], nrows, length,
+    Scores scores = goodColumns(matrix,
             min_identity, min_length);
     return goodSlices(scores,
         frame_length, lr.min_end,
         min_identity, min_length);
 }
 
-static bool checkAlignment(const Block* block,
-                           const LengthRequirements& lr) {
-    int length = block->alignment_length();
-    Coordinates slices = goodSubblocks(block, lr);
+static bool checkAlignment(const AlignmentMatrix& matrix,
+                           const FilterOptions& lr) {
+    int length = matrix.length();
+    Coordinates slices = goodSubblocks(matrix, lr);
     return slices.size() == 1 &&
         slices.front() == StartStop(0, length - 1);
 }
 
-bool Filter::is_good_block(const Block* block) const {
+bool Filter::is_good_block(const Block* block,
+                           const AlignmentMatrix* matrix) const {
     TimeIncrementer ti(this);
-    int min_length = opt_value("min-fragment").as<int>();
+    FilterOptions lr = options_.get(this);
+    int min_length = lr.min_fragment;
     if (block->alignment_length() < min_length) {
         return false;
     }
@@ -176,22 +175,26 @@ bool Filter::is_good_block(const Block* block) const {
             return false;
         }
     }
-    int min_block_size = opt_value("min-block").as<int>();
-    int max_block_size = opt_value("max-block").as<int>();
+    int min_block_size = lr.min_block;
+    int max_block_size = lr.max_block;
     if (block->size() < min_block_size) {
         return false;
     }
     if (block->size() > max_block_size && max_block_size != -1) {
         return false;
     }
+    boost::scoped_ptr<AlignmentMatrix> own_matrix;
+    if (!matrix) {
+        own_matrix.reset(new AlignmentMatrix(block));
+        matrix = own_matrix.get();
+    }
     AlignmentStat al_stat;
-    make_stat(al_stat, block);
-    Decimal min_identity = opt_value("min-identity").as<Decimal>();
+    make_stat(al_stat, block, *matrix);
+    Decimal min_identity = lr.min_identity;
     if (al_stat.alignment_rows() == block->size()) {
         Decimal identity = block_identity(al_stat);
         if (min_identity > 0.05) {
-            LengthRequirements lr(this);
-            if (!checkAlignment(block, lr)) {
+            if (!checkAlignment(*matrix, lr)) {
                 return false;
             }
         }
@@ -200,9 +203,11 @@ bool Filter::is_good_block(const Block* block) const {
 }
 
 void Filter::find_good_subblocks(const Block* block,
-                                 Blocks& good_subblocks) const {
+                                 Blocks& good_subblocks,
+                                 const AlignmentMatrix* matrix) const {
     TimeIncrementer ti(this);
-    int min_block_size = opt_value("min-block").as<int>();
+    FilterOptions lr = options_.get(this);
+    int min_block_size = lr.min_block;
     if (block->size() < min_block_size) {
         return;
     }
@@ -212,12 +217,16 @@ void Filter::find_good_subblocks(const Block* block,
             return;
         }
     }
-    LengthRequirements lr(this);
-    int min_length = lr.min_fragment_length;
+    int min_length = lr.min_fragment;
     if (length < min_length) {
         return;
     }
-    Coordinates slices = goodSubblocks(block, lr);
+    boost::scoped_ptr<AlignmentMatrix> own_matrix;
+    if (!matrix) {
+        own_matrix.reset(new AlignmentMatrix(block));
+        matrix = own_matrix.get();
+    }
+    Coordinates slices = goodSubblocks(*matrix, lr);
     BOOST_FOREACH (const StartStop& slice, slices) {
         Block* gb = block->slice(slice.first, slice.second);
         ASSERT_TRUE(is_good_block(gb));
@@ -237,16 +246,19 @@ ThreadData* Filter::before_thread_impl() const {
 
 void Filter::process_block_impl(Block* block, ThreadData* d) const {
     FilterData* data = boost::polymorphic_downcast<FilterData*>(d);
-    bool g_t_o = opt_value("good-to-other").as<bool>();
-    bool good = is_good_block(block);
+    FilterOptions o = options_.get(this);
+    bool g_t_o = o.good_to_other;
+    // one matrix for all checks of the block until it is changed
+    AlignmentMatrix matrix(block);
+    bool good = is_good_block(block, &matrix);
     if (g_t_o && good) {
         data->blocks_to_insert.push_back(block->clone());
     }
     if (!g_t_o && !good) {
-        bool find_subblocks = opt_value("find-subblocks").as<bool>();
+        bool find_subblocks = o.find_subblocks;
         std::vector<Block*> subblocks;
         if (find_subblocks) {
-            find_good_subblocks(block, subblocks);
+            find_good_subblocks(block, subblocks, &matrix);
         }
         if (!subblocks.empty()) {
             data->blocks_to_erase.push_back(block);
@@ -280,7 +292,7 @@ void Filter::after_thread_impl(ThreadData* d) const {
     FilterData* data = boost::polymorphic_downcast<FilterData*>(d);
     BlockSet& target = *block_set();
     BlockSet& o = *other();
-    bool g_t_o = opt_value("good-to-other").as<bool>();
+    bool g_t_o = options_.get(this).good_to_other;
     BlockSet& bs_to_insert = g_t_o ? o : target;
     BOOST_FOREACH (Block* block, data->blocks_to_erase) {
         // blocks_to_erase is empty if g_t_o
@@ -9,6 +9,8 @@
 #define NPGE_FILTER_HPP_
 
 #include "BlocksJobs.hpp"
+#include "OptionsSnapshot.hpp"
+#include "Decimal.hpp"
 
 namespace npge {
 
@@ -29,6 +31,24 @@ protected:
     const char* name_impl() const;
 };
 
+/** Values of options of Filter */
+struct FilterOptions {
+    int min_fragment;
+    int min_block;
+    int max_block;
+    Decimal min_identity;
+    int frame_length;
+    int min_end;
+    bool find_subblocks;
+    bool good_to_other;
+
+    /** Constructor */
+    FilterOptions();
+
+    /** Read values of options of the processor */
+    FilterOptions(const Processor* p);
+};
+
 /** Filter out short and invalid fragments.
 Fragments are removed (and disconnected).
 If block contains too few fragments, it is removed as well
@@ -52,14 +72,18 @@ public:
     /** Return if block is good according to this filter.
     Apply filter_block() before.
     Alignment must be good in the beginning and in the end of block.
+    If matrix is 0, it is built from the block if needed.
     */
-    bool is_good_block(const Block* block) const;
+    bool is_good_block(const Block* block,
+                       const AlignmentMatrix* matrix = 0) const;
 
     /** Slice out good subblocks.
     Ownership of new blocks is transferred to caller.
+    If matrix is 0, it is built from the block if needed.
     */
     void find_good_subblocks(const Block* block,
-                             Blocks& good_subblocks) const;
+                             Blocks& good_subblocks,
+                             const AlignmentMatrix* matrix = 0) const;
 
 protected:
     ThreadData* before_thread_impl() const;
@@ -69,6 +93,9 @@ protected:
     void after_thread_impl(ThreadData* data) const;
 
     const char* name_impl() const;
+
+private:
+    OptionsSnapshot<FilterOptions> options_;
 };
 
 }
@@ -13,15 +13,26 @@
 #include "SizeLimits.hpp"
 #include "Block.hpp"
 #include "BlockSet.hpp"
-#include "block_stat.hpp"
+#include "AlignmentMatrix.hpp"
 #include "block_hash.hpp"
 #include "throw_assert.hpp"
 
 namespace npge {
 
+FixEndsOptions::FixEndsOptions():
+    min_fragment(0) {
+}
+
+FixEndsOptions::FixEndsOptions(const Processor* p) {
+    min_fragment = p->opt_value("min-fragment").as<int>();
+    min_identity = p->opt_value("min-identity").as<Decimal>();
+}
+
 FixEnds::FixEnds() {
     add_size_limits_options(this);
     declare_bs("target", "Target blockset");
+    add_changed_only_options();
+    add_options_snapshot(&options_);
 }
 
 struct FEData : public ThreadData {
@@ -36,7 +47,8 @@ ThreadData* FixEnds::before_thread_impl() const {
 struct GoodAlnFinder {
     typedef std::vector<char> Bools;
 
-    Block* block;
+    const AlignmentMatrix* matrix;
+    bool reverse; // columns are read from the end
     Bools good_col;
     int length;
     int min_fragment;
@@ -45,6 +57,10 @@ struct GoodAlnFinder {
     int sub_frame;
     int start, stop;
 
+    bool good_column(int i) const {
+        return matrix->is_ident_nogap(reverse ? length - 1 - i : i);
+    }
+
     void init_frame() {
         good_col.clear();
         good_col.resize(min_fragment, false);
@@ -53,7 +69,7 @@ struct GoodAlnFinder {
                      min_fragment).to_i();
         good = 0;
         for (int i = 0; i < min_fragment; i++) {
-            bool g = is_ident_nogap(block, i);
+            bool g = good_column(i);
             good += g;
             good_col[i] = g;
         }
@@ -62,7 +78,7 @@ struct GoodAlnFinder {
     }
 
     void shift() {
-        bool g = is_ident_nogap(block, stop);
+        bool g = good_column(stop);
         char& c = good_col[stop % min_fragment];
         good -= c;
         good += g;
@@ -121,15 +137,19 @@ struct GoodAlnFinder {
 void FixEnds::process_block_impl(Block* b,
                                  ThreadData* d) const {
     ASSERT_TRUE(has_alignment(b));
+    // identity and gaps of a column do not depend on orientation,
+    // so the end is searched in reversed columns of the same matrix
+    AlignmentMatrix matrix(b);
     GoodAlnFinder gaf;
-    gaf.block = b;
-    gaf.length = b->alignment_length();
-    gaf.min_fragment = opt_value("min-fragment").as<int>();
-    gaf.min_identity = opt_value("min-identity").as<Decimal>();
+    gaf.matrix = &matrix;
+    gaf.length = matrix.length();
+    FixEndsOptions o = options_.get(this);
+    gaf.min_fragment = o.min_fragment;
+    gaf.min_identity = o.min_identity;
+    gaf.reverse = false;
     int start_direct = gaf.find_start();
-    b->inverse();
+    gaf.reverse = true;
     int start_reverse = gaf.find_start();
-    b->inverse();
     if (start_direct == 0 && start_reverse == 0) {
         // block is already good
     } else {
@@ -9,9 +9,23 @@
 #define NPGE_FIX_ENDS_HPP_
 
 #include "BlocksJobs.hpp"
+#include "OptionsSnapshot.hpp"
+#include "Decimal.hpp"
 
 namespace npge {
 
+/** Values of options of FixEnds */
+struct FixEndsOptions {
+    int min_fragment;
+    Decimal min_identity;
+
+    /** Constructor */
+    FixEndsOptions();
+
+    /** Read values of options of the processor */
+    FixEndsOptions(const Processor* p);
+};
+
 /** Cut bad aligned ends.
 
 Alignment is preserved.
@@ -37,6 +51,9 @@ protected:
     void process_block_impl(Block* block, ThreadData*) const;
     void after_thread_impl(ThreadData* data) const;
     const char* name_impl() const;
+
+private:
+    OptionsSnapshot<FixEndsOptions> options_;
 };
 
 }
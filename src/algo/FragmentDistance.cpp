@@ -6,11 +6,15 @@
  */
 
 #include <vector>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
 
 #include "FragmentDistance.hpp"
 #include "Block.hpp"
 #include "Fragment.hpp"
 #include "AlignmentRow.hpp"
+#include "simple_task.hpp"
 #include "Exception.hpp"
 
 namespace npge {
@@ -77,16 +81,47 @@ FragmentDistance::FragmentDistance() {
     declare_bs("target", "Target blockset");
 }
 
+typedef std::vector<const Fragment*> ConstFragments;
+
+/* ratios[i * n + j] = distance between fragments
+first_row + i and j (j > first_row + i) */
+static void distances_rows(std::vector<double>& ratios,
+                           const ConstFragments& fragments,
+                           const FragmentDistance* distance,
+                           int first_row, int first, int last) {
+    int n = fragments.size();
+    for (int i = first; i < last; i++) {
+        int row = first_row + i;
+        for (int j = row + 1; j < n; j++) {
+            ratios[i * n + j] = distance->fragment_distance(
+                                    fragments[row], fragments[j]).ratio();
+        }
+    }
+}
+
 void FragmentDistance::print_block(std::ostream& o, Block* block) const {
-    std::vector<const Fragment*> fragments(block->begin(), block->end());
-    for (int i = 0; i < fragments.size(); i++) {
-        const Fragment* f1 = fragments[i];
-        for (int j = i + 1; j < fragments.size(); j++) {
-            const Fragment* f2 = fragments[j];
-            o << block->name() << '\t';
-            o << f1->id() << '\t';
-            o << f2->id() << '\t';
-            o << fragment_distance(f1, f2).ratio() << '\n';
+    ConstFragments fragments(block->begin(), block->end());
+    int n = fragments.size();
+    // rows of distance matrix of giant block are
+    // calculated in parallel (see spawn_ranges) by windows,
+    // so memory does not grow as n * n
+    const int WINDOW = 64;
+    const int MIN_ROWS = 8;
+    std::vector<double> ratios(std::min(n, WINDOW) * n);
+    for (int first_row = 0; first_row < n; first_row += WINDOW) {
+        int rows = std::min(WINDOW, n - first_row);
+        spawn_ranges(rows, MIN_ROWS, boost::bind(distances_rows,
+                     boost::ref(ratios), boost::cref(fragments),
+                     this, first_row, _1, _2));
+        for (int i = 0; i < rows; i++) {
+            const Fragment* f1 = fragments[first_row + i];
+            for (int j = first_row + i + 1; j < n; j++) {
+                const Fragment* f2 = fragments[j];
+                o << block->name() << '\t';
+                o << f1->id() << '\t';
+                o << f2->id() << '\t';
+                o << ratios[i * n + j] << '\n';
+            }
         }
     }
 }
@@ -56,6 +56,7 @@ public:
         has_n_ = (p_.find('N') != std::string::npos);
         set_workers(f->workers());
         make_seqs();
+        make_parts(workers());
     }
 
     ThreadTask* create_task_impl(ThreadWorker* worker);
@@ -86,14 +87,17 @@ public:
     int max_matches_;
     bool has_n_;
 
-    FinderTask(Sequence* seq, FinderWorker* w, FinderTG* g):
+    pos_t end_;
+
+    FinderTask(const SeqPart& part, FinderWorker* w, FinderTG* g):
         ThreadTask(w),
-        SeqI(seq, g),
+        SeqI(part.seq_, g, part.begin_),
         ff_(w->ff_),
         pattern_(g->pattern_),
         p_(g->p_),
         max_matches_(g->max_matches_),
-        has_n_(g->has_n_) {
+        has_n_(g->has_n_),
+        end_(part.end_) {
     }
 
     void add_match(int ori) {
@@ -120,7 +124,7 @@ public:
     void run_impl() {
         init_state();
         test();
-        pos_t n = seq_->size() - anchor_;
+        pos_t n = end_ - anchor_ - pos_;
         for (pos_t i = 0; i < n; i++) {
             next_hash();
             test();
@@ -132,11 +136,11 @@ public:
 };
 
 ThreadTask* FinderTG::create_task_impl(ThreadWorker* worker) {
-    if (it_ != end_) {
-        Sequence* seq = *it_;
-        it_++;
+    if (part_it_ != parts_end_) {
+        const SeqPart& part = *part_it_;
+        part_it_++;
         FinderWorker* w = D_CAST<FinderWorker*>(worker);
-        return new FinderTask(seq, w, this);
+        return new FinderTask(part, w, this);
     } else {
         return 0;
     }
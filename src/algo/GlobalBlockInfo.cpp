@@ -47,7 +47,7 @@ void GlobalBlockInfo::prepare() const {
     BlockSetPtr global_bs = get_bs("global");
     BlockSetPtr normal_bs = get_bs("normal");
     global2normal_.clear();
-    VectorFc fc;
+    IndexFc fc;
     fc.add_bs(*global_bs);
     fc.prepare();
     BOOST_FOREACH (Block* b, *normal_bs) {
@@ -48,8 +48,14 @@ public:
 
     double distance_to_impl(const LeafNode* l0) const {
         const GenomeLeaf* leaf = D_CAST<const GenomeLeaf*>(l0);
-        Dist& dist = *(const_cast<Dist*>(dist_));
-        return dist[genome_][leaf->genome_];
+        // read only, may be called from several threads
+        Dist::const_iterator it = dist_->find(genome_);
+        if (it == dist_->end()) {
+            return 0.0;
+        }
+        const Genome2Double& g2d = it->second;
+        Genome2Double::const_iterator it2 = g2d.find(leaf->genome_);
+        return (it2 == g2d.end()) ? 0.0 : it2->second;
     }
 
     std::string name_impl() const {
@@ -99,7 +105,7 @@ void GlobalTree::run_impl() const {
         GenomeLeaf* leaf = new GenomeLeaf(genome, &dist);
         tree->add_child(leaf);
     }
-    tree->neighbor_joining();
+    tree->neighbor_joining(workers());
     //
     add_diagnostic(tree.get(), copy,
                    genomes_v.size(), workers());
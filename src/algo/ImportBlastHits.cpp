@@ -5,16 +5,15 @@
  * See the LICENSE file for terms of use.
  */
 
-#include <map>
+#include <cstring>
+#include <algorithm>
 #include <vector>
+#include <istream>
 #include <boost/foreach.hpp>
-#include <boost/assert.hpp>
-#include <boost/lexical_cast.hpp>
-#include <boost/algorithm/string/split.hpp>
-#include <boost/algorithm/string/trim.hpp>
-#include <boost/algorithm/string/classification.hpp>
-#include <boost/tuple/tuple.hpp>
-#include <boost/tuple/tuple_comparison.hpp>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/filesystem.hpp>
 
 #include "ImportBlastHits.hpp"
 #include "BlockSet.hpp"
@@ -24,6 +23,7 @@
 #include "AlignmentRow.hpp"
 #include "convert_position.hpp"
 #include "Exception.hpp"
+#include "simple_task.hpp"
 #include "cast.hpp"
 #include "po.hpp"
 #include "throw_assert.hpp"
@@ -37,6 +37,9 @@ ImportBlastHits::ImportBlastHits():
     file_reader_(this, "blast-hits", "results of blast -m 8") {
     add_gopt("blast-min-length", "min length of blast hit",
              "MIN_LENGTH");
+    add_opt("blast-min-ident", "min identity of blast hit "
+            "(third field of blast output divided by 100)",
+            D(0.0));
     add_opt("filtered-blast-hits",
             "File to write out filtered blast hits", std::string(""));
     add_gopt("filtered-min-ident", "min identity of hit to write out",
@@ -47,133 +50,435 @@ ImportBlastHits::ImportBlastHits():
                "on which blast was run");
 }
 
+/* Name of sequence or block, not copied from input */
+struct NameRef {
+    const char* data_;
+    int size_;
+
+    bool operator<(const NameRef& o) const {
+        int r = std::memcmp(data_, o.data_, std::min(size_, o.size_));
+        return r < 0 || (r == 0 && size_ < o.size_);
+    }
+
+    bool operator==(const NameRef& o) const {
+        return size_ == o.size_ &&
+               std::memcmp(data_, o.data_, size_) == 0;
+    }
+
+    std::string str() const {
+        return std::string(data_, size_);
+    }
+};
+
 struct BlastItem {
-    std::string id;
+    NameRef id;
     int start;
     int stop;
 
     bool operator<(const BlastItem& o) const {
-        typedef boost::tuple<const std::string&, int, int> Tie;
-        return Tie(id, start, stop) < Tie(o.id, o.start, o.stop);
+        if (!(id == o.id)) {
+            return id < o.id;
+        }
+        if (start != o.start) {
+            return start < o.start;
+        }
+        return stop < o.stop;
     }
 };
 
 struct BlastHit {
-    BlastHit(std::string line) {
-        using namespace boost::algorithm;
-        trim(line);
-        Strings parts;
-        split(parts, line, is_any_of("\t"));
-        if (parts.size() < 12) {
-            throw Exception("Number of fields in blast hits fasta"
-                            " (" + TO_S(parts.size()) + ") "
-                            "must be >= 12");
-        }
-        items[0].id = parts[0];
-        items[1].id = parts[1];
-        ident = Decimal(parts[2]) / 100;
-        length = boost::lexical_cast<int>(parts[3]);
-        mismatches = boost::lexical_cast<int>(parts[4]);
-        gap_openings = boost::lexical_cast<int>(parts[5]);
-        items[0].start = boost::lexical_cast<int>(parts[6]);
-        items[0].stop = boost::lexical_cast<int>(parts[7]);
-        items[1].start = boost::lexical_cast<int>(parts[8]);
-        items[1].stop = boost::lexical_cast<int>(parts[9]);
-        // evalue and bitscore are not used
-    }
-
     BlastItem items[2];
-    Decimal ident; // not used
+    int ident; // percent * 100, filtered by blast-min-ident
     int length;
-    int mismatches;
-    int gap_openings;
+    // mismatches, gap openings, evalue and bitscore are not used
+};
+
+static uint32_t name_hash(const char* data, int size) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Open addressing hash table of names of sequences and blocks.
+   Lookup does not allocate, so it is used by all workers. */
+class NameIndex {
+public:
+    struct Entry {
+        std::string name_;
+        Sequence* seq_;
+        Block* block_;
+    };
+
+    NameIndex(int names) {
+        int size = 16;
+        while (size < names * 2) {
+            size *= 2;
+        }
+        table_.resize(size, -1);
+    }
+
+    void add_seq(Sequence* seq) {
+        entry(seq->name()).seq_ = seq;
+    }
+
+    void add_block(Block* block) {
+        entry(block->name()).block_ = block;
+    }
+
+    const Entry* find(const char* data, int size) const {
+        int mask = table_.size() - 1;
+        for (int i = name_hash(data, size) & mask;; i = (i + 1) & mask) {
+            int e = table_[i];
+            if (e == -1) {
+                return 0;
+            }
+            const std::string& name = entries_[e].name_;
+            if (name.size() == size &&
+                    std::memcmp(name.c_str(), data, size) == 0) {
+                return &entries_[e];
+            }
+        }
+    }
+
+private:
+    std::vector<Entry> entries_;
+    std::vector<int> table_;
+
+    Entry& entry(const std::string& name) {
+        int mask = table_.size() - 1;
+        int i = name_hash(name.c_str(), name.size()) & mask;
+        for (;; i = (i + 1) & mask) {
+            int e = table_[i];
+            if (e == -1) {
+                break;
+            }
+            if (entries_[e].name_ == name) {
+                return entries_[e];
+            }
+        }
+        ASSERT_LT(entries_.size() * 2, table_.size());
+        table_[i] = entries_.size();
+        Entry new_entry;
+        new_entry.name_ = name;
+        new_entry.seq_ = 0;
+        new_entry.block_ = 0;
+        entries_.push_back(new_entry);
+        return entries_.back();
+    }
 };
 
-typedef std::map<std::string, Block*> NameToBlock;
-typedef std::map<std::string, Sequence*> NameToSeq;
+static void bad_hit(const char* line, const char* line_end) {
+    throw Exception("Bad line of blast hits: " +
+                    std::string(line, line_end));
+}
+
+static int parse_int(const char* begin, const char* end,
+                     const char* line, const char* line_end) {
+    const char* p = begin;
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+    if (p == end) {
+        bad_hit(line, line_end);
+    }
+    int result = 0;
+    for (; p != end; p++) {
+        if (*p < '0' || *p > '9') {
+            bad_hit(line, line_end);
+        }
+        result = result * 10 + (*p - '0');
+    }
+    return negative ? -result : result;
+}
+
+/* "97.35" -> 9735, digits after second are ignored */
+static int parse_percent(const char* begin, const char* end,
+                         const char* line, const char* line_end) {
+    const char* point = std::find(begin, end, '.');
+    int result = parse_int(begin, point, line, line_end) * 100;
+    int scale = 10;
+    for (const char* p = point + 1; p < end && scale > 0; p++) {
+        if (*p < '0' || *p > '9') {
+            bad_hit(line, line_end);
+        }
+        result += (*p - '0') * scale;
+        scale /= 10;
+    }
+    return result;
+}
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/* Parse line of blast -m 8 without copying.
+   Returns false for empty line. */
+static bool parse_hit(const char* line, const char* line_end,
+                      BlastHit& hit) {
+    // trim
+    while (line != line_end && is_space(*line)) {
+        line++;
+    }
+    while (line_end != line && is_space(line_end[-1])) {
+        line_end--;
+    }
+    if (line == line_end) {
+        return false;
+    }
+    const int FIELDS = 10; // fields after 10th are not used
+    const char* fields[FIELDS + 1];
+    int n = 0;
+    fields[n++] = line;
+    for (const char* p = line; p != line_end && n <= FIELDS; p++) {
+        if (*p == '\t') {
+            fields[n++] = p + 1;
+        }
+    }
+    // all 12 fields must be present
+    int tabs = n - 1;
+    for (const char* p = fields[n - 1]; p != line_end; p++) {
+        if (*p == '\t') {
+            tabs += 1;
+        }
+    }
+    if (tabs + 1 < 12) {
+        throw Exception("Number of fields in blast hits fasta"
+                        " (" + TO_S(tabs + 1) + ") "
+                        "must be >= 12");
+    }
+#define FIELD_END(i) (fields[(i) + 1] - 1)
+    hit.items[0].id.data_ = fields[0];
+    hit.items[0].id.size_ = FIELD_END(0) - fields[0];
+    hit.items[1].id.data_ = fields[1];
+    hit.items[1].id.size_ = FIELD_END(1) - fields[1];
+    hit.ident = parse_percent(fields[2], FIELD_END(2), line, line_end);
+    hit.length = parse_int(fields[3], FIELD_END(3), line, line_end);
+    hit.items[0].start = parse_int(fields[6], FIELD_END(6),
+                                   line, line_end);
+    hit.items[0].stop = parse_int(fields[7], FIELD_END(7),
+                                  line, line_end);
+    hit.items[1].start = parse_int(fields[8], FIELD_END(8),
+                                   line, line_end);
+    hit.items[1].stop = parse_int(fields[9], FIELD_END(9),
+                                  line, line_end);
+#undef FIELD_END
+    return true;
+}
 
-static void add_blast_item(const BlockSet* bs,
-                           const NameToSeq& name2seq,
-                           const NameToBlock& name2block,
+static void add_blast_item(const NameIndex& names,
                            Block* new_block, const BlastItem& item) {
-    Sequence* seq = 0;
-    NameToSeq::const_iterator it = name2seq.find(item.id);
-    if (it != name2seq.end()) {
-        seq = it->second;
-    }
-    Fragment* f = 0;
-    std::string f_seq_name = Fragment::seq_name_from_id(item.id);
-    if (!f_seq_name.empty()) {
-        NameToSeq::const_iterator it2 = name2seq.find(f_seq_name);
-        if (it2 != name2seq.end()) {
-            Sequence* s = it2->second;
-            f = s->fragment_from_id(item.id);
-        }
-    }
-    if (seq) {
-        Fragment* new_fragment = new Fragment(seq);
+    const NameIndex::Entry* entry = names.find(item.id.data_,
+                                               item.id.size_);
+    if (entry && entry->seq_) {
+        Fragment* new_fragment = new Fragment(entry->seq_);
         new_fragment->set_begin_last(item.start - 1, item.stop - 1);
         new_block->insert(new_fragment);
-    } else if (f) {
-        new_block->insert(f->subfragment(item.start - 1,
-                                         item.stop - 1));
-        delete f;
-    } else {
-        NameToBlock::const_iterator it = name2block.find(item.id);
-        if (it == name2block.end()) {
-            throw Exception("Bad block name: " + item.id);
-        }
-        const Block* block = it->second;
-        ASSERT_TRUE(block);
-        int block_length = block->alignment_length();
-        BOOST_FOREACH (Fragment* fr, *block) {
-            int start = fragment_pos(fr, item.start - 1, block_length);
-            ASSERT_NE(start, -1);
-            int stop = fragment_pos(fr, item.stop - 1, block_length);
-            ASSERT_NE(stop, -1);
-            new_block->insert(fr->subfragment(start, stop));
+        return;
+    }
+    // fragment id: seq-name_begin_last
+    const char* id = item.id.data_;
+    const char* u1 = static_cast<const char*>(
+                         std::memchr(id, '_', item.id.size_));
+    if (u1 && u1 != id) {
+        const NameIndex::Entry* seq_entry = names.find(id, u1 - id);
+        if (seq_entry && seq_entry->seq_) {
+            Fragment* f = seq_entry->seq_->fragment_from_id(
+                              item.id.str());
+            if (f) {
+                new_block->insert(f->subfragment(item.start - 1,
+                                                 item.stop - 1));
+                delete f;
+                return;
+            }
+        }
+    }
+    if (!entry || !entry->block_) {
+        throw Exception("Bad block name: " + item.id.str());
+    }
+    const Block* block = entry->block_;
+    int block_length = block->alignment_length();
+    BOOST_FOREACH (Fragment* fr, *block) {
+        int start = fragment_pos(fr, item.start - 1, block_length);
+        ASSERT_NE(start, -1);
+        int stop = fragment_pos(fr, item.stop - 1, block_length);
+        ASSERT_NE(stop, -1);
+        new_block->insert(fr->subfragment(start, stop));
+    }
+}
+
+struct ImportSettings {
+    const NameIndex* names_;
+    int min_length_;
+    int min_ident_; // percent * 100
+    bool filtered_;
+    Decimal filtered_min_ident_;
+};
+
+/* Blocks and filtered lines of one part of input */
+struct ImportPart {
+    const char* begin_;
+    const char* end_;
+    std::vector<Block*> blocks_;
+    std::string filtered_;
+};
+
+static void import_part(const ImportSettings& settings,
+                        ImportPart& part) {
+    const char* line = part.begin_;
+    while (line < part.end_) {
+        const char* line_end = static_cast<const char*>(
+                                   std::memchr(line, '\n',
+                                               part.end_ - line));
+        if (!line_end) {
+            line_end = part.end_;
+        }
+        BlastHit hit;
+        if (parse_hit(line, line_end, hit) &&
+                hit.items[0] < hit.items[1] &&
+                hit.length >= settings.min_length_ &&
+                hit.ident >= settings.min_ident_) {
+            Block* new_block = new Block;
+            add_blast_item(*settings.names_, new_block, hit.items[0]);
+            add_blast_item(*settings.names_, new_block, hit.items[1]);
+            part.blocks_.push_back(new_block);
+            if (settings.filtered_) {
+                AlignmentStat stat;
+                make_stat(stat, new_block);
+                Decimal identity = block_identity(stat);
+                if (identity > settings.filtered_min_ident_) {
+                    part.filtered_.append(line, line_end);
+                    part.filtered_ += '\n';
+                }
+            }
         }
+        line = line_end + 1;
     }
 }
 
+/* Size of part of input processed by one task */
+const size_t PART_SIZE = 4 * 1024 * 1024;
+
+/* Size of buffer for non-file inputs (e.g., stdin) */
+const size_t STREAM_BUFFER = 64 * 1024 * 1024;
+
+/* Import hits from the buffer which ends with complete line */
+static void import_buffer(const char* begin, const char* end,
+                          const ImportSettings& settings, int workers,
+                          BlockSet& target, std::ostream* filtered) {
+    std::vector<ImportPart> parts;
+    const char* part_begin = begin;
+    while (part_begin < end) {
+        const char* part_end = part_begin + PART_SIZE;
+        if (part_end >= end) {
+            part_end = end;
+        } else {
+            const char* nl = static_cast<const char*>(
+                                 std::memchr(part_end, '\n',
+                                             end - part_end));
+            part_end = nl ? (nl + 1) : end;
+        }
+        ImportPart part;
+        part.begin_ = part_begin;
+        part.end_ = part_end;
+        parts.push_back(part);
+        part_begin = part_end;
+    }
+    Tasks tasks;
+    BOOST_FOREACH (ImportPart& part, parts) {
+        tasks.push_back(boost::bind(import_part, boost::cref(settings),
+                                    boost::ref(part)));
+    }
+    do_tasks(tasks_to_generator(tasks), workers);
+    // keep order of hits in input
+    BOOST_FOREACH (ImportPart& part, parts) {
+        BOOST_FOREACH (Block* block, part.blocks_) {
+            target.insert(block);
+        }
+        if (filtered) {
+            (*filtered) << part.filtered_;
+        }
+    }
+}
+
+static bool is_regular_file(const std::string& name) {
+    if (name.empty() || name[0] == ':') {
+        return false;
+    }
+    std::string path = resolve_home_dir(name);
+    return file_exists(path) && !is_dir(path);
+}
+
 void ImportBlastHits::run_impl() const {
-    NameToSeq name2seq;
+    NameIndex names(other()->seqs().size() + other()->size());
     BOOST_FOREACH (SequencePtr seq, other()->seqs()) {
-        name2seq[seq->name()] = seq.get();
+        names.add_seq(seq.get());
     }
-    NameToBlock name2block;
     BOOST_FOREACH (Block* block, *other()) {
-        name2block[block->name()] = block;
+        names.add_block(block);
     }
-    BlockSet* bs = other().get();
-    int min_length = opt_value("blast-min-length").as<int>();
-    Decimal min_ident = opt_value("filtered-min-ident").as<Decimal>();
+    ImportSettings settings;
+    settings.names_ = &names;
+    settings.min_length_ = opt_value("blast-min-length").as<int>();
+    Decimal min_ident = opt_value("blast-min-ident").as<Decimal>();
+    settings.min_ident_ = (min_ident * 10000).to_i();
+    settings.filtered_min_ident_ =
+        opt_value("filtered-min-ident").as<Decimal>();
     std::string filtered_filename =
         opt_value("filtered-blast-hits").as<std::string>();
     boost::shared_ptr<std::ostream> filtered_file;
     if (!filtered_filename.empty()) {
         filtered_file = name_to_ostream(filtered_filename);
     }
-    BOOST_FOREACH (std::istream& input_file, file_reader_) {
-        for (std::string line; std::getline(input_file, line);) {
-            BlastHit hit(line);
-            if (hit.items[0] < hit.items[1] &&
-                    hit.length >= min_length) {
-                Block* new_block = new Block;
-                add_blast_item(bs, name2seq, name2block,
-                               new_block, hit.items[0]);
-                add_blast_item(bs, name2seq, name2block,
-                               new_block, hit.items[1]);
-                block_set()->insert(new_block);
-                if (filtered_file) {
-                    AlignmentStat stat;
-                    make_stat(stat, new_block);
-                    Decimal identity = block_identity(stat);
-                    if (identity > min_ident) {
-                        (*filtered_file) << line << "\n";
-                    }
+    settings.filtered_ = (filtered_file.get() != 0);
+    BlockSet& target = *block_set();
+    BOOST_FOREACH (const std::string& name, file_reader_.input_files()) {
+        if (is_regular_file(name)) {
+            std::string path = resolve_home_dir(name);
+            boost::iostreams::mapped_file_source file;
+            if (boost::filesystem::file_size(path) == 0) {
+                continue;
+            }
+            file.open(path);
+            if (!file.is_open()) {
+                throw Exception("Error opening file " + name);
+            }
+            import_buffer(file.data(), file.data() + file.size(),
+                          settings, workers(), target,
+                          filtered_file.get());
+            continue;
+        }
+        // stream: read by large buffers ending with complete line
+        boost::shared_ptr<std::istream> input = name_to_istream(name);
+        std::vector<char> buffer;
+        size_t tail = 0; // incomplete line from previous buffer
+        while (true) {
+            buffer.resize(tail + STREAM_BUFFER);
+            input->read(&buffer[tail], STREAM_BUFFER);
+            size_t size = tail + input->gcount();
+            bool eof = (input->gcount() == 0);
+            size_t complete = size;
+            if (!eof) {
+                while (complete > 0 && buffer[complete - 1] != '\n') {
+                    complete--;
                 }
             }
+            if (complete > 0) {
+                import_buffer(&buffer[0], &buffer[0] + complete,
+                              settings, workers(), target,
+                              filtered_file.get());
+            }
+            tail = size - complete;
+            if (tail) {
+                std::memmove(&buffer[0], &buffer[complete], tail);
+            }
+            if (eof) {
+                break;
+            }
         }
     }
 }
@@ -15,6 +15,9 @@
 namespace npge {
 
 /** Add blocks from blast hits (blast output -m 8).
+Regular files are memory-mapped, other inputs are read
+by large buffers. Parts of input are parsed by workers,
+blocks are added in order of lines in input.
 \note This processor depends on processor Read.
 */
 class ImportBlastHits : public Processor {
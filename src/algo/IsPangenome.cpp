@@ -74,7 +74,7 @@ static void fix_self_overlaps_in_hits(const BlockSetPtr& hits) {
     }
 }
 
-static bool is_good_joined(Block* joined, const VectorFc& fc) {
+static bool is_good_joined(Block* joined, const IndexFc& fc) {
     Fragments overlaps;
     BOOST_FOREACH (Fragment* f, *joined) {
         fc.find_overlap_fragments(overlaps, f);
@@ -99,7 +99,7 @@ static bool is_good_joined(Block* joined, const VectorFc& fc) {
 // from original of same or greater #fragments)
 static void remove_almost_similar(
     BlockSetPtr joined, BlockSetPtr original) {
-    VectorFc fc;
+    IndexFc fc;
     fc.add_bs(*original);
     fc.prepare();
     Blocks to_delete;
@@ -0,0 +1,322 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <boost/foreach.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "KmerIndex.hpp"
+#include "KmerScanner.hpp"
+#include "Sequence.hpp"
+#include "Exception.hpp"
+#include "make_hash.hpp"
+#include "throw_assert.hpp"
+
+namespace npge {
+
+BOOST_STATIC_ASSERT(sizeof(KmerRecord) == 16);
+
+const char MAGIC[8] = {'N', 'P', 'G', 'E', 'K', 'I', 'D', 'X'};
+const uint32_t VERSION = 1;
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+// records_ of unfinished file
+const uint64_t NO_RECORDS = ~uint64_t(0);
+
+struct IndexHeader {
+    char magic_[8];
+    uint32_t version_;
+    uint32_t byte_order_mark_;
+    uint32_t anchor_;
+    uint32_t seqs_;
+    uint64_t records_;
+    uint64_t names_size_;
+};
+
+struct IndexSeqEntry {
+    uint64_t fingerprint_;
+    uint64_t size_;
+    uint64_t name_offset_;
+    uint64_t name_length_;
+};
+
+static size_t records_offset(size_t seqs, size_t names_size) {
+    size_t offset = sizeof(IndexHeader) +
+                    seqs * sizeof(IndexSeqEntry) + names_size;
+    return (offset + 7) / 8 * 8;
+}
+
+class KmerIndex::Impl {
+public:
+    boost::iostreams::mapped_file_source file_;
+    int anchor_;
+    KmerIndexSeqs seqs_;
+    const KmerRecord* begin_;
+    const KmerRecord* end_;
+
+    Impl():
+        anchor_(0), begin_(0), end_(0) {
+    }
+
+    bool load() {
+        size_t size = file_.size();
+        const char* data = file_.data();
+        if (size < sizeof(IndexHeader)) {
+            return false;
+        }
+        IndexHeader header;
+        std::memcpy(&header, data, sizeof(IndexHeader));
+        if (std::memcmp(header.magic_, MAGIC, sizeof(MAGIC)) != 0 ||
+                header.version_ != VERSION ||
+                header.byte_order_mark_ != BYTE_ORDER_MARK ||
+                header.records_ == NO_RECORDS) {
+            return false;
+        }
+        size_t offset = records_offset(header.seqs_,
+                                       header.names_size_);
+        if (size != offset + header.records_ * sizeof(KmerRecord)) {
+            return false;
+        }
+        const char* names = data + sizeof(IndexHeader) +
+                            header.seqs_ * sizeof(IndexSeqEntry);
+        seqs_.resize(header.seqs_);
+        for (size_t i = 0; i < header.seqs_; i++) {
+            IndexSeqEntry entry;
+            std::memcpy(&entry, data + sizeof(IndexHeader) +
+                        i * sizeof(IndexSeqEntry), sizeof(entry));
+            if (entry.name_offset_ + entry.name_length_ >
+                    header.names_size_) {
+                return false;
+            }
+            KmerIndexSeq& seq = seqs_[i];
+            seq.name_.assign(names + entry.name_offset_,
+                             entry.name_length_);
+            seq.size_ = entry.size_;
+            seq.fingerprint_ = entry.fingerprint_;
+        }
+        anchor_ = header.anchor_;
+        begin_ = reinterpret_cast<const KmerRecord*>(data + offset);
+        end_ = begin_ + header.records_;
+        return true;
+    }
+};
+
+KmerIndex::KmerIndex():
+    impl_(new Impl) {
+}
+
+KmerIndex::~KmerIndex() {
+    delete impl_;
+}
+
+bool KmerIndex::open(const std::string& filename) {
+    close();
+    try {
+        impl_->file_.open(filename);
+    } catch (...) {
+        return false;
+    }
+    if (!impl_->file_.is_open()) {
+        return false;
+    }
+    if (!impl_->load()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void KmerIndex::close() {
+    if (impl_->file_.is_open()) {
+        impl_->file_.close();
+    }
+    impl_->anchor_ = 0;
+    impl_->seqs_.clear();
+    impl_->begin_ = 0;
+    impl_->end_ = 0;
+}
+
+bool KmerIndex::is_open() const {
+    return impl_->file_.is_open();
+}
+
+int KmerIndex::anchor() const {
+    return impl_->anchor_;
+}
+
+const KmerIndexSeqs& KmerIndex::seqs() const {
+    return impl_->seqs_;
+}
+
+size_t KmerIndex::size() const {
+    return impl_->end_ - impl_->begin_;
+}
+
+const KmerRecord* KmerIndex::begin() const {
+    return impl_->begin_;
+}
+
+const KmerRecord* KmerIndex::end() const {
+    return impl_->end_;
+}
+
+struct KmerRecordHashLess {
+    bool operator()(const KmerRecord& a, hash_t b) const {
+        return a.hash_ < b;
+    }
+
+    bool operator()(hash_t a, const KmerRecord& b) const {
+        return a < b.hash_;
+    }
+};
+
+std::pair<const KmerRecord*, const KmerRecord*>
+KmerIndex::find(hash_t hash) const {
+    return std::equal_range(impl_->begin_, impl_->end_, hash,
+                            KmerRecordHashLess());
+}
+
+const hash_t FNV_OFFSET = hash_t(0xcbf29ce484222325ULL);
+const hash_t FNV_PRIME = hash_t(0x100000001b3ULL);
+const int FINGERPRINT_CHUNK = 4096;
+
+hash_t KmerIndex::fingerprint(const Sequence& seq) {
+    hash_t result = FNV_OFFSET;
+    std::vector<char> codes(FINGERPRINT_CHUNK);
+    for (pos_t begin = 0; begin < seq.size();
+            begin += FINGERPRINT_CHUNK) {
+        int length = std::min(FINGERPRINT_CHUNK, seq.size() - begin);
+        seq.letter_codes(begin, length, &codes[0]);
+        for (int i = 0; i < length; i++) {
+            result = (result ^ hash_t(codes[i])) * FNV_PRIME;
+        }
+    }
+    return mix_hash(result ^ hash_t(seq.size()));
+}
+
+void KmerIndex::scan(KmerRecords& records, const Sequence& seq,
+                     uint32_t seq_index, int anchor,
+                     pos_t begin, pos_t end) {
+    KmerScanner scanner(&seq, anchor, begin, end);
+    while (scanner.next_chunk()) {
+        int size = scanner.size();
+        for (int i = 0; i < size; i++) {
+            if (!scanner.has_n(i)) {
+                records.push_back(KmerRecord(scanner.hash(i),
+                                             seq_index,
+                                             scanner.pos(i),
+                                             scanner.direct(i)));
+            }
+        }
+    }
+}
+
+void KmerIndex::write(const std::string& filename, int anchor,
+                      const KmerIndexSeqs& seqs,
+                      const KmerRecord* begin,
+                      const KmerRecord* end) {
+    KmerIndexWriter writer(filename, anchor, seqs);
+    for (const KmerRecord* it = begin; it != end; ++it) {
+        writer.add(*it);
+    }
+    writer.close();
+}
+
+class KmerIndexWriter::Impl {
+public:
+    std::string filename_;
+    std::ofstream out_;
+    uint64_t records_;
+    KmerRecord last_;
+
+    Impl(const std::string& filename):
+        filename_(filename),
+        out_(filename.c_str(), std::ios::binary | std::ios::trunc),
+        records_(0) {
+    }
+
+    void check() const {
+        if (!out_) {
+            throw Exception("Can't write k-mer index to " +
+                            filename_);
+        }
+    }
+};
+
+KmerIndexWriter::KmerIndexWriter(const std::string& filename,
+                                 int anchor,
+                                 const KmerIndexSeqs& seqs):
+    impl_(new Impl(filename)) {
+    impl_->check();
+    IndexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic_, MAGIC, sizeof(MAGIC));
+    header.version_ = VERSION;
+    header.byte_order_mark_ = BYTE_ORDER_MARK;
+    header.anchor_ = anchor;
+    header.seqs_ = seqs.size();
+    header.records_ = NO_RECORDS;
+    std::string names;
+    std::vector<IndexSeqEntry> entries;
+    BOOST_FOREACH (const KmerIndexSeq& seq, seqs) {
+        IndexSeqEntry entry;
+        entry.fingerprint_ = seq.fingerprint_;
+        entry.size_ = seq.size_;
+        entry.name_offset_ = names.size();
+        entry.name_length_ = seq.name_.size();
+        entries.push_back(entry);
+        names += seq.name_;
+    }
+    header.names_size_ = names.size();
+    std::ostream& out = impl_->out_;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!entries.empty()) {
+        out.write(reinterpret_cast<const char*>(&entries[0]),
+                  entries.size() * sizeof(IndexSeqEntry));
+    }
+    out.write(names.c_str(), names.size());
+    size_t offset = sizeof(IndexHeader) +
+                    entries.size() * sizeof(IndexSeqEntry) +
+                    names.size();
+    size_t padding = records_offset(seqs.size(), names.size()) -
+                     offset;
+    out.write("\0\0\0\0\0\0\0\0", padding);
+    impl_->check();
+}
+
+KmerIndexWriter::~KmerIndexWriter() {
+    delete impl_;
+}
+
+void KmerIndexWriter::add(const KmerRecord& record) {
+    if (impl_->records_ > 0) {
+        ASSERT_FALSE(record < impl_->last_);
+    }
+    impl_->last_ = record;
+    impl_->out_.write(reinterpret_cast<const char*>(&record),
+                      sizeof(KmerRecord));
+    impl_->records_ += 1;
+}
+
+void KmerIndexWriter::close() {
+    if (!impl_->out_.is_open()) {
+        return;
+    }
+    std::ostream& out = impl_->out_;
+    out.seekp(offsetof(IndexHeader, records_));
+    out.write(reinterpret_cast<const char*>(&impl_->records_),
+              sizeof(uint64_t));
+    impl_->check();
+    impl_->out_.close();
+    impl_->check();
+}
+
+}
+
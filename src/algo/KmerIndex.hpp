@@ -0,0 +1,196 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef NPGE_KMER_INDEX_HPP_
+#define NPGE_KMER_INDEX_HPP_
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <boost/utility.hpp>
+
+#include "global.hpp"
+
+namespace npge {
+
+/** Occurrence of k-mer in sequence */
+struct KmerRecord {
+    hash_t hash_; /**< Canonical hash (see KmerScanner) */
+    uint32_t seq_; /**< Index of sequence, highest bit is set if reverse */
+    uint32_t pos_; /**< Min position of k-mer */
+
+    /** Default constructor */
+    KmerRecord() {
+    }
+
+    /** Constructor */
+    KmerRecord(hash_t hash, uint32_t seq, uint32_t pos, bool direct):
+        hash_(hash), seq_(seq | (direct ? 0 : REVERSE_BIT)),
+        pos_(pos) {
+    }
+
+    /** Return index of sequence */
+    uint32_t seq() const {
+        return seq_ & ~REVERSE_BIT;
+    }
+
+    /** Return if canonical hash is direct hash of k-mer */
+    bool direct() const {
+        return (seq_ & REVERSE_BIT) == 0;
+    }
+
+    /** Compare by hash, sequence and position */
+    bool operator<(const KmerRecord& o) const {
+        if (hash_ != o.hash_) {
+            return hash_ < o.hash_;
+        }
+        if (seq_ != o.seq_) {
+            return seq_ < o.seq_;
+        }
+        return pos_ < o.pos_;
+    }
+
+    /** Highest bit of seq_ */
+    static const uint32_t REVERSE_BIT = uint32_t(1) << 31;
+};
+
+typedef std::vector<KmerRecord> KmerRecords;
+
+/** Description of sequence in KmerIndex */
+struct KmerIndexSeq {
+    std::string name_;
+    pos_t size_;
+    hash_t fingerprint_; /**< KmerIndex::fingerprint() */
+};
+
+typedef std::vector<KmerIndexSeq> KmerIndexSeqs;
+
+/** Memory-mapped index of k-mers of sequences.
+
+Index file contains table of sequences and array of
+occurrences of k-mers (KmerRecord), sorted by hash.
+K-mers including N are not stored.
+
+Sequences are identified by fingerprint and size,
+so the index can be reused for sequences with changed names
+(e.g., consensuses of unchanged blocks).
+
+File format (native byte order):
+ - header: magic "NPGEKIDX", version, byte order mark,
+    anchor size, number of sequences, number of records,
+    total size of names;
+ - table of sequences: fingerprint, size, offset of name
+    and length of name for each sequence;
+ - names of sequences;
+ - padding to 8 bytes;
+ - records.
+*/
+class KmerIndex : boost::noncopyable {
+public:
+    /** Constructor */
+    KmerIndex();
+
+    /** Destructor */
+    ~KmerIndex();
+
+    /** Map index file into memory.
+    Return false if file does not exist or has wrong format.
+    */
+    bool open(const std::string& filename);
+
+    /** Unmap index file */
+    void close();
+
+    /** Return if index file is opened */
+    bool is_open() const;
+
+    /** Return length of k-mers */
+    int anchor() const;
+
+    /** Return sequences */
+    const KmerIndexSeqs& seqs() const;
+
+    /** Return number of records */
+    size_t size() const;
+
+    /** Return pointer to first record */
+    const KmerRecord* begin() const;
+
+    /** Return pointer after last record */
+    const KmerRecord* end() const;
+
+    /** Return range of records with the hash */
+    std::pair<const KmerRecord*, const KmerRecord*>
+    find(hash_t hash) const;
+
+    /** Return fingerprint of contents of sequence */
+    static hash_t fingerprint(const Sequence& seq);
+
+    /** Find all k-mers of the sequence and append them to records.
+    Records are not sorted.
+    \param seq Sequence.
+    \param seq_index Index of sequence (KmerRecord::seq()).
+    \param anchor Length of k-mer.
+    \param begin Start of first k-mer.
+    \param end Position after last letter of last k-mer
+        (-1 means seq.size()).
+    */
+    static void scan(KmerRecords& records, const Sequence& seq,
+                     uint32_t seq_index, int anchor,
+                     pos_t begin = 0, pos_t end = -1);
+
+    /** Write index file.
+    Records must be sorted.
+    */
+    static void write(const std::string& filename, int anchor,
+                      const KmerIndexSeqs& seqs,
+                      const KmerRecord* begin,
+                      const KmerRecord* end);
+
+private:
+    class Impl;
+    Impl* impl_;
+};
+
+/** Sequential writer of index file.
+Use it if records are not stored in one array.
+*/
+class KmerIndexWriter : boost::noncopyable {
+public:
+    /** Constructor.
+    \param filename File name.
+    \param anchor Length of k-mer.
+    \param seqs Sequences.
+    */
+    KmerIndexWriter(const std::string& filename, int anchor,
+                    const KmerIndexSeqs& seqs);
+
+    /** Destructor.
+    If close() was not called, the file is left incomplete
+    and KmerIndex::open() rejects it.
+    */
+    ~KmerIndexWriter();
+
+    /** Add record.
+    Records must be added in sorted order.
+    */
+    void add(const KmerRecord& record);
+
+    /** Finish writing.
+    Number of records is written to the header.
+    */
+    void close();
+
+private:
+    class Impl;
+    Impl* impl_;
+};
+
+}
+
+#endif
+
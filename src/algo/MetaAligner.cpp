@@ -13,6 +13,8 @@
 #include "MetaAligner.hpp"
 #include "ExternalAligner.hpp"
 #include "SimilarAligner.hpp"
+#include "BandedAligner.hpp"
+#include "ProgressiveAligner.hpp"
 #include "DummyAligner.hpp"
 #include "throw_assert.hpp"
 #include "global.hpp"
@@ -57,11 +59,14 @@ MetaAligner::MetaAligner() {
     add_aligner(new MafftAligner);
     add_aligner(new MuscleAligner);
     add_aligner(new SimilarAligner);
+    add_aligner(new BandedAligner);
+    add_aligner(new ProgressiveAligner);
     add_aligner(new DummyAligner);
     aligner_ = 0;
     add_gopt("aligner-type", "Type of aligner "
              "(external, mafft, muscle, "
-             "similar, dummy). Specify several types, "
+             "similar, banded, progressive, dummy). "
+             "Specify several types, "
              "separated by comma, the first working one "
              "will be used or the last one if all fail.",
              "ALIGNER");
@@ -73,14 +78,28 @@ void MetaAligner::add_aligner(AbstractAligner* aligner) {
     aligners_.push_back(aligner);
 }
 
-void MetaAligner::align_seqs_impl(Strings& seqs) const {
+const AbstractAligner* MetaAligner::selected() const {
     if (!aligner_) {
         std::string m;
         bool ok = check_type(m);
         ASSERT_TRUE(ok);
     }
     ASSERT_TRUE(aligner_);
-    aligner_->align_seqs(seqs);
+    return aligner_;
+}
+
+void MetaAligner::align_seqs_impl(Strings& seqs) const {
+    selected()->align_seqs(seqs);
+}
+
+void MetaAligner::align_seqs_batch_impl(
+    std::vector<Strings>& batch) const {
+    // external aligners send batches to aligner-server
+    selected()->align_seqs_batch(batch);
+}
+
+int MetaAligner::batch_size_impl() const {
+    return selected()->batch_size();
 }
 
 std::string MetaAligner::aligner_type() const {
@@ -33,12 +33,20 @@ protected:
 
     void align_seqs_impl(Strings& seqs) const;
 
+    /** Pass the batch to selected aligner */
+    void align_seqs_batch_impl(std::vector<Strings>& batch) const;
+
+    /** Return batch size of selected aligner */
+    int batch_size_impl() const;
+
 private:
     std::vector<AbstractAligner*> aligners_;
     mutable AbstractAligner* aligner_;
     mutable std::string last_aligners_;
 
     bool check_type(std::string& m) const;
+
+    const AbstractAligner* selected() const;
 };
 
 }
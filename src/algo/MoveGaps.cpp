@@ -18,6 +18,15 @@
 
 namespace npge {
 
+MoveGapsOptions::MoveGapsOptions():
+    max_tail(0) {
+}
+
+MoveGapsOptions::MoveGapsOptions(const Processor* p) {
+    max_tail = p->opt_value("max-tail").as<int>();
+    max_tail_to_gap = p->opt_value("max-tail-to-gap").as<Decimal>();
+}
+
 MoveGaps::MoveGaps() {
     add_row_storage_options(this);
     add_gopt("max-tail", "Max length of tail", "MAX_TAIL");
@@ -25,12 +34,15 @@ MoveGaps::MoveGaps() {
              "Max tail length to gap length ratio",
              "MAX_TAIL_TO_GAP");
     declare_bs("target", "Target blockset");
+    add_changed_only_options();
+    add_options_snapshot(&options_);
 }
 
 bool MoveGaps::move_gaps(Block* block) const {
     TimeIncrementer ti(this);
-    int max_tail = opt_value("max-tail").as<int>();
-    Decimal max_tail_to_gap = opt_value("max-tail-to-gap").as<Decimal>();
+    MoveGapsOptions o = options_.get(this);
+    int max_tail = o.max_tail;
+    Decimal max_tail_to_gap = o.max_tail_to_gap;
     int length = block->alignment_length();
     bool result = false;
     BOOST_FOREACH (Fragment* f, *block) {
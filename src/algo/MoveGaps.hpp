@@ -9,9 +9,23 @@
 #define NPGE_MOVE_GAPS_HPP_
 
 #include "BlocksJobs.hpp"
+#include "OptionsSnapshot.hpp"
+#include "Decimal.hpp"
 
 namespace npge {
 
+/** Values of options of MoveGaps */
+struct MoveGapsOptions {
+    int max_tail;
+    Decimal max_tail_to_gap;
+
+    /** Constructor */
+    MoveGapsOptions();
+
+    /** Read values of options of the processor */
+    MoveGapsOptions(const Processor* p);
+};
+
 /** Move terminal letters inside.
 Exmaple:
 Before: "aaaaa-----a". After: "aaaaaa-----".
@@ -29,6 +43,9 @@ protected:
     void process_block_impl(Block* block, ThreadData*) const;
 
     const char* name_impl() const;
+
+private:
+    OptionsSnapshot<MoveGapsOptions> options_;
 };
 
 }
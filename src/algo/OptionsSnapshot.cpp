@@ -0,0 +1,38 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include "OptionsSnapshot.hpp"
+#include "throw_assert.hpp"
+
+namespace npge {
+
+OptionsSnapshotBase::OptionsSnapshotBase():
+    bindings_(0) {
+}
+
+OptionsSnapshotBase::~OptionsSnapshotBase() {
+}
+
+void OptionsSnapshotBase::bind(const Processor* processor) {
+    // if resolve() throws, the snapshot is not bound
+    resolve(processor);
+    bindings_ += 1;
+}
+
+void OptionsSnapshotBase::unbind() {
+    ASSERT_GT(bindings_, 0);
+    bindings_ -= 1;
+}
+
+void OptionsSnapshotBase::refresh(const Processor* processor) {
+    if (bound()) {
+        resolve(processor);
+    }
+}
+
+}
+
@@ -0,0 +1,85 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef NPGE_OPTIONS_SNAPSHOT_HPP_
+#define NPGE_OPTIONS_SNAPSHOT_HPP_
+
+#include "global.hpp"
+
+namespace npge {
+
+/** Base class of typed snapshots of options of processor.
+Snapshot is bound when the processor or any of its ancestors
+is run. Options are resolved (including getters of global
+options) and checked once when the snapshot is bound and
+each time options of the processor or of its ancestors
+are changed while it is bound.
+
+\see Processor::add_options_snapshot
+*/
+class OptionsSnapshotBase {
+public:
+    /** Constructor */
+    OptionsSnapshotBase();
+
+    /** Destructor */
+    virtual ~OptionsSnapshotBase();
+
+    /** Resolve options and increase number of bindings */
+    void bind(const Processor* processor);
+
+    /** Decrease number of bindings */
+    void unbind();
+
+    /** Resolve options again if the snapshot is bound */
+    void refresh(const Processor* processor);
+
+    /** Return if the snapshot is bound */
+    bool bound() const {
+        return bindings_ != 0;
+    }
+
+protected:
+    /** Resolve options of the processor */
+    virtual void resolve(const Processor* processor) = 0;
+
+private:
+    int bindings_;
+};
+
+/** Typed snapshot of options.
+T must have constructor T(const Processor*),
+resolving values of options.
+*/
+template<typename T>
+class OptionsSnapshot : public OptionsSnapshotBase {
+public:
+    /** Return values of options.
+    If the snapshot is not bound (e.g., method of processor
+    is called outside of run()), options are resolved now.
+    */
+    T get(const Processor* processor) const {
+        if (bound()) {
+            return value_;
+        } else {
+            return T(processor);
+        }
+    }
+
+protected:
+    void resolve(const Processor* processor) {
+        value_ = T(processor);
+    }
+
+private:
+    T value_;
+};
+
+}
+
+#endif
+
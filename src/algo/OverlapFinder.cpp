@@ -36,13 +36,13 @@ ThreadData* OverlapFinder::before_thread_impl() const {
 
 void OverlapFinder::process_block_impl(Block* b,
                                        ThreadData* d) const {
-    Fragments ff;
     BOOST_FOREACH (Fragment* f, *b) {
-        s2f_.find_overlap_fragments(ff, f);
-        if (!ff.empty()) {
+        // exact for IndexFc, even if pattern fragments overlap
+        if (s2f_.has_overlap(f)) {
             OFData* data = D_CAST<OFData*>(d);
             SBlocks& hits = data->hits_;
             hits.push_back(b);
+            break;
         }
     }
 }
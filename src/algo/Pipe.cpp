@@ -10,7 +10,7 @@
 #include <boost/foreach.hpp>
 
 #include "Pipe.hpp"
-#include "block_hash.hpp"
+#include "BlockSet.hpp"
 
 namespace npge {
 
@@ -62,13 +62,13 @@ void Pipe::run_impl() const {
         processor->set_workers(workers());
     }
     std::set<hash_t> hashes;
-    hashes.insert(blockset_hash(*block_set(), workers()));
+    hashes.insert(block_set()->digest());
     impl_->stopped_ = false;
     for (int i = 0; i < max_iterations() || max_iterations() == -1; i++) {
         BOOST_FOREACH (Processor* processor, impl_->processors_) {
             processor->run();
         }
-        hash_t new_hash = blockset_hash(*block_set(), workers());
+        hash_t new_hash = block_set()->digest();
         if (hashes.find(new_hash) != hashes.end()) {
             break;
         }
@@ -22,6 +22,7 @@
 #include <boost/thread/mutex.hpp>
 
 #include "Processor.hpp"
+#include "OptionsSnapshot.hpp"
 #include "BlockSet.hpp"
 #include "FileWriter.hpp"
 #include "class_name.hpp"
@@ -124,6 +125,7 @@ struct ProcessorImpl {
     std::vector<Processor*> children_;
     Name2Option opts_;
     std::vector<Processor::OptionsChecker> checkers_;
+    std::vector<OptionsSnapshotBase*> snapshots_;
     Strings tmp_files_;
     std::string name_;
     std::string key_;
@@ -649,6 +651,18 @@ void Processor::apply_string_options(const std::string& options) {
     apply_vector_options(opts);
 }
 
+/* Unbinds snapshots of options after run() */
+class SnapshotsBinding {
+public:
+    std::vector<OptionsSnapshotBase*> bound_;
+
+    ~SnapshotsBinding() {
+        BOOST_FOREACH (OptionsSnapshotBase* snapshot, bound_) {
+            snapshot->unbind();
+        }
+    }
+};
+
 void Processor::run() const {
     TimeIncrementer ti(this);
     check_interruption();
@@ -658,6 +672,8 @@ void Processor::run() const {
         throw Exception("Errors in " + key() + "'s options: " +
                         join(errors, ", "));
     }
+    SnapshotsBinding binding;
+    bind_options_snapshots(binding.bound_);
     bool timing1 = timing();
     if (timing1) {
         write_log("begin");
@@ -672,6 +688,30 @@ void Processor::run() const {
     }
 }
 
+void Processor::add_options_snapshot(OptionsSnapshotBase* snapshot) {
+    impl_->snapshots_.push_back(snapshot);
+}
+
+void Processor::bind_options_snapshots(
+    std::vector<OptionsSnapshotBase*>& bound) const {
+    BOOST_FOREACH (OptionsSnapshotBase* snapshot, impl_->snapshots_) {
+        snapshot->bind(this);
+        bound.push_back(snapshot);
+    }
+    BOOST_FOREACH (Processor* child, impl_->children_) {
+        child->bind_options_snapshots(bound);
+    }
+}
+
+void Processor::refresh_options_snapshots() const {
+    BOOST_FOREACH (OptionsSnapshotBase* snapshot, impl_->snapshots_) {
+        snapshot->refresh(this);
+    }
+    BOOST_FOREACH (Processor* child, impl_->children_) {
+        child->refresh_options_snapshots();
+    }
+}
+
 void Processor::apply_to_block(Block* block) const {
     apply_to_block_impl(block);
 }
@@ -922,6 +962,7 @@ void Processor::set_opt_value(const std::string& name,
     if (!any_equal(v, opt.default_value_) || !opt.value_.empty()) {
         opt.value_ = v;
     }
+    refresh_options_snapshots();
 }
 
 void Processor::set_opt_getter(const std::string& name,
@@ -933,6 +974,7 @@ void Processor::set_opt_getter(const std::string& name,
     }
     Option& opt = it->second;
     opt.getter_ = getter;
+    refresh_options_snapshots();
 }
 
 void Processor::fix_opt_value(const std::string& name,
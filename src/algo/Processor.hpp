@@ -463,6 +463,13 @@ public:
     std::string tmp_file() const;
 
 protected:
+    /** Register snapshot of options of this processor.
+    The snapshot is bound during run() of this processor
+    and of its ancestors.
+    Snapshot must be a member of the processor.
+    */
+    void add_options_snapshot(OptionsSnapshotBase* snapshot);
+
     /** Add options to options description.
     Default implementation does nothing.
     \deprecated Add options in constructor of processor.
@@ -505,6 +512,9 @@ private:
     Impl* impl_;
 
     void log_processor(std::ostream& o, int depth);
+    void bind_options_snapshots(
+        std::vector<OptionsSnapshotBase*>& bound) const;
+    void refresh_options_snapshots() const;
     void copy_not_ignored(const po::options_description& source,
                           po::options_description& dest) const;
 };
@@ -0,0 +1,445 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <vector>
+#include <algorithm>
+#include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+
+#include "ProgressiveAligner.hpp"
+#include "GeneralAligner.hpp"
+#include "thread_group.hpp"
+#include "throw_assert.hpp"
+
+namespace npge {
+
+ProgressiveAligner::ProgressiveAligner() {
+    add_gopt("gap-range", "Max distance from main diagonal "
+             "of considered states of pair alignment",
+             "ALIGNER_GAP_RANGE");
+    add_gopt("gap-penalty", "Gap penalty", "ALIGNER_GAP_PENALTY");
+    add_gopt("mismatch-penalty", "Mismatch penalty",
+             "ALIGNER_MISMATCH_PENALTY");
+    add_opt_rule("gap-range >= 0");
+    add_opt_rule("gap-penalty > 0");
+    add_opt_rule("mismatch-penalty >= 0");
+}
+
+typedef std::vector<int> Ints;
+
+// guide tree
+
+const int KMER = 4;
+const int KMERS = 1 << (2 * KMER);
+
+static void count_kmers(Ints& counts, const std::string& seq) {
+    counts.assign(KMERS, 0);
+    int kmer = 0;
+    int good = 0; // number of last ACGT letters
+    for (int i = 0; i < seq.size(); i++) {
+        int code;
+        switch (seq[i]) {
+        case 'A':
+            code = 0;
+            break;
+        case 'C':
+            code = 1;
+            break;
+        case 'G':
+            code = 2;
+            break;
+        case 'T':
+            code = 3;
+            break;
+        default:
+            good = 0;
+            continue;
+        }
+        kmer = ((kmer << 2) | code) & (KMERS - 1);
+        good += 1;
+        if (good >= KMER) {
+            counts[kmer] += 1;
+        }
+    }
+}
+
+/** Return 1 - fraction of common k-mers */
+static double kmer_distance(const Ints& a, const Ints& b,
+                            int a_length, int b_length) {
+    int kmers = std::min(a_length, b_length) - KMER + 1;
+    if (kmers <= 0) {
+        return 1.0;
+    }
+    int common = 0;
+    for (int i = 0; i < KMERS; i++) {
+        common += std::min(a[i], b[i]);
+    }
+    return 1.0 - double(common) / double(kmers);
+}
+
+typedef std::pair<int, int> Merge;
+typedef std::vector<Merge> Merges;
+
+/** UPGMA on distance matrix.
+Each merge (i, j) joins cluster j into cluster i.
+*/
+class Upgma {
+public:
+    Upgma(int size):
+        size_(size), distances_(size * size, 0.0),
+        cluster_size_(size, 1), active_(size, true),
+        nearest_(size, -1) {
+    }
+
+    double& distance(int i, int j) {
+        return distances_[i * size_ + j];
+    }
+
+    void build(Merges& merges) {
+        for (int i = 0; i < size_; i++) {
+            update_nearest(i);
+        }
+        for (int round = 0; round < size_ - 1; round++) {
+            int best = -1;
+            for (int i = 0; i < size_; i++) {
+                if (active_[i] && nearest_[i] != -1 &&
+                        (best == -1 || distance(i, nearest_[i]) <
+                         distance(best, nearest_[best]))) {
+                    best = i;
+                }
+            }
+            ASSERT_NE(best, -1);
+            int i = std::min(best, nearest_[best]);
+            int j = std::max(best, nearest_[best]);
+            merge(i, j);
+            merges.push_back(Merge(i, j));
+        }
+    }
+
+private:
+    int size_;
+    std::vector<double> distances_;
+    Ints cluster_size_;
+    std::vector<bool> active_;
+    Ints nearest_;
+
+    void update_nearest(int i) {
+        nearest_[i] = -1;
+        for (int k = 0; k < size_; k++) {
+            if (k == i || !active_[k]) {
+                continue;
+            }
+            if (nearest_[i] == -1 ||
+                    distance(i, k) < distance(i, nearest_[i])) {
+                nearest_[i] = k;
+            }
+        }
+    }
+
+    void merge(int i, int j) {
+        double si = cluster_size_[i];
+        double sj = cluster_size_[j];
+        active_[j] = false;
+        cluster_size_[i] += cluster_size_[j];
+        for (int k = 0; k < size_; k++) {
+            if (k != i && active_[k]) {
+                double d = (si * distance(i, k) +
+                            sj * distance(j, k)) / (si + sj);
+                distance(i, k) = d;
+                distance(k, i) = d;
+            }
+        }
+        update_nearest(i);
+        for (int k = 0; k < size_; k++) {
+            if (k == i || !active_[k]) {
+                continue;
+            }
+            if (nearest_[k] == i || nearest_[k] == j) {
+                update_nearest(k);
+            } else if (distance(k, i) < distance(k, nearest_[k])) {
+                nearest_[k] = i;
+            }
+        }
+    }
+};
+
+static void count_kmers_range(std::vector<Ints>& counts,
+                              const Strings& seqs,
+                              int first, int last) {
+    for (int i = first; i < last; i++) {
+        count_kmers(counts[i], seqs[i]);
+    }
+}
+
+static void kmer_distances_rows(Upgma& upgma,
+                                const std::vector<Ints>& counts,
+                                const Strings& seqs,
+                                int first, int last) {
+    int size = seqs.size();
+    for (int i = first; i < last; i++) {
+        for (int j = i + 1; j < size; j++) {
+            double d = kmer_distance(counts[i], counts[j],
+                                     seqs[i].size(), seqs[j].size());
+            upgma.distance(i, j) = d;
+            upgma.distance(j, i) = d;
+        }
+    }
+}
+
+static void make_guide_tree(Merges& merges, const Strings& seqs) {
+    int size = seqs.size();
+    // sequences of giant block are processed in parallel
+    const int MIN_ROWS = 16;
+    std::vector<Ints> counts(size);
+    spawn_ranges(size, MIN_ROWS,
+                 boost::bind(count_kmers_range, boost::ref(counts),
+                             boost::cref(seqs), _1, _2));
+    Upgma upgma(size);
+    spawn_ranges(size, MIN_ROWS,
+                 boost::bind(kmer_distances_rows, boost::ref(upgma),
+                             boost::cref(counts), boost::cref(seqs),
+                             _1, _2));
+    upgma.build(merges);
+}
+
+// profiles
+
+const int SYMBOLS = 6; // A, C, G, T, other letter, gap
+const int GAP = 5;
+
+static int symbol_of(char c) {
+    switch (c) {
+    case 'A':
+        return 0;
+    case 'C':
+        return 1;
+    case 'G':
+        return 2;
+    case 'T':
+        return 3;
+    case '-':
+        return GAP;
+    default:
+        return 4;
+    }
+}
+
+struct Column {
+    int counts_[SYMBOLS];
+
+    Column() {
+        std::fill(counts_, counts_ + SYMBOLS, 0);
+    }
+
+    int letters() const {
+        int result = 0;
+        for (int i = 0; i < GAP; i++) {
+            result += counts_[i];
+        }
+        return result;
+    }
+};
+
+struct Profile {
+    Ints seqs_; // indices of sequences
+    Strings rows_;
+    std::vector<Column> columns_;
+
+    int length() const {
+        return columns_.size();
+    }
+};
+
+// column scores are multiplied by SCALE to keep precision
+const int SCALE = 10;
+
+struct ProfileContents {
+    const Profile* first_;
+    const Profile* second_;
+    int mismatch_penalty_;
+    int gap_penalty_;
+
+    int first_size() const {
+        return first_->length();
+    }
+
+    int second_size() const {
+        return second_->length();
+    }
+
+    int substitution(int row, int col) const {
+        const Column& a = first_->columns_[row];
+        const Column& b = second_->columns_[col];
+        int a_letters = a.letters();
+        int b_letters = b.letters();
+        int equal = 0;
+        for (int i = 0; i < GAP; i++) {
+            equal += a.counts_[i] * b.counts_[i];
+        }
+        int mismatches = a_letters * b_letters - equal;
+        int gaps = a.counts_[GAP] * b_letters +
+                   a_letters * b.counts_[GAP];
+        int pairs = first_->rows_.size() * second_->rows_.size();
+        int cost = SCALE * (mismatch_penalty_ * mismatches +
+                            gap_penalty_ * gaps);
+        return (cost + pairs / 2) / pairs;
+    }
+};
+
+static void make_profile(Profile& profile, int index,
+                         const std::string& seq) {
+    profile.seqs_.push_back(index);
+    profile.rows_.push_back(seq);
+    profile.columns_.resize(seq.size());
+    for (int i = 0; i < seq.size(); i++) {
+        profile.columns_[i].counts_[symbol_of(seq[i])] += 1;
+    }
+}
+
+static void append_column(Profile& result, Column& column,
+                          const Profile& part, int first_row,
+                          int col) {
+    for (int r = 0; r < part.rows_.size(); r++) {
+        std::string& row = result.rows_[first_row + r];
+        row += (col == -1) ? '-' : part.rows_[r][col];
+    }
+    if (col == -1) {
+        column.counts_[GAP] += part.rows_.size();
+    } else {
+        const Column& c = part.columns_[col];
+        for (int i = 0; i < SYMBOLS; i++) {
+            column.counts_[i] += c.counts_[i];
+        }
+    }
+}
+
+struct AlignerParams {
+    int gap_range_;
+    int gap_penalty_;
+    int mismatch_penalty_;
+};
+
+/** Align profile b to profile a, store result in a */
+static void align_profiles(Profile& a, const Profile& b,
+                           const AlignerParams& params) {
+    ProfileContents contents;
+    contents.first_ = &a;
+    contents.second_ = &b;
+    contents.mismatch_penalty_ = params.mismatch_penalty_;
+    contents.gap_penalty_ = params.gap_penalty_;
+    GeneralAligner<ProfileContents> aligner;
+    aligner.set_contents(contents);
+    aligner.set_gap_penalty(SCALE * params.gap_penalty_);
+    aligner.set_max_errors(-1);
+    aligner.set_vectorized(true);
+    aligner.set_gap_range(global_gap_range(params.gap_range_,
+                          a.length(), b.length()));
+    int a_last, b_last;
+    aligner.align(a_last, b_last);
+    ASSERT_EQ(a_last, a.length() - 1);
+    ASSERT_EQ(b_last, b.length() - 1);
+    PairAlignment alignment;
+    aligner.export_alignment(a_last, b_last, alignment);
+    Profile result;
+    result.seqs_ = a.seqs_;
+    result.seqs_.insert(result.seqs_.end(),
+                        b.seqs_.begin(), b.seqs_.end());
+    result.rows_.resize(result.seqs_.size());
+    BOOST_FOREACH (std::string& row, result.rows_) {
+        row.reserve(alignment.size());
+    }
+    result.columns_.resize(alignment.size());
+    for (int i = 0; i < alignment.size(); i++) {
+        const AlignmentPair& pair = alignment[i];
+        Column& column = result.columns_[i];
+        append_column(result, column, a, 0, pair.first);
+        append_column(result, column, b, a.rows_.size(), pair.second);
+    }
+    std::swap(a.seqs_, result.seqs_);
+    a.rows_.swap(result.rows_);
+    a.columns_.swap(result.columns_);
+}
+
+/** Merges of guide tree and their dependencies.
+Merges of different subtrees use different profiles,
+so they are run in parallel (see SpawnedTasks).
+*/
+struct MergesTree {
+    const Merges& merges_;
+    std::vector<Profile>& profiles_;
+    const AlignerParams& params_;
+    Ints left_; // merge producing first profile or -1
+    Ints right_; // merge producing second profile or -1
+
+    MergesTree(const Merges& merges, std::vector<Profile>& profiles,
+               const AlignerParams& params):
+        merges_(merges), profiles_(profiles), params_(params),
+        left_(merges.size(), -1), right_(merges.size(), -1) {
+        Ints last(profiles.size(), -1);
+        for (int m = 0; m < merges.size(); m++) {
+            const Merge& merge = merges[m];
+            left_[m] = last[merge.first];
+            right_[m] = last[merge.second];
+            last[merge.first] = m;
+        }
+    }
+
+    void align(int m) {
+        if (left_[m] != -1 && right_[m] != -1) {
+            SpawnedTasks subtasks;
+            subtasks.spawn(boost::bind(&MergesTree::align,
+                                       this, right_[m]));
+            align(left_[m]);
+            subtasks.wait();
+        } else if (left_[m] != -1) {
+            align(left_[m]);
+        } else if (right_[m] != -1) {
+            align(right_[m]);
+        }
+        const Merge& merge = merges_[m];
+        align_profiles(profiles_[merge.first], profiles_[merge.second],
+                       params_);
+        profiles_[merge.second] = Profile();
+    }
+};
+
+void ProgressiveAligner::align_seqs_impl(Strings& seqs) const {
+    int size = seqs.size();
+    if (size < 2) {
+        return;
+    }
+    AlignerParams params;
+    params.gap_range_ = opt_value("gap-range").as<int>();
+    params.gap_penalty_ = opt_value("gap-penalty").as<int>();
+    params.mismatch_penalty_ = opt_value("mismatch-penalty").as<int>();
+    Merges merges;
+    make_guide_tree(merges, seqs);
+    std::vector<Profile> profiles(size);
+    for (int i = 0; i < size; i++) {
+        make_profile(profiles[i], i, seqs[i]);
+    }
+    ASSERT_EQ(merges.size(), size - 1);
+    MergesTree tree(merges, profiles, params);
+    tree.align(merges.size() - 1);
+    Profile& profile = profiles[merges.back().first];
+    ASSERT_EQ(profile.seqs_.size(), size);
+    for (int i = 0; i < size; i++) {
+        seqs[profile.seqs_[i]].swap(profile.rows_[i]);
+    }
+}
+
+std::string ProgressiveAligner::aligner_type() const {
+    return "progressive";
+}
+
+const char* ProgressiveAligner::name_impl() const {
+    return "Align blocks with internal progressive aligner";
+}
+
+}
+
@@ -0,0 +1,45 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef NPGE_PROGRESSIVE_ALIGNER_HPP_
+#define NPGE_PROGRESSIVE_ALIGNER_HPP_
+
+#include "AbstractAligner.hpp"
+
+namespace npge {
+
+/** Align blocks with internal progressive aligner.
+
+Guide tree is built by UPGMA from k-mer distances
+between sequences. Then profiles are aligned to each other
+in the order of the tree by global banded Needleman-Wunsch
+(GeneralAligner with vectorized kernel).
+The band is widened to the difference of lengths
+of profiles up to a limit (see global_gap_range).
+Substitution score of two columns is the average score
+of all pairs of their letters.
+
+Unlike ExternalAligner, no processes or temporary files
+are used, so blocks are aligned by all workers in parallel.
+*/
+class ProgressiveAligner : public AbstractAligner {
+public:
+    /** Constructor */
+    ProgressiveAligner();
+
+protected:
+    std::string aligner_type() const;
+
+    const char* name_impl() const;
+
+    void align_seqs_impl(Strings& seqs) const;
+};
+
+}
+
+#endif
+
@@ -27,6 +27,11 @@ this block or sequence to all blocksets. Use "set=s1,s2,s3" to
 specify multiple sets.
 
 See stream >> block_set, stream >> alignment_row.
+
+Files in binary format (see BinaryWrite) are detected by
+contents and memory-mapped; their blocks and sequences are
+added to target blockset. Sequences already present in any
+of blocksets are reused.
 */
 class Read : public Processor {
 public:
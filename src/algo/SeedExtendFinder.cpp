@@ -0,0 +1,474 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <climits>
+#include <vector>
+#include <set>
+#include <string>
+#include <algorithm>
+#include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
+
+#include "SeedExtendFinder.hpp"
+#include "BlockSet.hpp"
+#include "Block.hpp"
+#include "Fragment.hpp"
+#include "Sequence.hpp"
+#include "simple_task.hpp"
+#include "complement.hpp"
+#include "global.hpp"
+
+namespace npge {
+
+SeedExtendFinder::SeedExtendFinder() {
+    add_gopt("blast-min-length", "min length of blast hit",
+             "MIN_LENGTH");
+    add_opt("seed-max-occurrences",
+            "Max number of occurrences of seed per genome; "
+            "seeds found more times (in all genomes) are ignored",
+            200);
+    add_opt("xdrop", "Extension stops when score drops "
+            "by this value below the best score", 20);
+    add_opt_rule("blast-min-length >= 0");
+    add_opt_rule("seed-max-occurrences >= 1");
+    add_opt_rule("xdrop > 0");
+    declare_bs("target", "Blockset in which hits are searched");
+}
+
+typedef boost::uint32_t u32;
+
+static const char SEED[] = "11101101010110111";
+static const int SEED_SPAN = sizeof(SEED) - 1;
+
+static const int MATCH = 1;
+static const int MISMATCH = -2;
+static const int GAP = -3;
+static const int NEG = INT_MIN / 2;
+
+// min score of ungapped hit which is extended with gaps
+static const int GAPPED_TRIGGER = 20;
+
+static int letter_code(char c) {
+    switch (c) {
+    case 'A':
+        return 0;
+    case 'T':
+        return 1;
+    case 'G':
+        return 2;
+    case 'C':
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+static int pair_score(char a, char b) {
+    return (a == b && letter_code(a) != 4) ? MATCH : MISMATCH;
+}
+
+/* hashes[i] is hash of seed started at i or -1 if the seed
+   includes letters other than ATGC */
+static void seed_hashes(const std::string& s, std::vector<int>& hashes) {
+    int n = int(s.size()) - SEED_SPAN + 1;
+    hashes.assign(std::max(n, 0), -1);
+    std::vector<int> codes(s.size());
+    for (int i = 0; i < s.size(); i++) {
+        codes[i] = letter_code(s[i]);
+    }
+    for (int i = 0; i < n; i++) {
+        int hash = 0;
+        bool good = true;
+        for (int k = 0; k < SEED_SPAN; k++) {
+            if (SEED[k] == '1') {
+                int c = codes[i + k];
+                if (c == 4) {
+                    good = false;
+                    break;
+                }
+                hash = (hash << 2) | c;
+            }
+        }
+        if (good) {
+            hashes[i] = hash;
+        }
+    }
+}
+
+struct SeedEntry {
+    u32 hash_;
+    u32 seq_;
+    u32 pos_;
+
+    bool operator<(const SeedEntry& o) const {
+        typedef boost::tuple<u32, u32, u32> Tie;
+        return Tie(hash_, seq_, pos_) < Tie(o.hash_, o.seq_, o.pos_);
+    }
+};
+
+static bool hash_less(const SeedEntry& a, const SeedEntry& b) {
+    return a.hash_ < b.hash_;
+}
+
+typedef std::vector<SeedEntry> SeedIndex;
+
+struct SeedHit {
+    int subject_;
+    int x_;
+    int y_;
+
+    bool operator<(const SeedHit& o) const {
+        typedef boost::tuple<int, int, int> Tie;
+        return Tie(subject_, x_, y_) < Tie(o.subject_, o.x_, o.y_);
+    }
+};
+
+/* Region of query (x) and subject (y) explored by
+   an extension. Seeds inside it are not extended again. */
+struct Box {
+    int x_min_, x_max_, y_min_, y_max_;
+    int diag_min_, diag_max_;
+
+    bool covers(int x, int y) const {
+        int diag = y - x;
+        return x >= x_min_ && x + SEED_SPAN - 1 <= x_max_ &&
+               y >= y_min_ && y + SEED_SPAN - 1 <= y_max_ &&
+               diag >= diag_min_ && diag <= diag_max_;
+    }
+};
+
+struct Hit {
+    int q_, q_min_, q_max_, q_ori_;
+    int s_, s_min_, s_max_;
+
+    typedef boost::tuple<int, int, int, int, int, int, int> Tie;
+
+    Tie tie() const {
+        return Tie(q_, q_min_, q_max_, q_ori_, s_, s_min_, s_max_);
+    }
+
+    bool operator<(const Hit& o) const {
+        return tie() < o.tie();
+    }
+
+    bool operator==(const Hit& o) const {
+        return tie() == o.tie();
+    }
+};
+
+typedef std::vector<Hit> Hits;
+
+struct SeedExtendContext {
+    std::vector<Sequence*> seqs_;
+    Strings letters_;
+    SeedIndex index_;
+    int max_occurrences_;
+    int xdrop_;
+    int min_length_;
+};
+
+static void index_sequence(const std::string& letters, int seq,
+                           SeedIndex& entries) {
+    std::vector<int> hashes;
+    seed_hashes(letters, hashes);
+    for (int i = 0; i < hashes.size(); i++) {
+        if (hashes[i] != -1) {
+            SeedEntry entry;
+            entry.hash_ = hashes[i];
+            entry.seq_ = seq;
+            entry.pos_ = i;
+            entries.push_back(entry);
+        }
+    }
+}
+
+/* Ungapped X-drop extension of seed (x, y) in both directions.
+   Returns score, writes ends of hit on a. */
+static int ungapped_extend(const std::string& a, const std::string& b,
+                           int x, int y, int xdrop,
+                           int& x_min, int& x_max) {
+    int score = 0;
+    for (int k = 0; k < SEED_SPAN; k++) {
+        score += pair_score(a[x + k], b[y + k]);
+    }
+    int best = 0, s = 0;
+    x_max = x + SEED_SPAN - 1;
+    for (int i = x + SEED_SPAN, j = y + SEED_SPAN;
+            i < a.size() && j < b.size(); i++, j++) {
+        s += pair_score(a[i], b[j]);
+        if (s > best) {
+            best = s;
+            x_max = i;
+        } else if (best - s > xdrop) {
+            break;
+        }
+    }
+    score += best;
+    best = s = 0;
+    x_min = x;
+    for (int i = x - 1, j = y - 1; i >= 0 && j >= 0; i--, j--) {
+        s += pair_score(a[i], b[j]);
+        if (s > best) {
+            best = s;
+            x_min = i;
+        } else if (best - s > xdrop) {
+            break;
+        }
+    }
+    score += best;
+    return score;
+}
+
+/* Gapped X-drop extension starting from a[a0] and b[b0]
+   in direction step (1 or -1). Only cells with score not less
+   than best - xdrop are kept, so the band follows the alignment.
+   Writes number of letters of a and b in the best alignment. */
+static void gapped_extend(const std::string& a, int a0,
+                          const std::string& b, int b0,
+                          int step, int xdrop,
+                          int& a_ext, int& b_ext) {
+    int a_len = (step == 1) ? int(a.size()) - a0 : a0 + 1;
+    int b_len = (step == 1) ? int(b.size()) - b0 : b0 + 1;
+    a_ext = b_ext = 0;
+    int best = 0;
+    // prev[j - lo] is score of cell (i - 1, j)
+    std::vector<int> prev, cur;
+    int lo = 0, hi = 0;
+    prev.push_back(0);
+    for (int j = 1; j <= b_len && GAP * j >= -xdrop; j++) {
+        prev.push_back(GAP * j);
+        hi = j;
+    }
+    for (int i = 1; i <= a_len; i++) {
+        char ca = a[a0 + step * (i - 1)];
+        cur.clear();
+        int new_lo = -1, new_hi = -1;
+        int left = NEG;
+        for (int j = lo; j <= b_len; j++) {
+            int v = left + GAP;
+            if (j <= hi) {
+                v = std::max(v, prev[j - lo] + GAP);
+            }
+            if (j - 1 >= lo && j - 1 <= hi) {
+                char cb = b[b0 + step * (j - 1)];
+                v = std::max(v, prev[j - 1 - lo] + pair_score(ca, cb));
+            }
+            if (v < best - xdrop) {
+                v = NEG;
+            }
+            if (j > hi + 1 && v == NEG) {
+                break;
+            }
+            cur.push_back(v);
+            if (v != NEG) {
+                if (new_lo == -1) {
+                    new_lo = j;
+                }
+                new_hi = j;
+                if (v > best) {
+                    best = v;
+                    a_ext = i;
+                    b_ext = j;
+                }
+            }
+            left = v;
+        }
+        if (new_lo == -1) {
+            break;
+        }
+        prev.assign(cur.begin() + (new_lo - lo),
+                    cur.begin() + (new_hi - lo + 1));
+        lo = new_lo;
+        hi = new_hi;
+    }
+}
+
+/* Pair of seeds is processed only by one of two queries:
+   (q, x) < (s, y), where x is position on forward strand.
+   Inverted seed can match itself (x == y). */
+static bool is_canonical(int q, int x0, int s, int y, int ori) {
+    if (q != s) {
+        return q < s;
+    }
+    return (ori == 1) ? (x0 < y) : (x0 <= y);
+}
+
+static void find_hits(const SeedExtendContext& ctx,
+                      int q, int ori, Hits& hits) {
+    // copy only to complement
+    std::string complemented;
+    if (ori == -1) {
+        complemented = ctx.letters_[q];
+        complement(complemented);
+    }
+    const std::string& a = (ori == 1) ? ctx.letters_[q] : complemented;
+    int len = a.size();
+    std::vector<int> hashes;
+    seed_hashes(a, hashes);
+    std::vector<SeedHit> seeds;
+    const SeedIndex& index = ctx.index_;
+    for (int p = 0; p < hashes.size(); p++) {
+        if (hashes[p] == -1) {
+            continue;
+        }
+        SeedEntry key;
+        key.hash_ = hashes[p];
+        std::pair<SeedIndex::const_iterator, SeedIndex::const_iterator>
+        range = std::equal_range(index.begin(), index.end(),
+                                 key, hash_less);
+        if (range.second - range.first > ctx.max_occurrences_) {
+            continue;
+        }
+        int x0 = (ori == 1) ? p : len - p - SEED_SPAN;
+        for (SeedIndex::const_iterator it = range.first;
+                it != range.second; ++it) {
+            if (is_canonical(q, x0, it->seq_, it->pos_, ori)) {
+                SeedHit seed;
+                seed.subject_ = it->seq_;
+                seed.x_ = p;
+                seed.y_ = it->pos_;
+                seeds.push_back(seed);
+            }
+        }
+    }
+    std::sort(seeds.begin(), seeds.end());
+    std::vector<Box> active;
+    int subject = -1;
+    BOOST_FOREACH (const SeedHit& seed, seeds) {
+        if (seed.subject_ != subject) {
+            subject = seed.subject_;
+            active.clear();
+        }
+        // seeds are sorted by x, drop boxes left behind
+        int x = seed.x_, y = seed.y_;
+        bool covered = false;
+        for (int i = 0; i < active.size();) {
+            if (active[i].x_max_ < x) {
+                active[i] = active.back();
+                active.pop_back();
+            } else {
+                covered = covered || active[i].covers(x, y);
+                i++;
+            }
+        }
+        if (covered) {
+            continue;
+        }
+        const std::string& b = ctx.letters_[subject];
+        Box box;
+        int score = ungapped_extend(a, b, x, y, ctx.xdrop_,
+                                    box.x_min_, box.x_max_);
+        box.y_min_ = box.x_min_ + (y - x);
+        box.y_max_ = box.x_max_ + (y - x);
+        if (score >= GAPPED_TRIGGER) {
+            int a_ext, b_ext;
+            gapped_extend(a, x - 1, b, y - 1, -1, ctx.xdrop_,
+                          a_ext, b_ext);
+            box.x_min_ = x - a_ext;
+            box.y_min_ = y - b_ext;
+            gapped_extend(a, x + SEED_SPAN, b, y + SEED_SPAN, 1,
+                          ctx.xdrop_, a_ext, b_ext);
+            box.x_max_ = x + SEED_SPAN - 1 + a_ext;
+            box.y_max_ = y + SEED_SPAN - 1 + b_ext;
+        }
+        int d1 = box.y_min_ - box.x_min_;
+        int d2 = box.y_max_ - box.x_max_;
+        int band = ctx.xdrop_ / -GAP;
+        box.diag_min_ = std::min(d1, d2) - band;
+        box.diag_max_ = std::max(d1, d2) + band;
+        active.push_back(box);
+        if (score < GAPPED_TRIGGER) {
+            continue;
+        }
+        int a_length = box.x_max_ - box.x_min_ + 1;
+        int b_length = box.y_max_ - box.y_min_ + 1;
+        if (std::min(a_length, b_length) < ctx.min_length_) {
+            continue;
+        }
+        Hit hit;
+        hit.q_ = q;
+        hit.q_ori_ = ori;
+        if (ori == 1) {
+            hit.q_min_ = box.x_min_;
+            hit.q_max_ = box.x_max_;
+        } else {
+            hit.q_min_ = len - 1 - box.x_max_;
+            hit.q_max_ = len - 1 - box.x_min_;
+        }
+        hit.s_ = subject;
+        hit.s_min_ = box.y_min_;
+        hit.s_max_ = box.y_max_;
+        hits.push_back(hit);
+    }
+}
+
+void SeedExtendFinder::run_impl() const {
+    SeedExtendContext ctx;
+    ctx.xdrop_ = opt_value("xdrop").as<int>();
+    ctx.min_length_ = opt_value("blast-min-length").as<int>();
+    std::set<std::string> genomes;
+    BOOST_FOREACH (SequencePtr seq, block_set()->seqs()) {
+        ctx.seqs_.push_back(seq.get());
+        ctx.letters_.push_back(seq->contents());
+        genomes.insert(seq->genome());
+    }
+    // conserved regions and repeats occur in each genome,
+    // so the limit grows with number of genomes
+    int per_genome = opt_value("seed-max-occurrences").as<int>();
+    int n_genomes = std::max(int(genomes.size()), 1);
+    ctx.max_occurrences_ = std::max(per_genome * n_genomes, 2);
+    int n = ctx.seqs_.size();
+    std::vector<SeedIndex> parts(n);
+    Tasks tasks;
+    for (int i = 0; i < n; i++) {
+        tasks.push_back(boost::bind(index_sequence,
+                                    boost::cref(ctx.letters_[i]), i,
+                                    boost::ref(parts[i])));
+    }
+    do_tasks(tasks_to_generator(tasks), workers());
+    BOOST_FOREACH (SeedIndex& part, parts) {
+        ctx.index_.insert(ctx.index_.end(), part.begin(), part.end());
+        SeedIndex().swap(part);
+    }
+    std::sort(ctx.index_.begin(), ctx.index_.end());
+    std::vector<Hits> results(2 * n);
+    tasks.clear();
+    for (int i = 0; i < n; i++) {
+        tasks.push_back(boost::bind(find_hits, boost::cref(ctx),
+                                    i, 1, boost::ref(results[2 * i])));
+        tasks.push_back(boost::bind(find_hits, boost::cref(ctx),
+                                    i, -1,
+                                    boost::ref(results[2 * i + 1])));
+    }
+    do_tasks(tasks_to_generator(tasks), workers());
+    Hits hits;
+    BOOST_FOREACH (const Hits& part, results) {
+        hits.insert(hits.end(), part.begin(), part.end());
+    }
+    std::sort(hits.begin(), hits.end());
+    hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+    BlockSet& target = *block_set();
+    BOOST_FOREACH (const Hit& hit, hits) {
+        Block* block = new Block;
+        block->insert(new Fragment(ctx.seqs_[hit.q_], hit.q_min_,
+                                   hit.q_max_, hit.q_ori_));
+        block->insert(new Fragment(ctx.seqs_[hit.s_], hit.s_min_,
+                                   hit.s_max_, 1));
+        target.insert(block);
+    }
+}
+
+const char* SeedExtendFinder::name_impl() const {
+    return "Find homologous regions by seeds and X-drop extension";
+}
+
+}
+
@@ -0,0 +1,45 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef NPGE_SEED_EXTEND_FINDER_HPP_
+#define NPGE_SEED_EXTEND_FINDER_HPP_
+
+#include "Processor.hpp"
+
+namespace npge {
+
+/** Find homologous pairs of regions without external blast.
+Sequences of target blockset are indexed by spaced seed
+(11101101010110111, weight 12). The seed is palindromic,
+so reverse complement of a query matches the index of
+forward strands and inverted repeats are found too.
+Each seed hit is extended without gaps (X-drop);
+good ungapped hits are extended with gaps (X-drop,
+match = 1, mismatch = -2, gap = -3).
+
+Each pair of regions is reported once as a block of
+two fragments. Hits shorter than blast-min-length
+are discarded.
+
+Query sequences are processed by workers in parallel.
+Results do not depend on number of workers.
+*/
+class SeedExtendFinder : public Processor {
+public:
+    /** Constructor */
+    SeedExtendFinder();
+
+protected:
+    void run_impl() const;
+
+    const char* name_impl() const;
+};
+
+}
+
+#endif
+
@@ -28,6 +28,41 @@ struct CmpSeqSize {
     }
 };
 
+/** Part of sequence, processed by one task.
+Starts of k-mers are in [begin_, end_ - anchor + 1).
+Neighbour parts of a sequence overlap by anchor - 1 letters.
+*/
+struct SeqPart {
+    Sequence* seq_;
+    int seq_index_; // index in SeqBase::seqs_
+    pos_t begin_;
+    pos_t end_; // position after last letter
+
+    SeqPart(Sequence* seq, int seq_index,
+            pos_t begin, pos_t end):
+        seq_(seq), seq_index_(seq_index),
+        begin_(begin), end_(end) {
+    }
+
+    pos_t size() const {
+        return end_ - begin_;
+    }
+};
+
+typedef std::vector<SeqPart> SeqParts;
+
+struct CmpPartSize {
+    bool operator()(const SeqPart& a, const SeqPart& b) {
+        return a.size() < b.size();
+    }
+};
+
+/** Min number of k-mers in one part of sequence */
+const pos_t MIN_PART_KMERS = 100000;
+
+/** Number of parts per worker (to balance load) */
+const int PARTS_PER_WORKER = 4;
+
 struct SeqBase {
     BlockSet& bs_;
 
@@ -36,6 +71,11 @@ struct SeqBase {
     Sequences seqs_;
     It it_, end_;
 
+    typedef SeqParts::iterator PartIt;
+
+    SeqParts parts_;
+    PartIt part_it_, parts_end_;
+
     int anchor_;
 
     SeqBase(BlockSet& bs):
@@ -55,6 +95,44 @@ struct SeqBase {
         it_ = seqs_.begin();
         end_ = seqs_.end();
     }
+
+    /** Split sequences (seqs_) into overlapping parts.
+    If workers = 1, each sequence is one part.
+    Otherwise long sequences are split, so that
+    each worker gets several parts.
+    */
+    void make_parts(int workers) {
+        parts_.clear();
+        size_t total_kmers = 0;
+        BOOST_FOREACH (Sequence* seq, seqs_) {
+            total_kmers += seq->size() - anchor_ + 1;
+        }
+        pos_t part_kmers = MAX_POS;
+        if (workers != 1) {
+            int parts = std::max(workers, 1) * PARTS_PER_WORKER;
+            size_t per_part = total_kmers / parts + 1;
+            part_kmers = std::max(MIN_PART_KMERS,
+                                  pos_t(std::min(per_part,
+                                                 size_t(MAX_POS))));
+        }
+        for (int i = 0; i < seqs_.size(); i++) {
+            Sequence* seq = seqs_[i];
+            pos_t kmers = seq->size() - anchor_ + 1;
+            for (pos_t b = 0; b < kmers; b += part_kmers) {
+                pos_t part_end = std::min(kmers, b + part_kmers);
+                parts_.push_back(SeqPart(seq, i, b,
+                                         part_end + anchor_ - 1));
+                if (part_end == kmers) {
+                    break;
+                }
+            }
+        }
+        // sort by size desc
+        std::stable_sort(parts_.rbegin(), parts_.rend(),
+                         CmpPartSize());
+        part_it_ = parts_.begin();
+        parts_end_ = parts_.end();
+    }
 };
 
 inline int ns_in_fragment(const Fragment& f) {
@@ -76,16 +154,16 @@ public:
 
     hash_t dir_, rev_;
 
-    SeqI(Sequence* seq, SeqBase* base):
+    SeqI(Sequence* seq, SeqBase* base, pos_t begin = 0):
         seq_(seq),
-        pos_(0),
+        pos_(begin),
         ns_(0),
         anchor_(base->anchor_) {
     }
 
     void init_state() {
-        ASSERT_GTE(seq_->size(), anchor_);
-        Fragment init_f(seq_, 0, anchor_ - 1);
+        ASSERT_GTE(seq_->size(), pos_ + anchor_);
+        Fragment init_f(seq_, pos_, pos_ + anchor_ - 1);
         ns_ = ns_in_fragment(init_f);
         dir_ = init_f.hash();
         init_f.inverse();
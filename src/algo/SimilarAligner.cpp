@@ -484,17 +484,31 @@ struct SimilarAlignerImpl {
     }
 };
 
+SimilarAlignerOptions::SimilarAlignerOptions():
+    mismatch_check(0), gap_check(0), aligned_check(0),
+    min_length(0) {
+}
+
+SimilarAlignerOptions::SimilarAlignerOptions(const Processor* p) {
+    mismatch_check = p->opt_value("mismatch-check").as<int>();
+    gap_check = p->opt_value("gap-check").as<int>();
+    aligned_check = p->opt_value("aligned-check").as<int>();
+    min_length = p->opt_value("min-length").as<int>();
+    min_identity = p->opt_value("min-identity").as<Decimal>();
+}
+
 void SimilarAligner::similar_aligner(Strings& seqs) const {
     TimeIncrementer ti(this);
     if (seqs.empty()) {
         return;
     }
+    SimilarAlignerOptions o = options_.get(this);
     SimilarAlignerImpl im;
-    im.mismatch_check_ = opt_value("mismatch-check").as<int>();
-    im.gap_check_ = opt_value("gap-check").as<int>();
-    im.aligned_check_ = opt_value("aligned-check").as<int>();
-    im.min_length_ = opt_value("min-length").as<int>();
-    im.min_identity_ = opt_value("min-identity").as<Decimal>();
+    im.mismatch_check_ = o.mismatch_check;
+    im.gap_check_ = o.gap_check;
+    im.aligned_check_ = o.aligned_check;
+    im.min_length_ = o.min_length;
+    im.min_identity_ = o.min_identity;
     im.process_seqs(seqs);
     im.fix_bad_regions(seqs);
     im.realing_end(seqs);
@@ -513,6 +527,7 @@ SimilarAligner::SimilarAligner() {
              "MIN_LENGTH");
     add_gopt("min-identity", "Min identity of block",
              "MIN_IDENTITY");
+    add_options_snapshot(&options_);
 }
 
 void SimilarAligner::align_seqs_impl(Strings& seqs) const {
@@ -9,9 +9,26 @@
 #define NPGE_SIMILAR_ALIGNER_PROCESSOR_HPP_
 
 #include "AbstractAligner.hpp"
+#include "OptionsSnapshot.hpp"
+#include "Decimal.hpp"
 
 namespace npge {
 
+/** Values of options of SimilarAligner */
+struct SimilarAlignerOptions {
+    int mismatch_check;
+    int gap_check;
+    int aligned_check;
+    int min_length;
+    Decimal min_identity;
+
+    /** Constructor */
+    SimilarAlignerOptions();
+
+    /** Read values of options of the processor */
+    SimilarAlignerOptions(const Processor* p);
+};
+
 /** Align blocks with high similarity with internal aligner */
 class SimilarAligner : public AbstractAligner {
 public:
@@ -33,6 +50,9 @@ protected:
     const char* name_impl() const;
 
     void align_seqs_impl(Strings& seqs) const;
+
+private:
+    OptionsSnapshot<SimilarAlignerOptions> options_;
 };
 
 }
@@ -9,6 +9,8 @@
 #include <boost/foreach.hpp>
 #include <boost/cast.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
 
 #include "SplitRepeats.hpp"
 #include "PrintTree.hpp"
@@ -19,6 +21,8 @@
 #include "BlockSet.hpp"
 #include "Fragment.hpp"
 #include "Sequence.hpp"
+#include "AlignmentMatrix.hpp"
+#include "simple_task.hpp"
 #include "throw_assert.hpp"
 #include "cast.hpp"
 
@@ -76,10 +80,13 @@ void fragmentsToClade(std::string& clade,
     }
 }
 
+// columns of giant blocks are processed in parallel
+const int MIN_COLUMNS = 1024;
+
 // 1 - ident, 2 - 2 variants, or 0
-void buildStatus(Ints& status, const Fragments& all) {
-    int length = status.size();
-    for (int pos = 0; pos < length; pos++) {
+void buildStatus(Ints& status, const Fragments& all,
+                 int first, int last) {
+    for (int pos = first; pos < last; pos++) {
         char first_letter = all[0]->alignment_at(pos);
         char second_letter = 0;
         bool gap = false;
@@ -119,7 +126,9 @@ void findDiag(Ints& diag_pos, const Ints& status) {
 void findDiagnostic(Ints& result, const Fragments& all) {
     int length = all[0]->alignment_length();
     Ints status((length)); // 1 - ident, 2 - 2 variants, or 0
-    buildStatus(status, all);
+    spawn_ranges(length, MIN_COLUMNS,
+                 boost::bind(buildStatus, boost::ref(status),
+                             boost::cref(all), _1, _2));
     findDiag(result, status);
 }
 
@@ -160,12 +169,25 @@ static void find_repeated(StringSet& repeated,
 
 typedef std::vector<int> Ints;
 
-static void find_mutations(Ints& mutations, const Block* block) {
-    int l = block->alignment_length();
-    for (int col = 0; col < l; col++) {
+static void mark_mutations(std::vector<char>& is_mutation,
+                           const AlignmentMatrix& matrix,
+                           int first, int last) {
+    for (int col = first; col < last; col++) {
         bool ident, gap;
-        test_column(block, col, ident, gap);
-        if (!ident || gap) {
+        matrix.test_column(col, ident, gap);
+        is_mutation[col] = (!ident || gap);
+    }
+}
+
+static void find_mutations(Ints& mutations,
+                           const AlignmentMatrix& matrix) {
+    int l = matrix.length();
+    std::vector<char> is_mutation(l);
+    spawn_ranges(l, MIN_COLUMNS,
+                 boost::bind(mark_mutations, boost::ref(is_mutation),
+                             boost::cref(matrix), _1, _2));
+    for (int col = 0; col < l; col++) {
+        if (is_mutation[col]) {
             mutations.push_back(col);
         }
     }
@@ -233,8 +255,10 @@ static void build_branches(BranchTable& branches,
 void SplitRepeats::process_block_impl(Block* block,
                                       ThreadData* data) const {
     int min_mutations = opt_value("min-mutations").as<int>();
+    // the block is not changed until new blocks are built
+    AlignmentMatrix matrix(block);
     AlignmentStat stat;
-    make_stat(stat, block);
+    make_stat(stat, block, matrix);
     int mutations = stat.ident_gap() + stat.noident_nogap() +
                     stat.noident_gap();
     if (mutations < min_mutations) {
@@ -242,7 +266,7 @@ void SplitRepeats::process_block_impl(Block* block,
         return;
     }
     Ints mutcols;
-    find_mutations(mutcols, block);
+    find_mutations(mutcols, matrix);
     int md = opt_value("min-diagnostic-mutations").as<int>();
     Fragments all_ff((block->begin()), block->end());
     // build tree by diagnostic positions
@@ -4,6 +4,7 @@
  */
 
 #include "goodColumns.hpp"
+#include "AlignmentMatrix.hpp"
 
 namespace npge {
 
@@ -174,8 +175,10 @@ static void mapGap(Scores& scores, int start, int length,
     }
 }
 
-Scores goodColumns(const char** rows, int nrows, int length,
-                   int min_identity, int min_length) {
+// Column is a functor: (index, good, ident_gap)
+template<typename Column>
+static Scores goodColumnsBase(Column column, int length,
+                              int min_identity, int min_length) {
     if (min_length == -1) {
         // longest than all possible gaps
         min_length = length;
@@ -187,8 +190,8 @@ Scores goodColumns(const char** rows, int nrows, int length,
     Scores scores(length);
     int gap_length = 0;
     for (int i = 0; i < length; i++) {
-        bool good = isColumnGood(rows, nrows, i);
-        bool ident_gap = isColumnIdentGap(rows, nrows, i);
+        bool good, ident_gap;
+        column(i, good, ident_gap);
         if (good) {
             scores[i] = MAX_COLUMN_SCORE;
         }
@@ -208,4 +211,42 @@ Scores goodColumns(const char** rows, int nrows, int length,
     return scores;
 }
 
+struct RowsColumn {
+    const char** rows_;
+    int nrows_;
+
+    void operator()(int i, bool& good, bool& ident_gap) const {
+        good = isColumnGood(rows_, nrows_, i);
+        ident_gap = isColumnIdentGap(rows_, nrows_, i);
+    }
+};
+
+Scores goodColumns(const char** rows, int nrows, int length,
+                   int min_identity, int min_length) {
+    RowsColumn column;
+    column.rows_ = rows;
+    column.nrows_ = nrows;
+    return goodColumnsBase(column, length, min_identity, min_length);
+}
+
+struct MatrixColumn {
+    const AlignmentMatrix* matrix_;
+
+    void operator()(int i, bool& good, bool& ident_gap) const {
+        bool ident, gap;
+        char letter = matrix_->test_column(i, ident, gap);
+        bool atgc = letter && letter != 'N';
+        good = atgc && ident && !gap;
+        ident_gap = atgc && ident && gap;
+    }
+};
+
+Scores goodColumns(const AlignmentMatrix& matrix,
+                   int min_identity, int min_length) {
+    MatrixColumn column;
+    column.matrix_ = &matrix;
+    return goodColumnsBase(column, matrix.length(),
+                           min_identity, min_length);
+}
+
 }
@@ -10,6 +10,8 @@
 
 #include <vector>
 
+#include "global.hpp"
+
 namespace npge {
 
 const int MAX_COLUMN_SCORE = 100;
@@ -19,6 +21,12 @@ typedef std::vector<int> Scores;
 Scores goodColumns(const char** rows, int nrows, int length,
                    int min_identity, int min_length);
 
+/** Same as above, columns are taken from the matrix.
+Gaps are 0 instead of '-', so test_column() of the matrix is used.
+*/
+Scores goodColumns(const AlignmentMatrix& matrix,
+                   int min_identity, int min_length);
+
 }
 
 #endif
@@ -690,7 +690,7 @@ end)
 register_p('ExtendAndFix', function()
     local p = Pipe.new()
     p:add('FragmentsExtender', '--extend-length-portion:=0.5')
-    p:add('FixEnds')
+    p:add('FixEnds', '--changed-only:=1')
     return p
 end)
 
@@ -712,7 +712,7 @@ register_p('AnchorLoop', function()
     local p = Pipe.new()
     p:set_name("Find anchors on consensuses, extend")
     p:declare_bs("target", "Blockset to check")
-    p:add('Filter')
+    p:add('Filter', '--changed-only:=1')
     p:add('Rest', 'target=target other=target')
     p:add('ConSeq', 'target=cons other=target')
     p:add('AnchorFinder', 'target=cons')
@@ -742,7 +742,7 @@ register_p('AnchorLoopFast', function()
     local p = Pipe.new()
     p:set_name("Find anchors on consensuses, extend (fast)")
     p:declare_bs("target", "Blockset to check")
-    p:add('Filter')
+    p:add('Filter', '--changed-only:=1')
     p:add('Rest', 'target=target other=target')
     p:add('ConSeq', 'target=cons other=target')
     p:add('AnchorFinder', 'target=cons')
@@ -759,7 +759,7 @@ end)
 
 register_p('AddBlastBlocksToSelf', function()
     local p = Pipe.new()
-    p:add('Filter')
+    p:add('Filter', '--changed-only:=1')
     p:add('Rest', 'target=target other=target')
     p:add('AddBlastBlocks', 'target=target other=target')
     return p
@@ -17,6 +17,7 @@
 #include "ImportBlastHits.hpp"
 #include "AddBlastBlocks.hpp"
 #include "AnchorFinder.hpp"
+#include "SeedExtendFinder.hpp"
 #include "Filter.hpp"
 #include "RemoveNonStem.hpp"
 #include "SameChr.hpp"
@@ -45,6 +46,7 @@
 #include "Pipe.hpp"
 #include "RawWrite.hpp"
 #include "Write.hpp"
+#include "BinaryWrite.hpp"
 #include "FragmentDistance.hpp"
 #include "FragmentFinder.hpp"
 #include "OverlapFinder.hpp"
@@ -76,6 +78,8 @@
 #include "Rest.hpp"
 #include "ExternalAligner.hpp"
 #include "SimilarAligner.hpp"
+#include "BandedAligner.hpp"
+#include "ProgressiveAligner.hpp"
 #include "DummyAligner.hpp"
 #include "MetaAligner.hpp"
 #include "RemoveAlignment.hpp"
@@ -109,6 +113,7 @@ void add_meta_lib(Meta* meta) {
     meta->set_processor<ImportBlastHits>();
     meta->set_processor<AddBlastBlocks>();
     meta->set_processor<AnchorFinder>();
+    meta->set_processor<SeedExtendFinder>();
     meta->set_processor<LiteFilter>();
     meta->set_processor<Filter>();
     meta->set_processor<RemoveNonStem>();
@@ -138,6 +143,7 @@ void add_meta_lib(Meta* meta) {
     meta->set_processor<Pipe>();
     meta->set_processor<RawWrite>();
     meta->set_processor<Write>();
+    meta->set_processor<BinaryWrite>();
     meta->set_processor<FragmentDistance>();
     meta->set_processor<FragmentFinder>();
     meta->set_processor<OverlapFinder>();
@@ -171,6 +177,8 @@ void add_meta_lib(Meta* meta) {
     meta->set_processor<MafftAligner>();
     meta->set_processor<MuscleAligner>();
     meta->set_processor<SimilarAligner>();
+    meta->set_processor<BandedAligner>();
+    meta->set_processor<ProgressiveAligner>();
     meta->set_processor<DummyAligner>();
     meta->set_processor<MetaAligner>();
     meta->set_processor<RemoveAlignment>();
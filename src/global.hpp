@@ -48,8 +48,11 @@ template<typename Contents> class GeneralAligner;
 class Sequence;
 class InMemorySequence;
 class CompactSequence;
+class KmerScanner;
 class Fragment;
 class AlignmentStat;
+class AlignmentMatrix;
+class BlockConsensus;
 class Block;
 class BlockSet;
 class AlignmentRow;
@@ -59,6 +62,8 @@ class BlockSetFastaReader;
 
 // algo
 class BloomFilter;
+class BlockedBloomFilter;
+class KmerIndex;
 class PairAligner;
 class ExpanderBase;
 class FileReader;
@@ -69,6 +74,7 @@ class Meta;
 class Processor;
 class Pipe;
 class BlocksJobs;
+class OptionsSnapshotBase;
 
 /** Shared pointer to BloomFilter */
 typedef boost::shared_ptr<BloomFilter> BloomFilterPtr;
@@ -94,13 +100,15 @@ class Exception;
 enum SequenceType {
     ASIS_SEQUENCE, /**< InMemorySequence */
     COMPACT_SEQUENCE, /**< CompactSequence */
-    COMPACT_LOW_N_SEQUENCE /**< CompactLowNSequence */
+    COMPACT_LOW_N_SEQUENCE, /**< CompactLowNSequence */
+    MAPPED_SEQUENCE /**< MappedSequence */
 };
 
 /** Type of AlignmentRow */
 enum RowType {
     MAP_ROW, /**< MapAlignmentRow */
-    COMPACT_ROW /**< CompactAlignmentRow */
+    COMPACT_ROW, /**< CompactAlignmentRow */
+    SUCCINCT_ROW /**< SuccinctAlignmentRow */
 };
 
 /** Creat new BlockSet and return shared pointer to it */
@@ -25,10 +25,24 @@
 AlignmentModel::AlignmentModel(const Block* block, QObject* parent) :
     QAbstractTableModel(parent),
     genes_s2f_(0),
-    has_genes_(false), show_genes_(true) {
+    has_genes_(false), show_genes_(true),
+    generation_(0) {
     set_block(block);
 }
 
+AlignmentModel::~AlignmentModel() {
+    stop_tile_builders();
+}
+
+void AlignmentModel::stop_tile_builders() {
+    if (source_) {
+        source_->cancelled = 1;
+    }
+    tile_pool_.waitForDone();
+}
+
+const int TILE_COLUMNS = 256;
+
 QColor colors_[5] = {
     QRgb(0xFF64F73F), // green
     QRgb(0xFF3C88EE), // blue
@@ -44,60 +58,57 @@ QVariant AlignmentModel::data(const QModelIndex& index, int role) const {
     if (role == Qt::TextAlignmentRole) {
         return Qt::AlignCenter;
     }
-    if (role == Qt::FontRole) {
+    if (role == Qt::ToolTipRole) {
         GeneInfo go;
         test_genes(index, &go);
-        if (go.is_reverse) {
+        QStringList gene_texts;
+        BOOST_FOREACH (Fragment* gene, go.genes) {
+            if (gene && gene->block()) {
+                QString gene_text = QString("%1, %2 bp %3")
+                       .arg(QString::fromStdString(gene->block()->name()))
+                       .arg(gene->length())
+                       .arg(go.is_reverse ? "<" : ">");
+                gene_texts << gene_text;
+            }
+        }
+        if (!go.genes.empty()) {
+            return gene_texts.join(" %< ");
+        }
+        return QVariant();
+    }
+    AlignmentCell cell;
+    if (!cell_at(index, cell)) {
+        // tile is not ready yet
+        return QVariant();
+    }
+    if (role == Qt::FontRole) {
+        if (cell.flags & CELL_REVERSE) {
             QFont font;
             font.setUnderline(true);
             return font;
         }
-    }
-    if (role == Qt::DisplayRole) {
-        Fragment* f = fragments_[index.row()];
-        return QChar(f->alignment_at(index.column()) ? : '-');
+    } else if (role == Qt::DisplayRole) {
+        return QChar(cell.letter ? : '-');
     } else if (role == Qt::BackgroundRole) {
-        GeneInfo go;
-        test_genes(index, &go);
-        if (go.is_start) {
+        if (cell.flags & CELL_START) {
             return Qt::black;
-        } else if (go.is_stop) {
+        } else if (cell.flags & CELL_STOP) {
             return Qt::gray;
-        } else if (go.gene_overlap) {
+        } else if (cell.flags & CELL_GENE_OVERLAP) {
             return Qt::magenta;
         }
-        Fragment* f = fragments_[index.row()];
-        char c = f->alignment_at(index.column());
-        if (c == 0) {
+        if (cell.letter == 0) {
             // gap
             return Qt::white;
         }
-        size_t s = char_to_size(c);
+        size_t s = char_to_size(cell.letter);
         if (s < 5) {
             return colors_[s];
         }
     } else if (role == Qt::ForegroundRole) {
-        GeneInfo go;
-        test_genes(index, &go);
-        if (go.is_gene) {
+        if (cell.flags & CELL_GENE) {
             return Qt::white;
         }
-    } else if (role == Qt::ToolTipRole) {
-        GeneInfo go;
-        test_genes(index, &go);
-        QStringList gene_texts;
-        BOOST_FOREACH (Fragment* gene, go.genes) {
-            if (gene && gene->block()) {
-                QString gene_text = QString("%1, %2 bp %3")
-                       .arg(QString::fromStdString(gene->block()->name()))
-                       .arg(gene->length())
-                       .arg(go.is_reverse ? "<" : ">");
-                gene_texts << gene_text;
-            }
-        }
-        if (!go.genes.empty()) {
-            return gene_texts.join(" %< ");
-        }
     }
     return QVariant();
 }
@@ -240,10 +251,12 @@ private:
 };
 
 void AlignmentModel::set_block_set(BlockSetPtr block_set) {
+    stop_tile_builders();
     block_set_ = block_set;
     s2f_.clear();
     s2f_.add_bs(*block_set_);
     s2f_.prepare();
+    invalidate_tiles();
 }
 
 void AlignmentModel::set_block(const Block* block) {
@@ -263,6 +276,7 @@ void AlignmentModel::set_block(const Block* block) {
     genes_.clear();
     genes_.resize(fragments_.size());
     has_genes_ = false;
+    invalidate_tiles();
     endResetModel();
 }
 
@@ -272,6 +286,7 @@ void AlignmentModel::set_fragments(const Fragments& ff) {
     genes_.clear();
     genes_.resize(fragments_.size());
     has_genes_ = false;
+    invalidate_tiles();
     endResetModel();
 }
 
@@ -298,6 +313,7 @@ void AlignmentModel::move_rows(std::vector<int>& rows, bool up) {
             prev_row = row;
         }
     }
+    invalidate_tiles();
     endResetModel();
 }
 
@@ -327,6 +343,7 @@ void AlignmentModel::add_genes(Fragment* fragment,
     if (fragment->ori() == -1) {
         std::reverse(g.begin(), g.end());
     }
+    invalidate_tiles();
     endResetModel();
 }
 
@@ -348,6 +365,7 @@ void AlignmentModel::set_split_parts(const Blocks& blocks) {
     }
     std::sort(fragments_.begin(), fragments_.end(),
               SeqComp(split_parts_));
+    invalidate_tiles();
 }
 
 void AlignmentModel::set_low_similarity(const Blocks& blocks) {
@@ -364,6 +382,7 @@ void AlignmentModel::set_low_similarity(const Blocks& blocks) {
 void AlignmentModel::set_show_genes(bool show_genes) {
     beginResetModel();
     show_genes_ = show_genes;
+    invalidate_tiles();
     endResetModel();
 }
 
@@ -374,75 +393,78 @@ Fragment* AlignmentModel::logical_neighbor(Fragment* f,
 
 void AlignmentModel::set_genes_s2f(const VectorFc* genes_s2f) {
     genes_s2f_ = genes_s2f;
-}
-
-// ori = -1 for start codon, 1 for stop codon
-bool AlignmentModel::is_gene_start_stop(
-    Fragment* gene, int ori) const {
-    Block* gene_block = gene->block();
-    using namespace boost::algorithm;
-    if (gene_block->name().find("CDS") == std::string::npos) {
-        return false;
-    }
-    if (gene_block->size() == 1) {
-        return true;
-    }
-    ASSERT_TRUE(genes_s2f_);
-    Fragment* neighbour =
-        genes_s2f_->logical_neighbor(gene, ori);
-    if (neighbour && neighbour->block() == gene_block) {
-        return false;
-    }
-    return true;
+    invalidate_tiles();
 }
 
 void AlignmentModel::test_genes(const QModelIndex& index,
                                 GeneInfo* gene_info) const {
-    gene_info->is_gene = false;
-    gene_info->is_reverse = false;
-    gene_info->is_start = false;
-    gene_info->is_stop = false;
-    gene_info->gene_overlap = false;
-    if (!has_genes_ || !show_genes_) {
+    gene_info_at(*source_, index.row(), index.column(), gene_info);
+}
+
+void AlignmentModel::invalidate_tiles() {
+    stop_tile_builders();
+    generation_ += 1;
+    boost::shared_ptr<TileSource> source(new TileSource);
+    source->fragments = fragments_;
+    source->genes = genes_;
+    source->genes_s2f = genes_s2f_;
+    source->show_genes = has_genes_ && show_genes_;
+    source_ = source;
+    tiles_.clear();
+    tiles_.resize((length_ + TILE_COLUMNS - 1) / TILE_COLUMNS);
+}
+
+void AlignmentModel::request_tile(int tile_index) const {
+    if (tile_index < 0 || tile_index >= tiles_.size() ||
+            tiles_[tile_index]) {
         return;
     }
-    Fragment* f = fragments_[index.row()];
-    const AlignmentRow* row = f->row();
-    int f_pos;
-    if (row) {
-        f_pos = row->map_to_fragment(index.column());
-    } else if (index.column() < f->length()) {
-        f_pos = index.column();
+    AlignmentTilePtr tile(new AlignmentTile);
+    tile->first_col = tile_index * TILE_COLUMNS;
+    tile->cols = std::min(TILE_COLUMNS, length_ - tile->first_col);
+    tile->ready = false;
+    tile->failed = false;
+    tiles_[tile_index] = tile;
+    TileBuilder* builder = new TileBuilder;
+    builder->source_ = source_;
+    builder->tile_ = tile;
+    builder->generation_ = generation_;
+    builder->tile_index_ = tile_index;
+    connect(builder, SIGNAL(tileBuilt(int, int)),
+            this, SLOT(on_tile_built(int, int)),
+            Qt::QueuedConnection);
+    tile_pool_.start(builder);
+}
+
+bool AlignmentModel::cell_at(const QModelIndex& index,
+                             AlignmentCell& cell) const {
+    int tile_index = index.column() / TILE_COLUMNS;
+    const AlignmentTilePtr& tile = tiles_[tile_index];
+    if (!tile || !tile->ready) {
+        request_tile(tile_index);
+        // neighbours are likely to be shown while scrolling
+        request_tile(tile_index + 1);
+        request_tile(tile_index - 1);
+        return false;
+    }
+    if (tile->failed) {
+        fill_cell(*source_, index.row(), index.column(), cell);
     } else {
-        return;
+        cell = tile->cell(index.row(), index.column());
     }
-    if (f_pos == -1) {
+    return true;
+}
+
+void AlignmentModel::on_tile_built(int generation, int tile_index) {
+    if (generation != generation_) {
         return;
     }
-    int s_pos = frag_to_seq(f, f_pos);
-    BOOST_FOREACH (Fragment* gene, genes_[index.row()]) {
-        if (gene->has(s_pos)) {
-            gene_info->is_gene = true;
-            gene_info->is_reverse = (gene->ori() != f->ori());
-            int g_pos = seq_to_frag(gene, s_pos);
-            if (g_pos < 3 && is_gene_start_stop(gene, -1)) {
-                gene_info->is_start = true;
-            }
-            if (g_pos >= gene->length() - 3 &&
-                    is_gene_start_stop(gene, 1)) {
-                gene_info->is_stop = true;
-            }
-            gene_info->genes.push_back(gene);
-        }
-    }
-    Fragments& genes = gene_info->genes;
-    std::sort(genes.begin(), genes.end(),
-              fragment_compare_g);
-    if (f->ori() == -1) {
-        std::reverse(genes.begin(), genes.end());
-    }
-    if (genes.size() >= 2) {
-        gene_info->gene_overlap = true;
+    AlignmentTile& tile = *tiles_[tile_index];
+    tile.ready = true;
+    if (!fragments_.empty()) {
+        emit dataChanged(index(0, tile.first_col),
+                         index(fragments_.size() - 1,
+                               tile.first_col + tile.cols - 1));
     }
 }
 
@@ -11,28 +11,31 @@
 #include <vector>
 #include <set>
 #include <QAbstractTableModel>
+#include <QThreadPool>
 
 #ifndef Q_MOC_RUN
 #include "global.hpp"
 #include "FragmentCollection.hpp"
+#include "AlignmentTiles.hpp"
 #endif
 
 using namespace npge;
 
-struct GeneInfo {
-    bool is_gene : 1;
-    bool is_reverse : 1;
-    bool is_start : 1;
-    bool is_stop : 1;
-    bool gene_overlap : 1;
-    Fragments genes;
-};
-
 class AlignmentModel : public QAbstractTableModel {
     Q_OBJECT
 public:
     explicit AlignmentModel(const Block* block = 0, QObject* parent = 0);
 
+    /** Destructor */
+    ~AlignmentModel();
+
+    /** Cancel tile builders and wait for them.
+    Must be called before blocks or genes shown by the model
+    are changed or deleted. Tiles are rebuilt after
+    the model is updated (set_block, set_genes_s2f, etc).
+    */
+    void stop_tile_builders();
+
     QVariant data(const QModelIndex& index,
                   int role = Qt::DisplayRole) const;
 
@@ -104,6 +107,9 @@ public slots:
 
     void set_genes_s2f(const VectorFc* genes_s2f);
 
+private slots:
+    void on_tile_built(int generation, int tile_index);
+
 private:
     std::vector<Fragment*> fragments_;
     std::vector<std::vector<Fragment*> > genes_;
@@ -117,8 +123,18 @@ private:
     const Block* block_;
     int length_;
     bool has_genes_, show_genes_;
+    // cells are calculated by tiles of columns in background;
+    // tiles are dropped when rows or genes change
+    TileSourcePtr source_;
+    mutable std::vector<AlignmentTilePtr> tiles_;
+    int generation_;
+    mutable QThreadPool tile_pool_;
+
+    void invalidate_tiles();
+
+    void request_tile(int tile_index) const;
 
-    bool is_gene_start_stop(Fragment* gene, int ori) const;
+    bool cell_at(const QModelIndex& index, AlignmentCell& cell) const;
 };
 
 #endif // ALIGNMENTMODEL_HPP
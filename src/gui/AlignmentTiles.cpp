@@ -0,0 +1,129 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <algorithm>
+#include <boost/foreach.hpp>
+
+#include "AlignmentTiles.hpp"
+#include "Block.hpp"
+#include "Fragment.hpp"
+#include "AlignmentRow.hpp"
+#include "FragmentCollection.hpp"
+#include "convert_position.hpp"
+#include "throw_assert.hpp"
+
+static struct FragmentCompareG {
+    bool operator()(Fragment* f1, Fragment* f2) const {
+        return *f1 < *f2;
+    }
+} fragment_compare_g;
+
+// ori = -1 for start codon, 1 for stop codon
+static bool is_gene_start_stop(const VectorFc* genes_s2f,
+                               Fragment* gene, int ori) {
+    Block* gene_block = gene->block();
+    if (gene_block->name().find("CDS") == std::string::npos) {
+        return false;
+    }
+    if (gene_block->size() == 1) {
+        return true;
+    }
+    ASSERT_TRUE(genes_s2f);
+    Fragment* neighbour = genes_s2f->logical_neighbor(gene, ori);
+    if (neighbour && neighbour->block() == gene_block) {
+        return false;
+    }
+    return true;
+}
+
+void gene_info_at(const TileSource& source, int row, int col,
+                  GeneInfo* gene_info) {
+    gene_info->is_gene = false;
+    gene_info->is_reverse = false;
+    gene_info->is_start = false;
+    gene_info->is_stop = false;
+    gene_info->gene_overlap = false;
+    if (!source.show_genes) {
+        return;
+    }
+    Fragment* f = source.fragments[row];
+    const AlignmentRow* alignment_row = f->row();
+    int f_pos;
+    if (alignment_row) {
+        f_pos = alignment_row->map_to_fragment(col);
+    } else if (col < f->length()) {
+        f_pos = col;
+    } else {
+        return;
+    }
+    if (f_pos == -1) {
+        return;
+    }
+    int s_pos = frag_to_seq(f, f_pos);
+    BOOST_FOREACH (Fragment* gene, source.genes[row]) {
+        if (gene->has(s_pos)) {
+            gene_info->is_gene = true;
+            gene_info->is_reverse = (gene->ori() != f->ori());
+            int g_pos = seq_to_frag(gene, s_pos);
+            if (g_pos < 3 &&
+                    is_gene_start_stop(source.genes_s2f, gene, -1)) {
+                gene_info->is_start = true;
+            }
+            if (g_pos >= gene->length() - 3 &&
+                    is_gene_start_stop(source.genes_s2f, gene, 1)) {
+                gene_info->is_stop = true;
+            }
+            gene_info->genes.push_back(gene);
+        }
+    }
+    Fragments& genes = gene_info->genes;
+    std::sort(genes.begin(), genes.end(), fragment_compare_g);
+    if (f->ori() == -1) {
+        std::reverse(genes.begin(), genes.end());
+    }
+    if (genes.size() >= 2) {
+        gene_info->gene_overlap = true;
+    }
+}
+
+void fill_cell(const TileSource& source, int row, int col,
+               AlignmentCell& cell) {
+    cell.letter = source.fragments[row]->alignment_at(col);
+    cell.flags = 0;
+    if (source.show_genes && !source.genes[row].empty()) {
+        GeneInfo go;
+        gene_info_at(source, row, col, &go);
+        cell.flags = (go.is_gene ? CELL_GENE : 0) |
+                     (go.is_reverse ? CELL_REVERSE : 0) |
+                     (go.is_start ? CELL_START : 0) |
+                     (go.is_stop ? CELL_STOP : 0) |
+                     (go.gene_overlap ? CELL_GENE_OVERLAP : 0);
+    }
+}
+
+void TileBuilder::run() {
+    const TileSource& source = *source_;
+    AlignmentTile& tile = *tile_;
+    try {
+        int rows = source.fragments.size();
+        tile.cells.resize(rows * tile.cols);
+        for (int row = 0; row < rows; row++) {
+            if (source.cancelled) {
+                tile.failed = true;
+                break;
+            }
+            AlignmentCell* cells = &tile.cells[row * tile.cols];
+            for (int i = 0; i < tile.cols; i++) {
+                fill_cell(source, row, tile.first_col + i, cells[i]);
+            }
+        }
+    } catch (...) {
+        tile.failed = true;
+    }
+    emit tileBuilt(generation_, tile_index_);
+}
+
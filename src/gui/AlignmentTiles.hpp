@@ -0,0 +1,102 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef ALIGNMENT_TILES_HPP
+#define ALIGNMENT_TILES_HPP
+
+#include <vector>
+#include <QtCore>
+
+#ifndef Q_MOC_RUN
+#include <boost/shared_ptr.hpp>
+#include "global.hpp"
+#include "gui-global.hpp"
+#endif
+
+using namespace npge;
+
+struct GeneInfo {
+    bool is_gene : 1;
+    bool is_reverse : 1;
+    bool is_start : 1;
+    bool is_stop : 1;
+    bool gene_overlap : 1;
+    Fragments genes;
+};
+
+/** Flags of genes in cell of alignment */
+enum CellFlags {
+    CELL_GENE = 1,
+    CELL_REVERSE = 2,
+    CELL_START = 4,
+    CELL_STOP = 8,
+    CELL_GENE_OVERLAP = 16
+};
+
+/** Cell of alignment as shown in AlignmentView */
+struct AlignmentCell {
+    char letter; /**< Letter or 0 for gap */
+    unsigned char flags; /**< CellFlags */
+};
+
+/** Rows of AlignmentModel and their genes.
+Snapshot is made each time the model is changed, so that
+tiles can be filled in background.
+Fragments are not copied: the model sets cancelled and
+waits for builders before the blocks can change.
+*/
+struct TileSource {
+    std::vector<Fragment*> fragments;
+    std::vector<Fragments> genes;
+    const VectorFc* genes_s2f;
+    bool show_genes; /**< has_genes && show_genes */
+    mutable QAtomicInt cancelled; /**< Builders stop if non-zero */
+};
+
+typedef boost::shared_ptr<const TileSource> TileSourcePtr;
+
+/** Range of columns of all rows of alignment */
+struct AlignmentTile {
+    int first_col;
+    int cols;
+    std::vector<AlignmentCell> cells; // by rows
+    bool ready; /**< Changed in GUI thread only */
+    bool failed;
+
+    const AlignmentCell& cell(int row, int col) const {
+        return cells[row * cols + col - first_col];
+    }
+};
+
+typedef boost::shared_ptr<AlignmentTile> AlignmentTilePtr;
+
+/** Find genes of alignment cell */
+void gene_info_at(const TileSource& source, int row, int col,
+                  GeneInfo* gene_info);
+
+/** Calculate alignment cell */
+void fill_cell(const TileSource& source, int row, int col,
+               AlignmentCell& cell);
+
+/** Fill tile in thread pool */
+struct TileBuilder : public QObject, public QRunnable {
+    Q_OBJECT
+
+public:
+    TileSourcePtr source_;
+    AlignmentTilePtr tile_;
+    int generation_;
+    int tile_index_;
+
+    void run();
+
+signals:
+    void tileBuilt(int generation, int tile_index);
+};
+
+#endif
+
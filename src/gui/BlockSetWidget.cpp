@@ -812,6 +812,7 @@ BlockSetWidget::~BlockSetWidget() {
 }
 
 void BlockSetWidget::set_block_set(BlockSetPtr block_set) {
+    alignment_model_->stop_tile_builders();
     block_set_model_->set_block_set(block_set);
     bsa_model_->set_block_set(block_set);
     alignment_model_->set_block_set(block_set);
@@ -833,6 +834,7 @@ BlockSetPtr BlockSetWidget::block_set() const {
 }
 
 void BlockSetWidget::set_genes(BlockSetPtr genes) {
+    alignment_model_->stop_tile_builders();
     block_set_model_->set_genes(genes);
     const VectorFc& genes_s2f = block_set_model_->genes_s2f();
     alignment_model_->set_genes_s2f(&genes_s2f);
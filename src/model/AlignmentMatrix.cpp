@@ -0,0 +1,175 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <string>
+#include <algorithm>
+#include <boost/foreach.hpp>
+
+#include "AlignmentMatrix.hpp"
+#include "Block.hpp"
+#include "Fragment.hpp"
+#include "Sequence.hpp"
+#include "AlignmentRow.hpp"
+#include "char_to_size.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace npge {
+
+AlignmentMatrix::AlignmentMatrix(const Block* block,
+                                 pos_t start, pos_t stop):
+    rows_(block->size()), length_(block->alignment_length()),
+    start_(start), stop_(stop) {
+    if (stop_ == -1 || stop_ >= length_) {
+        stop_ = length_ - 1;
+    }
+    pos_t columns = std::max(stop_ - start_ + 1, pos_t(0));
+    // one extra byte to make column() valid for empty matrix
+    data_.resize(size_t(rows_) * columns + 1, 0);
+    int row = 0;
+    BOOST_FOREACH (const Fragment* f, *block) {
+        if (start_ == 0 && stop_ == length_ - 1) {
+            read_fragment(f, &data_[row]);
+        } else {
+            read_columns(f, &data_[row]);
+        }
+        row += 1;
+    }
+}
+
+static bool is_valid(const Fragment* f) {
+    // fragment can be out of sequence, then only
+    // positions present in alignment row are read
+    return f->seq() && f->max_pos() < f->seq()->size();
+}
+
+void AlignmentMatrix::read_fragment(const Fragment* f, char* cell) {
+    const AlignmentRow* alignment_row = f->row();
+    bool valid = is_valid(f);
+    std::string letters;
+    if (valid) {
+        letters = f->substr(0, -1);
+    }
+    for (pos_t pos = 0; pos < f->length(); pos++) {
+        pos_t col = alignment_row ?
+                    alignment_row->map_to_alignment(pos) : pos;
+        if (col >= 0 && col < length_) {
+            cell[size_t(col) * rows_] = valid ? letters[pos] :
+                                        f->raw_at(pos);
+        }
+    }
+}
+
+void AlignmentMatrix::read_columns(const Fragment* f, char* cell) {
+    // only fragment positions within start_..stop_ are read
+    const AlignmentRow* alignment_row = f->row();
+    std::vector<pos_t> positions;
+    pos_t min_pos = -1, max_pos = -1;
+    for (pos_t col = start_; col <= stop_; col++) {
+        pos_t pos = alignment_row ? alignment_row->map_to_fragment(col) :
+                    (col < f->length() ? col : -1);
+        positions.push_back(pos);
+        if (pos != -1) {
+            if (min_pos == -1) {
+                min_pos = pos;
+            }
+            max_pos = pos;
+        }
+    }
+    if (min_pos == -1) {
+        return;
+    }
+    bool valid = is_valid(f);
+    std::string letters;
+    if (valid) {
+        letters = f->substr(min_pos, max_pos);
+    }
+    for (pos_t i = 0; i < positions.size(); i++) {
+        pos_t pos = positions[i];
+        if (pos != -1) {
+            cell[size_t(i) * rows_] = valid ? letters[pos - min_pos] :
+                                      f->raw_at(pos);
+        }
+    }
+}
+
+static void count_letter(char c, int* atgc) {
+    if (c != 0) {
+        size_t letter_index = char_to_size(c);
+        if (letter_index < LETTERS_NUMBER) {
+            atgc[letter_index] += 1;
+        }
+    }
+}
+
+char AlignmentMatrix::test_column(pos_t col, bool& ident, bool& gap,
+                                  int* atgc) const {
+    const char* cells = column(col);
+    int first = 0;
+    while (first < rows_ && cells[first] == 0) {
+        first++;
+    }
+    gap = (first > 0);
+    ident = true;
+    if (first == rows_) {
+        return 0;
+    }
+    char seen_letter = cells[first];
+    int i = first;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i seen = _mm_set1_epi8(seen_letter);
+    const __m128i a = _mm_set1_epi8('A');
+    const __m128i t = _mm_set1_epi8('T');
+    const __m128i g = _mm_set1_epi8('G');
+    const __m128i c = _mm_set1_epi8('C');
+    for (; i + 16 <= rows_; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(cells + i));
+        __m128i is_gap = _mm_cmpeq_epi8(v, zero);
+        __m128i is_seen = _mm_cmpeq_epi8(v, seen);
+        int gaps = _mm_movemask_epi8(is_gap);
+        gap |= (gaps != 0);
+        if (_mm_movemask_epi8(_mm_or_si128(is_gap, is_seen)) != 0xFFFF) {
+            ident = false;
+        }
+        if (atgc) {
+            int na = __builtin_popcount(_mm_movemask_epi8(
+                                            _mm_cmpeq_epi8(v, a)));
+            int nt = __builtin_popcount(_mm_movemask_epi8(
+                                            _mm_cmpeq_epi8(v, t)));
+            int ng = __builtin_popcount(_mm_movemask_epi8(
+                                            _mm_cmpeq_epi8(v, g)));
+            int nc = __builtin_popcount(_mm_movemask_epi8(
+                                            _mm_cmpeq_epi8(v, c)));
+            int letters = 16 - __builtin_popcount(gaps);
+            atgc[char_to_size('A')] += na;
+            atgc[char_to_size('T')] += nt;
+            atgc[char_to_size('G')] += ng;
+            atgc[char_to_size('C')] += nc;
+            // other letters are counted as N by char_to_size
+            atgc[char_to_size('N')] += letters - na - nt - ng - nc;
+        }
+    }
+#endif
+    for (; i < rows_; i++) {
+        char letter = cells[i];
+        if (letter == 0) {
+            gap = true;
+        } else if (letter != seen_letter) {
+            ident = false;
+        }
+        if (atgc) {
+            count_letter(letter, atgc);
+        }
+    }
+    return seen_letter;
+}
+
+}
+
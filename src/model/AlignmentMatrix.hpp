@@ -0,0 +1,103 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef NPGE_ALIGNMENT_MATRIX_HPP_
+#define NPGE_ALIGNMENT_MATRIX_HPP_
+
+#include <vector>
+#include <boost/utility.hpp>
+
+#include "global.hpp"
+
+namespace npge {
+
+/** Dense copy of alignment of block.
+Cells are stored column by column, one byte per cell.
+Value of a cell is the letter (as Fragment::alignment_at())
+or 0 for a gap.
+Rows follow the order of fragments in the block.
+
+The matrix does not track changes of the block.
+It takes a byte per cell (4 times more than the sequences),
+so it is built for one pass over the block and dropped.
+A processor building it should pass it to all functions
+examining columns of the block during the pass.
+*/
+class AlignmentMatrix : boost::noncopyable {
+public:
+    /** Build the matrix from the block.
+    Only columns from start to stop are stored
+    (stop = -1 means the last column).
+    Other columns must not be accessed.
+    Columns are indexed as in the block anyway.
+    */
+    AlignmentMatrix(const Block* block, pos_t start = 0, pos_t stop = -1);
+
+    /** Return number of rows */
+    int rows() const {
+        return rows_;
+    }
+
+    /** Return number of columns of the block */
+    pos_t length() const {
+        return length_;
+    }
+
+    /** Return first stored column */
+    pos_t start() const {
+        return start_;
+    }
+
+    /** Return last stored column */
+    pos_t stop() const {
+        return stop_;
+    }
+
+    /** Return cells of the column (rows() bytes) */
+    const char* column(pos_t col) const {
+        return &data_[0] + size_t(col - start_) * rows_;
+    }
+
+    /** Return cell (letter or 0 for a gap) */
+    char at(int row, pos_t col) const {
+        return column(col)[row];
+    }
+
+    /** Test one column.
+    Return first letter of the column or 0 if it consists of gaps.
+    \param col Index of column
+    \param ident Return if all letters of the column are equal
+    \param gap Return if the column contains gaps
+    \param atgc If not 0, number of letters is added to the array
+        (see test_column() from block_stat.hpp).
+    */
+    char test_column(pos_t col, bool& ident, bool& gap,
+                     int* atgc = 0) const;
+
+    /** Return if the column is identical and has no gaps */
+    bool is_ident_nogap(pos_t col) const {
+        bool ident, gap;
+        test_column(col, ident, gap);
+        return ident && !gap;
+    }
+
+private:
+    std::vector<char> data_;
+    int rows_;
+    pos_t length_;
+    pos_t start_;
+    pos_t stop_;
+
+    void read_fragment(const Fragment* f, char* cell);
+
+    void read_columns(const Fragment* f, char* cell);
+};
+
+}
+
+#endif
+
@@ -8,11 +8,15 @@
 #include <cctype>
 #include <algorithm>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "AlignmentRow.hpp"
 #include "Fragment.hpp"
 #include "throw_assert.hpp"
 #include "Exception.hpp"
+#include "small_object.hpp"
+#include "rank_select.hpp"
+#include "atomic.hpp"
 
 namespace npge {
 
@@ -31,7 +35,16 @@ AlignmentRow::~AlignmentRow() {
     }
 }
 
+void* AlignmentRow::operator new(size_t size) {
+    return small_object_allocate(size);
+}
+
+void AlignmentRow::operator delete(void* ptr, size_t size) {
+    small_object_deallocate(ptr, size);
+}
+
 void AlignmentRow::clear() {
+    changed();
     clear_impl();
 }
 
@@ -44,13 +57,21 @@ int AlignmentRow::map_to_fragment(int align_pos) const {
 }
 
 void AlignmentRow::bind(int fragment_pos, int align_pos) {
+    changed();
     bind_impl(fragment_pos, align_pos);
 }
 
 void AlignmentRow::grow(const std::string& alignment_string) {
+    changed();
     grow_impl(alignment_string);
 }
 
+void AlignmentRow::changed() {
+    if (fragment_) {
+        fragment_->alignment_changed();
+    }
+}
+
 void AlignmentRow::grow_impl(
     const std::string& alignment_string) {
     int align_pos = length();
@@ -114,6 +135,7 @@ int AlignmentRow::nearest_in_fragment_impl(
 
 void AlignmentRow::assign(const AlignmentRow& other,
                           int start, int stop) {
+    changed();
     assign_impl(other, start, stop);
 }
 
@@ -134,6 +156,8 @@ void AlignmentRow::assign_impl(const AlignmentRow& other,
 AlignmentRow* AlignmentRow::new_row(RowType type) {
     if (type == COMPACT_ROW) {
         return new CompactAlignmentRow;
+    } else if (type == SUCCINCT_ROW) {
+        return new SuccinctAlignmentRow;
     } else {
         // default = MAP_ROW
         return new MapAlignmentRow;
@@ -291,28 +315,16 @@ CompactAlignmentRow::Chunk::Chunk():
 }
 
 int CompactAlignmentRow::Chunk::size() const {
-    int s = 0;
-    for (int i = 0; i < BITS_IN_CHUNK; i++) {
-        if (get(i)) {
-            s += 1;
-        }
-    }
-    return s;
+    return popcount64(bitset);
 }
 
 int CompactAlignmentRow::Chunk::map_to_alignment(int fragment_pos) const {
     ASSERT_LT(fragment_pos, BITS_IN_CHUNK);
-    int fragment = 0;
-    for (int i = 0; i < BITS_IN_CHUNK; i++) {
-        if (get(i)) {
-            if (fragment == fragment_pos) {
-                return i;
-            }
-            fragment += 1;
-        }
+    if (fragment_pos >= size()) {
+        ASSERT_EQ(fragment_pos, 0);
+        return 0;
     }
-    ASSERT_EQ(fragment_pos, 0);
-    return 0;
+    return select64(bitset, fragment_pos);
 }
 
 int CompactAlignmentRow::Chunk::map_to_fragment(int align_pos) const {
@@ -320,13 +332,8 @@ int CompactAlignmentRow::Chunk::map_to_fragment(int align_pos) const {
     if (!get(align_pos)) {
         return -1;
     }
-    int result = 0;
-    for (int i = 0; i <= align_pos; i++) {
-        if (get(i)) {
-            result += 1;
-        }
-    }
-    return result - 1;
+    uint64_t below = bitset & ((uint64_t(1) << align_pos) - 1);
+    return popcount64(below);
 }
 
 bool CompactAlignmentRow::Chunk::get(int align_pos) const {
@@ -363,6 +370,184 @@ int CompactAlignmentRow::to_align_pos(const Chunk* chunk) const {
            / sizeof(Chunk) * BITS_IN_CHUNK;
 }
 
+const int WORD_BITS = 64;
+
+SuccinctAlignmentRow::SuccinctAlignmentRow(
+    const std::string& alignment_string,
+    Fragment* fragment):
+    AlignmentRow(fragment), letters_(0), last_(-1), outdated_(0) {
+    grow(alignment_string);
+}
+
+void SuccinctAlignmentRow::clear_impl() {
+    words_.clear();
+    ranks_.clear();
+    samples_.clear();
+    letters_ = 0;
+    last_ = -1;
+    outdated_ = 0;
+    set_length(0);
+}
+
+void SuccinctAlignmentRow::bind_impl(int /* fragment_pos */,
+                                     int align_pos) {
+    ASSERT_GTE(align_pos, 0);
+    int word = align_pos / WORD_BITS;
+    uint64_t bit = uint64_t(1) << (align_pos % WORD_BITS);
+    if (word < words_.size() && (words_[word] & bit)) {
+        return;
+    }
+    if (word >= words_.size()) {
+        words_.resize(word + 1, 0);
+        ranks_.resize(word + 1, letters_);
+    }
+    if (align_pos > last_ && !outdated_) {
+        if (letters_ % WORD_BITS == 0) {
+            samples_.push_back(word);
+        }
+        words_[word] |= bit;
+        letters_ += 1;
+        last_ = align_pos;
+    } else {
+        // letters_ and last_ are kept, ranks_ and samples_
+        // are rebuilt by update_index()
+        words_[word] |= bit;
+        letters_ += 1;
+        last_ = std::max(last_, align_pos);
+        outdated_ = 1;
+    }
+}
+
+// rebuilding of outdated index by concurrent readers
+static boost::mutex rebuild_mutex_;
+
+void SuccinctAlignmentRow::update_index() const {
+    if (atomic_load(&outdated_)) {
+        boost::mutex::scoped_lock lock(rebuild_mutex_);
+        if (outdated_) {
+            SuccinctAlignmentRow* self;
+            self = const_cast<SuccinctAlignmentRow*>(this);
+            self->rebuild_index();
+            atomic_store(&outdated_, 0);
+        }
+    }
+}
+
+void SuccinctAlignmentRow::rebuild_index() {
+    ranks_.resize(words_.size());
+    samples_.clear();
+    letters_ = 0;
+    last_ = -1;
+    for (int i = 0; i < words_.size(); i++) {
+        ranks_[i] = letters_;
+        uint64_t word = words_[i];
+        int ones = popcount64(word);
+        // word i has set bits letters_ .. letters_ + ones - 1
+        while (samples_.size() * WORD_BITS < letters_ + ones) {
+            samples_.push_back(i);
+        }
+        letters_ += ones;
+        if (word) {
+            last_ = i * WORD_BITS + WORD_BITS - 1 - __builtin_clzll(word);
+        }
+    }
+}
+
+int SuccinctAlignmentRow::rank(int align_pos) const {
+    update_index();
+    if (align_pos <= 0) {
+        return 0;
+    }
+    int word = align_pos / WORD_BITS;
+    if (word >= words_.size()) {
+        return letters_;
+    }
+    int bit = align_pos % WORD_BITS;
+    uint64_t below = words_[word] & ((uint64_t(1) << bit) - 1);
+    return ranks_[word] + popcount64(below);
+}
+
+int SuccinctAlignmentRow::select(int index) const {
+    update_index();
+    int sample = index / WORD_BITS;
+    Indexes::const_iterator begin = ranks_.begin() + samples_[sample];
+    Indexes::const_iterator end = ranks_.end();
+    if (sample + 1 < samples_.size()) {
+        end = ranks_.begin() + samples_[sample + 1] + 1;
+    }
+    // last word having <= index set bits before it
+    Indexes::const_iterator it = std::upper_bound(begin, end,
+                                 uint32_t(index));
+    --it;
+    int word = it - ranks_.begin();
+    return word * WORD_BITS + select64(words_[word], index - *it);
+}
+
+int SuccinctAlignmentRow::map_to_alignment_impl(
+    int fragment_pos) const {
+    if (fragment_pos >= length() || fragment_pos < 0) {
+        return -1;
+    }
+    if (fragment() && fragment_pos >= fragment()->length()) {
+        return -1;
+    }
+    if (fragment_pos >= letters_) {
+        return -1;
+    }
+    return select(fragment_pos);
+}
+
+int SuccinctAlignmentRow::map_to_fragment_impl(
+    int align_pos) const {
+    if (align_pos >= length() || align_pos < 0) {
+        return -1;
+    }
+    int word = align_pos / WORD_BITS;
+    if (word >= words_.size()) {
+        return -1;
+    }
+    if (!((words_[word] >> (align_pos % WORD_BITS)) & 1)) {
+        return -1;
+    }
+    return rank(align_pos);
+}
+
+int SuccinctAlignmentRow::nearest_in_fragment_impl(
+    int align_pos) const {
+    // same result as AlignmentRow's scan: closest letter,
+    // left one if distances are equal
+    int before = rank(std::min(align_pos, length()));
+    int prev_pos = -1;
+    if (before > 0) {
+        prev_pos = select(before - 1);
+        if (align_pos - prev_pos > length()) {
+            prev_pos = -1;
+        }
+    }
+    int next_pos = -1;
+    if (before < letters_) {
+        next_pos = select(before);
+        if (next_pos >= length() || next_pos - align_pos > length()) {
+            next_pos = -1;
+        }
+    }
+    if (prev_pos == -1 && next_pos == -1) {
+        return -1;
+    } else if (next_pos == -1) {
+        return before - 1;
+    } else if (prev_pos == -1) {
+        return before;
+    } else if (next_pos - align_pos < align_pos - prev_pos) {
+        return before;
+    } else {
+        return before - 1;
+    }
+}
+
+RowType SuccinctAlignmentRow::type_impl() const {
+    return SUCCINCT_ROW;
+}
+
 InversedRow::InversedRow(AlignmentRow* source):
     source_(0), fragment_length_(0) {
     set_source(source);
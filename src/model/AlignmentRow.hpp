@@ -10,6 +10,7 @@
 
 #include <map>
 #include <vector>
+#include <stdint.h>
 #include <string>
 #include <boost/utility.hpp>
 
@@ -23,6 +24,12 @@ public:
 
     virtual ~AlignmentRow();
 
+    /** Allocate memory (see small_object_allocate()) */
+    static void* operator new(size_t size);
+
+    /** Free memory (see small_object_deallocate()) */
+    static void operator delete(void* ptr, size_t size);
+
     void clear();
 
     /** Grow alignment row with string representing a part of alignment.
@@ -45,6 +52,7 @@ public:
 
     void set_length(int length) {
         length_ = length;
+        changed();
     }
 
     Fragment* fragment() const {
@@ -91,6 +99,9 @@ private:
         fragment_ = fragment;
     }
 
+    /* Tell the fragment that the row has changed */
+    void changed();
+
     friend class Fragment;
 };
 
@@ -165,6 +176,57 @@ private:
     friend struct ChunkCompare;
 };
 
+/** Alignment row stored as bit vector with rank/select index.
+Bit of alignment column is set if the column contains a letter.
+map_to_fragment() is rank: stored number of letters before
+the word plus popcount inside the word.
+map_to_alignment() is select: the word is found starting from
+sampled word of each 64th letter, the bit is found with PDEP.
+
+Binding in increasing order of positions is cheap.
+Other bindings mark the index as outdated; it is rebuilt
+once by the first query after binding.
+*/
+class SuccinctAlignmentRow : public AlignmentRow {
+public:
+    SuccinctAlignmentRow(const std::string& alignment_string = "",
+                         Fragment* fragment = 0);
+
+protected:
+    void clear_impl();
+
+    void bind_impl(int fragment_pos, int align_pos);
+
+    int map_to_alignment_impl(int fragment_pos) const;
+
+    int map_to_fragment_impl(int align_pos) const;
+
+    int nearest_in_fragment_impl(int align_pos) const;
+
+    RowType type_impl() const;
+
+private:
+    typedef std::vector<uint64_t> Words;
+    typedef std::vector<uint32_t> Indexes;
+
+    Words words_; // bit per alignment column
+    Indexes ranks_; // number of set bits before each word
+    Indexes samples_; // word containing each 64th set bit
+    int letters_; // number of set bits
+    int last_; // last set bit or -1
+    mutable volatile int outdated_; // ranks_ and samples_
+
+    void rebuild_index();
+
+    void update_index() const;
+
+    // number of set bits before align_pos
+    int rank(int align_pos) const;
+
+    // position of set bit number index (index < letters_)
+    int select(int index) const;
+};
+
 /** Proxy class for inversed row.
 Read-only.
 */
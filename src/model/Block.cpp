@@ -16,11 +16,14 @@
 #include "Block.hpp"
 #include "Fragment.hpp"
 #include "AlignmentRow.hpp"
+#include "BlockSet.hpp"
 #include "block_stat.hpp"
 #include "block_hash.hpp"
 #include "rand_name.hpp"
 #include "char_to_size.hpp"
 #include "convert_position.hpp"
+#include "small_object.hpp"
+#include "atomic.hpp"
 #include "throw_assert.hpp"
 #include "cast.hpp"
 
@@ -30,19 +33,31 @@ const int BLOCK_RAND_NAME_SIZE = 8;
 
 Block::Block():
     name_(BLOCK_RAND_NAME_SIZE, '0'),
-    weak_(false) {
+    weak_(false), block_set_(0), digest_hash_(0), changed_(0),
+    generation_(BlockSet::generation()) {
 }
 
 Block::Block(const std::string& name):
-    weak_(false) {
+    weak_(false), block_set_(0), digest_hash_(0), changed_(0),
+    generation_(BlockSet::generation()) {
     set_name(name);
 }
 
 Block::~Block() {
     clear();
+    alignment_changed();
+}
+
+void* Block::operator new(size_t size) {
+    return small_object_allocate(size);
+}
+
+void Block::operator delete(void* ptr, size_t size) {
+    small_object_deallocate(ptr, size);
 }
 
 void Block::insert(Fragment* fragment) {
+    mark_changed();
     fragments_.push_back(fragment);
     if (!weak() || !fragment->block_raw_ptr()) {
         fragment->set_block(this);
@@ -52,6 +67,7 @@ void Block::insert(Fragment* fragment) {
 void Block::erase(Fragment* fragment) {
     Impl::iterator it = std::find(begin(), end(), fragment);
     ASSERT_TRUE(it != end());
+    mark_changed();
     fragments_.erase(it);
     if (fragment->block_raw_ptr() == this) {
         fragment->set_block(0);
@@ -79,6 +95,7 @@ bool Block::has(Fragment* fragment) const {
 }
 
 void Block::clear() {
+    mark_changed();
     BOOST_FOREACH (Fragment* fragment, *this) {
         if (!weak() && fragment->block_raw_ptr() == this) {
             fragment->set_block(0);
@@ -89,6 +106,8 @@ void Block::clear() {
 }
 
 void Block::swap(Block& other) {
+    mark_changed();
+    other.mark_changed();
     fragments_.swap(other.fragments_);
     name_.swap(other.name_);
     std::swap(weak_, other.weak_);
@@ -383,6 +402,20 @@ void Block::set_weak(bool weak) {
         }
     }
     weak_ = weak;
+    mark_changed();
+}
+
+void Block::alignment_changed() {
+    generation_ = BlockSet::generation();
+}
+
+void Block::mark_changed() {
+    alignment_changed();
+    // fragments of the block can be changed from several threads
+    if (block_set_ && atomic_load(&changed_) == 0 &&
+            atomic_cas(&changed_, 0, 1)) {
+        block_set_->block_changed(this);
+    }
 }
 
 bool Block::operator==(const Block& other) const {
@@ -59,6 +59,12 @@ public:
     */
     ~Block();
 
+    /** Allocate memory (see small_object_allocate()) */
+    static void* operator new(size_t size);
+
+    /** Free memory (see small_object_deallocate()) */
+    static void operator delete(void* ptr, size_t size);
+
     /** Add fragment.
     If block is not weak or fragment is orphan,
     then fragment->block() is set to this block.
@@ -198,6 +204,15 @@ public:
     */
     void set_weak(bool weak);
 
+    /** Return generation of last change of the block.
+    It is updated when the block is created or inserted to
+    a blockset, when its fragments, their coordinates or
+    alignment rows change (see BlockSet::generation()).
+    */
+    unsigned int generation() const {
+        return generation_;
+    }
+
     /** Compare blocksets.
     This is implemented as comparison of hashes.
     */
@@ -207,6 +222,19 @@ private:
     Impl fragments_;
     std::string name_;
     bool weak_;
+    BlockSet* block_set_; // blockset maintaining digest for the block
+    hash_t digest_hash_; // contribution of the block to the digest
+    volatile int changed_; // block_set_ was told about the change
+    unsigned int generation_; // see BlockSet::generation()
+
+    /* Tell the blockset that hash of the block may have changed */
+    void mark_changed();
+
+    /* Update generation_ */
+    void alignment_changed();
+
+    friend class Fragment;
+    friend class BlockSet;
 };
 
 /** Streaming operator */
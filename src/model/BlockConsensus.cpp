@@ -0,0 +1,88 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <boost/foreach.hpp>
+
+#include "BlockConsensus.hpp"
+#include "AlignmentMatrix.hpp"
+#include "Block.hpp"
+#include "Fragment.hpp"
+#include "block_stat.hpp"
+#include "char_to_size.hpp"
+#include "throw_assert.hpp"
+
+namespace npge {
+
+static char majority(const int* freq) {
+    // first letter of maximum frequency,
+    // A for columns of gaps (see Block::consensus_char)
+    char result = 0;
+    for (int letter = 1; letter < LETTERS_NUMBER; letter++) {
+        if (freq[letter] > freq[int(result)]) {
+            result = letter;
+        }
+    }
+    return result;
+}
+
+BlockConsensus::BlockConsensus(const Block* block) {
+    AlignmentMatrix matrix(block);
+    bool has_rows = block->empty() || block->front()->row();
+    pos_t length = matrix.length();
+    if (has_rows) {
+        codes_.resize(length);
+    }
+    int ident_nogap = 0, ident_gap = 0;
+    int noident_nogap = 0, noident_gap = 0;
+    for (pos_t col = 0; col < length; col++) {
+        int freq[LETTERS_NUMBER] = {0};
+        bool ident, gap;
+        char letter = matrix.test_column(col, ident, gap, freq);
+        if (letter != 0) {
+            if (ident && !gap) {
+                ident_nogap += 1;
+            } else if (ident && gap) {
+                ident_gap += 1;
+            } else if (!ident && !gap) {
+                noident_nogap += 1;
+            } else {
+                noident_gap += 1;
+            }
+        }
+        if (has_rows) {
+            codes_[col] = majority(freq);
+        }
+    }
+    identity_ = block_identity(ident_nogap, ident_gap,
+                               noident_nogap, noident_gap);
+    if (!has_rows) {
+        Fragment* longest = block->front();
+        BOOST_FOREACH (Fragment* f, *block) {
+            ASSERT_MSG(!f->row(), "Alignment rows are set to some of "
+                       "fragments of block, being not set for other");
+            if (f->length() > longest->length()) {
+                longest = f;
+            }
+        }
+        std::string contents = longest->str();
+        codes_.resize(contents.size());
+        for (size_t i = 0; i < contents.size(); i++) {
+            codes_[i] = char_to_size(contents[i]);
+        }
+    }
+}
+
+std::string BlockConsensus::str() const {
+    std::string result(codes_.size(), 'N');
+    for (size_t i = 0; i < codes_.size(); i++) {
+        result[i] = size_to_char(codes_[i]);
+    }
+    return result;
+}
+
+}
+
@@ -0,0 +1,58 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef NPGE_BLOCK_CONSENSUS_HPP_
+#define NPGE_BLOCK_CONSENSUS_HPP_
+
+#include <vector>
+#include <boost/utility.hpp>
+
+#include "global.hpp"
+#include "Decimal.hpp"
+
+namespace npge {
+
+/** Consensus of block and its identity.
+Both are computed in one pass over AlignmentMatrix of the block.
+Letters of consensus are stored as codes returned by
+char_to_size() (A=0, T=1, G=2, C=3, N=4).
+Column majorities are chosen as in Block::consensus_char().
+If alignment rows are not set, the consensus is
+the longest fragment (as in Block::consensus()).
+*/
+class BlockConsensus : boost::noncopyable {
+public:
+    /** Build the consensus of the block */
+    BlockConsensus(const Block* block);
+
+    /** Return length of consensus */
+    pos_t length() const {
+        return codes_.size();
+    }
+
+    /** Return codes of letters of consensus (length() bytes) */
+    const char* codes() const {
+        return codes_.empty() ? 0 : &codes_[0];
+    }
+
+    /** Return consensus as string of letters */
+    std::string str() const;
+
+    /** Return identity of block (see block_identity()) */
+    const Decimal& identity() const {
+        return identity_;
+    }
+
+private:
+    std::vector<char> codes_;
+    Decimal identity_;
+};
+
+}
+
+#endif
+
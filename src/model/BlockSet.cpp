@@ -15,6 +15,7 @@
 #include <boost/tuple/tuple.hpp>
 #include <boost/tuple/tuple_comparison.hpp>
 #include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "BlockSet.hpp"
 #include "read_block_set.hpp"
@@ -27,18 +28,68 @@
 #include "throw_assert.hpp"
 #include "block_hash.hpp"
 #include "global.hpp"
+#include "atomic.hpp"
 
 namespace npge {
 
 typedef std::map<std::string, SequencePtr> Name2Seq;
 typedef std::map<std::string, BSA> Name2BSA;
+typedef std::map<Block*, hash_t> Block2Hash;
+
+struct RemovedFragment {
+    unsigned int generation_;
+    Fragment fragment_;
+
+    RemovedFragment(unsigned int generation, const Fragment& fragment):
+        generation_(generation), fragment_(fragment) {
+    }
+};
+
+typedef std::vector<RemovedFragment> RemovedFragments;
+
+// see BlockSet::generation()
+static volatile unsigned int global_generation = 1;
+
+// max number of remembered removed fragments per block in blockset
+const int MAX_REMOVED_PER_BLOCK = 4;
+const int MIN_MAX_REMOVED = 1024;
 
 struct BlockSet::I {
     BlockSet::Impl blocks_;
     std::set<SequencePtr> seqs_;
     Name2BSA bsas_;
+
+    // digest() = XOR of Block::digest_hash_ of own blocks
+    // and of values of foreign_
+    hash_t digest_;
+    // own blocks to be rehashed by digest()
+    BlockSet::Impl changed_;
+    // blocks owned by other blockset, rehashed by each digest()
+    Block2Hash foreign_;
+    // blocks can be changed from worker threads
+    boost::mutex changed_mutex_;
+
+    // see track_changes()
+    bool track_changes_;
+    // changes before this generation are unknown
+    unsigned int unknown_before_;
+    // see removed_since()
+    RemovedFragments removed_;
+
+    I():
+        digest_(0), track_changes_(false), unknown_before_(0) {
+    }
+
+    void forget_changes() {
+        unknown_before_ = BlockSet::generation() + 1;
+        RemovedFragments().swap(removed_);
+    }
 };
 
+static hash_t digest_hash(const Block* block) {
+    return (block->size() >= 2) ? block_hash(block) : 0;
+}
+
 BlockSet::BlockSet() {
     impl_ = new I;
 }
@@ -75,6 +126,16 @@ void BlockSet::insert(Block* block) {
     Impl& blocks = impl_->blocks_;
     ASSERT_TRUE(blocks.find(block) == blocks.end());
     blocks.insert(block);
+    block->generation_ = generation();
+    boost::mutex::scoped_lock lock(impl_->changed_mutex_);
+    if (block->block_set_) {
+        impl_->foreign_[block] = 0;
+    } else {
+        block->block_set_ = this;
+        block->digest_hash_ = 0;
+        atomic_store(&block->changed_, 1);
+        impl_->changed_.insert(block);
+    }
 }
 
 void BlockSet::erase(Block* block) {
@@ -83,7 +144,34 @@ void BlockSet::erase(Block* block) {
 }
 
 void BlockSet::detach(Block* block) {
-    impl_->blocks_.erase(block);
+    if (impl_->blocks_.erase(block) == 0) {
+        return;
+    }
+    if (impl_->track_changes_) {
+        int max_removed = std::max(MIN_MAX_REMOVED,
+                                   MAX_REMOVED_PER_BLOCK * size());
+        if (impl_->removed_.size() + block->size() > size_t(max_removed)) {
+            impl_->forget_changes();
+        } else {
+            BOOST_FOREACH (Fragment* fragment, *block) {
+                impl_->removed_.push_back(RemovedFragment(generation(),
+                                          *fragment));
+            }
+        }
+    }
+    boost::mutex::scoped_lock lock(impl_->changed_mutex_);
+    if (block->block_set_ == this) {
+        impl_->digest_ ^= block->digest_hash_;
+        impl_->changed_.erase(block);
+        block->block_set_ = 0;
+        block->digest_hash_ = 0;
+        atomic_store(&block->changed_, 0);
+    } else {
+        Block2Hash::iterator it = impl_->foreign_.find(block);
+        ASSERT_TRUE(it != impl_->foreign_.end());
+        impl_->digest_ ^= it->second;
+        impl_->foreign_.erase(it);
+    }
 }
 
 int BlockSet::size() const {
@@ -116,9 +204,17 @@ void BlockSet::clear() {
 
 void BlockSet::clear_blocks() {
     BOOST_FOREACH (Block* block, *this) {
+        if (block->block_set_ == this) {
+            block->block_set_ = 0;
+        }
         delete block;
     }
     impl_->blocks_.clear();
+    boost::mutex::scoped_lock lock(impl_->changed_mutex_);
+    impl_->digest_ = 0;
+    impl_->changed_.clear();
+    impl_->foreign_.clear();
+    RemovedFragments().swap(impl_->removed_);
 }
 
 void BlockSet::clear_seqs() {
@@ -159,6 +255,28 @@ void BlockSet::clear_bsas() {
 }
 
 void BlockSet::swap(BlockSet& other) {
+    std::vector<Block*> own, other_own;
+    BOOST_FOREACH (Block* block, *this) {
+        if (block->block_set_ == this) {
+            own.push_back(block);
+        }
+    }
+    BOOST_FOREACH (Block* block, other) {
+        if (block->block_set_ == &other) {
+            other_own.push_back(block);
+        }
+    }
+    BOOST_FOREACH (Block* block, own) {
+        block->block_set_ = &other;
+    }
+    BOOST_FOREACH (Block* block, other_own) {
+        block->block_set_ = this;
+    }
+    impl_->forget_changes();
+    other.impl_->forget_changes();
+    std::swap(impl_->digest_, other.impl_->digest_);
+    impl_->changed_.swap(other.impl_->changed_);
+    impl_->foreign_.swap(other.impl_->foreign_);
     impl_->blocks_.swap(other.impl_->blocks_);
     impl_->seqs_.swap(other.impl_->seqs_);
     impl_->bsas_.swap(other.impl_->bsas_);
@@ -197,8 +315,88 @@ BlockSet::const_iterator BlockSet::end() const {
     return impl_->blocks_.end();
 }
 
+hash_t BlockSet::digest() const {
+    I& impl = *impl_;
+    boost::mutex::scoped_lock lock(impl.changed_mutex_);
+    BlockSet::Impl weak_blocks;
+    BOOST_FOREACH (Block* block, impl.changed_) {
+        impl.digest_ ^= block->digest_hash_;
+        block->digest_hash_ = digest_hash(block);
+        impl.digest_ ^= block->digest_hash_;
+        if (block->weak()) {
+            // fragments of weak block do not report changes
+            weak_blocks.insert(block);
+        } else {
+            atomic_store(&block->changed_, 0);
+        }
+    }
+    impl.changed_.swap(weak_blocks);
+    Block2Hash::iterator it = impl.foreign_.begin();
+    while (it != impl.foreign_.end()) {
+        Block* block = it->first;
+        impl.digest_ ^= it->second;
+        hash_t hash = digest_hash(block);
+        impl.digest_ ^= hash;
+        if (block->block_set_) {
+            it->second = hash;
+            ++it;
+        } else {
+            // owner has detached the block
+            block->block_set_ = const_cast<BlockSet*>(this);
+            block->digest_hash_ = hash;
+            atomic_store(&block->changed_, block->weak() ? 1 : 0);
+            if (block->weak()) {
+                impl.changed_.insert(block);
+            }
+            impl.foreign_.erase(it++);
+        }
+    }
+    return impl.digest_;
+}
+
+unsigned int BlockSet::generation() {
+    return atomic_load(&global_generation);
+}
+
+unsigned int BlockSet::new_generation() {
+    return atomic_fetch_add(&global_generation, 1u) + 1;
+}
+
+void BlockSet::track_changes() {
+    if (!impl_->track_changes_) {
+        impl_->track_changes_ = true;
+        impl_->forget_changes();
+    }
+}
+
+void BlockSet::changed_since(unsigned int generation,
+                             std::vector<Block*>& blocks) const {
+    bool all = !impl_->track_changes_ ||
+               generation < impl_->unknown_before_;
+    BOOST_FOREACH (Block* block, *this) {
+        if (all || block->weak() ||
+                block->generation_ >= generation) {
+            blocks.push_back(block);
+        }
+    }
+}
+
+void BlockSet::removed_since(unsigned int generation,
+                             std::vector<Fragment>& fragments) const {
+    BOOST_FOREACH (const RemovedFragment& r, impl_->removed_) {
+        if (r.generation_ >= generation) {
+            fragments.push_back(r.fragment_);
+        }
+    }
+}
+
+void BlockSet::block_changed(Block* block) {
+    boost::mutex::scoped_lock lock(impl_->changed_mutex_);
+    impl_->changed_.insert(block);
+}
+
 bool BlockSet::operator==(const BlockSet& other) const {
-    return blockset_hash(*this) == blockset_hash(other);
+    return digest() == other.digest();
 }
 
 std::istream& operator>>(std::istream& input, BlockSet& block_set) {
@@ -158,6 +158,56 @@ public:
     /** Return constant iterator to end */
     const_iterator end() const;
 
+    /** Return XOR of block_hash() of blocks of >= 2 fragments.
+    The value equals to blockset_hash(), but it is maintained
+    incrementally: blocks are rehashed only if they were
+    inserted or changed since previous call.
+    Weak blocks and blocks shared with other blockset
+    are rehashed in each call.
+    Renaming of sequences is not tracked.
+    */
+    hash_t digest() const;
+
+    /** Return current generation.
+    Generation is a global counter of changes. A block remembers
+    the generation, in which it was inserted to a blockset or
+    changed (coordinates, fragments or alignment) last time.
+    */
+    static unsigned int generation();
+
+    /** Start new generation and return its number.
+    Blocks, inserted or changed after this call, are returned
+    by changed_since() called with the returned value.
+    */
+    static unsigned int new_generation();
+
+    /** Start remembering fragments of removed blocks.
+    Changes made before the first call are unknown.
+    \see changed_since(), removed_since()
+    */
+    void track_changes();
+
+    /** Add blocks inserted or changed since the generation.
+    Weak blocks are always added, since changes of their
+    fragments are reported to owning blocks.
+    If changes since the generation are unknown
+    (e.g., blocks were swapped with other blockset,
+    or track_changes() was not called),
+    all blocks are added.
+    */
+    void changed_since(unsigned int generation,
+                       std::vector<Block*>& blocks) const;
+
+    /** Add copies of fragments of blocks removed since the generation.
+    Coordinates of removed fragments are remembered
+    (after track_changes() was called) until
+    clear_blocks() or until there are too many of them;
+    in the latter case changed_since() returns all blocks
+    for older generations.
+    */
+    void removed_since(unsigned int generation,
+                       std::vector<Fragment>& fragments) const;
+
     /** Compare blocksets.
     This is implemented as comparison of hashes.
     */
@@ -167,6 +217,10 @@ private:
     struct I;
 
     I* impl_;
+
+    void block_changed(Block* block);
+
+    friend class Block;
 };
 
 /** Streaming operator.
@@ -17,6 +17,7 @@
 #include "Sequence.hpp"
 #include "complement.hpp"
 #include "convert_position.hpp"
+#include "small_object.hpp"
 #include "throw_assert.hpp"
 #include "cast.hpp"
 
@@ -50,6 +51,14 @@ Fragment::~Fragment() {
     set_row(0);
 }
 
+void* Fragment::operator new(size_t size) {
+    return small_object_allocate(size);
+}
+
+void Fragment::operator delete(void* ptr, size_t size) {
+    small_object_deallocate(ptr, size);
+}
+
 Block* Fragment::block() const {
     return block_raw_ptr();
 }
@@ -84,10 +93,14 @@ void Fragment::set_ori(int ori, bool inverse_row) {
             set_row(new InversedRow(row()));
         }
     }
+    if (ori == this->ori()) {
+        return;
+    }
     uintptr_t block_and_ori = uintptr_t(block_and_ori_);
     block_and_ori &= ~LAST_BIT;
     block_and_ori |= (ori == 1) ? LAST_BIT : 0;
     block_and_ori_ = (Block*)block_and_ori;
+    mark_changed();
 }
 
 pos_t Fragment::begin_pos() const {
@@ -316,6 +329,7 @@ AlignmentRow* Fragment::detach_row() {
 }
 
 void Fragment::set_row(AlignmentRow* row) {
+    alignment_changed();
     if (row_ && row_->fragment() && row != row_) {
         row_->set_fragment(0);
         delete row_;
@@ -385,6 +399,20 @@ Block* Fragment::block_raw_ptr() const {
     return (Block*)result;
 }
 
+void Fragment::mark_changed() {
+    Block* block = block_raw_ptr();
+    if (block) {
+        block->mark_changed();
+    }
+}
+
+void Fragment::alignment_changed() {
+    Block* block = block_raw_ptr();
+    if (block) {
+        block->alignment_changed();
+    }
+}
+
 std::ostream& operator<<(std::ostream& o, const Fragment& f) {
     o << '>';
     f.print_header(o);
@@ -53,6 +53,12 @@ public:
     */
     ~Fragment();
 
+    /** Allocate memory (see small_object_allocate()) */
+    static void* operator new(size_t size);
+
+    /** Free memory (see small_object_deallocate()) */
+    static void operator delete(void* ptr, size_t size);
+
     /** Get sequence */
     Sequence* seq() const {
         return seq_;
@@ -71,6 +77,7 @@ public:
     /** Set minimum position of sequence occupied by the fragment */
     void set_min_pos(pos_t min_pos) {
         min_pos_ = min_pos;
+        mark_changed();
     }
 
     /** Get maximum position of sequence occupied by the fragment */
@@ -81,6 +88,7 @@ public:
     /** Set maximum position of sequence occupied by the fragment */
     void set_max_pos(pos_t max_pos) {
         max_pos_ = max_pos;
+        mark_changed();
     }
 
     /** Get orientation (1 for forward, -1 for reverse) */
@@ -279,7 +287,14 @@ private:
 
     Block* block_raw_ptr() const;
 
+    /* Tell the block that its hash may have changed */
+    void mark_changed();
+
+    /* Tell the block that alignment row has changed */
+    void alignment_changed();
+
     friend class Block;
+    friend class AlignmentRow;
 };
 
 /** Streaming operator.
@@ -69,6 +69,195 @@ struct AssignFragment<Fragment*> {
     }
 };
 
+/** Sorted array of fragments with implicit interval tree.
+
+Fragments are sorted by FragmentCompare. The array is viewed
+as binary search tree: element i is a node of level equal to
+number of trailing 1 bits of i. Max position of each subtree
+is stored, so search of fragments overlapping given range
+takes O(log(N) + K), where K is number of found fragments.
+Positions are stored in separate arrays to reduce cache misses.
+
+After adding fragments call sort() (prepare() of
+FragmentCollection). erase() rebuilds the index itself.
+*/
+template<typename F>
+class IntervalIndex {
+public:
+    typedef std::vector<F> Vector;
+    typedef F value_type;
+    typedef typename Vector::const_iterator const_iterator;
+    typedef const_iterator iterator;
+    typedef typename Vector::size_type size_type;
+
+    /** Constructor */
+    IntervalIndex():
+        max_level_(0), prepared_(true) {
+    }
+
+    /** Return iterator to the first fragment */
+    const_iterator begin() const {
+        return items_.begin();
+    }
+
+    /** Return iterator after the last fragment */
+    const_iterator end() const {
+        return items_.end();
+    }
+
+    /** Return number of fragments */
+    size_type size() const {
+        return items_.size();
+    }
+
+    /** Return if there are no fragments */
+    bool empty() const {
+        return items_.empty();
+    }
+
+    /** Return fragment by index */
+    const F& operator[](size_type i) const {
+        return items_[i];
+    }
+
+    /** Add a fragment (sort() is needed after this) */
+    void push_back(const F& f) {
+        items_.push_back(f);
+        prepared_ = false;
+    }
+
+    /** Remove a fragment and rebuild index, O(N) */
+    void erase(const F& f) {
+        items_.erase(std::remove(items_.begin(), items_.end(), f),
+                     items_.end());
+        if (prepared_) {
+            build();
+        }
+    }
+
+    /** Sort fragments and build index */
+    void sort() {
+        std::sort(items_.begin(), items_.end(), FragmentCompare());
+        build();
+    }
+
+    /** Find fragments, overlapping range [min_pos, max_pos].
+    Fragments are appended to result in sorted order.
+    If result is 0, search stops after first found fragment.
+    Return if any fragment was found.
+    */
+    bool find(pos_t min_pos, pos_t max_pos, Fragments* result) const {
+        ASSERT_TRUE(prepared_);
+        int n = items_.size();
+        if (n == 0) {
+            return false;
+        }
+        bool found = false;
+        // subtree is scanned linearly if it is lower than this
+        const int SCAN_LEVEL = 3;
+        Cell stack[64];
+        int t = 0;
+        stack[t++] = Cell((1 << max_level_) - 1, max_level_, false);
+        while (t) {
+            Cell z = stack[--t];
+            if (z.level_ <= SCAN_LEVEL) {
+                int i0 = z.node_ >> z.level_ << z.level_;
+                int i1 = std::min(n, i0 + (1 << (z.level_ + 1)) - 1);
+                for (int i = i0; i < i1 && mins_[i] <= max_pos; i++) {
+                    if (min_pos <= maxs_[i]) {
+                        if (!result) {
+                            return true;
+                        }
+                        result->push_back(assigner_(items_[i]));
+                        found = true;
+                    }
+                }
+            } else if (!z.left_done_) {
+                int left = z.node_ - (1 << (z.level_ - 1));
+                stack[t++] = Cell(z.node_, z.level_, true);
+                if (left >= n || subtree_max_[left] >= min_pos) {
+                    stack[t++] = Cell(left, z.level_ - 1, false);
+                }
+            } else if (z.node_ < n && mins_[z.node_] <= max_pos) {
+                if (min_pos <= maxs_[z.node_]) {
+                    if (!result) {
+                        return true;
+                    }
+                    result->push_back(assigner_(items_[z.node_]));
+                    found = true;
+                }
+                int right = z.node_ + (1 << (z.level_ - 1));
+                stack[t++] = Cell(right, z.level_ - 1, false);
+            }
+        }
+        return found;
+    }
+
+private:
+    struct Cell {
+        int node_;
+        int level_;
+        bool left_done_;
+
+        Cell() {
+        }
+
+        Cell(int node, int level, bool left_done):
+            node_(node), level_(level), left_done_(left_done) {
+        }
+    };
+
+    Vector items_;
+    std::vector<pos_t> mins_;
+    std::vector<pos_t> maxs_;
+    std::vector<pos_t> subtree_max_;
+    int max_level_;
+    bool prepared_;
+    AssignFragment<F> assigner_;
+
+    void build() {
+        int n = items_.size();
+        mins_.resize(n);
+        maxs_.resize(n);
+        subtree_max_.resize(n);
+        for (int i = 0; i < n; i++) {
+            Fragment* f = assigner_(items_[i]);
+            mins_[i] = f->min_pos();
+            maxs_[i] = f->max_pos();
+        }
+        max_level_ = 0;
+        prepared_ = true;
+        if (n == 0) {
+            return;
+        }
+        // last_i is root of the rightmost subtree of current level,
+        // last is its max; it replaces missing right children
+        int last_i = 0;
+        pos_t last = 0;
+        for (int i = 0; i < n; i += 2) {
+            last_i = i;
+            last = subtree_max_[i] = maxs_[i];
+        }
+        int k = 1;
+        for (; (1 << k) <= n; k++) {
+            int x = 1 << (k - 1);
+            int i0 = (x << 1) - 1;
+            int step = x << 2;
+            for (int i = i0; i < n; i += step) {
+                pos_t left = subtree_max_[i - x];
+                pos_t right = (i + x < n) ? subtree_max_[i + x] : last;
+                subtree_max_[i] = std::max(maxs_[i],
+                                           std::max(left, right));
+            }
+            last_i = ((last_i >> k) & 1) ? last_i - x : last_i + x;
+            if (last_i < n && subtree_max_[last_i] > last) {
+                last = subtree_max_[last_i];
+            }
+        }
+        max_level_ = k - 1;
+    }
+};
+
 template<typename F, typename C>
 struct InsertFragment {
     void operator()(C& col, const F& fragment) const;
@@ -92,6 +281,15 @@ struct InsertFragment<F, std::set<F, FragmentCompare> > {
     }
 };
 
+template<typename F>
+struct InsertFragment<F, IntervalIndex<F> > {
+    typedef IntervalIndex<F> C;
+
+    void operator()(C& col, const F& f) const {
+        col.push_back(f);
+    }
+};
+
 template<typename F, typename C>
 struct RemoveFragment {
     void operator()(C& col, const F& fragment) const;
@@ -115,6 +313,15 @@ struct RemoveFragment<F, std::set<F, FragmentCompare> > {
     }
 };
 
+template<typename F>
+struct RemoveFragment<F, IntervalIndex<F> > {
+    typedef IntervalIndex<F> C;
+
+    void operator()(C& col, const F& f) const {
+        col.erase(f);
+    }
+};
+
 template<typename C>
 struct SortFragments {
     void operator()(C& col) const;
@@ -138,6 +345,15 @@ struct SortFragments<std::set<F, FragmentCompare> > {
     }
 };
 
+template<typename F>
+struct SortFragments<IntervalIndex<F> > {
+    typedef IntervalIndex<F> C;
+
+    void operator()(C& col) const {
+        col.sort();
+    }
+};
+
 template<typename F, typename C>
 struct LowerBound {
     typename C::const_iterator
@@ -164,6 +380,43 @@ struct LowerBound<F, std::set<F, FragmentCompare> > {
     }
 };
 
+template<typename F>
+struct LowerBound<F, IntervalIndex<F> > {
+    typedef IntervalIndex<F> C;
+
+    typename C::const_iterator
+    operator()(const C& col, const F& fragment) const {
+        return std::lower_bound(col.begin(), col.end(), fragment, fc_);
+    }
+};
+
+/** Search of overlapping fragments using index of container.
+If INDEXED is false, FragmentCollection scans fragments
+around lower bound.
+*/
+template<typename F, typename C>
+struct FindOverlaps {
+    static const bool INDEXED = false;
+
+    bool operator()(const C& col, Fragment* fragment,
+                    Fragments* result) const {
+        return false;
+    }
+};
+
+template<typename F>
+struct FindOverlaps<F, IntervalIndex<F> > {
+    typedef IntervalIndex<F> C;
+
+    static const bool INDEXED = true;
+
+    bool operator()(const C& col, Fragment* fragment,
+                    Fragments* result) const {
+        return col.find(fragment->min_pos(), fragment->max_pos(),
+                        result);
+    }
+};
+
 /** Collection of fragments.
 Template class.
 First template parameter is type used to store fragments:
@@ -173,6 +426,7 @@ First template parameter is type used to store fragments:
 Second template parameter is type used to store several fragments:
  - std::vector<F>
  - std::set<F, FragmentCompare>
+ - IntervalIndex<F>
 
 Add fragments using add_fragment(), add_block() and add_bs().
 Then call prepare().
@@ -180,6 +434,13 @@ After this you can use has_overlap() and find_overlaps() methods.
 
 If std::set is used to store fragments, then call of prepare() is not needed.
 You can add fragments and check overlaps in any order in this case.
+
+Vector and set find overlaps by scanning fragments around
+the searched one. has_overlap() checks only nearest fragments,
+so it is exact only if fragments of the collection do not
+overlap each other. IntervalIndex answers both queries exactly
+in O(log(N) + K) for nested and long fragments.
+Use it if the collection is built once and then queried.
 */
 template<typename F, typename C>
 class FragmentCollection {
@@ -283,6 +544,9 @@ public:
         if (fragments.empty()) {
             return false;
         }
+        if (overlaps_finder_.INDEXED) {
+            return overlaps_finder_(fragments, fragment, 0);
+        }
         typename C::const_iterator i2 = lower_bound_(fragments, f);
         if (i2 != fragments.end() &&
                 assigner_(*i2)->common_positions(*fragment)) {
@@ -328,6 +592,10 @@ public:
         }
         const C& fragments = it->second;
         ASSERT_FALSE(fragments.empty());
+        if (overlaps_finder_.INDEXED) {
+            overlaps_finder_(fragments, fragment, &overlap_fragments);
+            return;
+        }
         typename C::const_iterator i2 = lower_bound_(fragments, f);
         typename C::const_iterator i2r = i2, i2l = i2;
         if (i2 != fragments.end() &&
@@ -522,6 +790,7 @@ private:
     RemoveFragment<F, C> remover_;
     SortFragments<C> sorter_;
     LowerBound<F, C> lower_bound_;
+    FindOverlaps<F, C> overlaps_finder_;
     bool cycles_allowed_;
 };
 
@@ -529,6 +798,8 @@ typedef std::set<Fragment*, FragmentCompare> FSet;
 typedef FragmentCollection<Fragment*, FSet> SetFc;
 typedef std::vector<Fragment*> FVec;
 typedef FragmentCollection<Fragment*, FVec> VectorFc;
+typedef IntervalIndex<Fragment*> FIndex;
+typedef FragmentCollection<Fragment*, FIndex> IndexFc;
 
 typedef std::set<Fragment, FragmentCompare> DirectFSet;
 typedef FragmentCollection<Fragment, DirectFSet> DirectSetFc;
@@ -0,0 +1,94 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <algorithm>
+
+#include "KmerScanner.hpp"
+#include "Sequence.hpp"
+#include "char_to_size.hpp"
+#include "make_hash.hpp"
+#include "throw_assert.hpp"
+
+namespace npge {
+
+KmerScanner::KmerScanner(const Sequence* seq, int kmer,
+                         pos_t begin, pos_t end, int chunk):
+    seq_(seq), kmer_(kmer), end_(end), chunk_(chunk),
+    chunk_begin_(begin), next_begin_(begin),
+    size_(0), no_n_(true) {
+    ASSERT_GTE(kmer_, 1);
+    ASSERT_LTE(kmer_, MAX_ANCHOR_SIZE);
+    ASSERT_GTE(chunk_, 1);
+    ASSERT_GTE(begin, 0);
+    if (end_ == -1) {
+        end_ = seq_->size();
+    }
+    ASSERT_LTE(end_, seq_->size());
+    if (kmer_ * POS_BITS >= sizeof(hash_t) * BYTE_BITS) {
+        kmer_mask_ = ~hash_t(0);
+    } else {
+        kmer_mask_ = (hash_t(1) << (kmer_ * POS_BITS)) - 1;
+    }
+    codes_.resize(chunk_ + kmer_ - 1);
+    hashes_.resize(chunk_);
+    int words = (chunk_ + WORD_BITS - 1) / WORD_BITS;
+    n_mask_.resize(words);
+    dir_mask_.resize(words);
+}
+
+bool KmerScanner::next_chunk() {
+    chunk_begin_ = next_begin_;
+    pos_t kmers_left = end_ - kmer_ + 1 - chunk_begin_;
+    if (kmers_left <= 0) {
+        size_ = 0;
+        return false;
+    }
+    size_ = std::min(pos_t(chunk_), kmers_left);
+    next_begin_ = chunk_begin_ + size_;
+    int letters = size_ + kmer_ - 1;
+    seq_->letter_codes(chunk_begin_, letters, &codes_[0]);
+    std::fill(n_mask_.begin(), n_mask_.end(), 0);
+    std::fill(dir_mask_.begin(), dir_mask_.end(), 0);
+    no_n_ = true;
+    const char* codes = &codes_[0];
+    hash_t* hashes = &hashes_[0];
+    uint64_t* n_mask = &n_mask_[0];
+    uint64_t* dir_mask = &dir_mask_[0];
+    int last_shift = (kmer_ - 1) * POS_BITS;
+    hash_t dir = 0, rev = 0;
+    int last_n = -1;
+    for (int j = 0; j < letters; j++) {
+        char code = codes[j];
+        hash_t letter = code & LAST_TWO_BITS;
+        hash_t complement = letter;
+        if (code == N) {
+            last_n = j;
+        } else {
+            complement = complement_letter(letter);
+        }
+        dir = (dir >> POS_BITS) | (letter << last_shift);
+        rev = ((rev << POS_BITS) | complement) & kmer_mask_;
+        int i = j - kmer_ + 1;
+        if (i >= 0) {
+            uint64_t bit = uint64_t(1) << (i % WORD_BITS);
+            if (last_n >= i) {
+                n_mask[i / WORD_BITS] |= bit;
+                no_n_ = false;
+            }
+            if (dir <= rev) {
+                hashes[i] = dir;
+                dir_mask[i / WORD_BITS] |= bit;
+            } else {
+                hashes[i] = rev;
+            }
+        }
+    }
+    return true;
+}
+
+}
+
@@ -0,0 +1,113 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef NPGE_KMER_SCANNER_HPP_
+#define NPGE_KMER_SCANNER_HPP_
+
+#include <vector>
+
+#include "global.hpp"
+
+namespace npge {
+
+/** Batch scanner of k-mers of a sequence.
+
+Letters are decoded by chunks using Sequence::letter_codes(),
+hashes of all k-mers of the chunk are computed in one pass.
+
+Hash of k-mer is equal to Sequence::hash() of corresponding fragment
+(direct or reverse). Canonical hash is min of direct and reverse
+hashes. If k-mer contains N, its hashes are undefined.
+
+Usage:
+\code
+KmerScanner scanner(seq, anchor);
+while (scanner.next_chunk()) {
+    for (int i = 0; i < scanner.size(); i++) {
+        if (!scanner.has_n(i)) {
+            use(scanner.pos(i), scanner.hash(i), scanner.direct(i));
+        }
+    }
+}
+\endcode
+*/
+class KmerScanner {
+public:
+    /** Default number of k-mers in chunk */
+    static const int DEFAULT_CHUNK = 4096;
+
+    /** Constructor.
+    \param seq Sequence.
+    \param kmer Length of k-mer (1 <= kmer <= MAX_ANCHOR_SIZE).
+    \param begin Start position of first k-mer.
+    \param end Position after the last letter of last k-mer
+        (-1 means seq->size()).
+    \param chunk Max number of k-mers in chunk.
+    */
+    KmerScanner(const Sequence* seq, int kmer,
+                pos_t begin = 0, pos_t end = -1,
+                int chunk = DEFAULT_CHUNK);
+
+    /** Scan next chunk.
+    Return false if no k-mers left.
+    */
+    bool next_chunk();
+
+    /** Return number of k-mers in current chunk */
+    int size() const {
+        return size_;
+    }
+
+    /** Return start position of k-mer i of current chunk */
+    pos_t pos(int i) const {
+        return chunk_begin_ + i;
+    }
+
+    /** Return canonical hash of k-mer i of current chunk */
+    hash_t hash(int i) const {
+        return hashes_[i];
+    }
+
+    /** Return if k-mer i of current chunk contains N */
+    bool has_n(int i) const {
+        return (n_mask_[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+    }
+
+    /** Return if canonical hash of k-mer i is its direct hash */
+    bool direct(int i) const {
+        return (dir_mask_[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+    }
+
+    /** Return if no k-mer of current chunk contains N */
+    bool no_n() const {
+        return no_n_;
+    }
+
+private:
+    static const int WORD_BITS = 64;
+
+    const Sequence* seq_;
+    int kmer_;
+    pos_t end_;
+    int chunk_;
+    hash_t kmer_mask_;
+
+    pos_t chunk_begin_;
+    pos_t next_begin_;
+    int size_;
+    bool no_n_;
+
+    std::vector<char> codes_;
+    std::vector<hash_t> hashes_;
+    std::vector<uint64_t> n_mask_;
+    std::vector<uint64_t> dir_mask_;
+};
+
+}
+
+#endif
+
@@ -6,19 +6,20 @@
  */
 
 #include <cctype>
-#include <sstream>
 #include <vector>
 #include <algorithm>
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include <boost/utility/binary.hpp>
 
 #include "Sequence.hpp"
 #include "Block.hpp"
+#include "BlockConsensus.hpp"
 #include "Fragment.hpp"
 #include "FastaReader.hpp"
 #include "block_stat.hpp"
@@ -45,6 +46,8 @@ SequencePtr Sequence::new_sequence(SequenceType seq_type) {
         return boost::make_shared<InMemorySequence>();
     } else if (seq_type == COMPACT_LOW_N_SEQUENCE) {
         return boost::make_shared<CompactLowNSequence>();
+    } else if (seq_type == MAPPED_SEQUENCE) {
+        return boost::make_shared<MappedSequence>();
     } else {
         return boost::make_shared<CompactSequence>();
     }
@@ -298,6 +301,40 @@ hash_t Sequence::hash_impl(pos_t index, pos_t length,
     }
 }
 
+void Sequence::letter_codes(pos_t index, pos_t length,
+                            char* codes) const {
+    if (length == 0) {
+        return;
+    }
+    ASSERT_GTE(index, 0);
+    ASSERT_GT(length, 0);
+    ASSERT_LTE(index + length, size());
+    letter_codes_impl(index, length, codes);
+}
+
+void Sequence::letter_codes_impl(pos_t index, pos_t length,
+                                 char* codes) const {
+    for (pos_t i = 0; i < length; i++) {
+        codes[i] = char_to_size(char_at_impl(index + i));
+    }
+}
+
+void Sequence::append_codes(const char* codes, pos_t length) {
+    if (length == 0) {
+        return;
+    }
+    ASSERT_GT(length, 0);
+    append_codes_impl(codes, length);
+}
+
+void Sequence::append_codes_impl(const char* codes, pos_t length) {
+    std::string letters(length, 'N');
+    for (pos_t i = 0; i < length; i++) {
+        letters[i] = size_to_char(codes[i]);
+    }
+    read_from_string(letters);
+}
+
 void Sequence::set_block(const Block* block,
                          bool set_consensus) {
     if (set_consensus) {
@@ -305,22 +342,23 @@ void Sequence::set_block(const Block* block,
         ASSERT_EQ(block_, 0);
     }
     block_ = block;
+    boost::scoped_ptr<BlockConsensus> consensus;
     if (set_consensus) {
-        std::string name_value = name();
-        std::string description_value = description();
-        std::stringstream cons;
-        cons << ">dummy\n";
-        block->consensus(cons);
-        read_from_file(cons);
-        set_name(name_value);
-        set_description(description_value);
+        consensus.reset(new BlockConsensus(block));
+        append_codes(consensus->codes(), consensus->length());
     }
     if (name().empty()) {
         set_name(block->name());
     }
     if (description().empty()) {
-        AlignmentStat stat;
-        make_stat(stat, block);
+        Decimal identity;
+        if (consensus) {
+            identity = consensus->identity();
+        } else {
+            AlignmentStat stat;
+            make_stat(stat, block);
+            identity = block_identity(stat);
+        }
         std::string d;
         d += "fragments=";
         BOOST_FOREACH (Fragment* f, *block) {
@@ -329,7 +367,7 @@ void Sequence::set_block(const Block* block,
         }
         d.resize(d.size() - 1); // cut last comma
         d += " columns=" + TO_S(block->alignment_length());
-        d += " identity=" + TO_S(block_identity(stat));
+        d += " identity=" + TO_S(identity);
         set_description(d);
     }
 }
@@ -356,6 +394,14 @@ char InMemorySequence::char_at_impl(pos_t index) const {
     return data_[index];
 }
 
+void InMemorySequence::letter_codes_impl(pos_t index,
+        pos_t length, char* codes) const {
+    const char* data = data_.c_str() + index;
+    for (pos_t i = 0; i < length; i++) {
+        codes[i] = char_to_size(data[i]);
+    }
+}
+
 template <typename F>
 class SequenceFastaReader : public FastaReader {
 public:
@@ -446,6 +492,62 @@ char CompactSequence::char_at_impl(pos_t index) const {
     return size_to_char(s);
 }
 
+void CompactSequence::letter_codes_impl(pos_t index,
+        pos_t length, char* codes) const {
+    pos_t end = index + length;
+    pos_t pos = index;
+    while (pos < end) {
+        // decode whole chunk of SEQ_CHUNK_LETTERS letters
+        size_t n_i = n_index(pos);
+        if (n_i + SEQ_CHUNK_BYTES > data_.size()) {
+            // chunk is not allocated
+            for (; pos < end; pos++) {
+                codes[pos - index] = char_to_size(char_at_impl(pos));
+            }
+            break;
+        }
+        size_t ns = (unsigned char)(data_[n_i]);
+        size_t letters = (unsigned char)(data_[n_i + 1]) |
+                         ((unsigned char)(data_[n_i + 2]) <<
+                          SEQ_BITS_IN_BYTE);
+        size_t first = index_in_chunk(pos);
+        size_t last = std::min(SEQ_CHUNK_LETTERS,
+                               size_t(first + end - pos));
+        for (size_t i = first; i < last; i++) {
+            char code;
+            if ((ns >> i) & LAST_BIT) {
+                code = N;
+            } else {
+                code = (letters >> (SEQ_BITS_PER_LETTER * i)) &
+                       LAST_2_BITS;
+            }
+            codes[pos - index] = code;
+            pos += 1;
+        }
+    }
+}
+
+void CompactSequence::append_codes_impl(const char* codes,
+        pos_t length) {
+    size_t old_size = size();
+    size_t new_size = old_size + length;
+    size_t chunks_needed = chunk_index(new_size - 1) + 1;
+    if (chunks_needed * SEQ_CHUNK_BYTES > data_.size()) {
+        data_.resize(chunks_needed * SEQ_CHUNK_BYTES);
+    }
+    for (pos_t i = 0; i < length; i++) {
+        size_t index = old_size + i;
+        size_t code = codes[i];
+        if (code == N) {
+            data_[n_index(index)] |= 1 << index_in_chunk(index);
+        } else {
+            data_[contents_index(index)] |=
+                code << index_in_contents(index);
+        }
+    }
+    set_size(new_size);
+}
+
 void CompactSequence::read_from_file(std::istream& input) {
     read_fasta(*this, input,
                boost::bind(&CompactSequence::add_hunk, this, _1));
@@ -539,6 +641,40 @@ char CompactLowNSequence::char_at_impl(pos_t index) const {
     return size_to_char(s);
 }
 
+void CompactLowNSequence::letter_codes_impl(pos_t index,
+        pos_t length, char* codes) const {
+    const char* data = data_.c_str();
+    pos_t end = index + length;
+    for (pos_t pos = index; pos < end; pos++) {
+        codes[pos - index] = (data[byte_index(pos)] >> shift(pos)) &
+                             LAST_2_BITS;
+    }
+    Boundaries::const_iterator it = std::lower_bound(ns_.begin(),
+                                    ns_.end(), index);
+    for (; it != ns_.end() && *it < end; ++it) {
+        codes[*it - index] = N;
+    }
+}
+
+void CompactLowNSequence::append_codes_impl(const char* codes,
+        pos_t length) {
+    size_t old_size = size();
+    size_t new_size = old_size + length;
+    if (byte_index(new_size - 1) >= data_.size()) {
+        data_.resize(byte_index(new_size - 1) + 1);
+    }
+    for (pos_t i = 0; i < length; i++) {
+        size_t index = old_size + i;
+        size_t code = codes[i];
+        if (code == N) {
+            ns_.push_back(index);
+        } else {
+            data_[byte_index(index)] |= code << shift(index);
+        }
+    }
+    set_size(new_size);
+}
+
 void CompactLowNSequence::read_from_file(std::istream& input) {
     read_fasta(*this, input,
                boost::bind(&CompactLowNSequence::add_hunk,
@@ -595,6 +731,150 @@ size_t CompactLowNSequence::shift(size_t index) const {
     return 2 * (index % 4);
 }
 
+MappedSequence::MappedSequence():
+    letters_(0), n_runs_(0), n_runs_size_(0) {
+}
+
+MappedSequence::MappedSequence(const std::string& data):
+    letters_(0), n_runs_(0), n_runs_size_(0) {
+    read_from_string(data);
+}
+
+MappedSequence::MappedSequence(Owner owner,
+                               const unsigned char* letters,
+                               pos_t size, const uint64_t* n_runs,
+                               size_t n_runs_size):
+    owner_(owner), letters_(letters),
+    n_runs_(n_runs), n_runs_size_(n_runs_size) {
+    set_size(size);
+}
+
+size_t MappedSequence::runs_before(pos_t index) const {
+    size_t lo = 0, hi = n_runs_size_;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (n_runs_[2 * mid] <= index) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+bool MappedSequence::is_n(pos_t index) const {
+    // last run with start <= index
+    size_t lo = runs_before(index);
+    return lo > 0 && index < n_runs_[2 * (lo - 1)] +
+           n_runs_[2 * (lo - 1) + 1];
+}
+
+char MappedSequence::char_at_impl(pos_t index) const {
+    if (n_runs_size_ && is_n(index)) {
+        return 'N';
+    }
+    size_t s = (letters_[index / 4] >> (2 * (index % 4))) &
+               LAST_2_BITS;
+    return size_to_char(s);
+}
+
+void MappedSequence::letter_codes_impl(pos_t index,
+                                       pos_t length, char* codes) const {
+    pos_t end = index + length;
+    for (pos_t pos = index; pos < end; pos++) {
+        codes[pos - index] = (letters_[pos / 4] >> (2 * (pos % 4))) &
+                             LAST_2_BITS;
+    }
+    // first run which can overlap the range
+    size_t first_run = runs_before(index);
+    if (first_run > 0) {
+        first_run -= 1;
+    }
+    for (size_t r = first_run; r < n_runs_size_; r++) {
+        uint64_t start = n_runs_[2 * r];
+        uint64_t stop = start + n_runs_[2 * r + 1];
+        if (start >= end) {
+            break;
+        }
+        for (uint64_t pos = std::max<uint64_t>(start, index);
+                pos < stop && pos < end; pos++) {
+            codes[pos - index] = N;
+        }
+    }
+}
+
+std::string MappedSequence::substr_impl(pos_t index, pos_t length,
+                                        int ori) const {
+    ASSERT_LT(index, size());
+    ASSERT_LT(index + (length - 1) * ori, size());
+    std::vector<char> codes(length);
+    pos_t min_pos = (ori == 1) ? index : (index - length + 1);
+    letter_codes_impl(min_pos, length, &codes[0]);
+    static const char LETTERS[] = "ATGCN";
+    static const char COMPLEMENTS[] = "TACGN";
+    std::string result(length, 'N');
+    if (ori == 1) {
+        for (pos_t i = 0; i < length; i++) {
+            result[i] = LETTERS[int(codes[i])];
+        }
+    } else {
+        for (pos_t i = 0; i < length; i++) {
+            result[i] = COMPLEMENTS[int(codes[length - 1 - i])];
+        }
+    }
+    return result;
+}
+
+void MappedSequence::read_from_file(std::istream& input) {
+    read_fasta(*this, input,
+               boost::bind(&MappedSequence::add_hunk, this, _1));
+}
+
+void MappedSequence::read_from_string(const std::string& data) {
+    std::string data_copy(data);
+    to_atgcn(data_copy);
+    add_hunk(data_copy);
+}
+
+void MappedSequence::map_from_string_impl(
+    const std::string&, pos_t) {
+    throw Exception("MappedSequence::map_from_string "
+                    "not implemented");
+}
+
+void MappedSequence::add_hunk(const std::string& hunk) {
+    if (hunk.empty()) {
+        return;
+    }
+    if (owner_) {
+        throw Exception("MappedSequence: can not change mapped data");
+    }
+    size_t old_size = size();
+    size_t new_size = old_size + hunk.size();
+    own_letters_.resize((new_size + 3) / 4);
+    for (size_t i = 0; i < hunk.size(); i++) {
+        size_t pos = old_size + i;
+        if (hunk[i] == 'N') {
+            size_t runs = own_n_runs_.size();
+            if (runs && own_n_runs_[runs - 2] +
+                    own_n_runs_[runs - 1] == pos) {
+                own_n_runs_[runs - 1] += 1;
+            } else {
+                own_n_runs_.push_back(pos);
+                own_n_runs_.push_back(1);
+            }
+        } else {
+            own_letters_[pos / 4] |= char_to_size(hunk[i]) <<
+                                     (2 * (pos % 4));
+        }
+    }
+    letters_ = reinterpret_cast<const unsigned char*>(
+                   own_letters_.c_str());
+    n_runs_ = own_n_runs_.empty() ? 0 : &own_n_runs_[0];
+    n_runs_size_ = own_n_runs_.size() / 2;
+    set_size(new_size);
+}
+
 DummySequence::DummySequence(char letter, int size) {
     set_letter(letter);
     set_size(size);
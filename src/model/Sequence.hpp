@@ -11,7 +11,9 @@
 #include <iosfwd>
 #include <string>
 #include <vector>
+#include <stdint.h>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include "global.hpp"
 #include "boundaries.hpp"
@@ -139,9 +141,36 @@ public:
     hash_t hash(pos_t index, pos_t length,
                 int ori) const;
 
+    /** Write codes of letters [index, index + length) to codes.
+    Codes are returned by char_to_size(): A=0, T=1, G=2, C=3, N=4.
+    Array codes must have at least length elements.
+    This is much faster than calling char_at() for each letter.
+    */
+    void letter_codes(pos_t index, pos_t length,
+                      char* codes) const;
+
+    /** Append letters given by codes to the end of sequence.
+    Codes are as in letter_codes(): A=0, T=1, G=2, C=3, N=4.
+    Compact sequences store the codes without conversion
+    to letters and back.
+    */
+    void append_codes(const char* codes, pos_t length);
+
 protected:
     virtual char char_at_impl(pos_t index) const = 0;
 
+    /** Write codes of letters (implementation).
+    Default implementation calls char_at_impl() for each letter.
+    */
+    virtual void letter_codes_impl(pos_t index, pos_t length,
+                                   char* codes) const;
+
+    /** Append letters given by codes (implementation).
+    Default implementation converts codes to letters
+    and calls read_from_string().
+    */
+    virtual void append_codes_impl(const char* codes, pos_t length);
+
     virtual void map_from_string_impl(const std::string& data,
                                       pos_t min_pos) = 0;
 
@@ -178,6 +207,9 @@ public:
 protected:
     char char_at_impl(pos_t index) const;
 
+    void letter_codes_impl(pos_t index, pos_t length,
+                           char* codes) const;
+
     void map_from_string_impl(const std::string& data,
                               pos_t min_pos);
 
@@ -200,6 +232,11 @@ public:
 protected:
     char char_at_impl(pos_t index) const;
 
+    void letter_codes_impl(pos_t index, pos_t length,
+                           char* codes) const;
+
+    void append_codes_impl(const char* codes, pos_t length);
+
     void map_from_string_impl(const std::string& data,
                               pos_t min_pos);
 
@@ -234,6 +271,11 @@ public:
 protected:
     char char_at_impl(pos_t index) const;
 
+    void letter_codes_impl(pos_t index, pos_t length,
+                           char* codes) const;
+
+    void append_codes_impl(const char* codes, pos_t length);
+
     void map_from_string_impl(const std::string& data,
                               pos_t min_pos);
 
@@ -252,6 +294,72 @@ private:
     size_t shift(size_t index) const;
 };
 
+/** Sequence of 2-bit letters and runs of N, which are not owned.
+Letters are stored as in CompactLowNSequence (4 letters per byte,
+A=0, T=1, G=2, C=3). Runs of N are pairs (start, length),
+sorted by start.
+
+Usually the data is located in memory-mapped file (see
+BlockSetBinaryReader), so page cache is shared by processes
+reading the same file. Owner of the data is kept by the sequence.
+If the sequence is read from string or file, it stores the data
+itself.
+*/
+class MappedSequence : public Sequence {
+public:
+    /** Owner of mapped data */
+    typedef boost::shared_ptr<const void> Owner;
+
+    /** Constructor of empty sequence */
+    MappedSequence();
+
+    /** Constructor of sequence storing the data itself */
+    MappedSequence(const std::string& data);
+
+    /** Constructor.
+    \param owner Object keeping the data alive.
+    \param letters 2-bit letters.
+    \param size Number of letters.
+    \param n_runs Array of n_runs_size pairs (start, length).
+    \param n_runs_size Number of runs of N.
+    */
+    MappedSequence(Owner owner, const unsigned char* letters,
+                   pos_t size, const uint64_t* n_runs,
+                   size_t n_runs_size);
+
+    void read_from_string(const std::string& data);
+
+protected:
+    char char_at_impl(pos_t index) const;
+
+    void letter_codes_impl(pos_t index, pos_t length,
+                           char* codes) const;
+
+    std::string substr_impl(pos_t index, pos_t length,
+                            int ori) const;
+
+    void map_from_string_impl(const std::string& data,
+                              pos_t min_pos);
+
+private:
+    Owner owner_;
+    const unsigned char* letters_;
+    const uint64_t* n_runs_;
+    size_t n_runs_size_;
+    // data of sequence read from string or file
+    std::string own_letters_;
+    std::vector<uint64_t> own_n_runs_;
+
+    void read_from_file(std::istream& input);
+
+    void add_hunk(const std::string& hunk);
+
+    /* Number of runs of N with start <= index */
+    size_t runs_before(pos_t index) const;
+
+    bool is_n(pos_t index) const;
+};
+
 /** Sequence returning the one letter for each position.
 This utility sequence can be used to use in place of long
 sequences without large memory allocations.
@@ -0,0 +1,597 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <stdint.h>
+#include <cstring>
+#include <map>
+#include <vector>
+#include <fstream>
+#include <ostream>
+#include <algorithm>
+#include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/ref.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "binary_block_set.hpp"
+#include "BlockSet.hpp"
+#include "Block.hpp"
+#include "Fragment.hpp"
+#include "Sequence.hpp"
+#include "AlignmentRow.hpp"
+#include "simple_task.hpp"
+#include "name_to_stream.hpp"
+#include "Exception.hpp"
+#include "throw_assert.hpp"
+
+namespace npge {
+
+const char MAGIC[8] = {'N', 'P', 'G', 'E', 'B', 'S', 'E', 'T'};
+const uint32_t VERSION = 1;
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+const uint64_t NO_ROW = ~uint64_t(0);
+
+struct BinaryHeader {
+    char magic_[8];
+    uint32_t version_;
+    uint32_t byte_order_mark_;
+    uint64_t seqs_;
+    uint64_t blocks_;
+    uint64_t fragments_;
+    uint64_t strings_size_;
+    uint64_t letters_size_; // bytes
+    uint64_t n_runs_;
+    uint64_t row_words_;
+};
+
+struct BinarySeq {
+    uint64_t name_offset_;
+    uint32_t name_length_;
+    uint32_t descr_length_; // description follows name
+    uint64_t length_;
+    uint64_t letters_offset_; // bytes, 4 letters per byte
+    uint64_t first_n_run_;
+    uint64_t n_runs_;
+};
+
+struct BinaryBlock {
+    uint64_t name_offset_;
+    uint32_t name_length_;
+    uint32_t size_;
+    uint64_t first_fragment_;
+};
+
+struct BinaryFragment {
+    uint32_t seq_;
+    int32_t ori_;
+    uint64_t min_pos_;
+    uint64_t max_pos_;
+    uint64_t row_offset_; // words, NO_ROW if no row
+};
+
+struct NRun {
+    uint64_t start_;
+    uint64_t length_;
+};
+
+BOOST_STATIC_ASSERT(sizeof(BinaryHeader) == 72);
+BOOST_STATIC_ASSERT(sizeof(BinarySeq) == 48);
+BOOST_STATIC_ASSERT(sizeof(BinaryBlock) == 24);
+BOOST_STATIC_ASSERT(sizeof(BinaryFragment) == 32);
+BOOST_STATIC_ASSERT(sizeof(NRun) == 16);
+
+static size_t align8(size_t offset) {
+    return (offset + 7) / 8 * 8;
+}
+
+/* Offsets of tables in the file */
+struct BinaryLayout {
+    size_t seqs_;
+    size_t blocks_;
+    size_t fragments_;
+    size_t strings_;
+    size_t letters_;
+    size_t n_runs_;
+    size_t rows_;
+    size_t end_;
+
+    BinaryLayout(const BinaryHeader& h) {
+        seqs_ = align8(sizeof(BinaryHeader));
+        blocks_ = align8(seqs_ + h.seqs_ * sizeof(BinarySeq));
+        fragments_ = align8(blocks_ + h.blocks_ * sizeof(BinaryBlock));
+        strings_ = align8(fragments_ +
+                          h.fragments_ * sizeof(BinaryFragment));
+        letters_ = align8(strings_ + h.strings_size_);
+        n_runs_ = align8(letters_ + h.letters_size_);
+        rows_ = align8(n_runs_ + h.n_runs_ * sizeof(NRun));
+        end_ = rows_ + h.row_words_ * sizeof(uint32_t);
+    }
+};
+
+static int letter_code(char c) {
+    switch (c) {
+    case 'A':
+        return 0;
+    case 'T':
+        return 1;
+    case 'G':
+        return 2;
+    case 'C':
+        return 3;
+    default:
+        return -1;
+    }
+}
+
+static const char CODE_LETTER[4] = {'A', 'T', 'G', 'C'};
+
+bool is_binary_block_set(const std::string& filename) {
+    if (filename.empty() || filename[0] == ':') {
+        return false;
+    }
+    std::string path = resolve_home_dir(filename);
+    if (!file_exists(path) || is_dir(path)) {
+        return false;
+    }
+    std::ifstream file(path.c_str(), std::ios_base::binary);
+    char magic[sizeof(MAGIC)];
+    if (!file.read(magic, sizeof(magic))) {
+        return false;
+    }
+    return std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+// writer
+
+template<typename T>
+static void write_table(std::ostream& out, const std::vector<T>& t) {
+    if (!t.empty()) {
+        out.write(reinterpret_cast<const char*>(&t[0]),
+                  t.size() * sizeof(T));
+    }
+}
+
+static void write_padding(std::ostream& out, size_t& offset) {
+    static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    size_t aligned = align8(offset);
+    out.write(zeros, aligned - offset);
+    offset = aligned;
+}
+
+/* length, then lengths of runs of letters and gaps */
+static void encode_row(const Fragment* f, std::vector<uint32_t>& words) {
+    const AlignmentRow* row = f->row();
+    words.push_back(row->length());
+    int prev = -1; // alignment position of previous letter
+    uint32_t letters = 0;
+    for (int pos = 0; pos < f->length(); pos++) {
+        int align_pos = row->map_to_alignment(pos);
+        ASSERT_GT(align_pos, prev);
+        int gap = align_pos - prev - 1;
+        if (gap > 0) {
+            words.push_back(letters);
+            words.push_back(gap);
+            letters = 0;
+        }
+        letters += 1;
+        prev = align_pos;
+    }
+    words.push_back(letters);
+    int gap = row->length() - prev - 1;
+    if (gap > 0) {
+        words.push_back(gap);
+    }
+}
+
+struct SeqNameLess {
+    bool operator()(const SequencePtr& a, const SequencePtr& b) const {
+        return a->name() < b->name();
+    }
+};
+
+void write_binary_block_set(const BlockSet& block_set,
+                            std::ostream& output) {
+    std::vector<SequencePtr> seqs = block_set.seqs();
+    std::sort(seqs.begin(), seqs.end(), SeqNameLess());
+    std::map<const Sequence*, int> seq_index;
+    for (int i = 0; i < seqs.size(); i++) {
+        seq_index[seqs[i].get()] = i;
+    }
+    std::vector<Block*> blocks(block_set.begin(), block_set.end());
+    std::vector<BinarySeq> seq_table;
+    std::vector<BinaryBlock> block_table;
+    std::vector<BinaryFragment> fragment_table;
+    std::string strings;
+    std::vector<unsigned char> letters;
+    std::vector<NRun> n_runs;
+    std::vector<uint32_t> rows;
+    BOOST_FOREACH (const SequencePtr& seq, seqs) {
+        BinarySeq s;
+        s.name_offset_ = strings.size();
+        s.name_length_ = seq->name().size();
+        s.descr_length_ = seq->description().size();
+        strings += seq->name();
+        strings += seq->description();
+        std::string contents = seq->contents();
+        s.length_ = contents.size();
+        s.letters_offset_ = letters.size();
+        s.first_n_run_ = n_runs.size();
+        letters.resize(letters.size() + (contents.size() + 3) / 4, 0);
+        for (size_t i = 0; i < contents.size(); i++) {
+            int code = letter_code(contents[i]);
+            if (code == -1) {
+                if (n_runs.size() > s.first_n_run_ &&
+                        n_runs.back().start_ +
+                        n_runs.back().length_ == i) {
+                    n_runs.back().length_ += 1;
+                } else {
+                    NRun run;
+                    run.start_ = i;
+                    run.length_ = 1;
+                    n_runs.push_back(run);
+                }
+                code = 0;
+            }
+            letters[s.letters_offset_ + i / 4] |= code << ((i % 4) * 2);
+        }
+        s.n_runs_ = n_runs.size() - s.first_n_run_;
+        seq_table.push_back(s);
+    }
+    BOOST_FOREACH (Block* block, blocks) {
+        BinaryBlock b;
+        b.name_offset_ = strings.size();
+        b.name_length_ = block->name().size();
+        strings += block->name();
+        b.size_ = block->size();
+        b.first_fragment_ = fragment_table.size();
+        BOOST_FOREACH (Fragment* fragment, *block) {
+            std::map<const Sequence*, int>::const_iterator it =
+                seq_index.find(fragment->seq());
+            if (it == seq_index.end()) {
+                throw Exception("Sequence of fragment " +
+                                fragment->id() +
+                                " is not in the blockset");
+            }
+            BinaryFragment f;
+            f.seq_ = it->second;
+            f.ori_ = fragment->ori();
+            f.min_pos_ = fragment->min_pos();
+            f.max_pos_ = fragment->max_pos();
+            if (fragment->row()) {
+                f.row_offset_ = rows.size();
+                encode_row(fragment, rows);
+            } else {
+                f.row_offset_ = NO_ROW;
+            }
+            fragment_table.push_back(f);
+        }
+        block_table.push_back(b);
+    }
+    BinaryHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic_, MAGIC, sizeof(MAGIC));
+    h.version_ = VERSION;
+    h.byte_order_mark_ = BYTE_ORDER_MARK;
+    h.seqs_ = seq_table.size();
+    h.blocks_ = block_table.size();
+    h.fragments_ = fragment_table.size();
+    h.strings_size_ = strings.size();
+    h.letters_size_ = letters.size();
+    h.n_runs_ = n_runs.size();
+    h.row_words_ = rows.size();
+    size_t offset = 0;
+    output.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    offset += sizeof(h);
+    write_padding(output, offset);
+    write_table(output, seq_table);
+    offset += seq_table.size() * sizeof(BinarySeq);
+    write_padding(output, offset);
+    write_table(output, block_table);
+    offset += block_table.size() * sizeof(BinaryBlock);
+    write_padding(output, offset);
+    write_table(output, fragment_table);
+    offset += fragment_table.size() * sizeof(BinaryFragment);
+    write_padding(output, offset);
+    output.write(strings.c_str(), strings.size());
+    offset += strings.size();
+    write_padding(output, offset);
+    write_table(output, letters);
+    offset += letters.size();
+    write_padding(output, offset);
+    write_table(output, n_runs);
+    offset += n_runs.size() * sizeof(NRun);
+    write_padding(output, offset);
+    write_table(output, rows);
+    offset += rows.size() * sizeof(uint32_t);
+    ASSERT_EQ(offset, BinaryLayout(h).end_);
+}
+
+// reader
+
+typedef std::map<std::string, SequencePtr> Name2Seq;
+typedef std::map<std::string, BlockSet*> Name2BlockSet;
+
+class BlockSetBinaryReader::Impl {
+public:
+    Name2BlockSet name2block_set_;
+    std::string filename_;
+    RowType row_type_;
+    SequenceType seq_type_;
+    int workers_;
+
+    typedef boost::iostreams::mapped_file_source MappedFile;
+    boost::shared_ptr<MappedFile> file_;
+    BinaryHeader header_;
+    const char* data_;
+    std::vector<SequencePtr> seqs_;
+
+    Impl(const std::string& filename,
+         RowType row_type, SequenceType seq_type):
+        filename_(filename),
+        row_type_(row_type), seq_type_(seq_type),
+        workers_(1), data_(0) {
+    }
+
+    BlockSet& target() const {
+        Name2BlockSet::const_iterator it = name2block_set_.find("target");
+        ASSERT_TRUE(it != name2block_set_.end());
+        return *(it->second);
+    }
+
+    void bad_file(const std::string& what) const {
+        throw Exception("Bad binary blockset " + filename_ + ": " + what);
+    }
+
+    void open() {
+        file_ = boost::make_shared<MappedFile>();
+        file_->open(resolve_home_dir(filename_));
+        if (!file_->is_open()) {
+            bad_file("can not open");
+        }
+        data_ = file_->data();
+        if (file_->size() < sizeof(BinaryHeader)) {
+            bad_file("too short");
+        }
+        std::memcpy(&header_, data_, sizeof(BinaryHeader));
+        if (std::memcmp(header_.magic_, MAGIC, sizeof(MAGIC)) != 0) {
+            bad_file("bad magic");
+        }
+        if (header_.byte_order_mark_ != BYTE_ORDER_MARK) {
+            bad_file("other byte order");
+        }
+        if (header_.version_ != VERSION) {
+            bad_file("unsupported version");
+        }
+        if (file_->size() != BinaryLayout(header_).end_) {
+            bad_file("wrong size");
+        }
+    }
+
+    template<typename T>
+    T entry(size_t table, uint64_t index) const {
+        T result;
+        std::memcpy(&result, data_ + table + index * sizeof(T),
+                    sizeof(T));
+        return result;
+    }
+
+    std::string str(uint64_t offset, uint32_t length) const {
+        if (offset + length > header_.strings_size_) {
+            bad_file("string out of range");
+        }
+        return std::string(data_ + BinaryLayout(header_).strings_ +
+                           offset, length);
+    }
+
+    void check_seq(const BinarySeq& s) const {
+        if (s.letters_offset_ + (s.length_ + 3) / 4 >
+                header_.letters_size_ ||
+                s.first_n_run_ + s.n_runs_ > header_.n_runs_) {
+            bad_file("sequence out of range");
+        }
+    }
+
+    /* Sequence pointing to letters and N runs in the mapping.
+    The mapping is kept alive by the sequence. */
+    SequencePtr map_seq(const BinarySeq& s) const {
+        check_seq(s);
+        BinaryLayout layout(header_);
+        uint64_t end = 0;
+        for (uint64_t r = 0; r < s.n_runs_; r++) {
+            NRun run = entry<NRun>(layout.n_runs_, s.first_n_run_ + r);
+            if (run.start_ < end || run.start_ + run.length_ > s.length_) {
+                bad_file("N run out of range");
+            }
+            end = run.start_ + run.length_;
+        }
+        const unsigned char* letters =
+            reinterpret_cast<const unsigned char*>(data_ +
+                    layout.letters_ + s.letters_offset_);
+        // tables are aligned to 8 bytes
+        const uint64_t* n_runs = reinterpret_cast<const uint64_t*>(
+                                     data_ + layout.n_runs_ +
+                                     s.first_n_run_ * sizeof(NRun));
+        return boost::make_shared<MappedSequence>(file_, letters,
+                s.length_, n_runs, s.n_runs_);
+    }
+
+    void decode_seq(int index, SequencePtr seq) const {
+        BinaryLayout layout(header_);
+        BinarySeq s = entry<BinarySeq>(layout.seqs_, index);
+        check_seq(s);
+        const unsigned char* l =
+            reinterpret_cast<const unsigned char*>(data_ +
+                    layout.letters_ + s.letters_offset_);
+        std::string contents(s.length_, 'N');
+        for (size_t i = 0; i < s.length_; i++) {
+            contents[i] = CODE_LETTER[(l[i / 4] >> ((i % 4) * 2)) & 3];
+        }
+        for (uint64_t r = 0; r < s.n_runs_; r++) {
+            NRun run = entry<NRun>(layout.n_runs_, s.first_n_run_ + r);
+            if (run.start_ + run.length_ > s.length_) {
+                bad_file("N run out of range");
+            }
+            std::fill(contents.begin() + run.start_,
+                      contents.begin() + run.start_ + run.length_, 'N');
+        }
+        seq->read_from_string(contents);
+    }
+
+    AlignmentRow* decode_row(uint64_t offset, int fragment_length) const {
+        BinaryLayout layout(header_);
+        AlignmentRow* row = AlignmentRow::new_row(row_type_);
+        uint64_t i = offset;
+        if (i >= header_.row_words_) {
+            bad_file("row out of range");
+        }
+        uint32_t length = entry<uint32_t>(layout.rows_, i++);
+        int fragment_pos = 0, align_pos = 0;
+        bool letters = true;
+        while (align_pos < length) {
+            if (i >= header_.row_words_) {
+                bad_file("row out of range");
+            }
+            uint32_t run = entry<uint32_t>(layout.rows_, i++);
+            if (letters) {
+                for (uint32_t k = 0; k < run; k++) {
+                    row->bind(fragment_pos, align_pos);
+                    fragment_pos += 1;
+                    align_pos += 1;
+                }
+            } else {
+                align_pos += run;
+            }
+            letters = !letters;
+        }
+        if (align_pos != length || fragment_pos != fragment_length) {
+            bad_file("bad row");
+        }
+        row->set_length(length);
+        return row;
+    }
+
+    Block* decode_block(uint64_t index) const {
+        BinaryLayout layout(header_);
+        BinaryBlock b = entry<BinaryBlock>(layout.blocks_, index);
+        if (b.first_fragment_ + b.size_ > header_.fragments_) {
+            bad_file("block out of range");
+        }
+        Block* block = new Block;
+        block->set_name(str(b.name_offset_, b.name_length_));
+        for (uint32_t j = 0; j < b.size_; j++) {
+            BinaryFragment f = entry<BinaryFragment>(layout.fragments_,
+                               b.first_fragment_ + j);
+            if (f.seq_ >= seqs_.size() || f.min_pos_ > f.max_pos_ ||
+                    f.max_pos_ >= seqs_[f.seq_]->size()) {
+                bad_file("fragment out of range");
+            }
+            Fragment* fragment = new Fragment(seqs_[f.seq_].get(),
+                                              f.min_pos_, f.max_pos_,
+                                              f.ori_);
+            if (f.row_offset_ != NO_ROW) {
+                fragment->set_row(decode_row(f.row_offset_,
+                                             fragment->length()));
+            }
+            block->insert(fragment);
+        }
+        return block;
+    }
+
+    void decode_blocks(uint64_t first, uint64_t last,
+                       std::vector<Block*>& blocks) const {
+        for (uint64_t i = first; i < last; i++) {
+            blocks[i] = decode_block(i);
+        }
+    }
+};
+
+BlockSetBinaryReader::BlockSetBinaryReader(BlockSet& block_set,
+        const std::string& filename, RowType row_type,
+        SequenceType seq_type):
+    impl_(new Impl(filename, row_type, seq_type)) {
+    set_block_set("target", &block_set);
+}
+
+BlockSetBinaryReader::~BlockSetBinaryReader() {
+    delete impl_;
+}
+
+void BlockSetBinaryReader::set_block_set(const std::string& name,
+        BlockSet* block_set) {
+    impl_->name2block_set_[name] = block_set;
+}
+
+int BlockSetBinaryReader::workers() const {
+    return impl_->workers_;
+}
+
+void BlockSetBinaryReader::set_workers(int workers) {
+    impl_->workers_ = workers;
+}
+
+void BlockSetBinaryReader::run() {
+    Impl& impl = *impl_;
+    impl.open();
+    BinaryLayout layout(impl.header_);
+    BlockSet& target = impl.target();
+    Name2Seq name2seq;
+    BOOST_FOREACH (const Name2BlockSet::value_type& n2bs,
+                  impl.name2block_set_) {
+        BOOST_FOREACH (SequencePtr seq, n2bs.second->seqs()) {
+            name2seq[seq->name()] = seq;
+        }
+    }
+    // sequences already present are not decoded
+    Tasks tasks;
+    for (uint64_t i = 0; i < impl.header_.seqs_; i++) {
+        BinarySeq s = impl.entry<BinarySeq>(layout.seqs_, i);
+        std::string name = impl.str(s.name_offset_, s.name_length_);
+        SequencePtr seq = name2seq[name];
+        if (!seq) {
+            if (impl.seq_type_ == MAPPED_SEQUENCE) {
+                seq = impl.map_seq(s);
+            } else {
+                seq = Sequence::new_sequence(impl.seq_type_);
+                tasks.push_back(boost::bind(&Impl::decode_seq, &impl,
+                                            int(i), seq));
+            }
+            seq->set_name(name);
+            seq->set_description(impl.str(s.name_offset_ +
+                                          s.name_length_,
+                                          s.descr_length_));
+        } else if (seq->size() != s.length_) {
+            impl.bad_file("length of sequence " + name +
+                          " differs from existing sequence");
+        }
+        impl.seqs_.push_back(seq);
+    }
+    do_tasks(tasks_to_generator(tasks), impl.workers_);
+    // sequences reused from other blocksets are added too
+    target.add_sequences(impl.seqs_);
+    // blocks are decoded by ranges
+    uint64_t blocks = impl.header_.blocks_;
+    std::vector<Block*> decoded(blocks);
+    const uint64_t RANGE = 1024;
+    tasks.clear();
+    for (uint64_t first = 0; first < blocks; first += RANGE) {
+        uint64_t last = std::min(first + RANGE, blocks);
+        tasks.push_back(boost::bind(&Impl::decode_blocks, &impl,
+                                    first, last, boost::ref(decoded)));
+    }
+    do_tasks(tasks_to_generator(tasks), impl.workers_);
+    BOOST_FOREACH (Block* block, decoded) {
+        target.insert(block);
+    }
+    // mapped sequences keep their own reference to the file
+    impl.file_.reset();
+    impl.data_ = 0;
+}
+
+}
+
@@ -0,0 +1,91 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef NPGE_BINARY_BLOCK_SET_HPP_
+#define NPGE_BINARY_BLOCK_SET_HPP_
+
+#include <iosfwd>
+#include <string>
+
+#include "global.hpp"
+
+namespace npge {
+
+/** Return if the file is a blockset in binary format.
+Only regular files are checked (not streams like ":stdin").
+*/
+bool is_binary_block_set(const std::string& filename);
+
+/** Write sequences and blocks of blockset in binary format.
+The file consists of a header (magic, version, byte order mark,
+sizes of tables) and tables aligned to 8 bytes:
+ - sequences (name, description, length, letters, N runs),
+ - blocks (name, range of fragments),
+ - fragments (sequence index, coordinates, ori, row),
+ - strings (names and descriptions),
+ - letters (2 bits per letter, non-ATGC letters are N runs),
+ - N runs (start, length),
+ - alignment rows (length and lengths of alternating
+   runs of letters and gaps, starting from letters).
+
+Numbers are written in native byte order; files with
+other byte order are rejected by the reader.
+*/
+void write_binary_block_set(const BlockSet& block_set,
+                            std::ostream& output);
+
+/** Read blockset in binary format.
+The file is memory-mapped. Sequences which are already
+present in the blockset or in associated blocksets (by name)
+are reused and not decoded.
+All blocks and sequences of the file are added to the blockset
+("target"), since the format does not store blockset names.
+Sequences and blocks are decoded by workers when run() is called.
+If seq_type is MAPPED_SEQUENCE, sequences are not decoded:
+they point to letters in the mapped file, which stays mapped
+until all of them are destroyed.
+*/
+class BlockSetBinaryReader {
+public:
+    /** Constructor.
+    \param block_set BlockSet to read to.
+    \param filename Name of file in binary format.
+    \param type Storage type of alignment rows.
+    \param seq_type Type of sequences created by this processor.
+    */
+    BlockSetBinaryReader(BlockSet& block_set,
+                         const std::string& filename,
+                         RowType type, SequenceType seq_type);
+
+    /** Destructor */
+    virtual ~BlockSetBinaryReader();
+
+    /** Associate name with blockset.
+    Sequences of the blockset are reused by the reader.
+    Name "target" replaces the blockset to read to.
+    */
+    void set_block_set(const std::string& name,
+                       BlockSet* block_set);
+
+    /** Return number of workers */
+    int workers() const;
+
+    /** Set number of workers */
+    void set_workers(int workers);
+
+    /** Run the reader */
+    void run();
+
+private:
+    class Impl;
+    Impl* impl_;
+};
+
+}
+
+#endif
+
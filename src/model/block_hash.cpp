@@ -6,12 +6,12 @@
  */
 
 #include <climits>
+#include <algorithm>
 #include <vector>
 #include <set>
 #include <string>
 #include <boost/cast.hpp>
 #include <boost/foreach.hpp>
-#include <boost/algorithm/string/join.hpp>
 
 #include "block_hash.hpp"
 #include "Sequence.hpp"
@@ -20,44 +20,56 @@
 #include "Block.hpp"
 #include "BlockSet.hpp"
 #include "thread_pool.hpp"
+#include "make_hash.hpp"
 #include "throw_assert.hpp"
 #include "cast.hpp"
 #include "global.hpp"
 
 namespace npge {
 
+const hash_t FNV_OFFSET = hash_t(0xcbf29ce484222325ULL);
+const hash_t FNV_PRIME = hash_t(0x100000001b3ULL);
+
+static hash_t name_hash(const Sequence* seq) {
+    hash_t result = FNV_OFFSET;
+    if (seq) {
+        const std::string& name = seq->name();
+        for (int i = 0; i < name.size(); i++) {
+            result = (result ^ hash_t((unsigned char)(name[i]))) *
+                     FNV_PRIME;
+        }
+    }
+    return result;
+}
+
+// same as hash of Fragment::id(): single reversed letter
+// has begin_pos = last_pos and is distinguished by ori
+static hash_t fragment_hash(hash_t name, const Fragment* f, int ori) {
+    hash_t h = mix_hash(name ^ hash_t(f->min_pos()));
+    h = mix_hash(h ^ (hash_t(f->max_pos()) << 1) ^
+                 hash_t(ori == 1 ? 1 : 0));
+    return h;
+}
+
 hash_t block_hash(const Block* block) {
-    Strings ids_dir, ids_inv;
-    BOOST_FOREACH (Fragment* f, *block) {
-        ids_dir.push_back(f->id());
-        f->inverse(/* inverse_row */ false);
-        ids_inv.push_back(f->id());
-        f->inverse(/* inverse_row */ false);
-    }
-    std::sort(ids_dir.begin(), ids_dir.end());
-    std::sort(ids_inv.begin(), ids_inv.end());
-    Strings& ids = (ids_dir < ids_inv) ? ids_dir : ids_inv;
-    std::string joint = boost::algorithm::join(ids, " ");
-    const int LOOP_SIZE = sizeof(hash_t) * 2;
-    // 2 = for * and for ^
-    int new_size = ((joint.size() + LOOP_SIZE - 1) / LOOP_SIZE)
-                   * LOOP_SIZE;
-    joint.resize(new_size, ' ');
-    const char* c = joint.c_str();
-    const hash_t* value = reinterpret_cast<const hash_t*>(c);
-    int loops = joint.size() / LOOP_SIZE;
-    hash_t a = 1;
-    for (int i = 0; i < loops; i++) {
-        a *= value[2 * i];
-        a ^= value[2 * i + 1];
-    }
-    return a;
+    // sum is used instead of XOR not to cancel out
+    // duplicate fragments
+    hash_t dir = 0, inv = 0;
+    BOOST_FOREACH (const Fragment* f, *block) {
+        hash_t name = name_hash(f->seq());
+        dir += fragment_hash(name, f, f->ori());
+        inv += fragment_hash(name, f, -f->ori());
+    }
+    return mix_hash(std::min(dir, inv));
 }
 
 class HashTask;
 class HashWorker;
 class HashGroup;
 
+// numeric block_hash is cheap, so blocks are grouped in tasks
+const int HASH_TASK_BLOCKS = 256;
+
 class HashGroup : public ReusingThreadGroup {
 public:
     HashGroup(const BlockSet& block_set):
@@ -91,29 +103,33 @@ public:
 
 class HashTask : public ThreadTask {
 public:
-    HashTask(const Block* block, HashWorker* worker):
-        ThreadTask(worker), block_(block) {
+    HashTask(HashWorker* worker):
+        ThreadTask(worker) {
     }
 
     void run_impl() {
         HashWorker* w = D_CAST<HashWorker*>(worker());
-        w->hash_ ^= block_hash(block_);
+        BOOST_FOREACH (const Block* block, blocks_) {
+            w->hash_ ^= block_hash(block);
+        }
     }
 
-private:
-    const Block* block_;
+    std::vector<const Block*> blocks_;
 };
 
 ThreadTask* HashGroup::create_task_impl(ThreadWorker* worker) {
-    while (it_ != end_ && (*it_)->size() <= 1) {
+    HashWorker* w = D_CAST<HashWorker*>(worker);
+    HashTask* task = new HashTask(w);
+    while (it_ != end_ && task->blocks_.size() < HASH_TASK_BLOCKS) {
+        if ((*it_)->size() > 1) {
+            task->blocks_.push_back(*it_);
+        }
         it_++;
     }
-    if (it_ == end_) {
+    if (task->blocks_.empty()) {
+        delete task;
         return 0;
     } else {
-        HashWorker* w = D_CAST<HashWorker*>(worker);
-        HashTask* task = new HashTask(*it_, w);
-        it_++;
         return task;
     }
 }
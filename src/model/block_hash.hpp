@@ -16,12 +16,17 @@ namespace npge {
 Fragment::id() (i.e., sequence names, fragment positions and ori)
 affects hash value.
 Alignment and order of fragments does not.
+Inversion of the block does not change the hash either.
+The hash is computed without strings and without changing
+the fragments.
 */
 hash_t block_hash(const Block* block);
 
-/** Return hash of block.
+/** Return hash of blockset.
 Hashes of blocks of blockset are XOR'ed.
 Blocks of <=1 fragment are skipped.
+All blocks are rehashed, see BlockSet::digest() for
+incremental version.
 */
 hash_t blockset_hash(const BlockSet& block_set,
                      int workers = 1);
@@ -6,15 +6,20 @@
  */
 
 #include <set>
+#include <vector>
 #include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
 
 #include "block_stat.hpp"
 #include "Block.hpp"
+#include "AlignmentMatrix.hpp"
 #include "Fragment.hpp"
 #include "Sequence.hpp"
 #include "BlockSet.hpp"
 #include "boundaries.hpp"
 #include "char_to_size.hpp"
+#include "simple_task.hpp"
 #include "throw_assert.hpp"
 
 namespace npge {
@@ -108,27 +113,92 @@ Decimal AlignmentStat::gc() const {
 // TODO rename Boundaries to smth
 typedef Boundaries Integers;
 
-void make_stat(AlignmentStat& stat, const Block* block, int start, int stop) {
-    int alignment_length = block->alignment_length();
-    if (stop == -1) {
-        stop = alignment_length - 1;
+struct ColumnsStat {
+    int ident_nogap_;
+    int ident_gap_;
+    int noident_nogap_;
+    int noident_gap_;
+    int pure_gap_;
+    int atgc_[LETTERS_NUMBER];
+
+    ColumnsStat():
+        ident_nogap_(0),
+        ident_gap_(0),
+        noident_nogap_(0),
+        noident_gap_(0),
+        pure_gap_(0) {
+        memset(&atgc_, 0, LETTERS_NUMBER * sizeof(int));
     }
-    stat.impl_->total_ = stop - start + 1;
+};
+
+typedef std::vector<ColumnsStat> ColumnsStats;
+
+static void stat_columns(ColumnsStat& s, const AlignmentMatrix& matrix,
+                         int start, int stop) {
     for (int pos = start; pos <= stop; pos++) {
-        bool ident, gap, pure_gap;
-        test_column(block, pos, ident, gap, pure_gap, stat.impl_->atgc_);
+        bool ident, gap;
+        char letter = matrix.test_column(pos, ident, gap, s.atgc_);
+        bool pure_gap = (letter == 0);
         if (!pure_gap) {
             if (ident && !gap) {
-                stat.impl_->ident_nogap_ += 1;
+                s.ident_nogap_ += 1;
             } else if (ident && gap) {
-                stat.impl_->ident_gap_ += 1;
+                s.ident_gap_ += 1;
             } else if (!ident && !gap) {
-                stat.impl_->noident_nogap_ += 1;
+                s.noident_nogap_ += 1;
             } else if (!ident && gap) {
-                stat.impl_->noident_gap_ += 1;
+                s.noident_gap_ += 1;
             }
         } else {
-            stat.impl_->pure_gap_ += 1;
+            s.pure_gap_ += 1;
+        }
+    }
+}
+
+static void stat_chunks(ColumnsStats& stats,
+                        const AlignmentMatrix& matrix,
+                        int start, int stop, int chunk,
+                        int first, int last) {
+    for (int i = first; i < last; i++) {
+        int chunk_start = start + i * chunk;
+        int chunk_stop = std::min(chunk_start + chunk - 1, stop);
+        stat_columns(stats[i], matrix, chunk_start, chunk_stop);
+    }
+}
+
+void make_stat(AlignmentStat& stat, const Block* block, int start, int stop) {
+    AlignmentMatrix matrix(block, start, stop);
+    make_stat(stat, block, matrix, start, stop);
+}
+
+void make_stat(AlignmentStat& stat, const Block* block,
+               const AlignmentMatrix& matrix, int start, int stop) {
+    int alignment_length = block->alignment_length();
+    if (stop == -1) {
+        stop = alignment_length - 1;
+    }
+    ASSERT_LTE(matrix.start(), start);
+    ASSERT_TRUE(stop <= matrix.stop() || stop < start);
+    stat.impl_->total_ = stop - start + 1;
+    // columns of giant block are counted by chunks
+    // in parallel (see spawn_ranges)
+    const int MIN_CHUNK_CELLS = 1 << 16;
+    int chunk = std::max(1024, MIN_CHUNK_CELLS /
+                         std::max(int(block->size()), 1));
+    int columns = std::max(stop - start + 1, 0);
+    int chunks = (columns + chunk - 1) / chunk;
+    ColumnsStats stats(chunks);
+    spawn_ranges(chunks, 1, boost::bind(stat_chunks, boost::ref(stats),
+                                        boost::cref(matrix),
+                                        start, stop, chunk, _1, _2));
+    BOOST_FOREACH (const ColumnsStat& s, stats) {
+        stat.impl_->ident_nogap_ += s.ident_nogap_;
+        stat.impl_->ident_gap_ += s.ident_gap_;
+        stat.impl_->noident_nogap_ += s.noident_nogap_;
+        stat.impl_->noident_gap_ += s.noident_gap_;
+        stat.impl_->pure_gap_ += s.pure_gap_;
+        for (int i = 0; i < LETTERS_NUMBER; i++) {
+            stat.impl_->atgc_[i] += s.atgc_[i];
         }
     }
     Integers lengths;
@@ -62,7 +62,8 @@ private:
 
     Impl* impl_;
 
-    friend void make_stat(AlignmentStat&, const Block*, int, int);
+    friend void make_stat(AlignmentStat&, const Block*,
+                          const AlignmentMatrix&, int, int);
 };
 
 /** Make alignment stat of alignment.
@@ -72,10 +73,18 @@ private:
 \param stop last column to consider (-1 means last column of alignment)
 
 start and stop affect gaps, ident and ATGC counters only.
+Only columns from start to stop are read into AlignmentMatrix.
 */
 void make_stat(AlignmentStat& stat, const Block* block, int start = 0,
                int stop = -1);
 
+/** Make alignment stat of alignment using prebuilt matrix.
+The matrix must store columns from start to stop.
+*/
+void make_stat(AlignmentStat& stat, const Block* block,
+               const AlignmentMatrix& matrix, int start = 0,
+               int stop = -1);
+
 /** Return if the column is ident and has no gaps */
 bool is_ident_nogap(const Block* block, int column);
 
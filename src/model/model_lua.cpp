@@ -298,6 +298,11 @@ static void make_stat0(AlignmentStat& stat,
     make_stat(stat, block, 0, -1);
 }
 
+static void make_stat2(AlignmentStat& stat, const Block* block,
+                       int start, int stop) {
+    make_stat(stat, block, start, stop);
+}
+
 static Decimal alignmentstat_identity(
     const AlignmentStat& stat) {
     return block_identity(stat);
@@ -360,7 +365,8 @@ static luabind::scope register_sequence() {
                value("ASIS_SEQUENCE", ASIS_SEQUENCE),
                value("COMPACT_SEQUENCE", COMPACT_SEQUENCE),
                value("COMPACT_LOW_N_SEQUENCE",
-                     COMPACT_LOW_N_SEQUENCE)
+                     COMPACT_LOW_N_SEQUENCE),
+               value("MAPPED_SEQUENCE", MAPPED_SEQUENCE)
            ]
            .scope [
                def("new", &new_sequence0),
@@ -563,7 +569,8 @@ static luabind::scope register_alignment_row() {
            class_<AlignmentRow>("AlignmentRow")
            .enum_("Type") [
                value("MAP_ROW", MAP_ROW),
-               value("COMPACT_ROW", COMPACT_ROW)
+               value("COMPACT_ROW", COMPACT_ROW),
+               value("SUCCINCT_ROW", SUCCINCT_ROW)
            ]
            .scope [
                def("new", &AlignmentRow::new_row),
@@ -673,7 +680,7 @@ static luabind::scope register_alignment_stat() {
                 &AlignmentStat::min_fragment_length)
            .def("letter_count", &alignmentstat_letter_count)
            .def("gc", &AlignmentStat::gc)
-           .def("make_stat", &make_stat)
+           .def("make_stat", &make_stat2)
            .def("make_stat", &make_stat0)
            .def("block_identity", &alignmentstat_identity)
           ;
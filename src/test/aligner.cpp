@@ -5,11 +5,25 @@
  * See the LICENSE file for terms of use.
  */
 
+#include <algorithm>
 #include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 
 #include "SimilarAligner.hpp"
+#include "BandedAligner.hpp"
+#include "ProgressiveAligner.hpp"
 #include "DummyAligner.hpp"
+#include "MetaAligner.hpp"
 #include "ExternalAligner.hpp"
+#include "PipeProcess.hpp"
+#include "Sequence.hpp"
+#include "Fragment.hpp"
+#include "Block.hpp"
+#include "BlockSet.hpp"
+#include "read_file.hpp"
+#include "name_to_stream.hpp"
+#include "simple_task.hpp"
 
 BOOST_AUTO_TEST_CASE (Aligner_test) {
     using namespace npge;
@@ -27,3 +41,201 @@ BOOST_AUTO_TEST_CASE (Aligner_test) {
     BOOST_CHECK(!ea_bad.test(/* gaps */ true));
 }
 
+BOOST_AUTO_TEST_CASE (Aligner_external_pipes) {
+    using namespace npge;
+    if (!PipeProcess::supported()) {
+        return;
+    }
+    ExternalAligner ea;
+    // rows of equal length are valid alignment
+    ea.set_opt_value("aligner-cmd", std::string("cat %1% > %2%"));
+    ea.set_opt_value("aligner-pipes", true);
+    Strings seqs;
+    seqs.push_back("ATGC");
+    seqs.push_back("atcc");
+    seqs.push_back("");
+    ea.align_seqs(seqs);
+    BOOST_REQUIRE(seqs.size() == 3);
+    BOOST_CHECK(seqs[0] == "ATGC");
+    BOOST_CHECK(seqs[1] == "ATCC");
+    BOOST_CHECK(seqs[2] == "----");
+    ea.set_opt_value("aligner-cmd", std::string("exit 1"));
+    BOOST_CHECK(!ea.test());
+}
+
+BOOST_AUTO_TEST_CASE (Aligner_external_server) {
+    using namespace npge;
+    if (!PipeProcess::supported()) {
+        return;
+    }
+    ExternalAligner ea;
+    ea.set_opt_value("aligner-cmd", std::string("false"));
+    ea.set_opt_value("aligner-server", std::string("cat"));
+    std::vector<Strings> batch(3);
+    batch[0].push_back("ATGC");
+    batch[0].push_back("ATCC");
+    batch[1].push_back("");
+    batch[2].push_back("AA");
+    batch[2].push_back("TT");
+    batch[2].push_back("");
+    for (int i = 0; i < 2; i++) {
+        std::vector<Strings> b = batch;
+        ea.align_seqs_batch(b);
+        BOOST_REQUIRE(b.size() == 3);
+        BOOST_CHECK(b[0] == batch[0]);
+        BOOST_CHECK(b[1] == batch[1]);
+        BOOST_REQUIRE(b[2].size() == 3);
+        BOOST_CHECK(b[2][0] == "AA");
+        BOOST_CHECK(b[2][1] == "TT");
+        BOOST_CHECK(b[2][2] == "--");
+    }
+    ea.stop_servers();
+    ea.set_opt_value("aligner-server", std::string("head -n 1"));
+    BOOST_CHECK(!ea.test());
+}
+
+
+BOOST_AUTO_TEST_CASE (Aligner_banded) {
+    using namespace npge;
+    BandedAligner ba;
+    BOOST_CHECK(ba.test(/* gaps */ false));
+    BOOST_CHECK(ba.test(/* gaps */ true));
+    Strings seqs;
+    seqs.push_back("ATGCTAGCTAGCATCGAT");
+    seqs.push_back("ATGCTAGTAGCATCGAT");
+    seqs.push_back("ATGCTAGCTAGCAATCGAT");
+    ba.align_seqs(seqs);
+    BOOST_CHECK(seqs[0] == "ATGCTAGCTAGC-ATCGAT");
+    BOOST_CHECK(seqs[1] == "ATGCTAG-TAGC-ATCGAT");
+    BOOST_CHECK(seqs[2] == "ATGCTAGCTAGCAATCGAT");
+}
+
+BOOST_AUTO_TEST_CASE (Aligner_progressive) {
+    using namespace npge;
+    ProgressiveAligner pa;
+    BOOST_CHECK(pa.test(/* gaps */ false));
+    BOOST_CHECK(pa.test(/* gaps */ true));
+    Strings seqs;
+    seqs.push_back("ATGCTAGCTAGCATCGAT");
+    seqs.push_back("ATGCTAGTAGCATCGAT");
+    seqs.push_back("ATGCTAGCTAGCAATCGAT");
+    seqs.push_back("ATGCTAGTAGCATCGAT");
+    Strings orig = seqs;
+    pa.align_seqs(seqs);
+    for (int i = 0; i < seqs.size(); i++) {
+        BOOST_CHECK(seqs[i].size() == seqs[0].size());
+        std::string s = seqs[i];
+        s.erase(std::remove(s.begin(), s.end(), '-'), s.end());
+        BOOST_CHECK(s == orig[i]);
+    }
+    BOOST_CHECK(seqs[1] == seqs[3]);
+    BOOST_CHECK(seqs[2] == "ATGCTAGCTAGCAATCGAT");
+}
+
+static void align_progressive(npge::Strings* seqs) {
+    npge::ProgressiveAligner pa;
+    pa.align_seqs(*seqs);
+}
+
+BOOST_AUTO_TEST_CASE (Aligner_progressive_subtasks) {
+    using namespace npge;
+    Strings seqs;
+    unsigned int r = 1;
+    std::string base;
+    for (int i = 0; i < 200; i++) {
+        r = r * 1103515245 + 12345;
+        base += "ATGC"[(r >> 8) % 4];
+    }
+    for (int i = 0; i < 40; i++) {
+        std::string seq = base;
+        for (int j = 0; j < 5; j++) {
+            r = r * 1103515245 + 12345;
+            int pos = (r >> 8) % seq.size();
+            if (j % 2) {
+                seq.erase(pos, 1);
+            } else {
+                seq[pos] = "ATGC"[(r >> 4) % 4];
+            }
+        }
+        seqs.push_back(seq);
+    }
+    Strings expected = seqs;
+    align_progressive(&expected);
+    // guide tree and subtrees are processed by spawned tasks
+    Tasks tasks;
+    tasks.push_back(boost::bind(align_progressive, &seqs));
+    do_tasks(tasks_to_generator(tasks), 4);
+    BOOST_CHECK(seqs == expected);
+}
+
+class BatchCountingAligner : public npge::DummyAligner {
+public:
+    mutable int batches_;
+
+    BatchCountingAligner():
+        batches_(0) {
+    }
+
+    std::string aligner_type() const {
+        return "batch-counting";
+    }
+
+protected:
+    void align_seqs_batch_impl(std::vector<npge::Strings>& batch) const {
+        batches_ += 1;
+        DummyAligner::align_seqs_batch_impl(batch);
+    }
+};
+
+BOOST_AUTO_TEST_CASE (Aligner_meta_batch) {
+    using namespace npge;
+    MetaAligner ma;
+    BatchCountingAligner* counting = new BatchCountingAligner;
+    ma.add_aligner(counting);
+    ma.set_opt_value("aligner-type", std::string("batch-counting"));
+    std::vector<Strings> batch(2);
+    batch[0].push_back("ATGC");
+    batch[0].push_back("AT");
+    batch[1].push_back("A");
+    ma.align_seqs_batch(batch);
+    BOOST_CHECK(counting->batches_ == 1);
+    BOOST_CHECK(batch[0][1] == "AT--");
+    BOOST_CHECK(batch[1][0] == "A");
+}
+
+BOOST_AUTO_TEST_CASE (Aligner_meta_server_batch) {
+    using namespace npge;
+    if (!PipeProcess::supported()) {
+        return;
+    }
+    MetaAligner ma;
+    ExternalAligner* ea = new ExternalAligner;
+    ma.add_aligner(ea);
+    ma.set_opt_value("aligner-type", std::string("external"));
+    std::string log = ma.tmp_file();
+    // rows of equal length are valid alignment
+    ea->set_opt_value("aligner-cmd", std::string("false"));
+    ea->set_opt_value("aligner-server", "tee " + log);
+    ea->set_opt_value("aligner-batch", 4);
+    SequencePtr seq(new InMemorySequence("TGAGATGCGGGCCTGAGATGCGGGCC"));
+    ma.block_set()->add_sequence(seq);
+    for (int i = 0; i < 5; i++) {
+        Block* b = new Block;
+        b->insert(new Fragment(seq, i, i + 3));
+        b->insert(new Fragment(seq, i + 10, i + 13));
+        ma.block_set()->insert(b);
+    }
+    ma.set_workers(1);
+    ma.run();
+    BOOST_FOREACH (Block* b, *ma.block_set()) {
+        BOOST_FOREACH (Fragment* f, *b) {
+            BOOST_CHECK(f->row());
+        }
+    }
+    ea->stop_servers();
+    std::string requests = read_file(log);
+    remove_file(log);
+    // 5 blocks are sent as 2 requests: 4 + 1 blocks
+    BOOST_CHECK(std::count(requests.begin(), requests.end(), '/') == 4);
+    BOOST_CHECK(std::count(requests.begin(), requests.end(), '>') == 10);
+}
@@ -0,0 +1,143 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <cstdlib>
+#include <boost/test/unit_test.hpp>
+#include <boost/foreach.hpp>
+
+#include "AlignmentMatrix.hpp"
+#include "Sequence.hpp"
+#include "Fragment.hpp"
+#include "Block.hpp"
+#include "AlignmentRow.hpp"
+#include "block_stat.hpp"
+#include "char_to_size.hpp"
+
+static void check_matrix(const npge::Block* block) {
+    using namespace npge;
+    AlignmentMatrix m(block);
+    BOOST_REQUIRE(m.rows() == block->size());
+    BOOST_REQUIRE(m.length() == block->alignment_length());
+    for (pos_t col = 0; col < m.length(); col++) {
+        int row = 0;
+        char seen = 0;
+        bool ident = true, gap = false;
+        int atgc[LETTERS_NUMBER] = {0};
+        BOOST_FOREACH (Fragment* f, *block) {
+            char c = f->alignment_at(col);
+            BOOST_CHECK(m.at(row, col) == c);
+            if (c == 0) {
+                gap = true;
+            } else {
+                atgc[char_to_size(c)] += 1;
+                if (seen == 0) {
+                    seen = c;
+                } else if (c != seen) {
+                    ident = false;
+                }
+            }
+            row += 1;
+        }
+        bool m_ident, m_gap;
+        int m_atgc[LETTERS_NUMBER] = {0};
+        char letter = m.test_column(col, m_ident, m_gap, m_atgc);
+        BOOST_CHECK(letter == seen);
+        BOOST_CHECK(m_ident == ident);
+        BOOST_CHECK(m_gap == gap);
+        for (int i = 0; i < LETTERS_NUMBER; i++) {
+            BOOST_CHECK(m_atgc[i] == atgc[i]);
+        }
+    }
+}
+
+static void check_range(const npge::Block* block,
+                        npge::pos_t start, npge::pos_t stop) {
+    using namespace npge;
+    AlignmentMatrix full(block);
+    AlignmentMatrix m(block, start, stop);
+    BOOST_REQUIRE(m.start() == start);
+    if (stop == -1) {
+        stop = block->alignment_length() - 1;
+    }
+    BOOST_REQUIRE(m.stop() == stop);
+    for (pos_t col = start; col <= stop; col++) {
+        for (int row = 0; row < m.rows(); row++) {
+            BOOST_CHECK(m.at(row, col) == full.at(row, col));
+        }
+    }
+    AlignmentStat stat, full_stat;
+    make_stat(stat, block, start, stop);
+    make_stat(full_stat, block, full, start, stop);
+    BOOST_CHECK(stat.total() == full_stat.total());
+    BOOST_CHECK(stat.ident_nogap() == full_stat.ident_nogap());
+    BOOST_CHECK(stat.ident_gap() == full_stat.ident_gap());
+    BOOST_CHECK(stat.noident_nogap() == full_stat.noident_nogap());
+    BOOST_CHECK(stat.noident_gap() == full_stat.noident_gap());
+    BOOST_CHECK(stat.letter_count('A') == full_stat.letter_count('A'));
+}
+
+BOOST_AUTO_TEST_CASE (AlignmentMatrix_main) {
+    using namespace npge;
+    SequencePtr s = boost::make_shared<InMemorySequence>("ATGCNATGCA"
+                    "TTGCAATGCATGGATGCA");
+    Block block;
+    for (int i = 0; i < 37; i++) {
+        int ori = (i % 3 == 0) ? -1 : 1;
+        Fragment* f = new Fragment(s, i % 7, i % 7 + 12, ori);
+        std::string letters = f->str(0);
+        std::string alignment;
+        for (int j = 0; j < letters.size(); j++) {
+            if ((i + j) % 5 == 0) {
+                alignment += '-';
+            }
+            alignment += letters[j];
+        }
+        AlignmentRow* row = AlignmentRow::new_row(COMPACT_ROW);
+        row->grow(alignment);
+        f->set_row(row);
+        block.insert(f);
+    }
+    check_matrix(&block);
+    check_range(&block, 3, 9);
+    check_range(&block, 0, 0);
+    check_range(&block, 10, -1);
+    // new matrix follows changes of rows, fragments and block
+    block.front()->row()->grow("-");
+    check_matrix(&block);
+    block.front()->inverse();
+    check_matrix(&block);
+    block.front()->set_row(0);
+    check_matrix(&block);
+    block.erase(block.front());
+    check_matrix(&block);
+}
+
+BOOST_AUTO_TEST_CASE (AlignmentMatrix_columns) {
+    using namespace npge;
+    SequencePtr s = boost::make_shared<InMemorySequence>("AAAAAAAAAA"
+                    "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA");
+    Block block;
+    for (int i = 0; i < 40; i++) {
+        block.insert(new Fragment(s, i, i + 5));
+    }
+    bool ident, gap, pure_gap;
+    test_column(&block, 0, ident, gap);
+    BOOST_CHECK(ident && !gap);
+    BOOST_CHECK(is_ident_nogap(&block, 3));
+    // gap in the last (scalar) part
+    block.insert(new Fragment(s, 0, 3));
+    test_column(&block, 5, ident, gap);
+    BOOST_CHECK(ident && gap);
+    BOOST_CHECK(!is_ident_nogap(&block, 5));
+    int atgc[LETTERS_NUMBER] = {0};
+    test_column(&block, 5, ident, gap, pure_gap, atgc);
+    BOOST_CHECK(!pure_gap);
+    BOOST_CHECK(atgc[char_to_size('A')] == 40);
+    Block empty;
+    BOOST_CHECK(is_ident_nogap(&empty, 0));
+}
+
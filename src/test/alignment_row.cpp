@@ -144,6 +144,7 @@ BOOST_AUTO_TEST_CASE (AlignmentRow_map_to_alignment) {
     std::vector<RowType> types;
     types.push_back(MAP_ROW);
     types.push_back(COMPACT_ROW);
+    types.push_back(SUCCINCT_ROW);
     for (int length = 0; length < 150; length++) {
         BOOST_FOREACH (RowType type, types) {
             AlignmentRow* row = AlignmentRow::new_row(type);
@@ -174,3 +175,58 @@ BOOST_AUTO_TEST_CASE (AlignmentRow_InversedRow) {
     BOOST_CHECK(f->str() == "CAT-T");
 }
 
+
+BOOST_AUTO_TEST_CASE (SuccinctAlignmentRow_main) {
+    using namespace npge;
+    SequencePtr s1 = boost::make_shared<InMemorySequence>("TGGTCCGAGATGCGGGCC");
+    Fragment f1(s1, 0, 9, 1);
+    AlignmentRow* row = new SuccinctAlignmentRow("TG--GTCCG-AGA");
+    f1.set_row(row);
+    BOOST_CHECK(row->type() == SUCCINCT_ROW);
+    BOOST_CHECK(row->length() == 13);
+    BOOST_CHECK(row->map_to_alignment(2) == 4);
+    BOOST_CHECK(row->map_to_fragment(4) == 2);
+    BOOST_CHECK(row->map_to_fragment(3) == -1);
+    BOOST_CHECK(row->map_to_fragment(13) == -1);
+    BOOST_CHECK(row->map_to_alignment(10) == -1);
+    BOOST_CHECK(row->nearest_in_fragment(2) == 1);
+    BOOST_CHECK(row->nearest_in_fragment(3) == 2);
+    BOOST_CHECK(f1.str('-') == "TG--GTCCG-AGA");
+}
+
+BOOST_AUTO_TEST_CASE (SuccinctAlignmentRow_random) {
+    using namespace npge;
+    for (int iteration = 0; iteration < 20; iteration++) {
+        int length = 1 + iteration * 37;
+        std::string alignment;
+        for (int i = 0; i < length; i++) {
+            // long gaps to have empty words
+            bool gap = (i / 100) % 3 == 1 || (i * 7 + iteration) % 5 == 0;
+            alignment += gap ? '-' : 'A';
+        }
+        MapAlignmentRow map_row(alignment);
+        SuccinctAlignmentRow row(alignment);
+        // same bits set in reverse order
+        SuccinctAlignmentRow reversed;
+        reversed.set_length(length);
+        for (int i = length - 1; i >= 0; i--) {
+            if (alignment[i] != '-') {
+                reversed.bind(-1, i);
+            }
+        }
+        // index of reversed row is rebuilt by first query
+        BOOST_REQUIRE(row.length() == length);
+        for (int pos = -2; pos < length + 2; pos++) {
+            BOOST_CHECK(row.map_to_fragment(pos) ==
+                        map_row.map_to_fragment(pos));
+            BOOST_CHECK(reversed.map_to_fragment(pos) ==
+                        map_row.map_to_fragment(pos));
+            BOOST_CHECK(row.map_to_alignment(pos) ==
+                        map_row.map_to_alignment(pos));
+            BOOST_CHECK(reversed.map_to_alignment(pos) ==
+                        map_row.map_to_alignment(pos));
+            BOOST_CHECK(row.nearest_in_fragment(pos) ==
+                        map_row.nearest_in_fragment(pos));
+        }
+    }
+}
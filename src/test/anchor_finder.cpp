@@ -5,6 +5,7 @@
  * See the LICENSE file for terms of use.
  */
 
+#include <cstdio>
 #include <boost/test/unit_test.hpp>
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
@@ -14,6 +15,10 @@
 #include "Block.hpp"
 #include "BlockSet.hpp"
 #include "AnchorFinder.hpp"
+#include "SeqI.hpp"
+#include "KmerIndex.hpp"
+#include "temp_file.hpp"
+#include "test_sequences.hpp"
 
 BOOST_AUTO_TEST_CASE (AnchorFinder_main) {
     using namespace npge;
@@ -109,3 +114,223 @@ BOOST_AUTO_TEST_CASE (AnchorFinder_two_workers) {
     BOOST_WARN(block_set->size() >= 1 && block_set->front()->size() == 4);
 }
 
+
+BOOST_AUTO_TEST_CASE (AnchorFinder_hash_main) {
+    using namespace npge;
+    SequencePtr s1 = boost::make_shared<InMemorySequence>("tgGTCCGagCGGACggcc");
+    BlockSetPtr block_set = new_bs();
+    block_set->add_sequence(s1);
+    AnchorFinder anchor_finder;
+    anchor_finder.set_block_set(block_set);
+    anchor_finder.set_opt_value("anchor-size", 5);
+    anchor_finder.set_opt_value("anchor-engine", std::string("hash"));
+    anchor_finder.run();
+    BOOST_REQUIRE(block_set->size() == 1);
+    Fragment* f = block_set->front()->front();
+    BOOST_CHECK(f->str() == "GTCCG" || f->str() == "CGGAC");
+    // second run does not return same anchors
+    BlockSetPtr block_set2 = new_bs();
+    block_set2->add_sequence(s1);
+    anchor_finder.set_block_set(block_set2);
+    anchor_finder.run();
+    BOOST_CHECK(block_set2->size() == 0);
+}
+
+BOOST_AUTO_TEST_CASE (AnchorFinder_hash_n) {
+    using namespace npge;
+    SequencePtr s1 = boost::make_shared<InMemorySequence>("tgGTNCGagCGNACggcc");
+    SequencePtr s2 = boost::make_shared<InMemorySequence>("GTNCGATAnnnGTNCGATA");
+    BlockSetPtr block_set = new_bs();
+    block_set->add_sequence(s1);
+    AnchorFinder anchor_finder;
+    anchor_finder.set_block_set(block_set);
+    anchor_finder.set_opt_value("anchor-size", 5);
+    anchor_finder.set_opt_value("anchor-engine", std::string("hash"));
+    anchor_finder.run();
+    BOOST_CHECK(block_set->size() == 0);
+    BlockSetPtr block_set2 = new_bs();
+    block_set2->add_sequence(s2);
+    anchor_finder.set_block_set(block_set2);
+    anchor_finder.run();
+    BOOST_CHECK(block_set2->size() > 0);
+}
+
+BOOST_AUTO_TEST_CASE (AnchorFinder_hash_palindrome) {
+    using namespace npge;
+    SequencePtr s1 = boost::make_shared<InMemorySequence>("ATGCAT");
+    BlockSetPtr block_set = new_bs();
+    block_set->add_sequence(s1);
+    AnchorFinder anchor_finder;
+    anchor_finder.set_block_set(block_set);
+    anchor_finder.set_opt_value("anchor-size", 6);
+    anchor_finder.set_opt_value("anchor-engine", std::string("hash"));
+    anchor_finder.run();
+    BOOST_CHECK(block_set->size() == 0);
+}
+
+BOOST_AUTO_TEST_CASE (AnchorFinder_hash_workers) {
+    using namespace npge;
+    SequencePtr s1 = boost::make_shared<InMemorySequence>("GAAAGAAA");
+    SequencePtr s2 = boost::make_shared<InMemorySequence>("GAAAGAAA");
+    for (int workers = 1; workers <= 3; workers++) {
+        BlockSetPtr block_set = new_bs();
+        block_set->add_sequence(s1);
+        block_set->add_sequence(s2);
+        AnchorFinder anchor_finder;
+        anchor_finder.set_block_set(block_set);
+        anchor_finder.set_opt_value("anchor-size", 3);
+        anchor_finder.set_opt_value("anchor-engine",
+                                    std::string("hash"));
+        anchor_finder.set_workers(workers);
+        anchor_finder.run();
+        BOOST_REQUIRE(block_set->size() == 1);
+        BOOST_CHECK(block_set->front()->size() == 4);
+        BOOST_CHECK(block_set->front()->front()->str() == "GAA" ||
+                    block_set->front()->front()->str() == "TTC");
+    }
+}
+
+BOOST_AUTO_TEST_CASE (AnchorFinder_hash_not_similar) {
+    using namespace npge;
+    SequencePtr s1 = boost::make_shared<InMemorySequence>("GAAAGAAA");
+    BlockSetPtr block_set = new_bs();
+    block_set->add_sequence(s1);
+    AnchorFinder anchor_finder;
+    anchor_finder.set_block_set(block_set);
+    anchor_finder.set_opt_value("anchor-size", 3);
+    anchor_finder.set_opt_value("anchor-similar", false);
+    anchor_finder.set_opt_value("anchor-engine", std::string("hash"));
+    anchor_finder.run();
+    // GAA and AAA
+    BOOST_CHECK(block_set->size() == 2);
+}
+
+BOOST_AUTO_TEST_CASE (AnchorFinder_make_parts) {
+    using namespace npge;
+    std::srand(1);
+    BlockSetPtr block_set = new_bs();
+    SequencePtr s1 = boost::make_shared<CompactSequence>(random_dna(350000));
+    SequencePtr s2 = boost::make_shared<CompactSequence>(random_dna(1000));
+    block_set->add_sequence(s1);
+    block_set->add_sequence(s2);
+    SeqBase base(*block_set);
+    base.anchor_ = 20;
+    base.make_seqs();
+    base.make_parts(1);
+    BOOST_CHECK(base.parts_.size() == 2);
+    base.make_parts(4);
+    BOOST_CHECK(base.parts_.size() == 5);
+    std::vector<int> kmers(s1->size() - base.anchor_ + 1);
+    BOOST_FOREACH (const SeqPart& part, base.parts_) {
+        BOOST_REQUIRE(base.seqs_[part.seq_index_] == part.seq_);
+        BOOST_REQUIRE(part.end_ <= part.seq_->size());
+        if (part.seq_ == s1.get()) {
+            for (pos_t p = part.begin_;
+                    p + base.anchor_ <= part.end_; p++) {
+                kmers[p] += 1;
+            }
+        }
+    }
+    BOOST_CHECK(std::count(kmers.begin(), kmers.end(), 1) ==
+                kmers.size());
+}
+
+BOOST_AUTO_TEST_CASE (AnchorFinder_parts_workers) {
+    using namespace npge;
+    std::srand(2);
+    std::string repeat = random_dna(100);
+    std::string s = random_dna(99950) + repeat +
+                    random_dna(100000) + repeat + random_dna(100000);
+    SequencePtr s1 = boost::make_shared<CompactSequence>(s);
+    std::string engines[] = {"bloom", "hash"};
+    BOOST_FOREACH (const std::string& engine, engines) {
+        for (int workers = 1; workers <= 4; workers += 3) {
+            BlockSetPtr block_set = new_bs();
+            block_set->add_sequence(s1);
+            AnchorFinder anchor_finder;
+            anchor_finder.set_block_set(block_set);
+            anchor_finder.set_opt_value("anchor-size", 20);
+            anchor_finder.set_opt_value("anchor-similar", false);
+            anchor_finder.set_opt_value("anchor-engine", engine);
+            anchor_finder.set_workers(workers);
+            anchor_finder.run();
+            // all k-mers of the repeat (crossing border of parts)
+            BOOST_CHECK(block_set->size() >= 100 - 20 + 1);
+            BOOST_CHECK(block_set->size() < 100);
+        }
+    }
+}
+
+static int count_fragments(const npge::BlockSet& bs) {
+    int result = 0;
+    BOOST_FOREACH (npge::Block* block, bs) {
+        result += block->size();
+    }
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE (AnchorFinder_index) {
+    using namespace npge;
+    std::srand(3);
+    std::string repeat = random_dna(50);
+    SequencePtr s1 = boost::make_shared<CompactSequence>(
+                         random_dna(1000) + repeat + random_dna(1000));
+    SequencePtr s2 = boost::make_shared<CompactSequence>(
+                         random_dna(500) + repeat + random_dna(500));
+    SequencePtr s3 = boost::make_shared<CompactSequence>(
+                         random_dna(700) + repeat + random_dna(700));
+    std::string filename = temp_file();
+    int expected = 0;
+    {
+        BlockSetPtr block_set = new_bs();
+        block_set->add_sequence(s1);
+        block_set->add_sequence(s2);
+        AnchorFinder anchor_finder;
+        anchor_finder.set_block_set(block_set);
+        anchor_finder.set_opt_value("anchor-engine", std::string("hash"));
+        anchor_finder.run();
+        expected = count_fragments(*block_set);
+        BOOST_REQUIRE(expected >= 2);
+    }
+    for (int run = 0; run < 2; run++) {
+        // second run reuses the index
+        BlockSetPtr block_set = new_bs();
+        block_set->add_sequence(s1);
+        block_set->add_sequence(s2);
+        AnchorFinder anchor_finder;
+        anchor_finder.set_block_set(block_set);
+        anchor_finder.set_opt_value("anchor-engine",
+                                    std::string("index"));
+        anchor_finder.set_opt_value("anchor-index", filename);
+        anchor_finder.run();
+        BOOST_CHECK(count_fragments(*block_set) == expected);
+        KmerIndex index;
+        BOOST_REQUIRE(index.open(filename));
+        BOOST_CHECK(index.seqs().size() == 2);
+    }
+    {
+        // s2 is replaced with s3, s1 is reused
+        BlockSetPtr block_set = new_bs();
+        block_set->add_sequence(s3);
+        block_set->add_sequence(s1);
+        AnchorFinder anchor_finder;
+        anchor_finder.set_block_set(block_set);
+        anchor_finder.set_workers(2);
+        anchor_finder.set_opt_value("anchor-engine",
+                                    std::string("index"));
+        anchor_finder.set_opt_value("anchor-index", filename);
+        anchor_finder.run();
+        BOOST_CHECK(count_fragments(*block_set) == expected);
+        BOOST_FOREACH (Block* block, *block_set) {
+            BOOST_FOREACH (Fragment* f, *block) {
+                BOOST_CHECK(f->seq() == s1.get() ||
+                            f->seq() == s3.get());
+            }
+        }
+        KmerIndex index;
+        BOOST_REQUIRE(index.open(filename));
+        BOOST_REQUIRE(index.seqs().size() == 2);
+        BOOST_CHECK(index.seqs()[1].size_ == s3->size());
+    }
+    std::remove(filename.c_str());
+}
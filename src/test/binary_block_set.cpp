@@ -0,0 +1,170 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <cstdio>
+#include <set>
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+#include <boost/foreach.hpp>
+
+#include "Sequence.hpp"
+#include "Fragment.hpp"
+#include "Block.hpp"
+#include "BlockSet.hpp"
+#include "AlignmentRow.hpp"
+#include "binary_block_set.hpp"
+#include "BinaryWrite.hpp"
+#include "Read.hpp"
+#include "name_to_stream.hpp"
+#include "temp_file.hpp"
+
+static std::set<std::string> describe(const npge::BlockSet& bs) {
+    using namespace npge;
+    std::set<std::string> result;
+    BOOST_FOREACH (Block* block, bs) {
+        BOOST_FOREACH (Fragment* f, *block) {
+            result.insert(block->name() + " " + f->id() + " " +
+                          f->str() + " " + f->seq()->description());
+        }
+    }
+    return result;
+}
+
+static npge::BlockSetPtr make_bs() {
+    using namespace npge;
+    SequencePtr s1 = boost::make_shared<InMemorySequence>(
+                         "ATGCNNATGCTTGACANGTA");
+    s1->set_name("s1");
+    s1->set_description("ac=s1 test");
+    SequencePtr s2 = boost::make_shared<InMemorySequence>("TTGCAAGC");
+    s2->set_name("s2");
+    BlockSetPtr bs = new_bs();
+    bs->add_sequence(s1);
+    bs->add_sequence(s2);
+    Block* b1 = new Block("b1");
+    Fragment* f1 = new Fragment(s1.get(), 0, 4, 1);
+    AlignmentRow* r1 = AlignmentRow::new_row(COMPACT_ROW);
+    r1->grow("AT-GCN-");
+    f1->set_row(r1);
+    b1->insert(f1);
+    Fragment* f2 = new Fragment(s2.get(), 2, 7, -1);
+    AlignmentRow* r2 = AlignmentRow::new_row(COMPACT_ROW);
+    r2->grow("GCTTGC-");
+    f2->set_row(r2);
+    b1->insert(f2);
+    bs->insert(b1);
+    Block* b2 = new Block("b2");
+    b2->insert(new Fragment(s1.get(), 10, 19, -1)); // no row
+    bs->insert(b2);
+    return bs;
+}
+
+BOOST_AUTO_TEST_CASE (binary_block_set_main) {
+    using namespace npge;
+    BlockSetPtr bs = make_bs();
+    std::string filename = temp_file();
+    {
+        boost::shared_ptr<std::ostream> out = name_to_ostream(filename);
+        write_binary_block_set(*bs, *out);
+    }
+    remove_ostream(filename);
+    BOOST_CHECK(is_binary_block_set(filename));
+    BlockSetPtr copy = new_bs();
+    BlockSetBinaryReader reader(*copy, filename,
+                                SUCCINCT_ROW, COMPACT_SEQUENCE);
+    reader.set_workers(2);
+    reader.run();
+    BOOST_CHECK(copy->seqs().size() == 2);
+    BOOST_CHECK(describe(*copy) == describe(*bs));
+    BOOST_CHECK(copy->digest() == bs->digest());
+    BOOST_FOREACH (SequencePtr seq, copy->seqs()) {
+        if (seq->name() == "s1") {
+            BOOST_CHECK(seq->contents() == "ATGCNNATGCTTGACANGTA");
+        }
+    }
+    // existing sequences are reused
+    BlockSetPtr with_seqs = new_bs();
+    with_seqs->add_sequences(bs->seqs());
+    BlockSetBinaryReader reader2(*with_seqs, filename,
+                                 COMPACT_ROW, ASIS_SEQUENCE);
+    reader2.run();
+    BOOST_CHECK(with_seqs->seqs().size() == 2);
+    BOOST_CHECK(describe(*with_seqs) == describe(*bs));
+    // sequences of associated blocksets are reused too
+    BlockSetPtr empty = new_bs();
+    BlockSetBinaryReader reader3(*empty, filename,
+                                 COMPACT_ROW, ASIS_SEQUENCE);
+    reader3.set_block_set("other", bs.get());
+    reader3.run();
+    BOOST_CHECK(empty->seqs().size() == 2);
+    BOOST_CHECK(describe(*empty) == describe(*bs));
+    BOOST_FOREACH (SequencePtr seq, empty->seqs()) {
+        std::vector<SequencePtr> orig = bs->seqs();
+        BOOST_CHECK(std::find(orig.begin(), orig.end(), seq) !=
+                    orig.end());
+    }
+    std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE (binary_block_set_mapped) {
+    using namespace npge;
+    BlockSetPtr bs = make_bs();
+    std::string filename = temp_file();
+    {
+        boost::shared_ptr<std::ostream> out = name_to_ostream(filename);
+        write_binary_block_set(*bs, *out);
+    }
+    remove_ostream(filename);
+    BlockSetPtr copy = new_bs();
+    BlockSetBinaryReader reader(*copy, filename,
+                                COMPACT_ROW, MAPPED_SEQUENCE);
+    reader.run();
+    BOOST_CHECK(describe(*copy) == describe(*bs));
+    BOOST_CHECK(copy->digest() == bs->digest());
+    std::remove(filename.c_str());
+    // the file stays mapped while sequences are alive
+    BOOST_FOREACH (SequencePtr seq, copy->seqs()) {
+        BOOST_CHECK(boost::dynamic_pointer_cast<MappedSequence>(seq));
+        if (seq->name() == "s1") {
+            BOOST_CHECK(seq->contents() == "ATGCNNATGCTTGACANGTA");
+            BOOST_CHECK(seq->substr(16, 4, -1) == "NTGT");
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE (binary_block_set_processors) {
+    using namespace npge;
+    BlockSetPtr bs = make_bs();
+    std::string filename = temp_file();
+    BinaryWrite writer;
+    writer.set_opt_value("out-binary", filename);
+    writer.set_block_set(bs);
+    writer.run();
+    writer.set_opt_value("out-binary", std::string(":null"));
+    remove_ostream(filename);
+    BlockSetPtr copy = new_bs();
+    Read read;
+    read.set_opt_value("in-blocks", Strings(1, filename));
+    read.set_block_set(copy);
+    read.run();
+    BOOST_CHECK(describe(*copy) == describe(*bs));
+    std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE (binary_block_set_text_is_not_binary) {
+    using namespace npge;
+    std::string filename = temp_file();
+    {
+        boost::shared_ptr<std::ostream> out = name_to_ostream(filename);
+        (*out) << ">s1 ac=s1\nATGC\n";
+    }
+    remove_ostream(filename);
+    BOOST_CHECK(!is_binary_block_set(filename));
+    BOOST_CHECK(!is_binary_block_set(":stdin"));
+    std::remove(filename.c_str());
+}
+
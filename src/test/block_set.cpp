@@ -12,6 +12,7 @@
 #include "Fragment.hpp"
 #include "Block.hpp"
 #include "BlockSet.hpp"
+#include "block_hash.hpp"
 #include "Joiner.hpp"
 #include "Filter.hpp"
 
@@ -62,3 +63,111 @@ BOOST_AUTO_TEST_CASE (BlockSet_filter) {
     BOOST_CHECK(block_set->size() == 1);
 }
 
+
+BOOST_AUTO_TEST_CASE (BlockSet_digest) {
+    using namespace npge;
+    SequencePtr s1 = boost::make_shared<InMemorySequence>("tggtcCGAGATgcgggcc");
+    BlockSetPtr bs = new_bs();
+    BOOST_CHECK(bs->digest() == 0);
+    Block* b1 = new Block();
+    b1->insert(new Fragment(s1, 1, 2, 1));
+    b1->insert(new Fragment(s1, 5, 6, -1));
+    Block* b2 = new Block();
+    b2->insert(new Fragment(s1, 7, 8, 1));
+    bs->insert(b1);
+    bs->insert(b2);
+    BOOST_CHECK(bs->digest() == blockset_hash(*bs));
+    BOOST_CHECK(bs->digest() == block_hash(b1));
+    hash_t h1 = bs->digest();
+    b1->front()->set_max_pos(3);
+    BOOST_CHECK(bs->digest() != h1);
+    BOOST_CHECK(bs->digest() == blockset_hash(*bs));
+    b1->front()->set_max_pos(2);
+    BOOST_CHECK(bs->digest() == h1);
+    b1->inverse();
+    BOOST_CHECK(bs->digest() == h1);
+    b2->insert(new Fragment(s1, 10, 12, 1));
+    BOOST_CHECK(bs->digest() == blockset_hash(*bs));
+    BOOST_CHECK(bs->digest() != h1);
+    bs->erase(b2);
+    BOOST_CHECK(bs->digest() == h1);
+    // weak block
+    Block* w = new Block();
+    w->set_weak(true);
+    BOOST_FOREACH (Fragment* f, *b1) {
+        w->insert(f);
+    }
+    bs->insert(w);
+    BOOST_CHECK(bs->digest() == 0);
+    b1->front()->set_min_pos(0);
+    BOOST_CHECK(bs->digest() == 0);
+    bs->detach(b1);
+    BOOST_CHECK(bs->digest() == blockset_hash(*bs));
+    BOOST_CHECK(bs->digest() == block_hash(w));
+    // blocks shared with other blockset
+    BlockSetPtr other = new_bs();
+    other->insert(b1);
+    BOOST_CHECK(other->digest() == block_hash(b1));
+    bs->swap(*other);
+    BOOST_CHECK(bs->digest() == block_hash(b1));
+    BOOST_CHECK(other->digest() == block_hash(w));
+    b1->front()->set_min_pos(1);
+    BOOST_CHECK(bs->digest() == blockset_hash(*bs));
+    other->detach(w);
+    delete w;
+    BOOST_CHECK(other->digest() == 0);
+    BlockSetPtr copy = bs->clone();
+    BOOST_CHECK(*copy == *bs);
+    copy->front()->front()->set_min_pos(0);
+    BOOST_CHECK(!(*copy == *bs));
+}
+
+BOOST_AUTO_TEST_CASE (BlockSet_changed_since) {
+    using namespace npge;
+    SequencePtr s1 = boost::make_shared<InMemorySequence>("tggtcCGAGATgcgggcc");
+    BlockSetPtr bs = new_bs();
+    Block* b1 = new Block();
+    b1->insert(new Fragment(s1, 1, 2, 1));
+    Block* b2 = new Block();
+    b2->insert(new Fragment(s1, 7, 8, 1));
+    Block* b3 = new Block();
+    b3->insert(new Fragment(s1, 10, 12, 1));
+    bs->insert(b1);
+    bs->insert(b2);
+    bs->insert(b3);
+    unsigned int g = BlockSet::new_generation();
+    Blocks changed;
+    // changes are unknown until tracking starts
+    bs->changed_since(g, changed);
+    BOOST_CHECK(changed.size() == 3);
+    changed.clear();
+    bs->track_changes();
+    g = BlockSet::new_generation();
+    bs->changed_since(g, changed);
+    BOOST_CHECK(changed.empty());
+    b1->front()->set_max_pos(3);
+    bs->changed_since(g, changed);
+    BOOST_REQUIRE(changed.size() == 1);
+    BOOST_CHECK(changed[0] == b1);
+    std::vector<Fragment> removed;
+    bs->removed_since(g, removed);
+    BOOST_CHECK(removed.empty());
+    bs->erase(b2);
+    bs->removed_since(g, removed);
+    BOOST_REQUIRE(removed.size() == 1);
+    BOOST_CHECK(removed[0].min_pos() == 7);
+    BOOST_CHECK(removed[0].max_pos() == 8);
+    unsigned int g2 = BlockSet::new_generation();
+    changed.clear();
+    bs->changed_since(g2, changed);
+    BOOST_CHECK(changed.empty());
+    removed.clear();
+    bs->removed_since(g2, removed);
+    BOOST_CHECK(removed.empty());
+    // swap makes changes unknown
+    BlockSetPtr other = new_bs();
+    other->track_changes();
+    bs->swap(*other);
+    other->changed_since(g2, changed);
+    BOOST_CHECK(changed.size() == 2);
+}
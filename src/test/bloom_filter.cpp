@@ -6,8 +6,12 @@
  */
 
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
 
 #include "BloomFilter.hpp"
+#include "BlockedBloomFilter.hpp"
+#include "make_hash.hpp"
 
 BOOST_AUTO_TEST_CASE (BloomFilter_test) {
     npge::BloomFilter filter(1e6, 0.01);
@@ -77,3 +81,75 @@ BOOST_AUTO_TEST_CASE (BloomFilter_test_and_add) {
     BOOST_CHECK(filter.test("TTAA") == true);
 }
 
+
+BOOST_AUTO_TEST_CASE (BlockedBloomFilter_main) {
+    using namespace npge;
+    BlockedBloomFilter filter(1e6, 0.01);
+    BOOST_CHECK(filter.bits() % 64 == 0);
+    BOOST_CHECK(filter.bits() > BloomFilter::optimal_bits(1e6, 0.01));
+    BOOST_CHECK(filter.hashes() >= 1);
+    BOOST_CHECK(filter.hashes() <= BlockedBloomFilter::max_hashes());
+    BOOST_CHECK(BlockedBloomFilter::false_positive(1e6, filter.bits(),
+                filter.hashes()) <= 0.01);
+    hash_t atgc = make_hash("ATGC", 4);
+    hash_t aaaa = make_hash("AAAA", 4);
+    BOOST_CHECK(filter.test_and_add(atgc) == false);
+    filter.add(aaaa);
+    BOOST_CHECK(filter.test(atgc));
+    BOOST_CHECK(filter.test(aaaa));
+    BOOST_CHECK(filter.test_and_add(atgc) == true);
+    BOOST_WARN(!filter.test(make_hash("GGGG", 4)));
+    BOOST_CHECK(filter.true_bits() <= 2 * filter.hashes());
+    filter.clear();
+    BOOST_CHECK(filter.bits() == 0);
+    BOOST_CHECK(filter.hashes() == 0);
+}
+
+BOOST_AUTO_TEST_CASE (BlockedBloomFilter_fp) {
+    using namespace npge;
+    const int N = 100000;
+    BlockedBloomFilter filter(N, 0.01);
+    for (int i = 0; i < N; i++) {
+        filter.add(hash_t(i) * 2);
+    }
+    int fp = 0;
+    for (int i = 0; i < N; i++) {
+        BOOST_REQUIRE(filter.test(hash_t(i) * 2));
+        if (filter.test(hash_t(i) * 2 + 1)) {
+            fp += 1;
+        }
+    }
+    BOOST_CHECK(fp < N * 0.02);
+}
+
+static void add_all(npge::BlockedBloomFilter* filter,
+                    std::vector<char>* found, int n) {
+    for (int i = 0; i < n; i++) {
+        if (filter->test_and_add(i)) {
+            (*found)[i] = true;
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE (BlockedBloomFilter_threads) {
+    using namespace npge;
+    const int N = 100000;
+    const int THREADS = 4;
+    BlockedBloomFilter filter(N, 0.01);
+    std::vector<std::vector<char> > found(THREADS,
+                                          std::vector<char>(N));
+    boost::thread_group threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.create_thread(boost::bind(add_all, &filter,
+                                          &found[t], N));
+    }
+    threads.join_all();
+    for (int i = 0; i < N; i++) {
+        bool any = false;
+        for (int t = 0; t < THREADS; t++) {
+            any = any || found[t][i];
+        }
+        // each member was added THREADS times
+        BOOST_REQUIRE(any);
+    }
+}
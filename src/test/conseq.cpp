@@ -185,3 +185,55 @@ BOOST_AUTO_TEST_CASE (DeConSeq_alignment) {
     BOOST_CHECK(aln[3] == "GCTG-GATG-");
 }
 
+
+static npge::SequencePtr seq_by_name(const npge::BlockSetPtr& bs,
+                                     const std::string& name) {
+    using namespace npge;
+    BOOST_FOREACH (const SequencePtr& seq, bs->seqs()) {
+        if (seq->name() == name) {
+            return seq;
+        }
+    }
+    return SequencePtr();
+}
+
+BOOST_AUTO_TEST_CASE (ConSeq_cache) {
+    using namespace npge;
+    SequencePtr s1 = boost::make_shared<CompactSequence>("CAGGCCGG");
+    SequencePtr s2 = boost::make_shared<CompactSequence>("CAGGCTGG");
+    Block* b1 = new Block("b1");
+    b1->insert(new Fragment(s1, 0, 3));
+    b1->insert(new Fragment(s2, 0, 3));
+    Block* b2 = new Block("b2");
+    b2->insert(new Fragment(s1, 4, 7));
+    Fragment* f = new Fragment(s2, 4, 7);
+    b2->insert(f);
+    BlockSetPtr block_set = new_bs();
+    block_set->insert(b1);
+    block_set->insert(b2);
+    ConSeq conseq(block_set);
+    conseq.set_empty_block_set();
+    conseq.run();
+    BOOST_REQUIRE(conseq.block_set()->seqs().size() == 2);
+    SequencePtr seq1 = seq_by_name(conseq.block_set(), "b1");
+    SequencePtr seq2 = seq_by_name(conseq.block_set(), "b2");
+    BOOST_REQUIRE(seq1 && seq2);
+    BOOST_CHECK(seq2->contents() == "CCGG");
+    // second run: b1 is not changed, b2 is changed
+    f->set_ori(-1);
+    f->set_ori(1);
+    conseq.set_empty_block_set();
+    conseq.run();
+    BOOST_REQUIRE(conseq.block_set()->seqs().size() == 2);
+    SequencePtr seq1a = seq_by_name(conseq.block_set(), "b1");
+    SequencePtr seq2a = seq_by_name(conseq.block_set(), "b2");
+    BOOST_CHECK(seq1a == seq1); // not recomputed
+    BOOST_REQUIRE(seq2a);
+    BOOST_CHECK(seq2a != seq2); // recomputed
+    BOOST_CHECK(seq2a->contents() == "CCGG");
+    // renamed block is recomputed
+    b1->set_name("b3");
+    conseq.set_empty_block_set();
+    conseq.run();
+    BOOST_CHECK(seq_by_name(conseq.block_set(), "b3"));
+}
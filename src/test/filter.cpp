@@ -13,7 +13,9 @@
 #include "AlignmentRow.hpp"
 #include "Fragment.hpp"
 #include "Block.hpp"
+#include "BlockSet.hpp"
 #include "Filter.hpp"
+#include "Pipe.hpp"
 #include "SizeLimits.hpp"
 
 BOOST_AUTO_TEST_CASE (Filter_good_block) {
@@ -196,3 +198,145 @@ BOOST_AUTO_TEST_CASE (Filter_good_blocks_expand) {
     }
 }
 
+
+class ChangedOnlyJobs : public npge::BlocksJobs {
+public:
+    mutable std::vector<npge::Block*> processed_;
+
+    ChangedOnlyJobs() {
+        add_changed_only_options(true);
+    }
+
+protected:
+    void process_block_impl(npge::Block* block,
+                            npge::ThreadData*) const {
+        processed_.push_back(block);
+    }
+};
+
+BOOST_AUTO_TEST_CASE (Filter_changed_only) {
+    using namespace npge;
+    SequencePtr s1 = boost::make_shared<InMemorySequence>(
+                         "TGGTCCGAGATGCGGGCCCGTAAGCTTACATACAGG");
+    BlockSetPtr bs = new_bs();
+    Block* b1 = new Block;
+    b1->insert(new Fragment(s1, 0, 3));
+    Block* b2 = new Block;
+    b2->insert(new Fragment(s1, 10, 14));
+    Block* b3 = new Block;
+    b3->insert(new Fragment(s1, 20, 24));
+    bs->insert(b1);
+    bs->insert(b2);
+    bs->insert(b3);
+    ChangedOnlyJobs jobs;
+    jobs.set_workers(1);
+    jobs.set_block_set(bs);
+    jobs.run();
+    BOOST_CHECK(jobs.processed_.size() == 3);
+    jobs.processed_.clear();
+    jobs.run();
+    BOOST_CHECK(jobs.processed_.empty());
+    b2->front()->set_max_pos(15);
+    jobs.run();
+    BOOST_REQUIRE(jobs.processed_.size() == 1);
+    BOOST_CHECK(jobs.processed_[0] == b2);
+    // neighbours of changed blocks
+    jobs.processed_.clear();
+    jobs.set_opt_value("changed-distance", 6);
+    jobs.run(); // options changed: all blocks
+    BOOST_CHECK(jobs.processed_.size() == 3);
+    jobs.processed_.clear();
+    b2->front()->set_max_pos(14);
+    jobs.run();
+    BOOST_CHECK(jobs.processed_.size() == 2); // b2, b3
+    BOOST_CHECK(std::find(jobs.processed_.begin(), jobs.processed_.end(),
+                          b1) == jobs.processed_.end());
+    // neighbours of removed blocks
+    jobs.processed_.clear();
+    bs->erase(b2);
+    jobs.run();
+    BOOST_CHECK(jobs.processed_.size() == 1); // b3
+    // Filter removes blocks changed since previous run
+    Filter filter;
+    allow_everything(&filter);
+    filter.set_opt_value("changed-only", true);
+    filter.set_opt_value("min-fragment", 4);
+    filter.set_block_set(bs);
+    filter.run();
+    BOOST_CHECK(bs->size() == 2);
+    b1->front()->set_max_pos(2);
+    filter.run();
+    BOOST_CHECK(bs->size() == 1);
+}
+
+// shrinks fragments longer than 3 having given parity of length
+class ShrinkingJobs : public npge::BlocksJobs {
+public:
+    mutable std::vector<int> processed_; // number of blocks per run
+
+    ShrinkingJobs(int parity):
+        parity_(parity) {
+        add_changed_only_options();
+    }
+
+protected:
+    void initialize_work_impl() const {
+        processed_.push_back(0);
+    }
+
+    void process_block_impl(npge::Block* block,
+                            npge::ThreadData*) const {
+        processed_.back() += 1;
+        BOOST_FOREACH (npge::Fragment* f, *block) {
+            if (f->length() > 3 && f->length() % 2 == parity_) {
+                f->set_max_pos(f->max_pos() - 1);
+            }
+        }
+    }
+
+private:
+    int parity_;
+};
+
+BOOST_AUTO_TEST_CASE (Filter_changed_only_loop) {
+    using namespace npge;
+    SequencePtr s1 = boost::make_shared<InMemorySequence>(
+                         "TGGTCCGAGATGCGGGCCCGTAAGCTTACATACAGG");
+    Pipe pipe;
+    pipe.set_max_iterations(-1);
+    // as in AlignLoop
+    ShrinkingJobs* even = new ShrinkingJobs(0);
+    ShrinkingJobs* odd = new ShrinkingJobs(1);
+    pipe.add(even, "--changed-only:=1");
+    pipe.add(odd, "--changed-only:=1");
+    pipe.set_workers(1);
+    // digest of blockset ignores blocks of one fragment
+    Block* b1 = new Block;
+    b1->insert(new Fragment(s1, 0, 3));
+    b1->insert(new Fragment(s1, 25, 27));
+    Block* b2 = new Block;
+    b2->insert(new Fragment(s1, 10, 14));
+    b2->insert(new Fragment(s1, 29, 31));
+    Block* b3 = new Block;
+    b3->insert(new Fragment(s1, 20, 22));
+    b3->insert(new Fragment(s1, 33, 35));
+    pipe.block_set()->insert(b1);
+    pipe.block_set()->insert(b2);
+    pipe.block_set()->insert(b3);
+    pipe.run();
+    // next passes touch only blocks changed by other processor:
+    // b1 (4 -> 3) by even, b2 (5 -> 4) by odd, then b2 (4 -> 3)
+    BOOST_REQUIRE(even->processed_.size() == 3);
+    BOOST_CHECK(even->processed_[0] == 3);
+    BOOST_CHECK(even->processed_[1] == 1); // b2
+    BOOST_CHECK(even->processed_[2] == 0);
+    BOOST_REQUIRE(odd->processed_.size() == 3);
+    BOOST_CHECK(odd->processed_[0] == 3);
+    BOOST_CHECK(odd->processed_[1] == 1); // b2
+    BOOST_CHECK(odd->processed_[2] == 0);
+    BOOST_FOREACH (Block* b, *pipe.block_set()) {
+        BOOST_FOREACH (Fragment* f, *b) {
+            BOOST_CHECK(f->length() == 3);
+        }
+    }
+}
@@ -0,0 +1,95 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <cstdlib>
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+#include <boost/foreach.hpp>
+
+#include "Sequence.hpp"
+#include "Fragment.hpp"
+#include "Block.hpp"
+#include "BlockSet.hpp"
+#include "FragmentCollection.hpp"
+
+BOOST_AUTO_TEST_CASE (FragmentCollection_index) {
+    using namespace npge;
+    SequencePtr s1 = boost::make_shared<InMemorySequence>("tggtcCGAGATgcgggcc");
+    Fragment* f1 = new Fragment(s1, 1, 2, 1);
+    Fragment* f2 = new Fragment(s1, 5, 6, -1);
+    Fragment* f3 = new Fragment(s1, 7, 8, 1);
+    Fragment* big = new Fragment(s1, 0, 17, 1);
+    BlockSetPtr block_set = new_bs();
+    Fragment* ff[] = {f1, f2, f3, big};
+    BOOST_FOREACH (Fragment* f, ff) {
+        Block* b = new Block;
+        b->insert(f);
+        block_set->insert(b);
+    }
+    IndexFc fc;
+    fc.add_bs(*block_set);
+    fc.prepare();
+    BOOST_CHECK(fc.next(big) == f1);
+    BOOST_CHECK(fc.prev(f2) == f1);
+    BOOST_CHECK(fc.next(f2) == f3);
+    BOOST_CHECK(fc.next(f3) == 0);
+    Fragment query(s1, 3, 5);
+    BOOST_CHECK(fc.has_overlap(&query));
+    Fragments overlaps;
+    fc.find_overlap_fragments(overlaps, &query);
+    BOOST_REQUIRE(overlaps.size() == 2);
+    BOOST_CHECK(overlaps[0] == big);
+    BOOST_CHECK(overlaps[1] == f2);
+    fc.remove_fragment(big);
+    Fragment query2(s1, 3, 4);
+    BOOST_CHECK(!fc.has_overlap(&query2));
+    overlaps.clear();
+    fc.find_overlap_fragments(overlaps, &query2);
+    BOOST_CHECK(overlaps.empty());
+}
+
+BOOST_AUTO_TEST_CASE (FragmentCollection_index_random) {
+    using namespace npge;
+    const int LENGTH = 10000;
+    SequencePtr s1 = boost::make_shared<InMemorySequence>(
+                         std::string(LENGTH, 'a'));
+    int sizes[] = {1, 2, 7, 16, 17, 31, 100, 1000};
+    BOOST_FOREACH (int size, sizes) {
+        BlockSetPtr block_set = new_bs();
+        Fragments all;
+        for (int n = 0; n < size; n++) {
+            // mix of short, long and nested fragments
+            int length = (n % 10 == 0) ? rand() % LENGTH : rand() % 50;
+            int min_pos = rand() % (LENGTH - length);
+            Fragment* f = new Fragment(s1, min_pos, min_pos + length);
+            Block* b = new Block;
+            b->insert(f);
+            block_set->insert(b);
+            all.push_back(f);
+        }
+        IndexFc fc;
+        fc.add_bs(*block_set);
+        fc.prepare();
+        for (int q = 0; q < 300; q++) {
+            int length = rand() % 100;
+            int min_pos = rand() % (LENGTH - length);
+            Fragment query(s1, min_pos, min_pos + length);
+            Fragments expected;
+            BOOST_FOREACH (Fragment* f, all) {
+                if (f->common_positions(query)) {
+                    expected.push_back(f);
+                }
+            }
+            Fragments overlaps;
+            fc.find_overlap_fragments(overlaps, &query);
+            std::sort(expected.begin(), expected.end());
+            std::sort(overlaps.begin(), overlaps.end());
+            BOOST_CHECK(overlaps == expected);
+            BOOST_CHECK(fc.has_overlap(&query) == !expected.empty());
+        }
+    }
+}
@@ -0,0 +1,197 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include "GeneralAligner.hpp"
+#include "aligner_kernel.hpp"
+#include "test_sequences.hpp"
+
+using namespace npge;
+
+struct TestContents {
+    std::string first_, second_;
+
+    int first_size() const {
+        return first_.size();
+    }
+
+    int second_size() const {
+        return second_.size();
+    }
+
+    int substitution(int row, int col) const {
+        return (first_[row] == second_[col]) ? 0 : 1;
+    }
+};
+
+static std::string mutate(const std::string& seq) {
+    std::string result;
+    for (int i = 0; i < seq.size(); i++) {
+        int r = std::rand() % 20;
+        if (r == 0) {
+            // deletion
+        } else if (r == 1) {
+            result += "ATGC"[std::rand() % 4];
+            result += seq[i];
+        } else if (r == 2) {
+            result += "ATGC"[std::rand() % 4];
+        } else {
+            result += seq[i];
+        }
+    }
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE (GeneralAligner_kernels) {
+    std::srand(1);
+    const int MAX_LENGTH = 50;
+    for (int iter = 0; iter < 200; iter++) {
+        int length = 1 + std::rand() % MAX_LENGTH;
+        int gap_penalty = 1 + std::rand() % 3;
+        bool local = std::rand() % 2;
+        std::vector<int> up(length + 1), subst(length);
+        for (int i = 0; i <= length; i++) {
+            up[i] = std::rand() % 100 - (local ? 50 : 0);
+        }
+        if (std::rand() % 2) {
+            up[length] = BAD_VALUE;
+        }
+        for (int i = 0; i < length; i++) {
+            subst[i] = std::rand() % 2;
+        }
+        int left = (std::rand() % 3 == 0) ? BAD_VALUE :
+                   std::rand() % 100;
+        // reference loop
+        std::vector<int> ref_score(length + 1), ref_track(length);
+        ref_score[0] = left;
+        for (int c = 0; c < length; c++) {
+            int match = up[c] + subst[c];
+            int gap1 = ref_score[c] + gap_penalty;
+            int gap2 = up[c + 1] + gap_penalty;
+            int score = std::min(match, std::min(gap1, gap2));
+            if (local) {
+                score = std::min(score, 0);
+            }
+            ref_score[c + 1] = score;
+            ref_track[c] = (score == match) ? 0 :
+                           (score == gap1) ? -1 : 1;
+        }
+        for (int k = SCALAR_KERNEL; k <= AVX2_KERNEL; k++) {
+            AlignerKernel kernel = AlignerKernel(k);
+            if (!aligner_kernel_supported(kernel)) {
+                continue;
+            }
+            std::vector<int> score(length + 1), track(length);
+            std::vector<int> match(length);
+            score[0] = left;
+            aligner_fill_row(&score[1], &track[0], &up[1], &subst[0],
+                             &match[0], length, gap_penalty, local,
+                             kernel);
+            BOOST_REQUIRE(score == ref_score);
+            BOOST_REQUIRE(track == ref_track);
+        }
+    }
+}
+
+static void compare_aligners(const TestContents& contents,
+                             int gap_range, int max_errors,
+                             bool local) {
+    GeneralAligner<TestContents> scalar, vectorized;
+    scalar.set_contents(contents);
+    scalar.set_gap_range(gap_range);
+    scalar.set_max_errors(max_errors);
+    scalar.set_local(local);
+    vectorized = scalar;
+    vectorized.set_vectorized(true);
+    int s_row, s_col, v_row, v_col;
+    scalar.align(s_row, s_col);
+    vectorized.align(v_row, v_col);
+    BOOST_REQUIRE(s_row == v_row);
+    BOOST_REQUIRE(s_col == v_col);
+    if (s_row == -1) {
+        return;
+    }
+    if (scalar.in(s_row, s_col)) {
+        // gaps at the end outside the band are not stored
+        BOOST_REQUIRE(scalar.at(s_row, s_col) ==
+                      vectorized.at(v_row, v_col));
+    }
+    PairAlignment s_aln, v_aln;
+    scalar.export_alignment(s_row, s_col, s_aln);
+    vectorized.export_alignment(v_row, v_col, v_aln);
+    BOOST_REQUIRE(s_aln == v_aln);
+}
+
+BOOST_AUTO_TEST_CASE (GeneralAligner_vectorized) {
+    std::srand(2);
+    for (int iter = 0; iter < 100; iter++) {
+        TestContents contents;
+        contents.first_ = random_dna(1 + std::rand() % 200);
+        contents.second_ = mutate(contents.first_);
+        if (contents.second_.empty()) {
+            continue;
+        }
+        int gap_range = 1 + std::rand() % 20;
+        compare_aligners(contents, gap_range, -1, false);
+        compare_aligners(contents, gap_range, 5, false);
+        int max_size = std::max(contents.first_size(),
+                                contents.second_size());
+        compare_aligners(contents, max_size, -1, true);
+    }
+}
+
+BOOST_AUTO_TEST_CASE (GeneralAligner_band) {
+    TestContents contents;
+    contents.first_ = "AAAACCCCGGGGTTTTAAAACCCCGGGGTTTT";
+    contents.second_ = "AAAACCCCGGGTTTTAAAACCCCGGGGTTTTT";
+    GeneralAligner<TestContents> aligner;
+    aligner.set_contents(contents);
+    aligner.set_gap_range(2);
+    aligner.set_max_errors(-1);
+    int row, col;
+    aligner.align(row, col);
+    BOOST_CHECK(row == 31 && col == 31);
+    // only band is stored
+    BOOST_CHECK(aligner.in(10, 12));
+    BOOST_CHECK(!aligner.in(10, 20));
+    BOOST_CHECK(aligner.at(row, col) == 2 * aligner.gap_penalty());
+}
+
+BOOST_AUTO_TEST_CASE (GeneralAligner_band_tail) {
+    TestContents contents;
+    contents.first_ = "AAAACCCCGGGGTTTT";
+    contents.second_ = "AAAACCCCGGGGTTTTAAAACCCCGGGG";
+    for (int swap = 0; swap < 2; swap++) {
+        GeneralAligner<TestContents> aligner;
+        aligner.set_contents(contents);
+        aligner.set_gap_range(2);
+        aligner.set_max_errors(-1);
+        int row, col;
+        aligner.align(row, col);
+        BOOST_CHECK(row == contents.first_size() - 1);
+        BOOST_CHECK(col == contents.second_size() - 1);
+        // the band is stored even if lengths differ
+        BOOST_CHECK(!aligner.in(10, 20));
+        PairAlignment aln;
+        aligner.export_alignment(row, col, aln);
+        BOOST_REQUIRE(aln.size() == 28);
+        for (int i = 0; i < 16; i++) {
+            BOOST_CHECK(aln[i] == std::make_pair(i, i));
+        }
+        for (int i = 16; i < 28; i++) {
+            BOOST_CHECK((swap ? aln[i].second : aln[i].first) == -1);
+        }
+        std::swap(contents.first_, contents.second_);
+    }
+    BOOST_CHECK(global_gap_range(15, 100, 130) == 30);
+    BOOST_CHECK(global_gap_range(15, 100, 90) == 15);
+    BOOST_CHECK(global_gap_range(15, 1000000, 1) == 15);
+}
@@ -0,0 +1,105 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <boost/test/unit_test.hpp>
+#include <boost/foreach.hpp>
+
+#include "Sequence.hpp"
+#include "Fragment.hpp"
+#include "Block.hpp"
+#include "BlockSet.hpp"
+#include "ImportBlastHits.hpp"
+#include "name_to_stream.hpp"
+#include "temp_file.hpp"
+
+static const char* HITS =
+    "a\tb\t100.00\t5\t0\t0\t1\t5\t1\t5\t1e-5\t10\n"
+    // same hit, other direction
+    "b\ta\t100.00\t5\t0\t0\t1\t5\t1\t5\t1e-5\t10\n"
+    // inverted
+    "a\tb\t80.00\t5\t1\t0\t6\t10\t10\t6\t1e-3\t8\r\n"
+    // short
+    "a\tb\t100.00\t2\t0\t0\t11\t12\t11\t12\t1\t4\n";
+
+static npge::BlockSetPtr import_hits(const std::string& file,
+                                     int workers) {
+    using namespace npge;
+    SequencePtr a = boost::make_shared<InMemorySequence>("ATGCTGGACCAT");
+    a->set_name("a");
+    SequencePtr b = boost::make_shared<InMemorySequence>("ATGCTGGACCAT");
+    b->set_name("b");
+    BlockSetPtr bs = new_bs();
+    bs->add_sequence(a);
+    bs->add_sequence(b);
+    ImportBlastHits importer;
+    importer.set_opt_value("blast-hits", Strings(1, file));
+    importer.set_opt_value("blast-min-length", 3);
+    importer.set_bs("target", bs);
+    importer.set_bs("other", bs);
+    importer.set_workers(workers);
+    importer.run();
+    return bs;
+}
+
+static void check_hits(npge::BlockSetPtr bs) {
+    using namespace npge;
+    BOOST_REQUIRE(bs->size() == 2);
+    int inverted = 0;
+    BOOST_FOREACH (Block* block, *bs) {
+        BOOST_REQUIRE(block->size() == 2);
+        std::vector<Fragment*> fragments(block->begin(), block->end());
+        BOOST_CHECK(fragments[0]->length() == 5);
+        BOOST_CHECK(fragments[1]->length() == 5);
+        if (fragments[0]->ori() != fragments[1]->ori()) {
+            inverted += 1;
+        }
+    }
+    BOOST_CHECK(inverted == 1);
+}
+
+BOOST_AUTO_TEST_CASE (ImportBlastHits_stream) {
+    using namespace npge;
+    set_sstream(":hits", HITS);
+    check_hits(import_hits(":hits", 1));
+    remove_stream(":hits");
+}
+
+BOOST_AUTO_TEST_CASE (ImportBlastHits_file) {
+    using namespace npge;
+    std::string filename = temp_file();
+    {
+        std::ofstream out(filename.c_str());
+        out << HITS;
+    }
+    check_hits(import_hits(filename, 1));
+    check_hits(import_hits(filename, 4));
+    std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE (ImportBlastHits_min_ident) {
+    using namespace npge;
+    set_sstream(":hits", HITS);
+    SequencePtr a = boost::make_shared<InMemorySequence>("ATGCTGGACCAT");
+    a->set_name("a");
+    SequencePtr b = boost::make_shared<InMemorySequence>("ATGCTGGACCAT");
+    b->set_name("b");
+    BlockSetPtr bs = new_bs();
+    bs->add_sequence(a);
+    bs->add_sequence(b);
+    ImportBlastHits importer;
+    importer.set_opt_value("blast-hits", Strings(1, ":hits"));
+    importer.set_opt_value("blast-min-ident", D(0.9));
+    importer.set_bs("target", bs);
+    importer.set_bs("other", bs);
+    importer.set_opt_value("blast-min-length", 3);
+    importer.run();
+    BOOST_CHECK(bs->size() == 1);
+    remove_stream(":hits");
+}
+
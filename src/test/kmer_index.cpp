@@ -0,0 +1,97 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+
+#include "KmerIndex.hpp"
+#include "Sequence.hpp"
+#include "temp_file.hpp"
+
+using namespace npge;
+
+static bool equal_records(const KmerRecord& a, const KmerRecord& b) {
+    return a.hash_ == b.hash_ && a.seq_ == b.seq_ && a.pos_ == b.pos_;
+}
+
+BOOST_AUTO_TEST_CASE (KmerIndex_main) {
+    InMemorySequence s1("TGGTCCGAGATGCGGGCCCGTAAGCTTACATACAGG");
+    CompactSequence s2("AATTGGCCATGCNNNAGTAGTGCATGGTCCGAGAT");
+    int anchor = 5;
+    KmerRecords records;
+    KmerIndex::scan(records, s1, 0, anchor);
+    KmerIndex::scan(records, s2, 1, anchor);
+    std::sort(records.begin(), records.end());
+    KmerIndexSeqs seqs(2);
+    seqs[0].name_ = "s1";
+    seqs[0].size_ = s1.size();
+    seqs[0].fingerprint_ = KmerIndex::fingerprint(s1);
+    seqs[1].name_ = "second";
+    seqs[1].size_ = s2.size();
+    seqs[1].fingerprint_ = KmerIndex::fingerprint(s2);
+    std::string filename = temp_file();
+    KmerIndex::write(filename, anchor, seqs,
+                     &records[0], &records[0] + records.size());
+    KmerIndex index;
+    BOOST_REQUIRE(index.open(filename));
+    BOOST_CHECK(index.anchor() == anchor);
+    BOOST_REQUIRE(index.seqs().size() == 2);
+    BOOST_CHECK(index.seqs()[1].name_ == "second");
+    BOOST_CHECK(index.seqs()[1].size_ == s2.size());
+    BOOST_CHECK(index.seqs()[0].fingerprint_ == seqs[0].fingerprint_);
+    BOOST_REQUIRE(index.size() == records.size());
+    BOOST_CHECK(std::equal(index.begin(), index.end(),
+                           records.begin(), equal_records));
+    // GGTCCGAGAT is in both sequences
+    hash_t dir = s1.hash(1, anchor, 1);
+    hash_t rev = s1.hash(1 + anchor - 1, anchor, -1);
+    std::pair<const KmerRecord*, const KmerRecord*> range =
+        index.find(std::min(dir, rev));
+    BOOST_REQUIRE(range.second - range.first == 2);
+    BOOST_CHECK(range.first[0].seq() == 0);
+    BOOST_CHECK(range.first[0].pos_ == 1);
+    BOOST_CHECK(range.first[0].direct() == (dir <= rev));
+    BOOST_CHECK(range.first[1].seq() == 1);
+    BOOST_CHECK(range.first[1].pos_ == 25);
+    BOOST_CHECK(index.find(0).first == index.find(0).second);
+    index.close();
+    BOOST_CHECK(!index.is_open());
+    std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE (KmerIndex_fingerprint) {
+    InMemorySequence s1("TGGTCCGAGATGCGGG");
+    CompactSequence s2("TGGTCCGAGATGCGGG");
+    InMemorySequence s3("TGGTCCGAGATGCGGC");
+    BOOST_CHECK(KmerIndex::fingerprint(s1) ==
+                KmerIndex::fingerprint(s2));
+    BOOST_CHECK(KmerIndex::fingerprint(s1) !=
+                KmerIndex::fingerprint(s3));
+}
+
+BOOST_AUTO_TEST_CASE (KmerIndex_bad_file) {
+    KmerIndex index;
+    std::string filename = temp_file();
+    BOOST_CHECK(!index.open(filename));
+    {
+        std::ofstream out(filename.c_str());
+        out << "not an index";
+    }
+    BOOST_CHECK(!index.open(filename));
+    {
+        // unfinished file
+        KmerIndexWriter writer(filename, 5, KmerIndexSeqs());
+    }
+    BOOST_CHECK(!index.open(filename));
+    KmerIndex::write(filename, 5, KmerIndexSeqs(), 0, 0);
+    BOOST_CHECK(index.open(filename));
+    BOOST_CHECK(index.size() == 0);
+    index.close();
+    std::remove(filename.c_str());
+}
@@ -0,0 +1,102 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+
+#include "KmerScanner.hpp"
+#include "Sequence.hpp"
+#include "char_to_size.hpp"
+
+using namespace npge;
+
+static void check_codes(const Sequence& seq) {
+    std::vector<char> codes(seq.size());
+    seq.letter_codes(0, seq.size(), &codes[0]);
+    for (int i = 0; i < seq.size(); i++) {
+        BOOST_REQUIRE(codes[i] == char_to_size(seq.char_at(i)));
+    }
+    // unaligned part
+    if (seq.size() > 10) {
+        seq.letter_codes(3, seq.size() - 5, &codes[0]);
+        for (int i = 3; i < seq.size() - 2; i++) {
+            BOOST_REQUIRE(codes[i - 3] ==
+                          char_to_size(seq.char_at(i)));
+        }
+    }
+}
+
+static void check_scanner(const Sequence& seq, int kmer, int chunk) {
+    KmerScanner scanner(&seq, kmer, 0, -1, chunk);
+    pos_t expected_pos = 0;
+    while (scanner.next_chunk()) {
+        BOOST_REQUIRE(scanner.size() <= chunk);
+        for (int i = 0; i < scanner.size(); i++) {
+            pos_t pos = scanner.pos(i);
+            BOOST_REQUIRE(pos == expected_pos);
+            expected_pos += 1;
+            std::string s = seq.substr(pos, kmer, 1);
+            bool has_n = (s.find('N') != std::string::npos);
+            BOOST_REQUIRE(scanner.has_n(i) == has_n);
+            if (!has_n) {
+                hash_t dir = seq.hash(pos, kmer, 1);
+                hash_t rev = seq.hash(pos + kmer - 1, kmer, -1);
+                BOOST_REQUIRE(scanner.hash(i) == std::min(dir, rev));
+                BOOST_REQUIRE(scanner.direct(i) == (dir <= rev));
+            }
+        }
+    }
+    BOOST_CHECK(expected_pos == std::max(0, seq.size() - kmer + 1));
+}
+
+static void check_sequence(const Sequence& seq) {
+    check_codes(seq);
+    check_scanner(seq, 1, 7);
+    check_scanner(seq, 3, 1);
+    check_scanner(seq, 5, 64);
+    check_scanner(seq, 20, 13);
+    check_scanner(seq, 32, 100);
+    check_scanner(seq, 32, KmerScanner::DEFAULT_CHUNK);
+}
+
+BOOST_AUTO_TEST_CASE (KmerScanner_main) {
+    std::string data = "TGGTCCGAGATGCGGGCCCGTAAGCTTACATACAGG"
+                       "AATTGGCCATGCNNNAGTAGTGCAAAATTTTGCGCGA"
+                       "TGCTAGCTAGNCATCGATGCATCGATCGATCGATGCA"
+                       "CGATGCTAGCTAGCTAGCATGCATCGATGCTAGCNAT";
+    InMemorySequence s1(data);
+    check_sequence(s1);
+    CompactSequence s2(data);
+    check_sequence(s2);
+    CompactLowNSequence s3(data);
+    check_sequence(s3);
+}
+
+BOOST_AUTO_TEST_CASE (KmerScanner_short) {
+    InMemorySequence seq("ATGC");
+    KmerScanner scanner(&seq, 5);
+    BOOST_CHECK(!scanner.next_chunk());
+    KmerScanner scanner2(&seq, 4);
+    BOOST_REQUIRE(scanner2.next_chunk());
+    BOOST_CHECK(scanner2.size() == 1);
+    BOOST_CHECK(scanner2.no_n());
+    BOOST_CHECK(!scanner2.next_chunk());
+}
+
+BOOST_AUTO_TEST_CASE (KmerScanner_range) {
+    CompactSequence seq("TGGTCCGAGATGCGGGCCCGTAAGCTTACATACAGG");
+    KmerScanner scanner(&seq, 4, 10, 20, 3);
+    int kmers = 0;
+    while (scanner.next_chunk()) {
+        for (int i = 0; i < scanner.size(); i++) {
+            BOOST_CHECK(scanner.pos(i) == 10 + kmers);
+            kmers += 1;
+        }
+    }
+    BOOST_CHECK(kmers == 20 - 4 + 1 - 10);
+}
+
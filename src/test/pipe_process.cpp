@@ -0,0 +1,60 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <string>
+#include <boost/test/unit_test.hpp>
+
+#include "PipeProcess.hpp"
+
+BOOST_AUTO_TEST_CASE (PipeProcess_requests) {
+    using namespace npge;
+    if (!PipeProcess::supported()) {
+        return;
+    }
+    PipeProcess cat("cat");
+    BOOST_CHECK(cat.good());
+    for (int i = 0; i < 3; i++) {
+        std::string output;
+        BOOST_CHECK(cat.communicate("ATGC\n//\n", output, "//\n"));
+        BOOST_CHECK(output == "ATGC\n//\n");
+        BOOST_CHECK(cat.good());
+    }
+    BOOST_CHECK(cat.wait() == 0);
+    BOOST_CHECK(!cat.good());
+}
+
+BOOST_AUTO_TEST_CASE (PipeProcess_one_shot) {
+    using namespace npge;
+    if (!PipeProcess::supported()) {
+        return;
+    }
+    // larger than pipe buffers: writing and reading must interleave
+    std::string input(10 * 1000 * 1000, 'a');
+    PipeProcess tr("tr a b");
+    std::string output;
+    BOOST_CHECK(tr.communicate(input, output));
+    BOOST_CHECK(!tr.good());
+    BOOST_CHECK(tr.wait() == 0);
+    BOOST_CHECK(output == std::string(input.size(), 'b'));
+}
+
+BOOST_AUTO_TEST_CASE (PipeProcess_fail) {
+    using namespace npge;
+    if (!PipeProcess::supported()) {
+        return;
+    }
+    // the process does not read input, write must not raise SIGPIPE
+    PipeProcess exit3("exit 3");
+    std::string output;
+    exit3.communicate(std::string(1000 * 1000, 'a'), output);
+    BOOST_CHECK(exit3.wait() == 3);
+    BOOST_CHECK(output.empty());
+    PipeProcess server("head -n 1");
+    BOOST_CHECK(!server.communicate("A\nT\n//\n", output, "//\n"));
+    BOOST_CHECK(!server.good());
+    BOOST_CHECK(output == "A\n");
+}
@@ -13,6 +13,7 @@
 #include "Pipe.hpp"
 #include "Filter.hpp"
 #include "Decimal.hpp"
+#include "OptionsSnapshot.hpp"
 
 using namespace npge;
 
@@ -187,3 +188,72 @@ BOOST_AUTO_TEST_CASE (processor_parent) {
     delete parent;
 }
 
+
+struct SnapshotTestOptions {
+    int value;
+
+    SnapshotTestOptions():
+        value(0) {
+    }
+
+    SnapshotTestOptions(const Processor* p) {
+        value = p->opt_value("value").as<int>();
+    }
+};
+
+class SnapshotTestChild : public Processor {
+public:
+    std::vector<int> values_;
+
+    SnapshotTestChild() {
+        add_opt("value", "value", 1);
+        add_options_snapshot(&options_);
+    }
+
+    bool bound() const {
+        return options_.bound();
+    }
+
+protected:
+    void run_impl() const {
+        SnapshotTestChild* self = const_cast<SnapshotTestChild*>(this);
+        self->values_.push_back(options_.get(this).value);
+        self->set_opt_value("value", 2);
+        self->values_.push_back(options_.get(this).value);
+    }
+
+private:
+    OptionsSnapshot<SnapshotTestOptions> options_;
+};
+
+class SnapshotTestParent : public Processor {
+public:
+    SnapshotTestChild* child_;
+
+    SnapshotTestParent() {
+        child_ = new SnapshotTestChild;
+        child_->set_parent(this);
+    }
+
+protected:
+    void run_impl() const {
+        BOOST_CHECK(child_->bound());
+        child_->run();
+        BOOST_CHECK(child_->bound());
+    }
+};
+
+BOOST_AUTO_TEST_CASE (processor_options_snapshot) {
+    SnapshotTestParent parent;
+    SnapshotTestChild* child = parent.child_;
+    BOOST_CHECK(!child->bound());
+    parent.run();
+    BOOST_CHECK(!child->bound());
+    BOOST_REQUIRE(child->values_.size() == 2);
+    BOOST_CHECK(child->values_[0] == 1);
+    BOOST_CHECK(child->values_[1] == 2);
+    child->set_opt_value("value", 3);
+    child->run();
+    BOOST_REQUIRE(child->values_.size() == 4);
+    BOOST_CHECK(child->values_[2] == 3);
+}
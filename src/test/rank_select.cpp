@@ -0,0 +1,35 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "rank_select.hpp"
+
+BOOST_AUTO_TEST_CASE (rank_select_main) {
+    using namespace npge;
+    uint64_t word = 0x8000000100000013ULL;
+    BOOST_CHECK(popcount64(word) == 5);
+    BOOST_CHECK(popcount64(0) == 0);
+    BOOST_CHECK(popcount64(~uint64_t(0)) == 64);
+    BOOST_CHECK(select64(word, 0) == 0);
+    BOOST_CHECK(select64(word, 1) == 1);
+    BOOST_CHECK(select64(word, 2) == 4);
+    BOOST_CHECK(select64(word, 3) == 32);
+    BOOST_CHECK(select64(word, 4) == 63);
+    uint64_t x = 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < 100; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        int rank = 0;
+        for (int bit = 0; bit < 64; bit++) {
+            if ((x >> bit) & 1) {
+                BOOST_CHECK(select64(x, rank) == bit);
+                rank += 1;
+            }
+        }
+        BOOST_CHECK(popcount64(x) == rank);
+    }
+}
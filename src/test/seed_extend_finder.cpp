@@ -0,0 +1,104 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <cstdlib>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <boost/foreach.hpp>
+
+#include "Sequence.hpp"
+#include "Fragment.hpp"
+#include "Block.hpp"
+#include "BlockSet.hpp"
+#include "SeedExtendFinder.hpp"
+#include "complement.hpp"
+#include "test_sequences.hpp"
+
+static bool has_hit(npge::BlockSetPtr bs, int min1, int max1, int ori1,
+                    int min2, int max2, int ori2) {
+    using namespace npge;
+    BOOST_FOREACH (Block* block, *bs) {
+        if (block->size() != 2) {
+            continue;
+        }
+        std::vector<Fragment*> fragments(block->begin(), block->end());
+        Fragment* a = fragments[0];
+        Fragment* b = fragments[1];
+        if (a->min_pos() > b->min_pos()) {
+            std::swap(a, b);
+        }
+        if (a->ori() * b->ori() == ori1 * ori2 &&
+                std::abs(int(a->min_pos()) - min1) <= 2 &&
+                std::abs(int(a->max_pos()) - max1) <= 2 &&
+                std::abs(int(b->min_pos()) - min2) <= 2 &&
+                std::abs(int(b->max_pos()) - max2) <= 2) {
+            return true;
+        }
+    }
+    return false;
+}
+
+BOOST_AUTO_TEST_CASE (SeedExtendFinder_repeats) {
+    using namespace npge;
+    srand(1);
+    std::string repeat = random_dna(300);
+    std::string copy = repeat;
+    copy[100] = (copy[100] == 'A') ? 'T' : 'A'; // mismatch
+    copy.erase(200, 2); // gap
+    std::string inverted = repeat;
+    complement(inverted);
+    std::string text = random_dna(500) + repeat + random_dna(500) +
+                       copy + random_dna(500) + inverted +
+                       random_dna(500);
+    SequencePtr s = boost::make_shared<InMemorySequence>(text);
+    BlockSetPtr bs = new_bs();
+    bs->add_sequence(s);
+    SeedExtendFinder finder;
+    finder.set_opt_value("blast-min-length", 100);
+    finder.set_block_set(bs);
+    finder.run();
+    // repeat and copy
+    BOOST_CHECK(has_hit(bs, 500, 799, 1, 1300, 1597, 1));
+    // repeat and inverted repeat
+    BOOST_CHECK(has_hit(bs, 500, 799, 1, 2098, 2397, -1));
+    // copy and inverted repeat
+    BOOST_CHECK(has_hit(bs, 1300, 1597, 1, 2098, 2397, -1));
+    BOOST_CHECK(bs->size() == 3);
+    // same result with multiple workers
+    BlockSetPtr bs2 = new_bs();
+    bs2->add_sequence(s);
+    finder.set_block_set(bs2);
+    finder.set_workers(4);
+    finder.run();
+    BOOST_CHECK(bs2->size() == bs->size());
+}
+
+BOOST_AUTO_TEST_CASE (SeedExtendFinder_two_sequences) {
+    using namespace npge;
+    srand(2);
+    std::string repeat = random_dna(200);
+    std::string t1 = random_dna(300) + repeat + random_dna(300);
+    std::string t2 = random_dna(100) + repeat + random_dna(100);
+    SequencePtr s1 = boost::make_shared<InMemorySequence>(t1);
+    SequencePtr s2 = boost::make_shared<InMemorySequence>(t2);
+    BlockSetPtr bs = new_bs();
+    bs->add_sequence(s1);
+    bs->add_sequence(s2);
+    SeedExtendFinder finder;
+    finder.set_opt_value("blast-min-length", 100);
+    finder.set_block_set(bs);
+    finder.run();
+    BOOST_REQUIRE(bs->size() == 1);
+    Block* block = bs->front();
+    BOOST_CHECK(block->size() == 2);
+    BOOST_FOREACH (Fragment* f, *block) {
+        // flanks can match by chance
+        BOOST_CHECK(f->str().find(repeat) != std::string::npos);
+        BOOST_CHECK(f->length() <= repeat.length() + 4);
+    }
+}
+
@@ -10,6 +10,8 @@
 #include "Sequence.hpp"
 #include "Block.hpp"
 #include "Fragment.hpp"
+#include "AlignmentRow.hpp"
+#include "BlockConsensus.hpp"
 
 BOOST_AUTO_TEST_CASE (Sequence_main) {
     using namespace npge;
@@ -38,6 +40,32 @@ BOOST_AUTO_TEST_CASE (Sequence_n) {
     CompactLowNSequence compact_low_n(seq_str);
     BOOST_CHECK(compact_low_n.size() == seq_str.size());
     BOOST_CHECK(compact_low_n.contents() == seq_str);
+    MappedSequence mapped(seq_str);
+    BOOST_CHECK(mapped.size() == seq_str.size());
+    BOOST_CHECK(mapped.contents() == seq_str);
+}
+
+BOOST_AUTO_TEST_CASE (Sequence_mapped) {
+    using namespace npge;
+    std::string seq_str = "NNTGGTCNNGAGATGCGGANNNCGTAN";
+    SequencePtr mapped = boost::make_shared<MappedSequence>(seq_str);
+    SequencePtr compact = boost::make_shared<CompactLowNSequence>(seq_str);
+    BOOST_REQUIRE(mapped->size() == seq_str.size());
+    for (int i = 0; i < seq_str.size(); i++) {
+        BOOST_CHECK(mapped->char_at(i) == seq_str[i]);
+    }
+    for (int start = 0; start < seq_str.size(); start++) {
+        for (int stop = start; stop < seq_str.size(); stop++) {
+            Fragment f(mapped, start, stop, 1);
+            Fragment g(compact, start, stop, 1);
+            BOOST_CHECK(f.str() == g.str());
+            BOOST_CHECK(f.hash() == g.hash());
+            f.inverse();
+            g.inverse();
+            BOOST_CHECK(f.str() == g.str());
+            BOOST_CHECK(f.hash() == g.hash());
+        }
+    }
 }
 
 BOOST_AUTO_TEST_CASE (Sequence_first_ori) {
@@ -160,6 +188,37 @@ BOOST_AUTO_TEST_CASE (Sequence_consensus_of_block_empty_name) {
     BOOST_CHECK(consensus.name() == "myblock");
 }
 
+BOOST_AUTO_TEST_CASE (Sequence_consensus_compact) {
+    using namespace npge;
+    SequencePtr s1 = boost::make_shared<InMemorySequence>("CAGNACGGTTA");
+    SequencePtr s2 = boost::make_shared<InMemorySequence>("CAGNAAGTT");
+    Fragment* f1 = new Fragment(s1, 0, s1->size() - 1);
+    new MapAlignmentRow("CAGNACGGTTA", f1);
+    Fragment* f2 = new Fragment(s2, 0, s2->size() - 1);
+    new MapAlignmentRow("CAGNAAG-TT-", f2);
+    Block block;
+    block.insert(f1);
+    block.insert(f2);
+    BlockConsensus cons(&block);
+    BOOST_CHECK(cons.str() == "CAGNAAGGTTA");
+    BOOST_CHECK(cons.str() == block.consensus_string());
+    BOOST_CHECK(cons.identity() == block.identity());
+    CompactSequence compact;
+    compact.set_block(&block);
+    BOOST_CHECK(compact.contents() == "CAGNAAGGTTA");
+    CompactLowNSequence low_n;
+    low_n.set_block(&block);
+    BOOST_CHECK(low_n.contents() == "CAGNAAGGTTA");
+    InMemorySequence in_memory;
+    in_memory.set_block(&block);
+    BOOST_CHECK(in_memory.contents() == "CAGNAAGGTTA");
+    BOOST_CHECK(in_memory.description() ==
+                compact.description());
+    block.erase(f2);
+    BlockConsensus cons2(&block);
+    BOOST_CHECK(cons2.str() == "CAGNACGGTTA");
+}
+
 BOOST_AUTO_TEST_CASE (Sequence_to_atgcn) {
     using namespace npge;
     std::string s = "AA-A";
@@ -0,0 +1,80 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <set>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <boost/foreach.hpp>
+#include <boost/thread.hpp>
+
+#include "small_object.hpp"
+#include "Sequence.hpp"
+#include "Fragment.hpp"
+#include "Block.hpp"
+#include "BlockSet.hpp"
+#include "AlignmentRow.hpp"
+
+BOOST_AUTO_TEST_CASE (small_object_reuse) {
+    using namespace npge;
+    std::vector<void*> ptrs;
+    std::set<void*> unique;
+    for (int i = 0; i < 1000; i++) {
+        void* ptr = small_object_allocate(40);
+        ptrs.push_back(ptr);
+        unique.insert(ptr);
+    }
+    BOOST_CHECK(unique.size() == ptrs.size());
+    BOOST_FOREACH (void* ptr, ptrs) {
+        small_object_deallocate(ptr, 40);
+    }
+    void* big = small_object_allocate(1000);
+    small_object_deallocate(big, 1000);
+    if (small_object_pools()) {
+        void* ptr = small_object_allocate(40);
+        BOOST_CHECK(unique.find(ptr) != unique.end());
+        small_object_deallocate(ptr, 40);
+    }
+}
+
+static void make_blocks(npge::SequencePtr seq, npge::BlockSet* bs) {
+    using namespace npge;
+    for (int i = 0; i < 1000; i++) {
+        Block* block = new Block;
+        for (int j = 0; j < 3; j++) {
+            Fragment* f = new Fragment(seq, j * 3, j * 3 + 2);
+            AlignmentRow* row = AlignmentRow::new_row(COMPACT_ROW);
+            row->grow("A-TG");
+            f->set_row(row);
+            block->insert(f);
+        }
+        bs->insert(block);
+    }
+}
+
+BOOST_AUTO_TEST_CASE (small_object_threads) {
+    using namespace npge;
+    SequencePtr seq = boost::make_shared<InMemorySequence>("ATGCATGCATGC");
+    // objects are created in threads and deleted in main thread
+    for (int iteration = 0; iteration < 3; iteration++) {
+        std::vector<BlockSetPtr> bss;
+        boost::thread_group threads;
+        for (int t = 0; t < 4; t++) {
+            bss.push_back(new_bs());
+            threads.create_thread(boost::bind(make_blocks, seq,
+                                              bss.back().get()));
+        }
+        threads.join_all();
+        BOOST_FOREACH (BlockSetPtr bs, bss) {
+            BOOST_CHECK(bs->size() == 1000);
+            BOOST_FOREACH (Block* block, *bs) {
+                BOOST_CHECK(block->size() == 3);
+                BOOST_CHECK(block->front()->str() == "A-TG");
+            }
+            bs->clear();
+        }
+    }
+}
@@ -0,0 +1,19 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <cstdlib>
+
+#include "test_sequences.hpp"
+
+std::string random_dna(int length) {
+    std::string result(length, 'A');
+    for (int i = 0; i < length; i++) {
+        result[i] = "ATGC"[std::rand() % 4];
+    }
+    return result;
+}
+
@@ -0,0 +1,20 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef NPGE_TEST_SEQUENCES_HPP_
+#define NPGE_TEST_SEQUENCES_HPP_
+
+#include <string>
+
+/** Return random sequence of letters ATGC.
+Letters are taken from std::rand(), so the result
+is reproducible after std::srand().
+*/
+std::string random_dna(int length);
+
+#endif
+
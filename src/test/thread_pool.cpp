@@ -5,12 +5,206 @@
  * See the LICENSE file for terms of use.
  */
 
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
 #include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
 
 #include "thread_pool.hpp"
+#include "simple_task.hpp"
+#include "atomic.hpp"
+#include "Exception.hpp"
 
 BOOST_AUTO_TEST_CASE (thread_pool_main) {
     using namespace npge;
     ThreadPool pool;
 }
 
+static void add_one(volatile int* counter) {
+    npge::atomic_fetch_add(counter, 1);
+}
+
+static void spawn_many(volatile int* counter, int n) {
+    using namespace npge;
+    SpawnedTasks subtasks;
+    for (int i = 0; i < n; i++) {
+        subtasks.spawn(boost::bind(add_one, counter));
+    }
+    subtasks.wait();
+}
+
+static void spawn_nested(volatile int* counter) {
+    using namespace npge;
+    SpawnedTasks subtasks;
+    for (int i = 0; i < 10; i++) {
+        subtasks.spawn(boost::bind(spawn_many, counter, 10));
+    }
+    // spawned tasks are waited for in destructor
+}
+
+BOOST_AUTO_TEST_CASE (thread_pool_spawn) {
+    using namespace npge;
+    for (int workers = 1; workers <= 4; workers++) {
+        volatile int counter = 0;
+        Tasks tasks;
+        for (int i = 0; i < 20; i++) {
+            tasks.push_back(boost::bind(spawn_nested, &counter));
+        }
+        do_tasks(tasks_to_generator(tasks), workers);
+        BOOST_CHECK(counter == 20 * 10 * 10);
+    }
+    // no worker: subtasks are run immediately
+    volatile int counter = 0;
+    spawn_many(&counter, 5);
+    BOOST_CHECK(counter == 5);
+}
+
+static void fail() {
+    throw std::runtime_error("subtask failed");
+}
+
+static void spawn_failing(volatile int* errors) {
+    using namespace npge;
+    SpawnedTasks subtasks;
+    subtasks.spawn(fail);
+    subtasks.spawn(boost::bind(add_one, errors));
+    try {
+        subtasks.wait();
+    } catch (Exception& e) {
+        if (std::string(e.what()) == "subtask failed") {
+            add_one(errors);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE (thread_pool_spawn_errors) {
+    using namespace npge;
+    volatile int errors = 0;
+    Tasks tasks;
+    for (int i = 0; i < 10; i++) {
+        tasks.push_back(boost::bind(spawn_failing, &errors));
+    }
+    do_tasks(tasks_to_generator(tasks), 4);
+    BOOST_CHECK(errors == 20);
+}
+
+static void nested_do_tasks(volatile int* counter) {
+    using namespace npge;
+    Tasks tasks;
+    for (int i = 0; i < 10; i++) {
+        tasks.push_back(boost::bind(add_one, counter));
+    }
+    do_tasks(tasks_to_generator(tasks), 4);
+}
+
+BOOST_AUTO_TEST_CASE (thread_pool_nested_groups) {
+    using namespace npge;
+    // all threads of pool are busy with outer tasks
+    volatile int counter = 0;
+    Tasks tasks;
+    for (int i = 0; i < 50; i++) {
+        tasks.push_back(boost::bind(nested_do_tasks, &counter));
+    }
+    do_tasks(tasks_to_generator(tasks), -1);
+    BOOST_CHECK(counter == 50 * 10);
+}
+
+class SpawningTask : public npge::ThreadTask {
+public:
+    SpawningTask(npge::ThreadWorker* worker, volatile int* counter):
+        npge::ThreadTask(worker), counter_(counter) {
+    }
+
+    void run_impl() {
+        spawn_nested(counter_);
+    }
+
+private:
+    volatile int* counter_;
+};
+
+class SpawningGroup : public npge::ThreadGroup {
+public:
+    SpawningGroup(int tasks):
+        tasks_(tasks), counter_(0) {
+    }
+
+    npge::ThreadTask* create_task_impl(npge::ThreadWorker* worker) {
+        if (tasks_ == 0) {
+            return 0;
+        }
+        tasks_ -= 1;
+        return new SpawningTask(worker, &counter_);
+    }
+
+    int tasks_;
+    volatile int counter_;
+};
+
+BOOST_AUTO_TEST_CASE (thread_pool_spawn_threads) {
+    using namespace npge;
+    // ThreadGroup creates new threads (not from pool)
+    for (int i = 0; i < 10; i++) {
+        SpawningGroup group(3);
+        group.set_workers(5);
+        group.perform();
+        BOOST_CHECK(group.counter_ == 3 * 10 * 10);
+    }
+}
+
+static void mark_range(std::vector<int>* marks, int first, int last) {
+    for (int i = first; i < last; i++) {
+        npge::atomic_fetch_add(&(*marks)[i], 1);
+    }
+}
+
+class RangesTask : public npge::ThreadTask {
+public:
+    RangesTask(npge::ThreadWorker* worker, std::vector<int>* marks):
+        npge::ThreadTask(worker), marks_(marks) {
+    }
+
+    void run_impl() {
+        npge::spawn_ranges(marks_->size(), 10,
+                           boost::bind(mark_range, marks_, _1, _2));
+    }
+
+private:
+    std::vector<int>* marks_;
+};
+
+class RangesGroup : public npge::ThreadGroup {
+public:
+    RangesGroup(std::vector<int>* marks):
+        marks_(marks), done_(false) {
+    }
+
+    npge::ThreadTask* create_task_impl(npge::ThreadWorker* worker) {
+        if (done_) {
+            return 0;
+        }
+        done_ = true;
+        return new RangesTask(worker, marks_);
+    }
+
+private:
+    std::vector<int>* marks_;
+    bool done_;
+};
+
+BOOST_AUTO_TEST_CASE (thread_pool_spawn_ranges) {
+    using namespace npge;
+    for (int workers = 1; workers <= 4; workers++) {
+        // one task, parts of range are stolen by other workers
+        std::vector<int> marks(1000, 0);
+        RangesGroup group(&marks);
+        group.set_workers(workers);
+        group.perform();
+        BOOST_CHECK(std::count(marks.begin(), marks.end(), 1) == 1000);
+    }
+    // not a worker
+    std::vector<int> marks(5, 0);
+    spawn_ranges(5, 10, boost::bind(mark_range, &marks, _1, _2));
+    BOOST_CHECK(std::count(marks.begin(), marks.end(), 1) == 5);
+}
@@ -8,6 +8,7 @@
 #include <map>
 #include <utility>
 #include <boost/test/unit_test.hpp>
+#include <boost/foreach.hpp>
 
 #include "tree.hpp"
 
@@ -205,6 +206,90 @@ BOOST_AUTO_TEST_CASE (tree_nj_w) {
     BOOST_CHECK(a->parent() == b->parent());
 }
 
+static void check_nj_additive(int workers) {
+    using namespace npge;
+    const int N = 200;
+    TreeNode tree;
+    Leafs leafs;
+    Nodes nodes;
+    for (int i = 0; i < N; i++) {
+        TestLeaf* leaf = new TestLeaf("a");
+        leafs.push_back(leaf);
+        nodes.push_back(leaf);
+        tree.add_child(leaf);
+    }
+    // random tree with integer lengths
+    unsigned int r = 1;
+    while (nodes.size() > 1) {
+        r = r * 1103515245 + 12345;
+        int i = (r >> 8) % nodes.size();
+        TreeNode* a = nodes[i];
+        nodes.erase(nodes.begin() + i);
+        r = r * 1103515245 + 12345;
+        int j = (r >> 8) % nodes.size();
+        TreeNode* b = nodes[j];
+        nodes.erase(nodes.begin() + j);
+        TreeNode* parent = new TreeNode;
+        tree.add_child(parent);
+        parent->add_child(a);
+        parent->add_child(b);
+        a->set_length(1 + (r >> 4) % 10);
+        b->set_length(1 + (r >> 12) % 10);
+        nodes.push_back(parent);
+    }
+    for (int i = 0; i < N; i++) {
+        for (int j = i + 1; j < N; j++) {
+            map[make_pair(leafs[i], leafs[j])] =
+                leafs[i]->tree_distance_to(leafs[j]);
+        }
+    }
+    tree.neighbor_joining(workers);
+    BOOST_REQUIRE(tree.children().size() == 3);
+    for (int i = 0; i < N; i++) {
+        for (int j = i + 1; j < N; j++) {
+            BOOST_CHECK(almost_equal(leafs[i]->tree_distance_to(leafs[j]),
+                                     map[make_pair(leafs[i], leafs[j])]));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE (tree_nj_additive) {
+    check_nj_additive(1);
+    check_nj_additive(4);
+}
+
+BOOST_AUTO_TEST_CASE (tree_branch_bits) {
+    using namespace npge;
+    TreeNode tree;
+    Leafs leafs;
+    for (int i = 0; i < 150; i++) {
+        TestLeaf* leaf = new TestLeaf("a");
+        leaf->set_length(i % 7);
+        leafs.push_back(leaf);
+    }
+    // caterpillar, first leaf is deep
+    TreeNode* node = &tree;
+    for (int i = 0; i < leafs.size(); i++) {
+        if (i % 2 == 0) {
+            TreeNode* next = new TreeNode;
+            next->set_length(i % 5);
+            node->add_child(next);
+            node = next;
+        }
+        node->add_child(leafs[leafs.size() - 1 - i]);
+    }
+    BranchTable table;
+    tree.branch_table(table, leafs, 2.0);
+    BranchBitsTable bits_table;
+    tree.branch_bits_table(bits_table, leafs, 2.0);
+    BOOST_REQUIRE(bits_table.size() == table.size());
+    BOOST_FOREACH (const BranchBitsTable::value_type& v, bits_table) {
+        std::string branch = TreeNode::branch_bits_to_str(v.first);
+        BOOST_REQUIRE(table.find(branch) != table.end());
+        BOOST_CHECK(almost_equal(table[branch], v.second));
+    }
+}
+
 BOOST_AUTO_TEST_CASE (tree_branch_str) {
     using namespace npge;
     TreeNode tree;
@@ -237,6 +322,12 @@ BOOST_AUTO_TEST_CASE (tree_branch_str) {
     BOOST_REQUIRE(table.size() == 1);
     BOOST_CHECK(table.begin()->first == "0011");
     BOOST_CHECK(almost_equal(table.begin()->second, 10.0 + 20.0));
+    BranchBitsTable bits_table;
+    tree.branch_bits_table(bits_table, leafs, 1.0);
+    BOOST_REQUIRE(bits_table.size() == 1);
+    const BranchBits& bits = bits_table.begin()->first;
+    BOOST_CHECK(TreeNode::branch_bits_to_str(bits) == "0011");
+    BOOST_CHECK(almost_equal(bits_table.begin()->second, 10.0 + 20.0));
     Leafs l0, l1;
     TreeNode::branch_str_decode(leafs, "0011", l0, l1);
     BOOST_REQUIRE(l0.size() == 2);
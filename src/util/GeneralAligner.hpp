@@ -8,11 +8,14 @@
 #ifndef NPGE_GENERAL_ALIGNER_HPP
 #define NPGE_GENERAL_ALIGNER_HPP
 
+#include <cstdlib>
 #include <vector>
 #include <algorithm>
 #include <utility>
+#include <boost/foreach.hpp>
 
 #include "global.hpp"
+#include "aligner_kernel.hpp"
 #include "throw_assert.hpp"
 #include "Exception.hpp"
 #include "cast.hpp"
@@ -22,9 +25,31 @@ namespace npge {
 // TODO: gap_open
 
 const int BAD_VALUE = 1e6;
-const int MATRICES_NUMBER = 2;
 
-/** Find the end of good alignment using Needleman-Wunsch with gap frame */
+/** Max number of cells in the band of global alignment */
+const int MAX_BAND_CELLS = 1 << 25;
+
+/** Return gap range for global alignment of sequences.
+The gap range is widened to the difference of lengths,
+so that the path to the last cell fits the band,
+until the band has MAX_BAND_CELLS cells.
+Otherwise the rest of longer sequence is aligned
+to gaps at the end (see GeneralAligner::align).
+*/
+inline int global_gap_range(int gap_range, int rows, int cols) {
+    int diff = std::abs(rows - cols);
+    int max_range = (MAX_BAND_CELLS / std::max(rows + 1, 1) - 3) / 2;
+    return std::max(gap_range, std::min(diff, max_range));
+}
+
+/** Find the end of good alignment using Needleman-Wunsch with gap frame.
+
+If gap range is less than length of sequences, only the band
+of the matrix around main diagonal is stored.
+If lengths of sequences differ by more than gap range and
+max_errors is -1, the rest of longer sequence is aligned
+to gaps at the end.
+*/
 template <typename Contents>
 class GeneralAligner {
 public:
@@ -37,7 +62,8 @@ public:
 
     /** Constructor */
     GeneralAligner():
-        gap_range_(1), max_errors_(0), gap_penalty_(1), local_(false) {
+        gap_range_(1), max_errors_(0), gap_penalty_(1), local_(false),
+        vectorized_(false), width_(0), band_(0), band_base_(-1) {
     }
 
     /** Get contents */
@@ -106,6 +132,20 @@ public:
         local_ = local;
     }
 
+    /** Return if rows are filled by aligner_fill_row() */
+    bool vectorized() const {
+        return vectorized_;
+    }
+
+    /** Set if rows are filled by aligner_fill_row().
+    It uses SIMD instructions if they are supported by processor.
+    Results are identical to results of scalar loop.
+    Default: false.
+    */
+    void set_vectorized(bool vectorized) {
+        vectorized_ = vectorized;
+    }
+
     /** Run alignment algorithm.
     \param first_last Last aligned position in first sequence (output)
     \param second_last Last aligned position in second sequence (output)
@@ -121,25 +161,12 @@ public:
         for (int row = 0; row <= max_row(); row++) {
             int start_col = min_col(row);
             int stop_col = max_col(row);
-            int min_score_col = start_col;
-            for (int col = start_col; col <= stop_col; col++) {
-                ASSERT_TRUE(col >= 0 && col < side());
-                ASSERT_TRUE(in(row, col));
-                int match = at(row - 1, col - 1) +
-                            substitution(row, col);
-                int gap1 = at(row, col - 1) + gap_penalty();
-                int gap2 = at(row - 1, col) + gap_penalty();
-                int score = std::min(match, std::min(gap1, gap2));
-                if (local()) {
-                    score = std::min(score, 0);
-                }
-                at(row, col) = score;
-                if (score < at(row, min_score_col)) {
-                    min_score_col = col;
-                }
-                track(row, col) = (score == match) ? MATCH :
-                                  (score == gap1) ? COL_INC :
-                                  ROW_INC;
+            int min_score_col;
+            if (vectorized()) {
+                min_score_col = fill_row(row, start_col, stop_col);
+            } else {
+                min_score_col = fill_row_scalar(row, start_col,
+                                                stop_col);
             }
             if (max_errors() != -1 &&
                     at(row, min_score_col) > max_errors()) {
@@ -156,16 +183,20 @@ public:
             // if stopped earlier because of gap range
             int last_row = contents().first_size() - 1;
             int last_col = contents().second_size() - 1;
+            // cells outside the band are not stored,
+            // they are added by export_alignment
             if (r_row == last_row) {
-                while (r_col < last_col) {
+                while (r_col < last_col && in(r_row, r_col + 1)) {
                     r_col += 1;
                     track(r_row, r_col) = COL_INC;
                 }
+                r_col = last_col;
             } else if (r_col == last_col) {
-                while (r_row < last_row) {
+                while (r_row < last_row && in(r_row + 1, r_col)) {
                     r_row += 1;
                     track(r_row, r_col) = ROW_INC;
                 }
+                r_row = last_row;
             } else {
                 throw Exception("row and column are not last");
             }
@@ -178,7 +209,7 @@ public:
         int col0 = col;
         for (int i = 0; i <= row0; i++) {
             for (int j = 0; j <= col0; j++) {
-                if (at(i, j) < at(row, col)) {
+                if (in(i, j) && at(i, j) < at(row, col)) {
                     row = i;
                     col = j;
                 }
@@ -262,6 +293,16 @@ public:
     void export_alignment(int first_last, int second_last,
                           PairAlignment& alignment) const {
         int row = first_last, col = second_last;
+        // gaps at the end outside the band (see align)
+        while (!in(row, col)) {
+            if (col - first_stored_col(row) >= width_) {
+                alignment.push_back(std::make_pair(-1, col));
+                col -= 1;
+            } else {
+                alignment.push_back(std::make_pair(row, -1));
+                row -= 1;
+            }
+        }
         while (row != -1 || col != -1) {
             int tr = track(row, col);
             if (tr == STOP) {
@@ -318,9 +359,7 @@ public:
     int& at(int row0, int col0) const {
         ASSERT_MSG(in(row0, col0),
                    (TO_S(row0) + " " + TO_S(col0)).c_str());
-        int row = row0 + 1, col = col0 + 1;
-        int index = row * cols_1() + col;
-        return matrix_[index * MATRICES_NUMBER];
+        return scores_[cell_index(row0, col0)];
     }
 
     /** Matrix with back track of alignment.
@@ -329,9 +368,7 @@ public:
     int& track(int row0, int col0) const {
         ASSERT_MSG(in(row0, col0),
                    (TO_S(row0) + " " + TO_S(col0)).c_str());
-        int row = row0 + 1, col = col0 + 1;
-        int index = row * cols_1() + col;
-        return matrix_[index * MATRICES_NUMBER + 1];
+        return tracks_[cell_index(row0, col0)];
     }
 
     /** Go to previous cell using track() */
@@ -360,7 +397,9 @@ public:
     bool in(int row, int col) const {
         bool row_is_good = (-1 <= row && row < rows());
         bool col_is_good = (-1 <= col && col < cols());
-        return row_is_good && col_is_good;
+        int band_col = col - first_stored_col(row);
+        bool band_is_good = (0 <= band_col && band_col < width_);
+        return row_is_good && col_is_good && band_is_good;
     }
 
     int substitution(int row, int col) const {
@@ -370,8 +409,20 @@ public:
     }
 
     void adjust_matrix_size() const {
-        int size = rows_1() * cols_1() * MATRICES_NUMBER;
-        matrix_.resize(size, BAD_VALUE);
+        int band_width = 2 * gap_range() + 3;
+        if (band_width < cols_1()) {
+            // (gap range + 1) cells on both sides of diagonal
+            width_ = band_width;
+            band_ = 1;
+            band_base_ = -gap_range() - 1;
+        } else {
+            width_ = cols_1();
+            band_ = 0;
+            band_base_ = -1;
+        }
+        int size = rows_1() * width_;
+        scores_.resize(size, BAD_VALUE);
+        tracks_.resize(size, BAD_VALUE);
     }
 
     void limit_range() const {
@@ -388,7 +439,7 @@ public:
     void make_frame() const {
         at(-1, -1) = 0;
         track(-1, -1) = STOP;
-        for (int row = 0; row < rows(); row++) {
+        for (int row = 0; row < rows() && in(row, -1); row++) {
             if (local()) {
                 at(row, -1) = 0;
             } else {
@@ -396,7 +447,7 @@ public:
             }
             track(row, -1) = ROW_INC;
         }
-        for (int col = 0; col < cols(); col++) {
+        for (int col = 0; col < cols() && in(-1, col); col++) {
             if (local()) {
                 at(-1, col) = 0;
             } else {
@@ -407,10 +458,75 @@ public:
     }
 
 private:
-    mutable std::vector<int> matrix_;
+    mutable std::vector<int> scores_;
+    mutable std::vector<int> tracks_;
+    mutable std::vector<int> subst_;
+    mutable std::vector<int> match_;
     int gap_range_, max_errors_, gap_penalty_;
     bool local_;
+    bool vectorized_;
+    mutable int width_; // number of stored cells in row
+    mutable int band_; // 1 if band is stored, 0 if full rows
+    mutable int band_base_;
     Contents contents_;
+
+    int first_stored_col(int row) const {
+        return row * band_ + band_base_;
+    }
+
+    int cell_index(int row, int col) const {
+        return (row + 1) * width_ + (col - first_stored_col(row));
+    }
+
+    /** Fill cells of the row, return column of min score */
+    int fill_row_scalar(int row, int start_col, int stop_col) const {
+        int min_score_col = start_col;
+        for (int col = start_col; col <= stop_col; col++) {
+            ASSERT_TRUE(col >= 0 && col < side());
+            ASSERT_TRUE(in(row, col));
+            int match = at(row - 1, col - 1) +
+                        substitution(row, col);
+            int gap1 = at(row, col - 1) + gap_penalty();
+            int gap2 = at(row - 1, col) + gap_penalty();
+            int score = std::min(match, std::min(gap1, gap2));
+            if (local()) {
+                score = std::min(score, 0);
+            }
+            at(row, col) = score;
+            if (score < at(row, min_score_col)) {
+                min_score_col = col;
+            }
+            track(row, col) = (score == match) ? MATCH :
+                              (score == gap1) ? COL_INC :
+                              ROW_INC;
+        }
+        return min_score_col;
+    }
+
+    /** Fill cells of the row by aligner_fill_row(),
+    return column of min score */
+    int fill_row(int row, int start_col, int stop_col) const {
+        int length = stop_col - start_col + 1;
+        if (subst_.size() < length) {
+            subst_.resize(length);
+            match_.resize(length);
+        }
+        for (int i = 0; i < length; i++) {
+            subst_[i] = substitution(row, start_col + i);
+        }
+        int* score = &at(row, start_col);
+        aligner_fill_row(score, &track(row, start_col),
+                         &at(row - 1, start_col),
+                         &subst_[0], &match_[0], length,
+                         gap_penalty(), local());
+        int min_i = 0;
+        for (int i = 1; i < length; i++) {
+            if (score[i] < score[min_i]) {
+                min_i = i;
+            }
+        }
+        return start_col + min_i;
+    }
 };
 
 template<typename Contents>
@@ -0,0 +1,307 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include "PipeProcess.hpp"
+#include "Exception.hpp"
+
+#if defined(_WIN32) || defined(__WIN32__)
+
+namespace npge {
+
+class PipeProcess::Impl {
+public:
+    std::string cmd_;
+};
+
+PipeProcess::PipeProcess(const std::string& cmd):
+    impl_(0) {
+    // nothing is allocated: destructor is not called
+    // if constructor throws
+    throw Exception("Pipes to processes are not supported");
+}
+
+PipeProcess::~PipeProcess() {
+    delete impl_;
+}
+
+const std::string& PipeProcess::cmd() const {
+    return impl_->cmd_;
+}
+
+bool PipeProcess::communicate(const std::string&, std::string&,
+                              const std::string&) {
+    return false;
+}
+
+bool PipeProcess::good() const {
+    return false;
+}
+
+int PipeProcess::wait() {
+    return -1;
+}
+
+bool PipeProcess::supported() {
+    return false;
+}
+
+}
+
+#else
+
+#include <cerrno>
+#include <csignal>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <boost/thread/mutex.hpp>
+
+namespace npge {
+
+const size_t CHUNK_SIZE = 64 * 1024;
+
+static void close_fd(int& fd) {
+    if (fd != -1) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+// fork() in other thread must not get pipe without FD_CLOEXEC,
+// otherwise the pipe is inherited by unrelated child and
+// our child never gets end of file
+static boost::mutex pipe_mutex;
+
+static bool make_pipe(int fds[2]) {
+#ifdef __linux__
+    return pipe2(fds, O_CLOEXEC) == 0;
+#else
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+#endif
+}
+
+// text[start:] ends with line end_line
+static bool ends_with(const std::string& text, size_t start,
+                      const std::string& end_line) {
+    size_t size = end_line.size();
+    if (text.size() < start + size) {
+        return false;
+    }
+    size_t line_start = text.size() - size;
+    if (text.compare(line_start, size, end_line) != 0) {
+        return false;
+    }
+    return line_start == start || text[line_start - 1] == '\n';
+}
+
+class PipeProcess::Impl {
+public:
+    std::string cmd_;
+    pid_t pid_;
+    int in_; // write end of stdin of child
+    int out_; // read end of stdout of child
+    bool good_;
+
+    Impl():
+        pid_(-1), in_(-1), out_(-1), good_(false) {
+    }
+
+    void start() {
+        boost::mutex::scoped_lock lock(pipe_mutex);
+        int in[2], out[2];
+        if (!make_pipe(in)) {
+            throw Exception("Can't create pipe for " + cmd_);
+        }
+        if (!make_pipe(out)) {
+            ::close(in[0]);
+            ::close(in[1]);
+            throw Exception("Can't create pipe for " + cmd_);
+        }
+        pid_ = fork();
+        if (pid_ == 0) {
+            // child, dup2 resets FD_CLOEXEC
+            dup2(in[0], STDIN_FILENO);
+            dup2(out[1], STDOUT_FILENO);
+            execl("/bin/sh", "sh", "-c", cmd_.c_str(), (char*)0);
+            _exit(127);
+        }
+        ::close(in[0]);
+        ::close(out[1]);
+        in_ = in[1];
+        out_ = out[0];
+        if (pid_ == -1) {
+            close_fd(in_);
+            close_fd(out_);
+            throw Exception("Can't start " + cmd_);
+        }
+        fcntl(in_, F_SETFL, fcntl(in_, F_GETFL) | O_NONBLOCK);
+        good_ = true;
+    }
+
+    int wait() {
+        close_fd(in_);
+        close_fd(out_);
+        good_ = false;
+        if (pid_ == -1) {
+            return -1;
+        }
+        int status;
+        while (waitpid(pid_, &status, 0) == -1) {
+            if (errno != EINTR) {
+                pid_ = -1;
+                return -1;
+            }
+        }
+        pid_ = -1;
+        if (WIFEXITED(status)) {
+            return WEXITSTATUS(status);
+        } else if (WIFSIGNALED(status)) {
+            return 128 + WTERMSIG(status);
+        } else {
+            return -1;
+        }
+    }
+};
+
+/* SIGPIPE is blocked in current thread while writing to pipe,
+   so EPIPE is returned instead of killing whole program.
+   Pending SIGPIPE is dropped after that. */
+class SigpipeBlocker {
+public:
+    SigpipeBlocker():
+        epipe_(false) {
+        sigemptyset(&sigpipe_);
+        sigaddset(&sigpipe_, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &sigpipe_, &old_);
+    }
+
+    ~SigpipeBlocker() {
+        if (epipe_ && !sigismember(&old_, SIGPIPE)) {
+            sigset_t pending;
+            sigpending(&pending);
+            if (sigismember(&pending, SIGPIPE)) {
+                int sig;
+                sigwait(&sigpipe_, &sig);
+            }
+        }
+        pthread_sigmask(SIG_SETMASK, &old_, 0);
+    }
+
+    bool epipe_;
+
+private:
+    sigset_t sigpipe_;
+    sigset_t old_;
+};
+
+PipeProcess::PipeProcess(const std::string& cmd):
+    impl_(new Impl) {
+    impl_->cmd_ = cmd;
+    try {
+        impl_->start();
+    } catch (...) {
+        delete impl_;
+        throw;
+    }
+}
+
+PipeProcess::~PipeProcess() {
+    impl_->wait();
+    delete impl_;
+}
+
+const std::string& PipeProcess::cmd() const {
+    return impl_->cmd_;
+}
+
+bool PipeProcess::communicate(const std::string& input,
+                              std::string& output,
+                              const std::string& end_line) {
+    if (!impl_->good_) {
+        return false;
+    }
+    SigpipeBlocker blocker;
+    size_t output_start = output.size();
+    size_t written = 0;
+    bool input_failed = false;
+    std::vector<char> buffer(CHUNK_SIZE);
+    while (true) {
+        bool writing = !input_failed && written < input.size();
+        if (!writing && end_line.empty()) {
+            close_fd(impl_->in_);
+        }
+        pollfd fds[2];
+        int nfds = 0;
+        fds[nfds].fd = impl_->out_;
+        fds[nfds].events = POLLIN;
+        nfds += 1;
+        if (writing) {
+            fds[nfds].fd = impl_->in_;
+            fds[nfds].events = POLLOUT;
+            nfds += 1;
+        }
+        if (poll(fds, nfds, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (writing && fds[1].revents) {
+            size_t size = std::min(input.size() - written, CHUNK_SIZE);
+            ssize_t w = ::write(impl_->in_, input.c_str() + written,
+                                size);
+            if (w > 0) {
+                written += w;
+            } else if (w == -1 && errno != EAGAIN && errno != EINTR) {
+                blocker.epipe_ = (errno == EPIPE);
+                input_failed = true;
+            }
+        }
+        if (fds[0].revents) {
+            ssize_t r = ::read(impl_->out_, &buffer[0], CHUNK_SIZE);
+            if (r > 0) {
+                output.append(&buffer[0], r);
+                if (!end_line.empty() && written == input.size() &&
+                        ends_with(output, output_start, end_line)) {
+                    return true;
+                }
+            } else if (r == 0 || (errno != EAGAIN && errno != EINTR)) {
+                // end of file
+                break;
+            }
+        }
+    }
+    impl_->good_ = false;
+    return end_line.empty() && !input_failed;
+}
+
+bool PipeProcess::good() const {
+    return impl_->good_;
+}
+
+int PipeProcess::wait() {
+    return impl_->wait();
+}
+
+bool PipeProcess::supported() {
+    return true;
+}
+
+}
+
+#endif
+
@@ -0,0 +1,78 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef NPGE_PIPE_PROCESS_HPP_
+#define NPGE_PIPE_PROCESS_HPP_
+
+#include <string>
+#include <boost/utility.hpp>
+
+namespace npge {
+
+/** Child process connected to parent through pipes.
+Command is run by /bin/sh. Standard input and standard output
+of the command are pipes, standard error is inherited.
+
+The process can be used for one request (communicate() with
+empty end line, then wait()) or it can be kept alive and
+used for many requests, if the command answers each request
+with output terminated by known line.
+
+Only POSIX systems are supported (see supported()).
+*/
+class PipeProcess : boost::noncopyable {
+public:
+    /** Start the command.
+    Throws Exception if the process can't be started.
+    */
+    PipeProcess(const std::string& cmd);
+
+    /** Close pipes and wait for the process */
+    ~PipeProcess();
+
+    /** Return the command */
+    const std::string& cmd() const;
+
+    /** Write input to the process and read its output.
+    Writing and reading are interleaved, so the process
+    can produce output before reading all input.
+
+    If end_line is empty, input of the process is closed
+    after writing, and output is read until end of file.
+    Otherwise output is read until it ends with end_line
+    (including the trailing new line), written by the process
+    after reading whole input. end_line is not removed.
+
+    Return false if the process closed its input or output
+    too early. Output is appended to output.
+    */
+    bool communicate(const std::string& input, std::string& output,
+                     const std::string& end_line = "");
+
+    /** Return if the process can take next request.
+    It is false after failed communicate() or after
+    communicate() with empty end_line.
+    */
+    bool good() const;
+
+    /** Close pipes and wait for the process.
+    Return exit status (0 on success).
+    */
+    int wait();
+
+    /** Return if pipes to processes are supported */
+    static bool supported();
+
+private:
+    class Impl;
+    Impl* impl_;
+};
+
+}
+
+#endif
+
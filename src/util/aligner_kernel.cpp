@@ -0,0 +1,257 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <climits>
+#include <algorithm>
+
+#include "aligner_kernel.hpp"
+#include "throw_assert.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NPGE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace npge {
+
+// values of GeneralAligner::Track
+const int TRACK_MATCH = 0;
+const int TRACK_ROW_INC = +1;
+const int TRACK_COL_INC = -1;
+
+// value of lanes shifted in by prefix scan
+const int SCAN_INF = INT_MAX / 4;
+
+static void fill_vertical_tail(int* score, const int* up,
+                               const int* subst, int* match,
+                               int begin, int length,
+                               int gap_penalty, bool local) {
+    for (int c = begin; c < length; c++) {
+        int m = up[c - 1] + subst[c];
+        match[c] = m;
+        int t = std::min(m, up[c] + gap_penalty);
+        if (local) {
+            t = std::min(t, 0);
+        }
+        score[c] = t;
+    }
+}
+
+static void scan_tail(int* score, int begin, int length,
+                      int gap_penalty) {
+    int s = score[begin - 1];
+    for (int c = begin; c < length; c++) {
+        s = std::min(score[c], s + gap_penalty);
+        score[c] = s;
+    }
+}
+
+static void track_tail(const int* score, int* track,
+                       const int* match, int begin, int length,
+                       int gap_penalty) {
+    for (int c = begin; c < length; c++) {
+        int gap1 = score[c - 1] + gap_penalty;
+        track[c] = (score[c] == match[c]) ? TRACK_MATCH :
+                   (score[c] == gap1) ? TRACK_COL_INC :
+                   TRACK_ROW_INC;
+    }
+}
+
+static void fill_row_scalar(int* score, int* track, const int* up,
+                            const int* subst, int* match, int length,
+                            int gap_penalty, bool local) {
+    fill_vertical_tail(score, up, subst, match, 0, length,
+                       gap_penalty, local);
+    scan_tail(score, 0, length, gap_penalty);
+    track_tail(score, track, match, 0, length, gap_penalty);
+}
+
+#ifdef NPGE_X86_KERNELS
+
+__attribute__((target("sse4.1")))
+static void fill_row_sse41(int* score, int* track, const int* up,
+                           const int* subst, int* match, int length,
+                           int gap_penalty, bool local) {
+    const int W = 4;
+    const __m128i g1 = _mm_set1_epi32(gap_penalty);
+    const __m128i g2 = _mm_set1_epi32(gap_penalty * 2);
+    const __m128i steps = _mm_mullo_epi32(_mm_setr_epi32(1, 2, 3, 4),
+                                          g1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i inf = _mm_set1_epi32(SCAN_INF);
+    int c = 0;
+    for (; c + W <= length; c += W) {
+        __m128i diag = _mm_loadu_si128((const __m128i*)(up + c - 1));
+        __m128i u = _mm_loadu_si128((const __m128i*)(up + c));
+        __m128i s = _mm_loadu_si128((const __m128i*)(subst + c));
+        __m128i m = _mm_add_epi32(diag, s);
+        _mm_storeu_si128((__m128i*)(match + c), m);
+        __m128i t = _mm_min_epi32(m, _mm_add_epi32(u, g1));
+        if (local) {
+            t = _mm_min_epi32(t, zero);
+        }
+        _mm_storeu_si128((__m128i*)(score + c), t);
+    }
+    fill_vertical_tail(score, up, subst, match, c, length,
+                       gap_penalty, local);
+    c = 0;
+    for (; c + W <= length; c += W) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(score + c));
+        // lanes shifted by 1 and 2, INF shifted in
+        __m128i v1 = _mm_alignr_epi8(v, inf, 12);
+        v = _mm_min_epi32(v, _mm_add_epi32(v1, g1));
+        __m128i v2 = _mm_alignr_epi8(v, inf, 8);
+        v = _mm_min_epi32(v, _mm_add_epi32(v2, g2));
+        __m128i carry = _mm_set1_epi32(score[c - 1]);
+        v = _mm_min_epi32(v, _mm_add_epi32(carry, steps));
+        _mm_storeu_si128((__m128i*)(score + c), v);
+    }
+    scan_tail(score, c, length, gap_penalty);
+    const __m128i match_t = _mm_set1_epi32(TRACK_MATCH);
+    const __m128i row_t = _mm_set1_epi32(TRACK_ROW_INC);
+    const __m128i col_t = _mm_set1_epi32(TRACK_COL_INC);
+    c = 0;
+    for (; c + W <= length; c += W) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(score + c));
+        __m128i left = _mm_loadu_si128((const __m128i*)(score + c - 1));
+        __m128i m = _mm_loadu_si128((const __m128i*)(match + c));
+        __m128i eq_match = _mm_cmpeq_epi32(s, m);
+        __m128i eq_gap1 = _mm_cmpeq_epi32(s, _mm_add_epi32(left, g1));
+        __m128i t = _mm_blendv_epi8(row_t, col_t, eq_gap1);
+        t = _mm_blendv_epi8(t, match_t, eq_match);
+        _mm_storeu_si128((__m128i*)(track + c), t);
+    }
+    track_tail(score, track, match, c, length, gap_penalty);
+}
+
+__attribute__((target("avx2")))
+static void fill_row_avx2(int* score, int* track, const int* up,
+                          const int* subst, int* match, int length,
+                          int gap_penalty, bool local) {
+    const int W = 8;
+    const __m256i g1 = _mm256_set1_epi32(gap_penalty);
+    const __m256i g2 = _mm256_set1_epi32(gap_penalty * 2);
+    const __m256i g4 = _mm256_set1_epi32(gap_penalty * 4);
+    const __m256i steps = _mm256_mullo_epi32(
+                              _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 8),
+                              g1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i inf = _mm256_set1_epi32(SCAN_INF);
+    const __m256i shift1 = _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6);
+    const __m256i shift2 = _mm256_setr_epi32(0, 0, 0, 1, 2, 3, 4, 5);
+    const __m256i shift4 = _mm256_setr_epi32(0, 0, 0, 0, 0, 1, 2, 3);
+    int c = 0;
+    for (; c + W <= length; c += W) {
+        __m256i diag = _mm256_loadu_si256((const __m256i*)(up + c - 1));
+        __m256i u = _mm256_loadu_si256((const __m256i*)(up + c));
+        __m256i s = _mm256_loadu_si256((const __m256i*)(subst + c));
+        __m256i m = _mm256_add_epi32(diag, s);
+        _mm256_storeu_si256((__m256i*)(match + c), m);
+        __m256i t = _mm256_min_epi32(m, _mm256_add_epi32(u, g1));
+        if (local) {
+            t = _mm256_min_epi32(t, zero);
+        }
+        _mm256_storeu_si256((__m256i*)(score + c), t);
+    }
+    fill_vertical_tail(score, up, subst, match, c, length,
+                       gap_penalty, local);
+    c = 0;
+    for (; c + W <= length; c += W) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(score + c));
+        // lanes shifted by 1, 2 and 4, INF shifted in
+        __m256i v1 = _mm256_blend_epi32(
+                         _mm256_permutevar8x32_epi32(v, shift1), inf, 0x01);
+        v = _mm256_min_epi32(v, _mm256_add_epi32(v1, g1));
+        __m256i v2 = _mm256_blend_epi32(
+                         _mm256_permutevar8x32_epi32(v, shift2), inf, 0x03);
+        v = _mm256_min_epi32(v, _mm256_add_epi32(v2, g2));
+        __m256i v4 = _mm256_blend_epi32(
+                         _mm256_permutevar8x32_epi32(v, shift4), inf, 0x0F);
+        v = _mm256_min_epi32(v, _mm256_add_epi32(v4, g4));
+        __m256i carry = _mm256_set1_epi32(score[c - 1]);
+        v = _mm256_min_epi32(v, _mm256_add_epi32(carry, steps));
+        _mm256_storeu_si256((__m256i*)(score + c), v);
+    }
+    scan_tail(score, c, length, gap_penalty);
+    const __m256i match_t = _mm256_set1_epi32(TRACK_MATCH);
+    const __m256i row_t = _mm256_set1_epi32(TRACK_ROW_INC);
+    const __m256i col_t = _mm256_set1_epi32(TRACK_COL_INC);
+    c = 0;
+    for (; c + W <= length; c += W) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(score + c));
+        __m256i left = _mm256_loadu_si256((const __m256i*)(score + c - 1));
+        __m256i m = _mm256_loadu_si256((const __m256i*)(match + c));
+        __m256i eq_match = _mm256_cmpeq_epi32(s, m);
+        __m256i eq_gap1 = _mm256_cmpeq_epi32(s,
+                                             _mm256_add_epi32(left, g1));
+        __m256i t = _mm256_blendv_epi8(row_t, col_t, eq_gap1);
+        t = _mm256_blendv_epi8(t, match_t, eq_match);
+        _mm256_storeu_si256((__m256i*)(track + c), t);
+    }
+    track_tail(score, track, match, c, length, gap_penalty);
+}
+
+static AlignerKernel detect_kernel() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return AVX2_KERNEL;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return SSE41_KERNEL;
+    }
+    return SCALAR_KERNEL;
+}
+
+#else
+
+static AlignerKernel detect_kernel() {
+    return SCALAR_KERNEL;
+}
+
+#endif
+
+AlignerKernel best_aligner_kernel() {
+    static AlignerKernel kernel = detect_kernel();
+    return kernel;
+}
+
+bool aligner_kernel_supported(AlignerKernel kernel) {
+    return kernel <= best_aligner_kernel();
+}
+
+const char* aligner_kernel_name(AlignerKernel kernel) {
+    if (kernel == AVX2_KERNEL) {
+        return "avx2";
+    } else if (kernel == SSE41_KERNEL) {
+        return "sse4.1";
+    } else {
+        return "scalar";
+    }
+}
+
+void aligner_fill_row(int* score, int* track, const int* up,
+                      const int* subst, int* match, int length,
+                      int gap_penalty, bool local,
+                      AlignerKernel kernel) {
+    ASSERT_TRUE(aligner_kernel_supported(kernel));
+#ifdef NPGE_X86_KERNELS
+    if (kernel == AVX2_KERNEL) {
+        fill_row_avx2(score, track, up, subst, match, length,
+                      gap_penalty, local);
+        return;
+    } else if (kernel == SSE41_KERNEL) {
+        fill_row_sse41(score, track, up, subst, match, length,
+                       gap_penalty, local);
+        return;
+    }
+#endif
+    fill_row_scalar(score, track, up, subst, match, length,
+                    gap_penalty, local);
+}
+
+}
+
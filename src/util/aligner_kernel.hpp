@@ -0,0 +1,65 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef NPGE_ALIGNER_KERNEL_HPP_
+#define NPGE_ALIGNER_KERNEL_HPP_
+
+namespace npge {
+
+/** Implementation of aligner_fill_row() */
+enum AlignerKernel {
+    SCALAR_KERNEL,
+    SSE41_KERNEL,
+    AVX2_KERNEL
+};
+
+/** Return the best kernel supported by the processor.
+Result is detected once at runtime.
+*/
+AlignerKernel best_aligner_kernel();
+
+/** Return if the kernel is supported by the processor */
+bool aligner_kernel_supported(AlignerKernel kernel);
+
+/** Return name of kernel ("scalar", "sse4.1" or "avx2") */
+const char* aligner_kernel_name(AlignerKernel kernel);
+
+/** Fill cells of one row of GeneralAligner's matrix.
+
+The recurrence is the same as in GeneralAligner::align():
+\code
+match = diag + subst;
+gap1 = left + gap_penalty;
+gap2 = up + gap_penalty;
+score = min(match, gap1, gap2); // and 0 if local
+track = score == match ? MATCH : score == gap1 ? COL_INC : ROW_INC;
+\endcode
+
+Vertical part (match, gap2) is computed for all cells at once,
+horizontal part (gap1) is computed by prefix minimum scan.
+Results are identical to the scalar loop for all kernels.
+
+\param score Scores of the row, score[-1] is left border (input),
+    score[0..length-1] are output.
+\param track Track of the row (output, values of GeneralAligner::Track).
+\param up Scores of previous row, up[-1..length-1].
+\param subst Substitution scores, subst[0..length-1].
+\param match Buffer of length cells.
+\param length Number of cells.
+\param gap_penalty Gap penalty.
+\param local If local alignment is used.
+\param kernel Implementation (must be supported).
+*/
+void aligner_fill_row(int* score, int* track, const int* up,
+                      const int* subst, int* match, int length,
+                      int gap_penalty, bool local,
+                      AlignerKernel kernel = best_aligner_kernel());
+
+}
+
+#endif
+
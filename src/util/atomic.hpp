@@ -0,0 +1,62 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef NPGE_ATOMIC_HPP_
+#define NPGE_ATOMIC_HPP_
+
+namespace npge {
+
+/** Atomically OR value into target, return old value of target.
+Full memory barrier.
+*/
+template<typename T>
+inline T atomic_fetch_or(volatile T* target, T value) {
+    return __sync_fetch_and_or(target, value);
+}
+
+/** Atomically add value to target, return old value of target.
+Full memory barrier.
+*/
+template<typename T>
+inline T atomic_fetch_add(volatile T* target, T value) {
+    return __sync_fetch_and_add(target, value);
+}
+
+/** Atomically replace target with new_value if it equals old_value.
+Return true if target was replaced.
+Full memory barrier.
+*/
+template<typename T>
+inline bool atomic_cas(volatile T* target, T old_value, T new_value) {
+    return __sync_bool_compare_and_swap(target, old_value, new_value);
+}
+
+/** Read target, which may be modified by other threads.
+Full memory barrier.
+*/
+template<typename T>
+inline T atomic_load(const volatile T* target) {
+    __sync_synchronize();
+    T result = *target;
+    __sync_synchronize();
+    return result;
+}
+
+/** Write target, which may be read by other threads.
+Full memory barrier.
+*/
+template<typename T>
+inline void atomic_store(volatile T* target, T value) {
+    __sync_synchronize();
+    *target = value;
+    __sync_synchronize();
+}
+
+}
+
+#endif
+
@@ -107,6 +107,17 @@ inline hash_t reuse_hash(hash_t old_hash, pos_t length,
     return old_hash;
 }
 
+/** Mix bits of hash value (splitmix64 finalizer).
+Hashes of short fragments occupy only low bits of hash_t.
+Use this function to get well distributed value,
+e.g. to select a bucket of hash table.
+*/
+inline hash_t mix_hash(hash_t z) {
+    z = (z ^ (z >> 30)) * hash_t(0xbf58476d1ce4e5b9ULL);
+    z = (z ^ (z >> 27)) * hash_t(0x94d049bb133111ebULL);
+    return z ^ (z >> 31);
+}
+
 }
 
 #endif
@@ -0,0 +1,104 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include "rank_select.hpp"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define NPGE_X86_RANK_SELECT
+#include <immintrin.h>
+#endif
+
+namespace npge {
+
+static int popcount64_generic(uint64_t word) {
+    word = word - ((word >> 1) & 0x5555555555555555ULL);
+    word = (word & 0x3333333333333333ULL) +
+           ((word >> 2) & 0x3333333333333333ULL);
+    word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (word * 0x0101010101010101ULL) >> 56;
+}
+
+static int select64_generic(uint64_t word, int rank) {
+    // skip whole bytes, then bits of the byte
+    int shift = 0;
+    while (true) {
+        int ones = popcount64_generic(word & 0xFF);
+        if (rank < ones) {
+            break;
+        }
+        rank -= ones;
+        word >>= 8;
+        shift += 8;
+    }
+    while (true) {
+        if (word & 1) {
+            if (rank == 0) {
+                return shift;
+            }
+            rank -= 1;
+        }
+        word >>= 1;
+        shift += 1;
+    }
+}
+
+#ifdef NPGE_X86_RANK_SELECT
+
+__attribute__((target("popcnt")))
+static int popcount64_hw(uint64_t word) {
+    return _mm_popcnt_u64(word);
+}
+
+__attribute__((target("bmi,bmi2")))
+static int select64_hw(uint64_t word, int rank) {
+    return _tzcnt_u64(_pdep_u64(uint64_t(1) << rank, word));
+}
+
+static bool detect_popcnt() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("popcnt");
+}
+
+static bool detect_bmi2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2");
+}
+
+static const bool HAS_POPCNT = detect_popcnt();
+static const bool HAS_BMI2 = detect_bmi2();
+
+int popcount64(uint64_t word) {
+    return HAS_POPCNT ? popcount64_hw(word) : popcount64_generic(word);
+}
+
+int select64(uint64_t word, int rank) {
+    return HAS_BMI2 ? select64_hw(word, rank) :
+           select64_generic(word, rank);
+}
+
+bool rank_select_hardware() {
+    return HAS_POPCNT && HAS_BMI2;
+}
+
+#else
+
+int popcount64(uint64_t word) {
+    return popcount64_generic(word);
+}
+
+int select64(uint64_t word, int rank) {
+    return select64_generic(word, rank);
+}
+
+bool rank_select_hardware() {
+    return false;
+}
+
+#endif
+
+}
+
@@ -0,0 +1,33 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef NPGE_RANK_SELECT_HPP_
+#define NPGE_RANK_SELECT_HPP_
+
+#include <stdint.h>
+
+namespace npge {
+
+/** Return number of set bits in the word.
+Hardware popcount is used if supported by the processor.
+*/
+int popcount64(uint64_t word);
+
+/** Return position of set bit number rank in the word.
+Bits are counted from the lowest one, rank is 0-based.
+The word must have more than rank set bits.
+PDEP instruction (BMI2) is used if supported by the processor.
+*/
+int select64(uint64_t word, int rank);
+
+/** Return if popcount64() and select64() use special instructions */
+bool rank_select_hardware();
+
+}
+
+#endif
+
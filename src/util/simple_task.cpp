@@ -5,6 +5,9 @@
  * See the LICENSE file for terms of use.
  */
 
+#include <algorithm>
+#include <boost/bind.hpp>
+
 #include "simple_task.hpp"
 #include "thread_pool.hpp"
 
@@ -103,5 +106,22 @@ TaskGenerator tasks_to_generator(Tasks& tasks) {
     return TaskGenerator(task_generator);
 }
 
+void spawn_ranges(int size, int min_part, RangeTask task) {
+    ThreadWorker* worker = ThreadWorker::current();
+    int workers = worker ? worker->thread_group()->workers() : 1;
+    // several parts per worker for load balancing
+    int parts = std::min(4 * workers, size / std::max(min_part, 1));
+    if (workers == 1 || parts <= 1) {
+        task(0, size);
+        return;
+    }
+    SpawnedTasks subtasks;
+    for (int p = 0; p < parts; p++) {
+        int first = size * p / parts;
+        int last = size * (p + 1) / parts;
+        subtasks.spawn(boost::bind(task, first, last));
+    }
+    subtasks.wait();
 }
 
+}
@@ -33,6 +33,20 @@ typedef std::vector<Task> Tasks;
 /** Create task generator operating on the tasks list */
 TaskGenerator tasks_to_generator(Tasks& tasks);
 
+/** Task applied to indices first <= i < last */
+typedef boost::function<void(int first, int last)> RangeTask;
+
+/** Split indices 0 <= i < size into parts and apply task to them.
+If current thread is a worker of thread group with several
+workers, parts are spawned (see SpawnedTasks) and can be
+run by idle workers of the group. Otherwise the task is
+applied to all indices at once in current thread.
+This is used to parallelize work inside a big block.
+\param min_part Min number of indices in one part.
+Errors are rethrown as Exception after all parts are done.
+*/
+void spawn_ranges(int size, int min_part, RangeTask task);
+
 }
 
 #endif
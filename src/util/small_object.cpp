@@ -0,0 +1,211 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#include <new>
+
+#include "config.hpp"
+#include "small_object.hpp"
+
+#ifdef NPGE_POOL_ALLOC
+
+#include <vector>
+#include <utility>
+#include "boost-xtime.hpp"
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+namespace npge {
+
+const size_t GRANULARITY = 16;
+const size_t MAX_SIZE = 256;
+const int CLASSES = MAX_SIZE / GRANULARITY;
+const size_t CHUNK_SIZE = 64 * 1024;
+
+// number of blocks moved between thread and global pool at once
+const int BATCH = 64;
+
+struct FreeNode {
+    FreeNode* next_;
+};
+
+struct FreeList {
+    FreeNode* head_;
+    int size_;
+
+    FreeList():
+        head_(0), size_(0) {
+    }
+
+    void push(void* ptr) {
+        FreeNode* node = reinterpret_cast<FreeNode*>(ptr);
+        node->next_ = head_;
+        head_ = node;
+        size_ += 1;
+    }
+
+    void* pop() {
+        FreeNode* node = head_;
+        head_ = node->next_;
+        size_ -= 1;
+        return node;
+    }
+
+    // detach first n nodes
+    FreeNode* cut(int n) {
+        FreeNode* first = head_;
+        FreeNode* last = head_;
+        for (int i = 1; i < n; i++) {
+            last = last->next_;
+        }
+        head_ = last->next_;
+        last->next_ = 0;
+        size_ -= n;
+        return first;
+    }
+};
+
+typedef std::pair<FreeNode*, int> Batch;
+
+class GlobalPool {
+public:
+    GlobalPool():
+        chunk_pos_(0), chunk_end_(0) {
+    }
+
+    void get_batch(int cls, FreeList& list) {
+        boost::mutex::scoped_lock lock(mutex_);
+        std::vector<Batch>& batches = batches_[cls];
+        if (!batches.empty()) {
+            list.head_ = batches.back().first;
+            list.size_ = batches.back().second;
+            batches.pop_back();
+            return;
+        }
+        size_t size = (cls + 1) * GRANULARITY;
+        for (int i = 0; i < BATCH; i++) {
+            if (chunk_pos_ + size > chunk_end_) {
+                // rest of old chunk is lost
+                chunk_pos_ = static_cast<char*>(
+                                 ::operator new(CHUNK_SIZE));
+                chunk_end_ = chunk_pos_ + CHUNK_SIZE;
+            }
+            list.push(chunk_pos_);
+            chunk_pos_ += size;
+        }
+    }
+
+    void put_batch(int cls, FreeNode* head, int size) {
+        boost::mutex::scoped_lock lock(mutex_);
+        batches_[cls].push_back(Batch(head, size));
+    }
+
+private:
+    boost::mutex mutex_;
+    std::vector<Batch> batches_[CLASSES];
+    char* chunk_pos_;
+    char* chunk_end_;
+};
+
+// pools are never destroyed, because objects can be
+// deleted by destructors of static objects
+static GlobalPool* global_pool() {
+    static GlobalPool* pool = new GlobalPool;
+    return pool;
+}
+
+class ThreadCache {
+public:
+    FreeList lists_[CLASSES];
+
+    ~ThreadCache() {
+        // called when thread exits
+        for (int cls = 0; cls < CLASSES; cls++) {
+            FreeList& list = lists_[cls];
+            if (list.size_) {
+                global_pool()->put_batch(cls, list.head_, list.size_);
+            }
+        }
+    }
+};
+
+typedef boost::thread_specific_ptr<ThreadCache> TssCache;
+
+static TssCache* tss_cache() {
+    static TssCache* tss = new TssCache;
+    return tss;
+}
+
+static ThreadCache* thread_cache() {
+    TssCache* tss = tss_cache();
+    ThreadCache* cache = tss->get();
+    if (!cache) {
+        cache = new ThreadCache;
+        tss->reset(cache);
+    }
+    return cache;
+}
+
+static int size_class(size_t size) {
+    return (size - 1) / GRANULARITY;
+}
+
+void* small_object_allocate(size_t size) {
+    if (size == 0 || size > MAX_SIZE) {
+        return ::operator new(size);
+    }
+    int cls = size_class(size);
+    FreeList& list = thread_cache()->lists_[cls];
+    if (!list.head_) {
+        global_pool()->get_batch(cls, list);
+    }
+    return list.pop();
+}
+
+void small_object_deallocate(void* ptr, size_t size) {
+    if (!ptr) {
+        return;
+    }
+    if (size == 0 || size > MAX_SIZE) {
+        ::operator delete(ptr);
+        return;
+    }
+    int cls = size_class(size);
+    FreeList& list = thread_cache()->lists_[cls];
+    list.push(ptr);
+    if (list.size_ >= 2 * BATCH) {
+        // memory freed by this thread can be reused by others
+        FreeNode* head = list.cut(BATCH);
+        global_pool()->put_batch(cls, head, BATCH);
+    }
+}
+
+bool small_object_pools() {
+    return true;
+}
+
+}
+
+#else
+
+namespace npge {
+
+void* small_object_allocate(size_t size) {
+    return ::operator new(size);
+}
+
+void small_object_deallocate(void* ptr, size_t) {
+    ::operator delete(ptr);
+}
+
+bool small_object_pools() {
+    return false;
+}
+
+}
+
+#endif
+
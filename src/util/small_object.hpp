@@ -0,0 +1,39 @@
+/*
+ * NPG-explorer, Nucleotide PanGenome explorer
+ * Copyright (C) 2012-2016 Boris Nagaev
+ *
+ * See the LICENSE file for terms of use.
+ */
+
+#ifndef NPGE_SMALL_OBJECT_HPP_
+#define NPGE_SMALL_OBJECT_HPP_
+
+#include <cstddef>
+
+namespace npge {
+
+/** Allocate memory for small object.
+If NPGE_POOL_ALLOC is defined, objects up to 256 bytes
+are allocated from pools of blocks of fixed size.
+Each thread keeps free lists of its own and exchanges
+batches of blocks with global pool, so most of allocations
+and deallocations take no lock and no call of malloc/free.
+Memory of pools is reused but never returned to the system.
+
+Otherwise global operator new is called.
+*/
+void* small_object_allocate(size_t size);
+
+/** Free memory, allocated by small_object_allocate().
+Size must be equal to the size passed to small_object_allocate().
+The memory can be freed in any thread.
+*/
+void small_object_deallocate(void* ptr, size_t size);
+
+/** Return if pools are used by small_object_allocate() */
+bool small_object_pools();
+
+}
+
+#endif
+
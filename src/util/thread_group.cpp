@@ -6,13 +6,17 @@
  */
 
 #include <vector>
+#include <deque>
 #include "boost-xtime.hpp"
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/tss.hpp>
 
 #include "thread_group.hpp"
+#include "atomic.hpp"
 #include "Exception.hpp"
 #include "throw_assert.hpp"
 
@@ -40,14 +44,33 @@ ThreadGroup* ThreadTask::thread_group() const {
 }
 
 ThreadWorker::ThreadWorker(ThreadGroup* thread_group):
-    thread_group_(thread_group) {
+    thread_group_(thread_group), index_(-1) {
 }
 
 ThreadWorker::~ThreadWorker() {
     thread_group()->check_worker(this);
 }
 
+static void do_nothing(ThreadWorker*) {
+}
+
+static boost::thread_specific_ptr<ThreadWorker> tss_worker_(do_nothing);
+
+struct CurrentWorkerKeeper {
+    ThreadWorker* prev_;
+
+    CurrentWorkerKeeper(ThreadWorker* worker):
+        prev_(tss_worker_.get()) {
+        tss_worker_.reset(worker);
+    }
+
+    ~CurrentWorkerKeeper() {
+        tss_worker_.reset(prev_);
+    }
+};
+
 void ThreadWorker::perform() {
+    CurrentWorkerKeeper keeper(this);
     perform_impl();
 }
 
@@ -67,6 +90,10 @@ const std::string& ThreadWorker::error_message() const {
     return error_message_;
 }
 
+ThreadWorker* ThreadWorker::current() {
+    return tss_worker_.get();
+}
+
 void ThreadWorker::perform_impl() {
     if (thread_group()->workers() == 1) {
         work();
@@ -82,28 +109,77 @@ void ThreadWorker::perform_impl() {
 }
 
 void ThreadWorker::work_impl() {
+    ThreadGroup* group = thread_group();
     while (true) {
+        if (group->run_spawned(this)) {
+            continue;
+        }
         typedef boost::scoped_ptr<ThreadTask> ThreadTaskPtr;
-        ThreadTaskPtr task(thread_group()->create_task(this));
+        ThreadTaskPtr task(group->create_task(this));
         if (task) {
-            run(task.get());
+            try {
+                run(task.get());
+            } catch (...) {
+                group->task_finished();
+                throw;
+            }
+            group->task_finished();
         } else {
             break;
         }
     }
+    group->help(this);
 }
 
 void ThreadWorker::run_impl(ThreadTask* task) {
     task->run();
 }
 
+typedef boost::mutex Mutex;
+typedef boost::mutex::scoped_lock Lock;
+
+struct SpawnedTask {
+    Task task_;
+    SpawnedTasks* owner_;
+
+    SpawnedTask(const Task& task = Task(), SpawnedTasks* owner = 0):
+        task_(task), owner_(owner) {
+    }
+};
+
+struct SpawnedQueue {
+    Mutex mutex_;
+    std::deque<SpawnedTask> tasks_;
+};
+
+typedef boost::shared_ptr<SpawnedQueue> SpawnedQueuePtr;
+
 struct ThreadGroup::Impl {
     boost::mutex mutex_;
     int workers_;
     std::string error_message_;
 
+    // queues of spawned tasks, one per worker
+    std::vector<SpawnedQueuePtr> queues_;
+    int next_index_;
+
+    volatile int queued_; // spawned tasks in queues
+    volatile int busy_; // tasks being run
+    volatile int owners_; // existing SpawnedTasks
+    volatile int sleeping_; // workers waiting for idle_condition_
+    Mutex idle_mutex_;
+    boost::condition_variable idle_condition_;
+
     Impl():
-        workers_(1) {
+        workers_(1), next_index_(0),
+        queued_(0), busy_(0), owners_(0), sleeping_(0) {
+    }
+
+    void notify_idle() {
+        if (atomic_load(&sleeping_) > 0) {
+            Lock lock(idle_mutex_);
+            idle_condition_.notify_all();
+        }
     }
 };
 
@@ -119,6 +195,13 @@ ThreadGroup::~ThreadGroup() {
 void ThreadGroup::perform() {
     ASSERT_GTE(workers(), 1);
     impl_->error_message_ = "";
+    impl_->queues_.clear();
+    if (workers() > 1) {
+        for (int i = 0; i < workers(); i++) {
+            impl_->queues_.push_back(SpawnedQueuePtr(new SpawnedQueue));
+        }
+    }
+    impl_->next_index_ = 0;
     perform_impl();
     if (!impl_->error_message_.empty()) {
         throw Exception(impl_->error_message_);
@@ -130,16 +213,27 @@ ThreadTask* ThreadGroup::create_task(ThreadWorker* worker) {
     if (!impl_->error_message_.empty()) {
         return 0;
     }
+    ThreadTask* task;
     if (workers() == 1) {
-        return create_task_impl(worker);
+        task = create_task_impl(worker);
     } else {
         boost::mutex::scoped_lock lock(impl_->mutex_);
-        return create_task_impl(worker);
+        task = create_task_impl(worker);
     }
+    if (task) {
+        // decreased by task_finished()
+        atomic_fetch_add(&impl_->busy_, 1);
+    }
+    return task;
 }
 
 ThreadWorker* ThreadGroup::create_worker() {
-    return create_worker_impl();
+    ThreadWorker* worker = create_worker_impl();
+    if (impl_->next_index_ < impl_->queues_.size()) {
+        worker->index_ = impl_->next_index_;
+        impl_->next_index_ += 1;
+    }
+    return worker;
 }
 
 void ThreadGroup::check_worker(ThreadWorker* worker) {
@@ -158,6 +252,156 @@ int ThreadGroup::workers() const {
     }
 }
 
+bool ThreadGroup::run_spawned(ThreadWorker* worker) {
+    if (worker->index_ == -1 || atomic_load(&impl_->queued_) == 0) {
+        return false;
+    }
+    int n = impl_->queues_.size();
+    SpawnedTask spawned;
+    for (int i = 0; i < n && !spawned.owner_; i++) {
+        SpawnedQueue& queue = *impl_->queues_[(worker->index_ + i) % n];
+        Lock lock(queue.mutex_);
+        if (!queue.tasks_.empty()) {
+            if (i == 0) {
+                spawned = queue.tasks_.back();
+                queue.tasks_.pop_back();
+            } else {
+                spawned = queue.tasks_.front();
+                queue.tasks_.pop_front();
+            }
+            // increase busy_ first not to show idle state
+            atomic_fetch_add(&impl_->busy_, 1);
+            atomic_fetch_add(&impl_->queued_, -1);
+        }
+    }
+    if (!spawned.owner_) {
+        return false;
+    }
+    SpawnedTasks* owner = spawned.owner_;
+    owner->run_one(spawned.task_);
+    if (atomic_fetch_add(&owner->pending_, -1) == 1) {
+        // owner can be deleted after this
+        impl_->notify_idle();
+    }
+    task_finished();
+    return true;
+}
+
+bool ThreadGroup::push_spawned(ThreadWorker* worker, const Task& task,
+                               SpawnedTasks* owner) {
+    if (worker->index_ == -1) {
+        return false;
+    }
+    SpawnedQueue& queue = *impl_->queues_[worker->index_];
+    atomic_fetch_add(&owner->pending_, 1);
+    {
+        Lock lock(queue.mutex_);
+        queue.tasks_.push_back(SpawnedTask(task, owner));
+        atomic_fetch_add(&impl_->queued_, 1);
+    }
+    impl_->notify_idle();
+    return true;
+}
+
+void ThreadGroup::help(ThreadWorker* worker) {
+    if (worker->index_ == -1) {
+        return;
+    }
+    while (true) {
+        if (run_spawned(worker)) {
+            continue;
+        }
+        Lock lock(impl_->idle_mutex_);
+        atomic_fetch_add(&impl_->sleeping_, 1);
+        // linger only while some task can spawn subtasks
+        bool has_tasks = atomic_load(&impl_->queued_) > 0;
+        bool done = !has_tasks && (atomic_load(&impl_->busy_) == 0 ||
+                                   atomic_load(&impl_->owners_) == 0);
+        if (!has_tasks && !done) {
+            impl_->idle_condition_.wait(lock);
+        }
+        atomic_fetch_add(&impl_->sleeping_, -1);
+        if (done) {
+            break;
+        }
+    }
+}
+
+void ThreadGroup::wait_spawned(ThreadWorker* worker,
+                               SpawnedTasks* owner) {
+    while (atomic_load(&owner->pending_) > 0) {
+        if (run_spawned(worker)) {
+            continue;
+        }
+        // remaining tasks are being run by other workers
+        Lock lock(impl_->idle_mutex_);
+        atomic_fetch_add(&impl_->sleeping_, 1);
+        if (atomic_load(&owner->pending_) > 0 &&
+                atomic_load(&impl_->queued_) == 0) {
+            impl_->idle_condition_.wait(lock);
+        }
+        atomic_fetch_add(&impl_->sleeping_, -1);
+    }
+}
+
+void ThreadGroup::task_finished() {
+    if (atomic_fetch_add(&impl_->busy_, -1) == 1) {
+        impl_->notify_idle();
+    }
+}
+
+SpawnedTasks::SpawnedTasks():
+    worker_(ThreadWorker::current()),
+    group_(worker_ ? worker_->thread_group() : 0),
+    pending_(0), failed_(0) {
+    if (group_) {
+        atomic_fetch_add(&group_->impl_->owners_, 1);
+    }
+}
+
+SpawnedTasks::~SpawnedTasks() {
+    try {
+        wait();
+    } catch (...) {
+    }
+    if (group_ && atomic_fetch_add(&group_->impl_->owners_, -1) == 1) {
+        group_->impl_->notify_idle();
+    }
+}
+
+void SpawnedTasks::spawn(const Task& task) {
+    if (!group_ || !group_->push_spawned(worker_, task, this)) {
+        run_one(task);
+    }
+}
+
+void SpawnedTasks::wait() {
+    if (group_) {
+        group_->wait_spawned(worker_, this);
+    }
+    if (atomic_load(&failed_)) {
+        std::string message = error_message_;
+        error_message_.clear();
+        atomic_store(&failed_, 0);
+        throw Exception(message);
+    }
+}
+
+void SpawnedTasks::run_one(const Task& task) {
+    std::string message;
+    try {
+        task();
+        return;
+    } catch (std::exception& e) {
+        message = e.what();
+    } catch (...) {
+        message = "unknown error";
+    }
+    if (atomic_cas(&failed_, 0, 1)) {
+        error_message_ = message;
+    }
+}
+
 struct AllJoiner {
     boost::thread_group& threads_;
 
@@ -9,12 +9,16 @@
 #define NPGE_THREAD_GROUP_HPP_
 
 #include <string>
+#include <boost/utility.hpp>
+
+#include "simple_task.hpp"
 
 namespace npge {
 
 class ThreadTask;
 class ThreadWorker;
 class ThreadGroup;
+class SpawnedTasks;
 
 /** ThreadTask to run */
 class ThreadTask {
@@ -71,6 +75,9 @@ public:
     /** Get error message */
     const std::string& error_message() const;
 
+    /** Return worker running in current thread or 0 */
+    static ThreadWorker* current();
+
 protected:
     /** Run work() under try-catch if workers() >= 2 */
     virtual void perform_impl();
@@ -89,6 +96,9 @@ protected:
 private:
     ThreadGroup* thread_group_;
     std::string error_message_;
+    int index_; // index of queue of spawned tasks
+
+    friend class ThreadGroup;
 };
 
 /** Main class for running work */
@@ -108,6 +118,9 @@ public:
     Get mutes and call create_task_impl().
     Caller takes ownership.
     Calls check_worker.
+    The task is counted as running until ThreadWorker
+    has run it (idle workers wait for running tasks,
+    which can spawn subtasks).
     */
     ThreadTask* create_task(ThreadWorker* worker);
 
@@ -130,6 +143,14 @@ public:
     */
     int workers() const;
 
+    /** Run one of spawned tasks (see SpawnedTasks).
+    Tasks from the queue of the worker are taken first
+    (last spawned first), then tasks are stolen from
+    queues of other workers (first spawned first).
+    Return false if queues are empty.
+    */
+    bool run_spawned(ThreadWorker* worker);
+
 protected:
     /* With each call, return new task or empty function.
     Result=0 means "end" of task collection.
@@ -157,6 +178,66 @@ protected:
 private:
     struct Impl;
     Impl* impl_;
+
+    bool push_spawned(ThreadWorker* worker, const Task& task,
+                      SpawnedTasks* owner);
+
+    void help(ThreadWorker* worker);
+
+    void wait_spawned(ThreadWorker* worker, SpawnedTasks* owner);
+
+    void task_finished();
+
+    friend class ThreadWorker;
+    friend class SpawnedTasks;
+};
+
+/** Subtasks spawned by a running task (nested parallelism).
+Subtasks are put to the queue of current worker
+(ThreadWorker::current()) and are run by this worker
+while it waits for them, or by idle workers of the
+same thread group, which steal them.
+Workers which have finished tasks from create_task()
+steal spawned tasks while some SpawnedTasks exist
+and other workers are busy.
+Tasks from create_task() are never stolen, since they
+may use data of their worker.
+If there is no current worker or the thread group
+has one worker, subtasks are run immediately.
+
+Subtasks can be run by other threads, so they must not
+depend on thread-local data (e.g. Meta::instance()).
+Errors of subtasks are caught; message of first error
+is rethrown from wait() as Exception.
+*/
+class SpawnedTasks : boost::noncopyable {
+public:
+    /** Constructor */
+    SpawnedTasks();
+
+    /** Destructor.
+    Waits for remaining subtasks, errors are ignored.
+    */
+    ~SpawnedTasks();
+
+    /** Spawn subtask */
+    void spawn(const Task& task);
+
+    /** Wait for all subtasks.
+    Current thread runs spawned tasks meanwhile.
+    */
+    void wait();
+
+private:
+    ThreadWorker* worker_;
+    ThreadGroup* group_;
+    volatile int pending_;
+    volatile int failed_;
+    std::string error_message_;
+
+    void run_one(const Task& task);
+
+    friend class ThreadGroup;
 };
 
 }
@@ -6,9 +6,10 @@
  */
 
 #include <vector>
+#include <deque>
 #include <set>
+#include <algorithm>
 #include "boost-xtime.hpp"
-#include <boost/asio/io_service.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/bind.hpp>
 #include <boost/thread.hpp>
@@ -19,37 +20,63 @@
 
 namespace npge {
 
-// http://stackoverflow.com/a/19500405
-
 typedef boost::mutex Mutex;
 typedef boost::mutex::scoped_lock Lock;
 typedef boost::condition_variable Condition;
-typedef boost::asio::io_service IoService;
-typedef boost::asio::io_service::work Work;
+typedef std::deque<ThreadWorker*> WorkersQueue;
 typedef std::set<ThreadWorker*> WorkersSet;
 
 struct ThreadPoolImpl {
-    IoService io_service_;
     boost::thread_group threads_;
-    Work work_;
 
+    // posted workers, not started yet
+    WorkersQueue queue_;
     WorkersSet finished_;
-    Mutex finished_mutex_;
+    bool stop_;
+    Mutex mutex_;
+    Condition queue_condition_;
     Condition finished_condition_;
 
     ThreadPoolImpl():
-        work_(io_service_) {
+        stop_(false) {
         int cores = boost::thread::hardware_concurrency();
         for (int i = 0; i < cores - 1; i++) {
-            threads_.create_thread(boost::bind(&IoService::run,
-                                               &io_service_));
+            threads_.create_thread(boost::bind(&ThreadPoolImpl::run,
+                                               this));
         }
     }
 
     ~ThreadPoolImpl() {
-        io_service_.stop();
+        {
+            Lock lock(mutex_);
+            stop_ = true;
+        }
+        queue_condition_.notify_all();
         threads_.join_all();
     }
+
+    void run() {
+        while (true) {
+            ThreadWorker* worker;
+            {
+                Lock lock(mutex_);
+                while (queue_.empty() && !stop_) {
+                    queue_condition_.wait(lock);
+                }
+                if (stop_) {
+                    return;
+                }
+                worker = queue_.front();
+                queue_.pop_front();
+            }
+            worker->perform();
+            {
+                Lock lock(mutex_);
+                finished_.insert(worker);
+            }
+            finished_condition_.notify_all();
+        }
+    }
 };
 
 struct ThreadPool::Impl : public ThreadPoolImpl {
@@ -64,29 +91,27 @@ ThreadPool::~ThreadPool() {
     impl_ = 0;
 }
 
-static void do_w(ThreadPoolImpl* impl, ThreadWorker* worker) {
-    worker->perform();
-    {
-        Lock lock(impl->finished_mutex_);
-        impl->finished_.insert(worker);
-    }
-    impl->finished_condition_.notify_all();
-}
-
 void ThreadPool::post(ThreadWorker* worker) {
-    if (impl_->threads_.size() == 0) {
-        // one core, no threads
-        return;
+    {
+        Lock lock(impl_->mutex_);
+        impl_->queue_.push_back(worker);
     }
-    impl_->io_service_.post(boost::bind(do_w, impl_, worker));
+    impl_->queue_condition_.notify_one();
 }
 
 void ThreadPool::wait(ThreadWorker* worker) {
-    if (impl_->threads_.size() == 0) {
-        // one core, no threads
+    Lock lock(impl_->mutex_);
+    WorkersQueue& queue = impl_->queue_;
+    WorkersQueue::iterator it = std::find(queue.begin(),
+                                          queue.end(), worker);
+    if (it != queue.end()) {
+        // not started: all threads are busy (maybe waiting for
+        // this worker from nested thread group) or no threads
+        queue.erase(it);
+        lock.unlock();
+        worker->perform();
         return;
     }
-    Lock lock(impl_->finished_mutex_);
     WorkersSet& finished = impl_->finished_;
     while (finished.find(worker) == finished.end()) {
         impl_->finished_condition_.wait(lock);
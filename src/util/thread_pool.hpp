@@ -26,7 +26,10 @@ public:
     /** Run worker in thread */
     void post(ThreadWorker* worker);
 
-    /** Block current thread until this worker has finished */
+    /** Block current thread until this worker has finished.
+    If the worker has not been started yet, it is
+    performed in current thread.
+    */
     void wait(ThreadWorker* worker);
 
     /** Return global thread pool */
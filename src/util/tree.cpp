@@ -9,10 +9,14 @@
 #include <vector>
 #include <sstream>
 #include <set>
+#include <limits>
 #include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
 #include <boost/algorithm/string/join.hpp>
 
 #include "tree.hpp"
+#include "simple_task.hpp"
 #include "Exception.hpp"
 #include "throw_assert.hpp"
 
@@ -282,13 +286,41 @@ private:
     TreeNode* b_;
 };
 
+typedef std::vector<double> Doubles;
+
+static void leaf_distances_rows(Doubles& d, const Leafs& leafs,
+                                int first, int last) {
+    int n = leafs.size();
+    for (int i = first; i < last; i++) {
+        for (int j = i + 1; j < n; j++) {
+            double distance = leafs[i]->distance_to(leafs[j]);
+            d[i * n + j] = distance;
+            d[j * n + i] = distance;
+        }
+    }
+}
+
+/* Dense matrix of distances between leafs.
+Rows are calculated in parallel inside a worker (spawn_ranges).
+*/
+static void leaf_distances(Doubles& d, const Leafs& leafs) {
+    int n = leafs.size();
+    d.assign(n * n, 0.0);
+    const int MIN_ROWS = 16;
+    spawn_ranges(n, MIN_ROWS, boost::bind(leaf_distances_rows,
+                                          boost::ref(d),
+                                          boost::cref(leafs), _1, _2));
+}
+
 static void build_distances(Distances& distances, Leafs& leafs) {
-    for (int i = 0; i < leafs.size(); i++) {
+    int n = leafs.size();
+    Doubles d;
+    leaf_distances(d, leafs);
+    for (int i = 0; i < n; i++) {
         LeafNode* leaf_i = leafs[i];
-        for (int j = i + 1; j < leafs.size(); j++) {
+        for (int j = i + 1; j < n; j++) {
             LeafNode* leaf_j = leafs[j];
-            double distance = leaf_i->distance_to(leaf_j);
-            distances[make_pair(leaf_i, leaf_j)] = distance;
+            distances[make_pair(leaf_i, leaf_j)] = d[i * n + j];
         }
     }
 }
@@ -357,97 +389,245 @@ void TreeNode::upgma() {
     ASSERT_EQ(nodes.size(), 1);
 }
 
-static void calculate_q(Distances& Q, Distances& distances, Nodes& nodes) {
-    for (int i = 0; i < nodes.size(); i++) {
-        TreeNode* node_i = nodes[i];
-        for (int j = i + 1; j < nodes.size(); j++) {
-            TreeNode* node_j = nodes[j];
-            double distance = (nodes.size() - 2.0) *
-                              distances[make_pair(node_i, node_j)];
-            for (int k = 0; k < nodes.size(); k++) {
-                TreeNode* node_k = nodes[k];
-                distance -= distances[make_pair(node_i, node_k)];
-                distance -= distances[make_pair(node_j, node_k)];
+/* Neighbor joining on dense distance matrix.
+Node is stored in slot; joined node takes slot of one of
+its children. Each row is sorted by distance once, when its node
+appears. A pair of nodes is found in the row of younger node.
+Q(i, j) >= (n - 2) * d(i, j) - sum(i) - max_sum, so scanning of
+sorted row stops when this bound exceeds current minimum of Q
+(RapidNJ). Ties are resolved in favour of older nodes, like in
+plain implementation iterating all pairs.
+*/
+class NeighborJoining {
+public:
+    NeighborJoining(TreeNode* tree, const Leafs& leafs, int workers):
+        tree_(tree), n_(leafs.size()),
+        nodes_(leafs.begin(), leafs.end()), rank_(n_),
+        sums_(n_, 0.0), rows_(n_), workers_(workers) {
+        leaf_distances(d_, leafs);
+        for (int i = 0; i < n_; i++) {
+            for (int j = i + 1; j < n_; j++) {
+                double distance = d(i, j);
+                sums_[i] += distance;
+                sums_[j] += distance;
+            }
+            rank_[i] = i;
+        }
+        next_rank_ = n_;
+        for (int i = 0; i < n_; i++) {
+            for (int j = 0; j < i; j++) {
+                rows_[i].push_back(Cell(d(i, j), j, rank_[j]));
             }
-            Q[make_pair(node_i, node_j)] = distance;
+            std::sort(rows_[i].begin(), rows_[i].end());
+        }
+        for (int i = 0; i < n_; i++) {
+            alive_.push_back(i);
         }
     }
-}
 
-static double distance_to_first(const Pair& min_pair,
-                                Distances& distances, Nodes& nodes) {
-    double min_distance = distances[min_pair];
-    double s = 0;
-    TreeNode* node_i = min_pair.first;
-    TreeNode* node_j = min_pair.second;
-    for (int k = 0; k < nodes.size(); k++) {
-        TreeNode* node_k = nodes[k];
-        if (node_k != node_i && node_k != node_j) {
-            s += distances[make_pair(node_i, node_k)];
-            s -= distances[make_pair(node_j, node_k)];
-        }
-    }
-    double dist;
-    if (nodes.size() > 2) {
-        dist = 0.5 * min_distance + 0.5 * s / (nodes.size() - 2);
-    } else {
-        dist = 0.5 * min_distance;
-    }
-    if (dist < 0.0) {
-        dist = 0.0;
+    void run() {
+        while (alive_.size() > 3) {
+            join(find_min());
+        }
+        ASSERT_EQ(alive_.size(), 3);
+        int s0 = alive_[0], s1 = alive_[1], s2 = alive_[2];
+        double l0 = distance_to_first(s0, s1);
+        double l1 = d(s0, s1) - l0;
+        double l2 = distance_to_pair(s0, s1, s2);
+        nodes_[s0]->set_length(l0);
+        nodes_[s1]->set_length(l1);
+        nodes_[s2]->set_length(l2);
     }
-    if (dist > min_distance) {
-        dist = min_distance;
+
+private:
+    struct Cell {
+        double distance_;
+        int slot_;
+        int rank_;
+
+        Cell(double distance, int slot, int rank):
+            distance_(distance), slot_(slot), rank_(rank) {
+        }
+
+        bool operator<(const Cell& other) const {
+            return distance_ < other.distance_ ||
+                   (distance_ == other.distance_ && rank_ < other.rank_);
+        }
+    };
+
+    struct Candidate {
+        double q_;
+        int older_; // rank
+        int younger_; // rank
+        int slot_a_;
+        int slot_b_;
+
+        Candidate():
+            q_(std::numeric_limits<double>::infinity()),
+            older_(-1), younger_(-1), slot_a_(-1), slot_b_(-1) {
+        }
+
+        bool found() const {
+            return slot_a_ != -1;
+        }
+
+        bool operator<(const Candidate& other) const {
+            if (!other.found()) {
+                return found();
+            }
+            if (!found()) {
+                return false;
+            }
+            return q_ < other.q_ || (q_ == other.q_ &&
+                   (older_ < other.older_ || (older_ == other.older_ &&
+                           younger_ < other.younger_)));
+        }
+    };
+
+    TreeNode* tree_;
+    int n_;
+    std::vector<double> d_;
+    std::vector<TreeNode*> nodes_; // 0 if slot is free
+    std::vector<int> rank_;
+    std::vector<double> sums_;
+    std::vector<std::vector<Cell> > rows_;
+    std::vector<int> alive_; // slots in order of rank
+    int next_rank_;
+    int workers_;
+
+    double d(int a, int b) const {
+        return d_[a * n_ + b];
+    }
+
+    void search_rows(int first, int last, double max_sum,
+                     Candidate& best) const {
+        double n2 = alive_.size() - 2.0;
+        for (int index = first; index < last; index++) {
+            int i = alive_[index];
+            double sum_i = sums_[i];
+            BOOST_FOREACH (const Cell& cell, rows_[i]) {
+                double bound = n2 * cell.distance_ - sum_i - max_sum;
+                if (best.found() && bound > best.q_) {
+                    break;
+                }
+                int j = cell.slot_;
+                if (!nodes_[j] || rank_[j] != cell.rank_) {
+                    continue;
+                }
+                Candidate c;
+                c.q_ = n2 * cell.distance_ - sum_i - sums_[j];
+                c.older_ = rank_[j];
+                c.younger_ = rank_[i];
+                c.slot_a_ = j;
+                c.slot_b_ = i;
+                if (c < best) {
+                    best = c;
+                }
+            }
+        }
     }
-    return dist;
-}
 
-static double distance_to_pair(const Pair& min_pair,
-                               Distances& distances, TreeNode* node_k) {
-    double min_distance = distances[min_pair];
-    double dist_f = distances[make_pair(min_pair.first, node_k)];
-    double dist_s = distances[make_pair(min_pair.second, node_k)];
-    return 0.5 * (dist_f + dist_s - min_distance);
-}
+    Candidate find_min() const {
+        double max_sum = -std::numeric_limits<double>::infinity();
+        BOOST_FOREACH (int i, alive_) {
+            max_sum = std::max(max_sum, sums_[i]);
+        }
+        int size = alive_.size();
+        const int MIN_ROWS = 64;
+        int parts = std::min(workers_, size / MIN_ROWS);
+        if (parts <= 1) {
+            Candidate best;
+            search_rows(0, size, max_sum, best);
+            return best;
+        }
+        std::vector<Candidate> bests(parts);
+        Tasks tasks;
+        for (int p = 0; p < parts; p++) {
+            int first = size * p / parts;
+            int last = size * (p + 1) / parts;
+            tasks.push_back(boost::bind(&NeighborJoining::search_rows,
+                                        this, first, last, max_sum,
+                                        boost::ref(bests[p])));
+        }
+        do_tasks(tasks_to_generator(tasks), workers_);
+        return *std::min_element(bests.begin(), bests.end());
+    }
+
+    double distance_to_first(int a, int b) const {
+        double min_distance = d(a, b);
+        // sum of d(a, k) - d(b, k) for k other than a, b
+        double s = sums_[a] - sums_[b];
+        double dist = 0.5 * min_distance +
+                      0.5 * s / (alive_.size() - 2);
+        if (dist < 0.0) {
+            dist = 0.0;
+        }
+        if (dist > min_distance) {
+            dist = min_distance;
+        }
+        return dist;
+    }
 
-static void neighbor_joining_round(TreeNode* tree, Distances& distances,
-                                   Nodes& nodes) {
-    Distances Q;
-    calculate_q(Q, distances, nodes);
-    Pair min_pair = find_min_pair(Q, nodes);
-    if (!min_pair.first || !min_pair.second) {
-        throw Exception("No min element of Q for neighbor joining");
+    double distance_to_pair(int a, int b, int k) const {
+        return 0.5 * (d(a, k) + d(b, k) - d(a, b));
     }
-    TreeNode* new_node = new TreeNode;
-    tree->add_child(new_node);
-    new_node->add_child(min_pair.first);
-    new_node->add_child(min_pair.second);
-    double min_distance = distances[min_pair];
-    double distance_to_left = distance_to_first(min_pair, distances, nodes);
-    double distance_to_right = min_distance - distance_to_left;
-    min_pair.first->set_length(distance_to_left);
-    min_pair.second->set_length(distance_to_right);
-    for (int k = 0; k < nodes.size(); k++) {
-        TreeNode* node_k = nodes[k];
-        if (node_k != min_pair.first && node_k != min_pair.second) {
-            double d = distance_to_pair(min_pair, distances, node_k);
-            distances[make_pair(new_node, node_k)] = d;
-            distances.erase(make_pair(min_pair.first, node_k));
-            distances.erase(make_pair(min_pair.second, node_k));
+
+    void join(const Candidate& c) {
+        if (!c.found()) {
+            throw Exception("No min element of Q for neighbor joining");
         }
+        int a = c.slot_a_;
+        int b = c.slot_b_;
+        TreeNode* first = nodes_[a];
+        TreeNode* second = nodes_[b];
+        double distance_to_a = distance_to_first(a, b);
+        TreeNode* new_node = new TreeNode;
+        tree_->add_child(new_node);
+        // order of children does not depend on order of search
+        if (second < first) {
+            std::swap(first, second);
+        }
+        new_node->add_child(first);
+        new_node->add_child(second);
+        nodes_[a]->set_length(distance_to_a);
+        nodes_[b]->set_length(d(a, b) - distance_to_a);
+        // new node takes slot a
+        int new_slot = a;
+        std::vector<double> new_d(n_, 0.0);
+        double new_sum = 0.0;
+        std::vector<int> new_alive;
+        BOOST_FOREACH (int k, alive_) {
+            if (k != a && k != b) {
+                double dk = distance_to_pair(a, b, k);
+                new_d[k] = dk;
+                new_sum += dk;
+                sums_[k] += dk - d(a, k) - d(b, k);
+                new_alive.push_back(k);
+            }
+        }
+        BOOST_FOREACH (int k, new_alive) {
+            d_[new_slot * n_ + k] = new_d[k];
+            d_[k * n_ + new_slot] = new_d[k];
+        }
+        nodes_[b] = 0;
+        std::vector<Cell>().swap(rows_[b]);
+        nodes_[new_slot] = new_node;
+        rank_[new_slot] = next_rank_++;
+        sums_[new_slot] = new_sum;
+        std::vector<Cell>& row = rows_[new_slot];
+        row.clear();
+        BOOST_FOREACH (int k, new_alive) {
+            row.push_back(Cell(new_d[k], k, rank_[k]));
+        }
+        std::sort(row.begin(), row.end());
+        new_alive.push_back(new_slot);
+        alive_.swap(new_alive);
     }
-    distances.erase(min_pair);
-    nodes.erase(std::remove_if(nodes.begin(), nodes.end(),
-                               IfRemove(min_pair.first, min_pair.second)),
-                nodes.end());
-    nodes.push_back(new_node);
-}
+};
 
-void TreeNode::neighbor_joining() {
+void TreeNode::neighbor_joining(int workers) {
     Leafs leafs;
     all_leafs(leafs);
-    Distances distances;
-    build_distances(distances, leafs);
     BOOST_FOREACH (LeafNode* leaf, leafs) {
         leaf->detach();
     }
@@ -455,28 +635,18 @@ void TreeNode::neighbor_joining() {
     BOOST_FOREACH (LeafNode* leaf, leafs) {
         add_child(leaf);
     }
-    Nodes nodes(leafs.begin(), leafs.end());
-    if (nodes.size() == 0) {
+    if (leafs.size() == 0) {
         return;
-    } else if (nodes.size() == 1) {
+    } else if (leafs.size() == 1) {
         return;
-    } else if (nodes.size() == 2) {
-        double d = distances[make_pair(nodes[0], nodes[1])];
-        nodes[0]->set_length(d / 2.0);
-        nodes[1]->set_length(d / 2.0);
+    } else if (leafs.size() == 2) {
+        double d = leafs[0]->distance_to(leafs[1]);
+        leafs[0]->set_length(d / 2.0);
+        leafs[1]->set_length(d / 2.0);
         return;
     }
-    for (int round = 0; round < int(leafs.size()) - 3; round++) {
-        neighbor_joining_round(this, distances, nodes);
-    }
-    ASSERT_EQ(nodes.size(), 3);
-    Pair pair01 = make_pair(nodes[0], nodes[1]);
-    double l0 = distance_to_first(pair01, distances, nodes);
-    double l1 = distances[pair01] - l0;
-    double l2 = distance_to_pair(pair01, distances, nodes[2]);
-    pair01.first->set_length(l0);
-    pair01.second->set_length(l1);
-    nodes[2]->set_length(l2);
+    NeighborJoining nj(this, leafs, workers);
+    nj.run();
 }
 
 void TreeNode::branch_table(BranchTable& table, const Leafs& leafs,
@@ -494,6 +664,73 @@ void TreeNode::branch_table(BranchTable& table, const Leafs& leafs,
     }
 }
 
+typedef std::map<const TreeNode*, int> LeafIndex;
+
+/* Set bits of leafs of node (except node) to bits, add branches
+of descendants to table. Return number of leafs except node.
+Element 0 of bits is not used. */
+static int add_branch_bits(const TreeNode* node, const LeafIndex& index,
+                           int leafs_size, double weight,
+                           BranchBits& bits, BranchBitsTable& table) {
+    int count = 0;
+    BranchBits child_bits(bits.size());
+    BOOST_FOREACH (const TreeNode* child, node->children()) {
+        std::fill(child_bits.begin(), child_bits.end(), 0);
+        int sub_leafs = add_branch_bits(child, index, leafs_size,
+                                        weight, child_bits, table);
+        if (sub_leafs >= 2 && leafs_size - sub_leafs >= 2) {
+            BranchBits key = child_bits;
+            if (key[1] & 1) {
+                for (int w = 1; w < key.size(); w++) {
+                    key[w] = ~key[w];
+                }
+                int tail = leafs_size % 64;
+                if (tail) {
+                    key.back() &= (uint64_t(1) << tail) - 1;
+                }
+            }
+            key[0] = leafs_size;
+            table[key] += child->length() * weight;
+        }
+        if (dynamic_cast<const LeafNode*>(child)) {
+            sub_leafs += 1;
+        }
+        count += sub_leafs;
+        for (int w = 1; w < bits.size(); w++) {
+            bits[w] |= child_bits[w];
+        }
+        LeafIndex::const_iterator it = index.find(child);
+        if (it != index.end()) {
+            int i = it->second;
+            bits[1 + i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+    return count;
+}
+
+void TreeNode::branch_bits_table(BranchBitsTable& table,
+                                 const Leafs& leafs,
+                                 double weight) const {
+    LeafIndex index;
+    for (int i = 0; i < leafs.size(); i++) {
+        index[leafs[i]] = i;
+    }
+    BranchBits bits(1 + (leafs.size() + 63) / 64);
+    add_branch_bits(this, index, leafs.size(), weight, bits, table);
+}
+
+std::string TreeNode::branch_bits_to_str(const BranchBits& bits) {
+    ASSERT_GT(bits.size(), 0);
+    int leafs_size = bits[0];
+    std::string result(leafs_size, '0');
+    for (int i = 0; i < leafs_size; i++) {
+        if ((bits[1 + i / 64] >> (i % 64)) & 1) {
+            result[i] = '1';
+        }
+    }
+    return result;
+}
+
 static std::string make_subbranch(const std::string& child,
         const std::string& parent, char parent_char) {
     ASSERT_EQ(child.size(), parent.size());
@@ -8,10 +8,12 @@
 #ifndef NPGE_TREE_HPP_
 #define NPGE_TREE_HPP_
 
+#include <stdint.h>
 #include <iosfwd>
 #include <map>
 #include <vector>
 #include <boost/utility.hpp>
+#include <boost/unordered_map.hpp>
 
 namespace npge {
 
@@ -24,6 +26,14 @@ typedef std::map<std::string, double> BranchTable;
 // branch is a sequence of 0 and 1 (first is 0)
 // 0 and 1 mark two sets of leafs
 
+/** Branch encoded as bits.
+First element is number of leafs, then bits follow,
+64 leafs per word. Bit i corresponds to leafs[i],
+bit of leafs[0] is 0.
+*/
+typedef std::vector<uint64_t> BranchBits;
+typedef boost::unordered_map<BranchBits, double> BranchBitsTable;
+
 class TreeNode : boost::noncopyable {
 public:
     enum ShowBootstrap {
@@ -100,13 +110,32 @@ public:
     std::string newick(bool lengthes = true,
                        ShowBootstrap sbs = NO_BOOTSTRAP) const;
 
+    /** Build tree of leafs using UPGMA.
+    See neighbor_joining() about calls of distance_to.
+    */
     void upgma();
 
-    void neighbor_joining();
+    /** Build tree of leafs using neighbor joining.
+    \param workers Number of threads searching for pairs to join.
+    Method distance_to of leafs is called from this thread,
+    or, if this thread is a worker of thread group,
+    from spawned tasks (see spawn_ranges), so it must be
+    thread-safe.
+    */
+    void neighbor_joining(int workers = 1);
 
     void branch_table(BranchTable& table, const Leafs& leafs,
                       double weight) const;
 
+    /** Same as branch_table, but branches are encoded as bits.
+    Leaf sets of all branches are built in one pass over the tree.
+    */
+    void branch_bits_table(BranchBitsTable& table, const Leafs& leafs,
+                           double weight) const;
+
+    /** Convert branch from bits to string of '0' and '1' */
+    static std::string branch_bits_to_str(const BranchBits& bits);
+
     /** Build tree from branch information.
     Conflicting branches with lower weight  are discarded.
     */